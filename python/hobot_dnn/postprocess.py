@@ -0,0 +1,338 @@
+'''
+COPYRIGHT NOTICE
+Copyright 2024 D-Robotics, Inc.
+All rights reserved.
+'''
+# libpostprocess.so 后处理插件注册表的 Python 接口
+#
+# 每个模型实例创建一个 PostProcessor，检测结果和中间缓存都保存在各自的上下文
+# 里，不同实例可以在不同线程中同时使用，同一个实例同一时间只能在一个线程中使用。
+# tensors 为 hbDNNTensor 的 ctypes 数组（和 libpostprocess 原有接口的用法相同）。
+#
+# yolov8_seg 输出的实例 mask 为裁剪后的游程编码，用 decode_mask 转换成数组。
+#
+# classification_topk 不经过 JSON，直接返回每个样本得分最高的类别，
+# 适合每帧对大量目标做分类的场景。
+#
+# ObjectTracker 为多目标跟踪，直接使用 PostProcessor.emit 输出的检测结果，
+# 检测可以隔帧运行，没有检测的帧由跟踪预测目标位置。
+
+import ctypes
+
+_LIB_NAME = 'libpostprocess.so'
+
+
+class PostProcessInfo(ctypes.Structure):
+    _fields_ = [
+        ('height', ctypes.c_int),
+        ('width', ctypes.c_int),
+        ('ori_height', ctypes.c_int),
+        ('ori_width', ctypes.c_int),
+        ('score_threshold', ctypes.c_float),
+        ('nms_threshold', ctypes.c_float),
+        ('nms_top_k', ctypes.c_int),
+        ('is_pad_resize', ctypes.c_int),
+    ]
+
+
+class ClassificationResult(ctypes.Structure):
+    _fields_ = [
+        ('id', ctypes.c_int),
+        ('score', ctypes.c_float),
+    ]
+
+
+class TrackerBox(ctypes.Structure):
+    _fields_ = [
+        ('xmin', ctypes.c_float),
+        ('ymin', ctypes.c_float),
+        ('xmax', ctypes.c_float),
+        ('ymax', ctypes.c_float),
+        ('score', ctypes.c_float),
+        ('id', ctypes.c_int),
+    ]
+
+
+class TrackerTrack(ctypes.Structure):
+    _fields_ = [
+        ('track_id', ctypes.c_int),
+        ('class_id', ctypes.c_int),
+        ('score', ctypes.c_float),
+        ('xmin', ctypes.c_float),
+        ('ymin', ctypes.c_float),
+        ('xmax', ctypes.c_float),
+        ('ymax', ctypes.c_float),
+        ('predicted', ctypes.c_int),
+        ('hits', ctypes.c_int),
+    ]
+
+
+class TrackerConfig(ctypes.Structure):
+    _fields_ = [
+        ('high_threshold', ctypes.c_float),
+        ('low_threshold', ctypes.c_float),
+        ('new_track_threshold', ctypes.c_float),
+        ('match_iou', ctypes.c_float),
+        ('low_match_iou', ctypes.c_float),
+        ('min_hits', ctypes.c_int),
+        ('max_age', ctypes.c_int),
+        ('class_aware', ctypes.c_int),
+        ('detect_interval', ctypes.c_int),
+        ('max_detect_interval', ctypes.c_int),
+        ('motion_threshold', ctypes.c_float),
+    ]
+
+
+_lib = None
+
+
+def _load(path=None):
+    global _lib
+    if _lib is not None and path is None:
+        return _lib
+    lib = ctypes.CDLL(path or _LIB_NAME)
+    lib.PostProcessPluginNames.argtypes = [
+        ctypes.POINTER(ctypes.c_char_p), ctypes.c_int]
+    lib.PostProcessPluginNames.restype = ctypes.c_int
+    lib.PostProcessCreate.argtypes = [ctypes.c_char_p]
+    lib.PostProcessCreate.restype = ctypes.c_void_p
+    lib.PostProcessDecode.argtypes = [
+        ctypes.c_void_p, ctypes.c_void_p, ctypes.c_int,
+        ctypes.POINTER(PostProcessInfo), ctypes.c_int]
+    lib.PostProcessDecode.restype = ctypes.c_int
+    lib.PostProcessDecodeLayers.argtypes = [
+        ctypes.c_void_p, ctypes.c_void_p, ctypes.POINTER(ctypes.c_int),
+        ctypes.c_int, ctypes.c_int, ctypes.POINTER(PostProcessInfo)]
+    lib.PostProcessDecodeLayers.restype = ctypes.c_int
+    lib.PostProcessSetThreadNum.argtypes = [ctypes.c_int]
+    lib.PostProcessSetThreadNum.restype = ctypes.c_int
+    lib.PostProcessGetThreadNum.argtypes = []
+    lib.PostProcessGetThreadNum.restype = ctypes.c_int
+    lib.PostProcessEmit.argtypes = [
+        ctypes.c_void_p, ctypes.POINTER(PostProcessInfo)]
+    # 返回的字符串需要用 PostProcessFreeResult 释放，不能让 ctypes 转换
+    lib.PostProcessEmit.restype = ctypes.c_void_p
+    lib.PostProcessFreeResult.argtypes = [ctypes.c_void_p]
+    lib.PostProcessFreeResult.restype = None
+    lib.PostProcessDestroy.argtypes = [ctypes.c_void_p]
+    lib.PostProcessDestroy.restype = None
+    lib.ClassificationTopK.argtypes = [
+        ctypes.c_void_p, ctypes.c_int, ctypes.POINTER(PostProcessInfo),
+        ctypes.c_int, ctypes.POINTER(ClassificationResult),
+        ctypes.POINTER(ctypes.c_int), ctypes.c_int]
+    lib.ClassificationTopK.restype = ctypes.c_int
+    lib.ClassificationLabelName.argtypes = [ctypes.c_int]
+    lib.ClassificationLabelName.restype = ctypes.c_char_p
+    lib.ObjectTrackerDefaultConfig.argtypes = [ctypes.POINTER(TrackerConfig)]
+    lib.ObjectTrackerDefaultConfig.restype = None
+    lib.ObjectTrackerCreate.argtypes = [ctypes.POINTER(TrackerConfig)]
+    lib.ObjectTrackerCreate.restype = ctypes.c_void_p
+    lib.ObjectTrackerDestroy.argtypes = [ctypes.c_void_p]
+    lib.ObjectTrackerDestroy.restype = None
+    lib.ObjectTrackerShouldDetect.argtypes = [ctypes.c_void_p]
+    lib.ObjectTrackerShouldDetect.restype = ctypes.c_int
+    lib.ObjectTrackerUpdate.argtypes = [
+        ctypes.c_void_p, ctypes.POINTER(TrackerBox), ctypes.c_int]
+    lib.ObjectTrackerUpdate.restype = ctypes.c_int
+    lib.ObjectTrackerPredict.argtypes = [ctypes.c_void_p]
+    lib.ObjectTrackerPredict.restype = ctypes.c_int
+    lib.ObjectTrackerGetTracks.argtypes = [
+        ctypes.c_void_p, ctypes.POINTER(TrackerTrack), ctypes.c_int]
+    lib.ObjectTrackerGetTracks.restype = ctypes.c_int
+    lib.ObjectTrackerParseResult.argtypes = [
+        ctypes.c_char_p, ctypes.POINTER(TrackerBox), ctypes.c_int]
+    lib.ObjectTrackerParseResult.restype = ctypes.c_int
+    _lib = lib
+    return lib
+
+
+def plugin_names(lib_path=None):
+    lib = _load(lib_path)
+    num = lib.PostProcessPluginNames(None, 0)
+    names = (ctypes.c_char_p * num)()
+    lib.PostProcessPluginNames(names, num)
+    return [name.decode() for name in names]
+
+
+def set_thread_num(thread_num, lib_path=None):
+    '''decode_layers 使用的线程数（包括调用线程），所有 PostProcessor 共用'''
+    if _load(lib_path).PostProcessSetThreadNum(thread_num) != 0:
+        raise ValueError('invalid thread num: %d' % thread_num)
+
+
+def get_thread_num(lib_path=None):
+    return _load(lib_path).PostProcessGetThreadNum()
+
+
+def decode_mask(mask):
+    '''解码 yolov8_seg 检测结果中的 "mask" 字段
+
+    返回 (rect, bitmap)：rect 为 mask 覆盖区域在原图上的 [xmin, ymin, xmax, ymax]，
+    bitmap 为原型分辨率的 uint8 数组 (height, width)，需要原图分辨率时把
+    bitmap 缩放到 rect 的大小
+    '''
+    import numpy as np
+    width, height = mask['size']
+    values = np.zeros(len(mask['rle']), dtype=np.uint8)
+    values[1::2] = 1
+    bitmap = np.repeat(values, mask['rle'])
+    return mask['rect'], bitmap.reshape(height, width)
+
+
+def classification_topk(tensors, tensor_num, max_samples, info=None,
+                        apply_softmax=False, lib_path=None):
+    '''分类模型的 top-k，tensors 中所有输出的所有样本依次处理
+
+    info.nms_top_k 为每个样本最多返回的类别数，info.score_threshold 为得分阈值，
+    apply_softmax 为 True 表示模型输出为 logits。返回每个样本一个列表，
+    元素为 {"id", "score", "name"}，按得分从大到小排列
+    '''
+    lib = _load(lib_path)
+    if info is None:
+        info = PostProcessInfo(score_threshold=0.0, nms_top_k=5)
+    top_k = max(info.nms_top_k, 0)
+    results = (ClassificationResult * max(max_samples * top_k, 1))()
+    result_num = (ctypes.c_int * max(max_samples, 1))()
+    num = lib.ClassificationTopK(
+        ctypes.cast(tensors, ctypes.c_void_p), tensor_num, ctypes.byref(info),
+        int(apply_softmax), results, result_num, max_samples)
+    if num < 0:
+        raise RuntimeError('classification top-k failed')
+    samples = []
+    for i in range(num):
+        classes = []
+        for r in results[i * top_k:i * top_k + result_num[i]]:
+            name = lib.ClassificationLabelName(r.id)
+            classes.append({'id': r.id, 'score': r.score,
+                            'name': name.decode() if name else None})
+        samples.append(classes)
+    return samples
+
+
+class PostProcessor(object):
+    def __init__(self, name, info=None, lib_path=None):
+        self._context = None
+        self._lib = _load(lib_path)
+        self._context = self._lib.PostProcessCreate(name.encode())
+        if not self._context:
+            raise ValueError('post process plugin %s not found' % name)
+        self.name = name
+        self.info = info if info is not None else PostProcessInfo()
+
+    def decode(self, tensors, tensor_num, layer=0):
+        '''解码一个输出层，tensors 为这一层使用的 tensor_num 个 hbDNNTensor'''
+        ret = self._lib.PostProcessDecode(
+            self._context, ctypes.cast(tensors, ctypes.c_void_p),
+            tensor_num, ctypes.byref(self.info), layer)
+        if ret != 0:
+            raise RuntimeError('%s decode layer %d failed' % (self.name, layer))
+
+    def decode_layers(self, tensors, tensor_num, layer_num, tensor_index=None):
+        '''多线程解码 layer_num 层，结果和依次调用 decode 相同
+
+        tensor_index 为每层使用的 tensor 下标（layer_num * tensor_num 个），
+        为 None 时每层按顺序连续使用 tensor_num 个
+        '''
+        index = None
+        if tensor_index is not None:
+            if len(tensor_index) != tensor_num * layer_num:
+                raise ValueError('tensor_index needs %d items' %
+                                 (tensor_num * layer_num))
+            index = (ctypes.c_int * len(tensor_index))(*tensor_index)
+        ret = self._lib.PostProcessDecodeLayers(
+            self._context, ctypes.cast(tensors, ctypes.c_void_p), index,
+            tensor_num, layer_num, ctypes.byref(self.info))
+        if ret != 0:
+            raise RuntimeError('%s decode layers failed' % self.name)
+
+    def emit(self):
+        '''合并所有层的结果，返回 JSON 字符串并清空上下文中的结果'''
+        result = self._lib.PostProcessEmit(self._context,
+                                           ctypes.byref(self.info))
+        if not result:
+            return None
+        try:
+            return ctypes.string_at(result).decode()
+        finally:
+            self._lib.PostProcessFreeResult(result)
+
+    def close(self):
+        if self._context:
+            self._lib.PostProcessDestroy(self._context)
+            self._context = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __del__(self):
+        self.close()
+
+
+class ObjectTracker(object):
+    '''一路视频的多目标跟踪
+
+    每帧先调用 should_detect()，需要检测时运行推理和后处理，把结果传给
+    update()，否则调用 predict()，然后用 tracks() 获取当前的轨迹
+    '''
+
+    def __init__(self, lib_path=None, **config):
+        self._tracker = None
+        self._lib = _load(lib_path)
+        self.config = TrackerConfig()
+        self._lib.ObjectTrackerDefaultConfig(ctypes.byref(self.config))
+        for key, value in config.items():
+            if key not in dict(TrackerConfig._fields_):
+                raise ValueError('unknown tracker config: %s' % key)
+            setattr(self.config, key, value)
+        self._tracker = self._lib.ObjectTrackerCreate(ctypes.byref(self.config))
+
+    def should_detect(self):
+        return bool(self._lib.ObjectTrackerShouldDetect(self._tracker))
+
+    def update(self, detections):
+        '''detections 为 PostProcessor.emit 返回的字符串，或者同样格式的
+        dict 列表（"bbox"、"score"、"id"）'''
+        if isinstance(detections, str):
+            encoded = detections.encode()
+            num = self._lib.ObjectTrackerParseResult(encoded, None, 0)
+            if num < 0:
+                raise ValueError('parse detection result failed')
+            boxes = (TrackerBox * max(num, 1))()
+            self._lib.ObjectTrackerParseResult(encoded, boxes, num)
+        else:
+            num = len(detections)
+            boxes = (TrackerBox * max(num, 1))()
+            for box, det in zip(boxes, detections):
+                box.xmin, box.ymin, box.xmax, box.ymax = det['bbox']
+                box.score = det['score']
+                box.id = det['id']
+        if self._lib.ObjectTrackerUpdate(self._tracker, boxes, num) != 0:
+            raise RuntimeError('tracker update failed')
+
+    def predict(self):
+        self._lib.ObjectTrackerPredict(self._tracker)
+
+    def tracks(self):
+        num = self._lib.ObjectTrackerGetTracks(self._tracker, None, 0)
+        tracks = (TrackerTrack * max(num, 1))()
+        num = self._lib.ObjectTrackerGetTracks(self._tracker, tracks, num)
+        return [{'track_id': t.track_id, 'id': t.class_id, 'score': t.score,
+                 'bbox': [t.xmin, t.ymin, t.xmax, t.ymax],
+                 'predicted': bool(t.predicted)} for t in tracks[:num]]
+
+    def close(self):
+        if self._tracker:
+            self._lib.ObjectTrackerDestroy(self._tracker)
+            self._tracker = None
+
+    def __enter__(self):
+        return self
+
+    def __exit__(self, *args):
+        self.close()
+
+    def __del__(self):
+        self.close()
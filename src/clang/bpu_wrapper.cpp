@@ -11,12 +11,17 @@
 #include <time.h>
 #include <stdbool.h>
 #include <future>
+#include <pthread.h>
 // #include "vp_bpu.h"
 
 #include "bpu_wrapper.h"
 #include "sp_bpu.h"
 #include "dnn/hb_dnn.h"
+#include "utils/image_preproc.h"
+#include "utils/tensor_pool.h"
+#include "utils/mqueue.h"
 static void print_model_info(hbPackedDNNHandle_t packed_dnn_handle);
+static int hb_bpu_infer(bpu_module *bpu_handle);
 
 #define ALIGN_16(v) ((v + (16 - 1)) / 16 * 16)
 
@@ -77,12 +82,15 @@ bpu_module *hb_bpu_predict_init(const char *model_file_name)
 
     bpu_handle->m_packed_dnn_handle = packed_dnn_handle;
     bpu_handle->m_dnn_handle = dnn_handle;
+    hbDNNGetOutputCount(&bpu_handle->m_output_count, dnn_handle);
 
-    //input size alloc
+    //input size alloc，同一个模型重新加载时复用内存池中的内存
     hbDNNTensorProperties input_properties;
     hbDNNGetInputTensorProperties(&input_properties, bpu_handle->m_dnn_handle, 0);
     bpu_handle->input_tensor.properties = input_properties;
-    hbSysAllocCachedMem(bpu_handle->input_tensor.sysMem, input_properties.validShape.dimensionSize[2] * input_properties.validShape.dimensionSize[3] * 3 / 2);
+    HB_CHECK_SUCCESS(tensor_pool_alloc(model_name_list[0], TENSOR_POOL_INPUT, TENSOR_POOL_INDEX(0, 0),
+                                       input_properties.validShape.dimensionSize[2] * input_properties.validShape.dimensionSize[3] * 3 / 2,
+                                       bpu_handle->input_tensor.sysMem), "tensor_pool_alloc fail");
 
     print_model_info(bpu_handle->m_packed_dnn_handle);
 
@@ -100,6 +108,14 @@ int hb_bpu_init_tensors(bpu_module *bpu_handle, hbDNNTensor *output_tensors)
         printf("[BPU ERR] %s:hbDNNGetOutputCount failed!Error code:%d\n", __func__, ret);
         return ret;
     }
+    const char **model_name_list;
+    int32_t model_count = 0;
+    ret = hbDNNGetModelNameList(&model_name_list, &model_count, bpu_handle->m_packed_dnn_handle);
+    if (ret)
+    {
+        printf("[BPU ERR] %s:hbDNNGetModelNameList failed!Error code:%d\n", __func__, ret);
+        return ret;
+    }
     // output_tensors = new hbDNNTensor[output_count];
     for (int i = 0; i < output_count; i++)
     {
@@ -118,10 +134,10 @@ int hb_bpu_init_tensors(bpu_module *bpu_handle, hbDNNTensor *output_tensors)
                 out_aligned_size * output_properties.alignedShape.dimensionSize[j];
         }
         hbSysMem &mem = output_tensors[i].sysMem[0];
-        ret = hbSysAllocCachedMem(&mem, out_aligned_size);
+        ret = tensor_pool_alloc(model_name_list[0], TENSOR_POOL_OUTPUT, TENSOR_POOL_INDEX(i, 0), out_aligned_size, &mem);
         if (ret)
         {
-            printf("[BPU ERR] %s:hbSysAllocCachedMem failed!Error code:%d\n", __func__, ret);
+            printf("[BPU ERR] %s:tensor_pool_alloc failed!Error code:%d\n", __func__, ret);
             return ret;
         }
     }
@@ -133,7 +149,8 @@ int hb_bpu_deinit_tensor(hbDNNTensor *tensor, int32_t len)
     int32_t ret = -1;
     for (size_t i = 0; i < len; i++)
     {
-        ret = hbSysFreeMem(&(tensor[i].sysMem[0]));
+        tensor_pool_free(&(tensor[i].sysMem[0]));
+        ret = 0;
     }
     return ret;
 }
@@ -145,8 +162,69 @@ int hb_bpu_start_predict(bpu_module *bpu_handle, char *frame_buffer)
     int32_t width = bpu_handle->input_tensor.properties.validShape.dimensionSize[3];
     int32_t yuv_length = height * width * 3 / 2;
     memcpy(bpu_handle->input_tensor.sysMem[0].virAddr, frame_buffer, yuv_length);
-    hbSysFlushMem(bpu_handle->input_tensor.sysMem, HB_SYS_MEM_CACHE_CLEAN);
+    tensor_pool_flush(bpu_handle->input_tensor.sysMem, 0, yuv_length, HB_SYS_MEM_CACHE_CLEAN);
+
+    return hb_bpu_infer(bpu_handle);
+}
+
+int hb_bpu_start_predict_frame(bpu_module *bpu_handle, char *frame_buffer, int32_t width, int32_t height,
+                               int32_t keep_ratio, bpu_transform_t *transform)
+{
+    image_preproc_t *preproc = (image_preproc_t *)bpu_handle->m_preproc;
+    color_nv12_image_t src;
+
+    // 源图像尺寸或者缩放方式变化时重新创建预处理句柄，缩放表只计算一次
+    if (preproc == nullptr || preproc->src_width != width || preproc->src_height != height
+        || preproc->config.keep_ratio != keep_ratio)
+    {
+        image_preproc_config_t config;
+        memset(&config, 0, sizeof(config));
+        config.dst_height = bpu_handle->input_tensor.properties.validShape.dimensionSize[2];
+        config.dst_width = bpu_handle->input_tensor.properties.validShape.dimensionSize[3];
+        config.format = PREPROC_FMT_NV12;
+        config.keep_ratio = keep_ratio;
+        config.center = 1;
+        config.pad_rgb[0] = config.pad_rgb[1] = config.pad_rgb[2] = 114;
+
+        image_preproc_destroy(preproc);
+        preproc = image_preproc_create(width, height, &config);
+        bpu_handle->m_preproc = preproc;
+        if (preproc == nullptr)
+        {
+            printf("[BPU ERR] %s:image_preproc_create failed! %dx%d\n", __func__, width, height);
+            return -1;
+        }
+    }
 
+    memset(&src, 0, sizeof(src));
+    src.y = (const uint8_t *)frame_buffer;
+    src.uv = src.y + width * height;
+    src.width = width;
+    src.height = height;
+
+    uint8_t *dst[3] = {(uint8_t *)bpu_handle->input_tensor.sysMem[0].virAddr, NULL, NULL};
+    if (image_preproc_run(preproc, &src, dst) != 0)
+    {
+        return -1;
+    }
+    tensor_pool_flush(bpu_handle->input_tensor.sysMem, 0, image_preproc_output_size(&preproc->config),
+                      HB_SYS_MEM_CACHE_CLEAN);
+
+    if (transform)
+    {
+        transform->scale_x = preproc->transform.scale_x;
+        transform->scale_y = preproc->transform.scale_y;
+        transform->pad_left = preproc->transform.pad_left;
+        transform->pad_top = preproc->transform.pad_top;
+        transform->crop_x = preproc->transform.crop_x;
+        transform->crop_y = preproc->transform.crop_y;
+    }
+
+    return hb_bpu_infer(bpu_handle);
+}
+
+static int hb_bpu_infer(bpu_module *bpu_handle)
+{
     auto dnn_handle = bpu_handle->m_dnn_handle;
     auto input = bpu_handle->input_tensor;
     hbDNNTaskHandle_t task_handle = nullptr;
@@ -159,7 +237,11 @@ int hb_bpu_start_predict(bpu_module *bpu_handle, char *frame_buffer)
                &infer_ctrl_param);
     // 第七步等待任务结束
     hbDNNWaitTaskDone(task_handle, 0);
-    hbSysFlushMem(&(bpu_handle->output_tensor->sysMem[0]), HB_SYS_MEM_CACHE_INVALIDATE);
+    for (int32_t i = 0; i < bpu_handle->m_output_count; i++)
+    {
+        hbDNNTensor *output = &bpu_handle->output_tensor[i];
+        tensor_pool_flush(&output->sysMem[0], 0, output->properties.alignedByteSize, HB_SYS_MEM_CACHE_INVALIDATE);
+    }
     // 释放task handle
     hbDNNReleaseTask(task_handle);
     return 0;
@@ -167,9 +249,246 @@ int hb_bpu_start_predict(bpu_module *bpu_handle, char *frame_buffer)
 
 int hb_bpu_predict_unint(bpu_module *handle)
 {
-    hbSysFreeMem(&(handle->input_tensor.sysMem[0]));
+    image_preproc_destroy((image_preproc_t *)handle->m_preproc);
+    tensor_pool_free(&(handle->input_tensor.sysMem[0]));
     hbDNNRelease(handle->m_packed_dnn_handle);
     free(handle);
+    tensor_pool_trim(TENSOR_POOL_KEEP_BYTES);
+    return 0;
+}
+
+#define BPU_PIPELINE_MAX_DEPTH 8
+
+// 流水线中的一组输入输出张量
+typedef struct
+{
+    hbDNNTensor input_tensor;
+    hbDNNTensor *output_tensors;
+    hbDNNTaskHandle_t task_handle;
+    void *frame_ctx;
+} bpu_pipeline_slot;
+
+struct bpu_pipeline_s
+{
+    bpu_module *bpu_handle;
+    int32_t depth;
+    bpu_pipeline_slot *slots;
+    tsQueue free_queue;    // 空闲的 slot
+    tsQueue busy_queue;    // 已经提交推理、等待后处理的 slot，NULL 表示退出
+    pthread_t worker;
+    int32_t worker_started;
+    sp_bpu_pipeline_callback callback;
+    void *user_data;
+    int32_t inflight;
+    pthread_mutex_t mutex;
+    pthread_cond_t idle_cond;
+};
+
+// 后处理线程：按提交顺序等待推理完成，调用回调，然后把 slot 还回空闲队列
+static void *bpu_pipeline_worker(void *arg)
+{
+    bpu_pipeline *pipeline = (bpu_pipeline *)arg;
+    int32_t output_count = pipeline->bpu_handle->m_output_count;
+
+    while (1)
+    {
+        void *data = nullptr;
+        mQueueDequeue(&pipeline->busy_queue, &data);
+        bpu_pipeline_slot *slot = (bpu_pipeline_slot *)data;
+        if (slot == nullptr)
+        {
+            break;
+        }
+
+        int32_t ret = hbDNNWaitTaskDone(slot->task_handle, 0);
+        if (ret == 0)
+        {
+            for (int32_t i = 0; i < output_count; i++)
+            {
+                hbDNNTensor *output = &slot->output_tensors[i];
+                tensor_pool_flush(&output->sysMem[0], 0, output->properties.alignedByteSize,
+                                  HB_SYS_MEM_CACHE_INVALIDATE);
+            }
+        }
+        else
+        {
+            printf("[BPU ERR] %s:hbDNNWaitTaskDone failed!Error code:%d\n", __func__, ret);
+        }
+        hbDNNReleaseTask(slot->task_handle);
+        slot->task_handle = nullptr;
+
+        // 推理失败也要回调，调用者通过 status 得知失败并释放 frame_ctx
+        if (ret == 0)
+        {
+            pipeline->callback(0, slot->output_tensors, output_count, slot->frame_ctx, pipeline->user_data);
+        }
+        else
+        {
+            pipeline->callback(ret, nullptr, 0, slot->frame_ctx, pipeline->user_data);
+        }
+        slot->frame_ctx = nullptr;
+
+        mQueueEnqueue(&pipeline->free_queue, slot);
+
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->inflight--;
+        pthread_cond_broadcast(&pipeline->idle_cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+    }
+
+    return nullptr;
+}
+
+static void bpu_pipeline_release_slots(bpu_pipeline *pipeline)
+{
+    for (int32_t i = 0; i < pipeline->depth; i++)
+    {
+        bpu_pipeline_slot *slot = &pipeline->slots[i];
+        tensor_pool_free(&slot->input_tensor.sysMem[0]);
+        if (slot->output_tensors)
+        {
+            hb_bpu_deinit_tensor(slot->output_tensors, pipeline->bpu_handle->m_output_count);
+            free(slot->output_tensors);
+        }
+    }
+    free(pipeline->slots);
+}
+
+bpu_pipeline *hb_bpu_pipeline_create(bpu_module *bpu_handle, int32_t depth,
+                                     sp_bpu_pipeline_callback callback, void *user_data)
+{
+    if (depth < 1 || depth > BPU_PIPELINE_MAX_DEPTH)
+    {
+        printf("[BPU ERR] %s:invalid depth %d, range [1, %d]\n", __func__, depth, BPU_PIPELINE_MAX_DEPTH);
+        return nullptr;
+    }
+
+    bpu_pipeline *pipeline = (bpu_pipeline *)calloc(1, sizeof(bpu_pipeline));
+    if (pipeline == nullptr)
+    {
+        return nullptr;
+    }
+    pipeline->bpu_handle = bpu_handle;
+    pipeline->depth = depth;
+    pipeline->callback = callback;
+    pipeline->user_data = user_data;
+    pthread_mutex_init(&pipeline->mutex, NULL);
+    pthread_cond_init(&pipeline->idle_cond, NULL);
+
+    // 队列中留一个空位区分空和满，退出时 busy_queue 还要放一个 NULL
+    mQueueCreate(&pipeline->free_queue, depth + 1);
+    mQueueCreate(&pipeline->busy_queue, depth + 2);
+
+    const char **model_name_list;
+    int32_t model_count = 0;
+    hbDNNGetModelNameList(&model_name_list, &model_count, bpu_handle->m_packed_dnn_handle);
+
+    // 每个 slot 有自己的输入张量，BPU 读取输入的同时可以写入下一帧
+    hbDNNTensorProperties &input_properties = bpu_handle->input_tensor.properties;
+    int32_t input_size = input_properties.validShape.dimensionSize[2] * input_properties.validShape.dimensionSize[3] * 3 / 2;
+    pipeline->slots = (bpu_pipeline_slot *)calloc(depth, sizeof(bpu_pipeline_slot));
+    int32_t ret = pipeline->slots == nullptr ? -1 : 0;
+    for (int32_t i = 0; i < depth && ret == 0; i++)
+    {
+        bpu_pipeline_slot *slot = &pipeline->slots[i];
+        slot->input_tensor.properties = input_properties;
+        ret = tensor_pool_alloc(model_name_list[0], TENSOR_POOL_INPUT, TENSOR_POOL_INDEX(0, 0),
+                                input_size, &slot->input_tensor.sysMem[0]);
+        if (ret == 0)
+        {
+            slot->output_tensors = (hbDNNTensor *)calloc(bpu_handle->m_output_count, sizeof(hbDNNTensor));
+            ret = slot->output_tensors == nullptr ? -1 : hb_bpu_init_tensors(bpu_handle, slot->output_tensors);
+        }
+        if (ret == 0)
+        {
+            mQueueEnqueue(&pipeline->free_queue, slot);
+        }
+    }
+
+    if (ret == 0 && pthread_create(&pipeline->worker, NULL, bpu_pipeline_worker, pipeline) == 0)
+    {
+        pipeline->worker_started = 1;
+        return pipeline;
+    }
+
+    printf("[BPU ERR] %s:create pipeline failed\n", __func__);
+    if (pipeline->slots)
+    {
+        bpu_pipeline_release_slots(pipeline);
+    }
+    mQueueDestroy(&pipeline->free_queue);
+    mQueueDestroy(&pipeline->busy_queue);
+    pthread_mutex_destroy(&pipeline->mutex);
+    pthread_cond_destroy(&pipeline->idle_cond);
+    free(pipeline);
+    return nullptr;
+}
+
+int hb_bpu_pipeline_submit(bpu_pipeline *pipeline, char *frame_buffer, void *frame_ctx)
+{
+    void *data = nullptr;
+
+    // 没有空闲的 slot 时在这里等待，最多 depth 帧在处理中
+    mQueueDequeue(&pipeline->free_queue, &data);
+    bpu_pipeline_slot *slot = (bpu_pipeline_slot *)data;
+
+    hbDNNTensorProperties &properties = slot->input_tensor.properties;
+    int32_t yuv_length = properties.validShape.dimensionSize[2] * properties.validShape.dimensionSize[3] * 3 / 2;
+    memcpy(slot->input_tensor.sysMem[0].virAddr, frame_buffer, yuv_length);
+    tensor_pool_flush(&slot->input_tensor.sysMem[0], 0, yuv_length, HB_SYS_MEM_CACHE_CLEAN);
+
+    hbDNNInferCtrlParam infer_ctrl_param;
+    HB_DNN_INITIALIZE_INFER_CTRL_PARAM(&infer_ctrl_param);
+    slot->frame_ctx = frame_ctx;
+    slot->task_handle = nullptr;
+
+    pthread_mutex_lock(&pipeline->mutex);
+    pipeline->inflight++;
+    pthread_mutex_unlock(&pipeline->mutex);
+
+    int32_t ret = hbDNNInfer(&slot->task_handle, &slot->output_tensors, &slot->input_tensor,
+                             pipeline->bpu_handle->m_dnn_handle, &infer_ctrl_param);
+    if (ret)
+    {
+        printf("[BPU ERR] %s:hbDNNInfer failed!Error code:%d\n", __func__, ret);
+        mQueueEnqueue(&pipeline->free_queue, slot);
+        pthread_mutex_lock(&pipeline->mutex);
+        pipeline->inflight--;
+        pthread_cond_broadcast(&pipeline->idle_cond);
+        pthread_mutex_unlock(&pipeline->mutex);
+        return ret;
+    }
+
+    mQueueEnqueue(&pipeline->busy_queue, slot);
+    return 0;
+}
+
+int hb_bpu_pipeline_flush(bpu_pipeline *pipeline)
+{
+    pthread_mutex_lock(&pipeline->mutex);
+    while (pipeline->inflight > 0)
+    {
+        pthread_cond_wait(&pipeline->idle_cond, &pipeline->mutex);
+    }
+    pthread_mutex_unlock(&pipeline->mutex);
+    return 0;
+}
+
+int hb_bpu_pipeline_destroy(bpu_pipeline *pipeline)
+{
+    hb_bpu_pipeline_flush(pipeline);
+    if (pipeline->worker_started)
+    {
+        mQueueEnqueue(&pipeline->busy_queue, nullptr);
+        pthread_join(pipeline->worker, NULL);
+    }
+
+    bpu_pipeline_release_slots(pipeline);
+    mQueueDestroy(&pipeline->free_queue);
+    mQueueDestroy(&pipeline->busy_queue);
+    pthread_mutex_destroy(&pipeline->mutex);
+    pthread_cond_destroy(&pipeline->idle_cond);
+    free(pipeline);
     return 0;
 }
 
@@ -19,7 +19,15 @@ bpu_module *hb_bpu_predict_init(const char *model_file_name);
 int hb_bpu_init_tensors(bpu_module *bpu_handle, hbDNNTensor *output_tensors);
 int hb_bpu_deinit_tensor(hbDNNTensor *tensor, int32_t len);
 int hb_bpu_start_predict(bpu_module *bpu_handle, char *frame_buffer);
+int hb_bpu_start_predict_frame(bpu_module *bpu_handle, char *frame_buffer, int32_t width, int32_t height,
+                               int32_t keep_ratio, bpu_transform_t *transform);
 int hb_bpu_predict_unint(bpu_module *handle);
+
+bpu_pipeline *hb_bpu_pipeline_create(bpu_module *bpu_handle, int32_t depth,
+                                     sp_bpu_pipeline_callback callback, void *user_data);
+int hb_bpu_pipeline_submit(bpu_pipeline *pipeline, char *frame_buffer, void *frame_ctx);
+int hb_bpu_pipeline_flush(bpu_pipeline *pipeline);
+int hb_bpu_pipeline_destroy(bpu_pipeline *pipeline);
 #ifdef __cplusplus
 }
 #endif
@@ -18,6 +18,16 @@ int sp_bpu_start_predict(bpu_module *bpu_handle, char *addr)
     return -1;
 }
 
+int sp_bpu_start_predict_frame(bpu_module *bpu_handle, char *addr, int32_t width, int32_t height,
+                               int32_t keep_ratio, bpu_transform_t *transform)
+{
+    if (bpu_handle)
+    {
+        return hb_bpu_start_predict_frame(bpu_handle, addr, width, height, keep_ratio, transform);
+    }
+    return -1;
+}
+
 int sp_release_bpu_module(bpu_module *bpu_handle)
 {
     if (bpu_handle)
@@ -26,6 +36,43 @@ int sp_release_bpu_module(bpu_module *bpu_handle)
     }
     return -1;
 }
+bpu_pipeline *sp_bpu_pipeline_create(bpu_module *bpu_handle, int32_t depth,
+                                     sp_bpu_pipeline_callback callback, void *user_data)
+{
+    if (bpu_handle && callback)
+    {
+        return hb_bpu_pipeline_create(bpu_handle, depth, callback, user_data);
+    }
+    return nullptr;
+}
+
+int sp_bpu_pipeline_submit(bpu_pipeline *pipeline, char *addr, void *frame_ctx)
+{
+    if (pipeline && addr)
+    {
+        return hb_bpu_pipeline_submit(pipeline, addr, frame_ctx);
+    }
+    return -1;
+}
+
+int sp_bpu_pipeline_flush(bpu_pipeline *pipeline)
+{
+    if (pipeline)
+    {
+        return hb_bpu_pipeline_flush(pipeline);
+    }
+    return -1;
+}
+
+int sp_bpu_pipeline_destroy(bpu_pipeline *pipeline)
+{
+    if (pipeline)
+    {
+        return hb_bpu_pipeline_destroy(pipeline);
+    }
+    return -1;
+}
+
 int sp_init_bpu_tensors(bpu_module *bpu_handle, hbDNNTensor *output_tensors)
 {
     if (bpu_handle)
@@ -18,6 +18,18 @@ extern "C"
     int32_t m_ori_height; // 用户看到的原始图像高，比如web上显示的推流视频
   } bpu_image_info_t;
 
+  // sp_bpu_start_predict_frame 的缩放和填充参数，模型输出的坐标按下面的方式还原到原始图像：
+  // x_src = (x_model - pad_left) / scale_x + crop_x
+  typedef struct
+  {
+    float scale_x;
+    float scale_y;
+    int32_t pad_left;
+    int32_t pad_top;
+    int32_t crop_x;
+    int32_t crop_y;
+  } bpu_transform_t;
+
   typedef struct
   {
     float xmin;
@@ -36,13 +48,40 @@ extern "C"
     hbDNNHandle_t m_dnn_handle;
     hbDNNTensor input_tensor;
     hbDNNTensor *output_tensor;
+    void *m_preproc; // sp_bpu_start_predict_frame 使用的预处理句柄
+    int32_t m_output_count;
   } bpu_module;
 
+  // 流水线推理：多组输入输出张量轮转，BPU 推理和后处理并行执行
+  typedef struct bpu_pipeline_s bpu_pipeline;
+
+  // 每一帧提交成功的推理完成后都会在后处理线程中调用一次，outputs 在回调返回之后被下一帧复用；
+  // status 为 0 表示成功，否则为 hbDNNWaitTaskDone 的错误码，此时 outputs 为 NULL、output_count 为 0，
+  // 回调仍然负责释放 frame_ctx
+  typedef void (*sp_bpu_pipeline_callback)(int32_t status, hbDNNTensor *outputs, int32_t output_count,
+                                           void *frame_ctx, void *user_data);
+
   bpu_module *sp_init_bpu_module(const char *model_file_name);
 
   int32_t sp_bpu_start_predict(bpu_module *bpu_handle, char *addr);
+  // 输入任意尺寸的 NV12 图像，缩放（keep_ratio 为 1 时保持宽高比并居中填充）到模型输入尺寸后推理，
+  // transform 不为 NULL 时返回坐标还原参数
+  int32_t sp_bpu_start_predict_frame(bpu_module *bpu_handle, char *addr, int32_t width, int32_t height,
+                                     int32_t keep_ratio, bpu_transform_t *transform);
 
   int32_t sp_release_bpu_module(bpu_module *bpu_handle);
+
+  /**
+   * 创建流水线，depth 为同时在处理中的帧数（2 即双缓冲），提交第 depth + 1 帧时阻塞，
+   * 等待最早的一帧后处理完成，保证延迟有上限
+   */
+  bpu_pipeline *sp_bpu_pipeline_create(bpu_module *bpu_handle, int32_t depth,
+                                       sp_bpu_pipeline_callback callback, void *user_data);
+  // 拷贝一帧模型输入尺寸的 NV12 图像并提交推理，frame_ctx 原样传给回调
+  int32_t sp_bpu_pipeline_submit(bpu_pipeline *pipeline, char *addr, void *frame_ctx);
+  // 等待所有已经提交的帧处理完成
+  int32_t sp_bpu_pipeline_flush(bpu_pipeline *pipeline);
+  int32_t sp_bpu_pipeline_destroy(bpu_pipeline *pipeline);
   int32_t sp_init_bpu_tensors(bpu_module *bpu_handle, hbDNNTensor *output_tensors);
   int32_t sp_deinit_bpu_tensor(hbDNNTensor *tensor, int32_t len);
 
@@ -0,0 +1,332 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "activation.h"
+
+// Cephes expf: x = n * ln2 + r, |r| <= ln2 / 2，exp(r) 用 6 阶多项式
+static const float kExpHi = 88.3762626647949f;
+static const float kExpLo = -88.3762626647949f;
+static const float kLog2e = 1.44269504088896341f;
+static const float kLn2Hi = 0.693359375f;
+static const float kLn2Lo = -2.12194440e-4f;
+static const float kExpP0 = 1.9875691500E-4f;
+static const float kExpP1 = 1.3981999507E-3f;
+static const float kExpP2 = 8.3334519073E-3f;
+static const float kExpP3 = 4.1665795894E-2f;
+static const float kExpP4 = 1.6666665459E-1f;
+static const float kExpP5 = 5.0000001201E-1f;
+
+static inline float ExpPoly(float x) {
+  x = std::min(std::max(x, kExpLo), kExpHi);
+  float n = std::floor(x * kLog2e + 0.5f);
+  float r = x - n * kLn2Hi;
+  r = r - n * kLn2Lo;
+  float p = kExpP0;
+  p = p * r + kExpP1;
+  p = p * r + kExpP2;
+  p = p * r + kExpP3;
+  p = p * r + kExpP4;
+  p = p * r + kExpP5;
+  p = p * r * r + r + 1.f;
+  // n = -127 时 2^n 的指数位为 0，结果按 0 处理
+  int32_t bits = (static_cast<int32_t>(n) + 127) << 23;
+  float pow2;
+  memcpy(&pow2, &bits, sizeof(pow2));
+  return p * pow2;
+}
+
+static inline float32x4_t ExpPoly4(float32x4_t x) {
+  x = vminq_f32(vmaxq_f32(x, vdupq_n_f32(kExpLo)), vdupq_n_f32(kExpHi));
+  float32x4_t n = vrndmq_f32(
+      vfmaq_f32(vdupq_n_f32(0.5f), x, vdupq_n_f32(kLog2e)));
+  float32x4_t r = vfmsq_f32(x, n, vdupq_n_f32(kLn2Hi));
+  r = vfmsq_f32(r, n, vdupq_n_f32(kLn2Lo));
+  float32x4_t p = vdupq_n_f32(kExpP0);
+  p = vfmaq_f32(vdupq_n_f32(kExpP1), p, r);
+  p = vfmaq_f32(vdupq_n_f32(kExpP2), p, r);
+  p = vfmaq_f32(vdupq_n_f32(kExpP3), p, r);
+  p = vfmaq_f32(vdupq_n_f32(kExpP4), p, r);
+  p = vfmaq_f32(vdupq_n_f32(kExpP5), p, r);
+  p = vfmaq_f32(vaddq_f32(r, vdupq_n_f32(1.f)), p, vmulq_f32(r, r));
+  int32x4_t bits =
+      vshlq_n_s32(vaddq_s32(vcvtq_s32_f32(n), vdupq_n_s32(127)), 23);
+  return vmulq_f32(p, vreinterpretq_f32_s32(bits));
+}
+
+static inline float32x4_t SigmoidPoly4(float32x4_t x) {
+  float32x4_t one = vdupq_n_f32(1.f);
+  return vdivq_f32(one, vaddq_f32(one, ExpPoly4(vnegq_f32(x))));
+}
+
+static std::mutex lut_mutex;
+static std::vector<ActivationLut *> lut_cache;
+static uint64_t lut_use_seq = 0;
+
+static void ReleaseLut(ActivationLut *lut) {
+  free(lut->scale);
+  free(lut->table);
+  free(lut->planes);
+  free(lut);
+}
+
+static ActivationLut *CreateLut(ActivationType type, const float *scale,
+                                int channels) {
+  auto *lut = static_cast<ActivationLut *>(calloc(1, sizeof(ActivationLut)));
+  if (lut == nullptr) {
+    return nullptr;
+  }
+  lut->type = type;
+  lut->channels = channels;
+  lut->scale = static_cast<float *>(malloc(channels * sizeof(float)));
+  lut->table = static_cast<float *>(malloc(channels * 256 * sizeof(float)));
+  if (channels == 1) {
+    lut->planes = static_cast<uint8_t *>(malloc(4 * 256));
+  }
+  if (lut->scale == nullptr || lut->table == nullptr ||
+      (channels == 1 && lut->planes == nullptr)) {
+    ReleaseLut(lut);
+    return nullptr;
+  }
+  memcpy(lut->scale, scale, channels * sizeof(float));
+
+  for (int c = 0; c < channels; c++) {
+    float *table = lut->table + c * 256;
+    for (int q = -128; q < 128; q++) {
+      double x = static_cast<double>(q) * scale[c];
+      if (type == ACTIVATION_SIGMOID) {
+        table[q + 128] = static_cast<float>(1.0 / (1.0 + std::exp(-x)));
+      } else {
+        table[q + 128] = static_cast<float>(std::exp(std::min(x, 88.0)));
+      }
+    }
+  }
+
+  if (lut->planes != nullptr) {
+    for (int i = 0; i < 256; i++) {
+      uint8_t bytes[4];
+      memcpy(bytes, lut->table + i, sizeof(bytes));
+      for (int p = 0; p < 4; p++) {
+        lut->planes[p * 256 + i] = bytes[p];
+      }
+    }
+  }
+  return lut;
+}
+
+const ActivationLut *ActivationLutGet(ActivationType type, const float *scale,
+                                      int channels) {
+  if (scale == nullptr || channels <= 0) {
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(lut_mutex);
+  for (auto *lut : lut_cache) {
+    if (lut->type == type && lut->channels == channels &&
+        memcmp(lut->scale, scale, channels * sizeof(float)) == 0) {
+      lut->refs++;
+      lut->last_use = ++lut_use_seq;
+      return lut;
+    }
+  }
+  auto *lut = CreateLut(type, scale, channels);
+  if (lut == nullptr) {
+    printf("create activation lut failed, channels: %d\n", channels);
+    return nullptr;
+  }
+  lut->refs = 1;
+  lut->last_use = ++lut_use_seq;
+
+  // 模型反复加载、释放时 scale 各不相同，淘汰最久没用的表，缓存不会无限增长
+  if (lut_cache.size() >= ACTIVATION_LUT_CACHE_MAX) {
+    auto oldest = lut_cache.end();
+    for (auto it = lut_cache.begin(); it != lut_cache.end(); ++it) {
+      if ((*it)->refs == 0 &&
+          (oldest == lut_cache.end() || (*it)->last_use < (*oldest)->last_use)) {
+        oldest = it;
+      }
+    }
+    if (oldest != lut_cache.end()) {
+      ReleaseLut(*oldest);
+      lut_cache.erase(oldest);
+    }
+  }
+  lut_cache.push_back(lut);
+  return lut;
+}
+
+void ActivationLutPut(const ActivationLut *lut) {
+  if (lut == nullptr) {
+    return;
+  }
+  std::lock_guard<std::mutex> lock(lut_mutex);
+  const_cast<ActivationLut *>(lut)->refs--;
+}
+
+void ActivationLutClear(void) {
+  std::lock_guard<std::mutex> lock(lut_mutex);
+  auto end = std::remove_if(lut_cache.begin(), lut_cache.end(),
+                            [](ActivationLut *lut) {
+                              if (lut->refs > 0) {
+                                return false;
+                              }
+                              ReleaseLut(lut);
+                              return true;
+                            });
+  lut_cache.erase(end, lut_cache.end());
+}
+
+static inline uint8x16x4_t LoadTable(const uint8_t *table) {
+  uint8x16x4_t value;
+  value.val[0] = vld1q_u8(table);
+  value.val[1] = vld1q_u8(table + 16);
+  value.val[2] = vld1q_u8(table + 32);
+  value.val[3] = vld1q_u8(table + 48);
+  return value;
+}
+
+void ActivationLutS8(const ActivationLut *lut, const int8_t *data, int count,
+                     int channel, float *out) {
+  const float *table = lut->table + channel * 256;
+  int i = 0;
+  if (lut->planes != nullptr) {
+    // 每个字节平面 256 项，分 4 段用 tbl/tbx 查，超出当前段的下标保持原值，
+    // 最后用 vst4 把 4 个字节平面交织成 16 个 float
+    uint8x16_t bias = vdupq_n_u8(0x80);
+    uint8x16_t step = vdupq_n_u8(64);
+    for (; i <= count - 16; i += 16) {
+      uint8x16_t idx0 =
+          veorq_u8(vreinterpretq_u8_s8(vld1q_s8(data + i)), bias);
+      uint8x16_t idx1 = vsubq_u8(idx0, step);
+      uint8x16_t idx2 = vsubq_u8(idx1, step);
+      uint8x16_t idx3 = vsubq_u8(idx2, step);
+      uint8x16x4_t bytes;
+      for (int p = 0; p < 4; p++) {
+        const uint8_t *plane = lut->planes + p * 256;
+        uint8x16_t value = vqtbl4q_u8(LoadTable(plane), idx0);
+        value = vqtbx4q_u8(value, LoadTable(plane + 64), idx1);
+        value = vqtbx4q_u8(value, LoadTable(plane + 128), idx2);
+        value = vqtbx4q_u8(value, LoadTable(plane + 192), idx3);
+        bytes.val[p] = value;
+      }
+      vst4q_u8(reinterpret_cast<uint8_t *>(out + i), bytes);
+    }
+  }
+  for (; i < count; i++) {
+    out[i] = table[data[i] + 128];
+  }
+}
+
+void ActivationLutS8Channels(const ActivationLut *lut, const int8_t *data,
+                             int count, int first_channel, float *out) {
+  const float *table = lut->table + first_channel * 256 + 128;
+  for (int i = 0; i < count; i++) {
+    out[i] = table[i * 256 + data[i]];
+  }
+}
+
+void ActivationExpF32(const float *data, int count, float *out) {
+  int i = 0;
+  for (; i <= count - 4; i += 4) {
+    vst1q_f32(out + i, ExpPoly4(vld1q_f32(data + i)));
+  }
+  for (; i < count; i++) {
+    out[i] = ExpPoly(data[i]);
+  }
+}
+
+void ActivationSigmoidF32(const float *data, int count, float *out) {
+  int i = 0;
+  for (; i <= count - 4; i += 4) {
+    vst1q_f32(out + i, SigmoidPoly4(vld1q_f32(data + i)));
+  }
+  for (; i < count; i++) {
+    out[i] = 1.f / (1.f + ExpPoly(-data[i]));
+  }
+}
+
+void ActivationSoftmaxF32(const float *data, int count, float *out) {
+  if (count <= 0) {
+    return;
+  }
+  int i = 0;
+  float max_value = data[0];
+  float32x4_t vec_max = vdupq_n_f32(max_value);
+  for (; i <= count - 4; i += 4) {
+    vec_max = vmaxq_f32(vec_max, vld1q_f32(data + i));
+  }
+  max_value = vmaxvq_f32(vec_max);
+  for (; i < count; i++) {
+    max_value = std::max(max_value, data[i]);
+  }
+
+  i = 0;
+  float32x4_t vec_max_value = vdupq_n_f32(max_value);
+  float32x4_t vec_sum = vdupq_n_f32(0.f);
+  for (; i <= count - 4; i += 4) {
+    float32x4_t value = ExpPoly4(vsubq_f32(vld1q_f32(data + i), vec_max_value));
+    vst1q_f32(out + i, value);
+    vec_sum = vaddq_f32(vec_sum, value);
+  }
+  float sum = vaddvq_f32(vec_sum);
+  for (; i < count; i++) {
+    out[i] = ExpPoly(data[i] - max_value);
+    sum += out[i];
+  }
+
+  float inv_sum = 1.f / sum;
+  i = 0;
+  for (; i <= count - 4; i += 4) {
+    vst1q_f32(out + i, vmulq_n_f32(vld1q_f32(out + i), inv_sum));
+  }
+  for (; i < count; i++) {
+    out[i] *= inv_sum;
+  }
+}
+
+static inline float32x4x2_t DequantiS16(const int16_t *data, float scale) {
+  int16x8_t raw = vld1q_s16(data);
+  float32x4x2_t value;
+  value.val[0] = vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_low_s16(raw))), scale);
+  value.val[1] =
+      vmulq_n_f32(vcvtq_f32_s32(vmovl_s16(vget_high_s16(raw))), scale);
+  return value;
+}
+
+void ActivationExpS16(const int16_t *data, int count, float scale, float *out) {
+  int i = 0;
+  for (; i <= count - 8; i += 8) {
+    float32x4x2_t value = DequantiS16(data + i, scale);
+    vst1q_f32(out + i, ExpPoly4(value.val[0]));
+    vst1q_f32(out + i + 4, ExpPoly4(value.val[1]));
+  }
+  for (; i < count; i++) {
+    out[i] = ExpPoly(data[i] * scale);
+  }
+}
+
+void ActivationSigmoidS16(const int16_t *data, int count, float scale,
+                          float *out) {
+  int i = 0;
+  for (; i <= count - 8; i += 8) {
+    float32x4x2_t value = DequantiS16(data + i, scale);
+    vst1q_f32(out + i, SigmoidPoly4(value.val[0]));
+    vst1q_f32(out + i + 4, SigmoidPoly4(value.val[1]));
+  }
+  for (; i < count; i++) {
+    out[i] = 1.f / (1.f + ExpPoly(-data[i] * scale));
+  }
+}
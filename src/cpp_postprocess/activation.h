@@ -0,0 +1,109 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_ACTIVATION_H_
+#define _POST_PROCESS_ACTIVATION_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * 后处理共用的激活函数
+ *
+ * int8 输出每个 scale 只有 256 种取值，sigmoid / exp 按通道预先算成查找表，
+ * 每个元素只需要一次查表；per-tensor 的表额外保存按字节拆开的 4 个平面，
+ * 连续数据用 NEON 的 tbl 指令一次查 16 个。
+ * int16 和 float 使用 NEON 多项式近似的 exp，|x| <= 87 时相对误差小于 2e-7。
+ */
+
+typedef enum {
+  ACTIVATION_SIGMOID = 0,
+  ACTIVATION_EXP = 1,   // softmax 的分子，x 超过 88 时按 88 计算
+} ActivationType;
+
+typedef struct {
+  ActivationType type;
+  int channels;         // 1 表示 per-tensor
+  float *scale;         // 建表使用的 scale，用于缓存匹配
+  float *table;         // channels * 256，下标为 raw + 128
+  uint8_t *planes;      // per-tensor 时 table 按字节拆成的 4 * 256，NEON 查表使用
+  int refs;             // 正在使用的次数，为 0 时才能被淘汰
+  uint64_t last_use;    // 最近一次 ActivationLutGet 的序号，淘汰最久没用的
+} ActivationLut;
+
+// 最多缓存的查找表个数，超过时淘汰最久没有使用、并且没有在使用中的表
+#define ACTIVATION_LUT_CACHE_MAX 32
+
+/**
+ * Schraudolph 的 exp 近似，误差约 4%，只用于对精度不敏感的得分
+ */
+static inline float FastExp(float x) {
+  union {
+    uint32_t i;
+    float f;
+  } v;
+  v.i = (12102203.1616540672f * x + 1064807160.56887296f);
+  return v.f;
+}
+
+/**
+ * 获取 int8 查找表，同样类型和 scale 的表只在第一次使用时建立，之后从缓存复用，
+ * 模型输出的 scale 在加载后不会变化，相当于每个模型输出建一次表。
+ * 用完之后需要调用 ActivationLutPut，缓存满时只淘汰没有在使用中的表
+ * @param[in] scale: 反量化系数，channels 个
+ * @param[in] channels: 1 表示 per-tensor
+ * @return 查找表，失败返回 NULL
+ */
+const ActivationLut *ActivationLutGet(ActivationType type, const float *scale,
+                                      int channels);
+
+/**
+ * 归还 ActivationLutGet 得到的查找表，lut 为 NULL 时什么都不做
+ */
+void ActivationLutPut(const ActivationLut *lut);
+
+/**
+ * 释放缓存中所有没有在使用中的查找表
+ */
+void ActivationLutClear(void);
+
+/**
+ * 查表：count 个元素都属于 channel 通道（per-tensor 或者 NCHW 的一个平面）
+ */
+void ActivationLutS8(const ActivationLut *lut, const int8_t *data, int count,
+                     int channel, float *out);
+
+/**
+ * 查表：data[i] 属于 first_channel + i 通道（NHWC 的一行）
+ */
+void ActivationLutS8Channels(const ActivationLut *lut, const int8_t *data,
+                             int count, int first_channel, float *out);
+
+void ActivationExpF32(const float *data, int count, float *out);
+void ActivationSigmoidF32(const float *data, int count, float *out);
+
+/**
+ * 减去最大值后计算 softmax
+ */
+void ActivationSoftmaxF32(const float *data, int count, float *out);
+
+/**
+ * per-tensor scale 的 int16 数据，反量化后计算
+ */
+void ActivationExpS16(const int16_t *data, int count, float scale, float *out);
+void ActivationSigmoidS16(const int16_t *data, int count, float scale,
+                          float *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_ACTIVATION_H_
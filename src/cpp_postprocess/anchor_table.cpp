@@ -0,0 +1,266 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <mutex>
+#include <vector>
+
+#include "activation.h"
+#include "anchor_table.h"
+
+enum AnchorType {
+  ANCHOR_SSD = 0,
+  ANCHOR_EFFICIENTDET = 1,
+};
+
+struct AnchorEntry {
+  AnchorType type;
+  SsdAnchorParam ssd;
+  EfficientDetAnchorParam efficientdet;
+  std::vector<float> data;    // cx, cy, w, h 依次排列，每段 count 个
+  AnchorTable table;
+};
+
+static std::mutex anchor_mutex;
+static std::vector<AnchorEntry *> anchor_cache;
+
+static bool SameParam(const SsdAnchorParam &a, const SsdAnchorParam &b) {
+  if (a.input_height != b.input_height || a.input_width != b.input_width ||
+      a.feat_height != b.feat_height || a.feat_width != b.feat_width ||
+      a.step != b.step || a.min_size != b.min_size ||
+      a.max_size != b.max_size || a.ratio_num != b.ratio_num ||
+      a.offset[0] != b.offset[0] || a.offset[1] != b.offset[1]) {
+    return false;
+  }
+  return std::equal(a.ratios, a.ratios + a.ratio_num, b.ratios);
+}
+
+static bool SameParam(const EfficientDetAnchorParam &a,
+                      const EfficientDetAnchorParam &b) {
+  if (a.input_height != b.input_height || a.input_width != b.input_width ||
+      a.feat_height != b.feat_height || a.feat_width != b.feat_width ||
+      a.stride != b.stride || a.scale_num != b.scale_num ||
+      a.ratio_num != b.ratio_num) {
+    return false;
+  }
+  return std::equal(a.scales, a.scales + a.scale_num, b.scales) &&
+         std::equal(a.ratios, a.ratios + a.ratio_num, b.ratios);
+}
+
+static void SetTable(AnchorEntry *entry, int count) {
+  entry->data.resize(count * 4);
+  entry->table.count = count;
+  entry->table.cx = entry->data.data();
+  entry->table.cy = entry->data.data() + count;
+  entry->table.w = entry->data.data() + count * 2;
+  entry->table.h = entry->data.data() + count * 3;
+}
+
+static inline void SetAnchor(AnchorEntry *entry, int index, float cx,
+                             float cy, float w, float h) {
+  int count = entry->table.count;
+  float *data = entry->data.data();
+  data[index] = cx;
+  data[count + index] = cy;
+  data[count * 2 + index] = w;
+  data[count * 3 + index] = h;
+}
+
+static void BuildSsd(AnchorEntry *entry) {
+  const SsdAnchorParam &param = entry->ssd;
+  // 每个位置的先验框大小：min_size，sqrt(min_size * max_size)，各个宽高比
+  std::vector<std::pair<float, float>> sizes;
+  sizes.emplace_back(param.min_size, param.min_size);
+  if (param.max_size > 0) {
+    float size = std::sqrt(param.max_size * param.min_size);
+    sizes.emplace_back(size, size);
+  }
+  for (int k = 0; k < param.ratio_num; k++) {
+    if (param.ratios[k] == 0) continue;
+    float sr = std::sqrt(param.ratios[k]);
+    sizes.emplace_back(param.min_size * sr, param.min_size / sr);
+  }
+
+  int per_pixel = sizes.size();
+  SetTable(entry, param.feat_height * param.feat_width * per_pixel);
+  int index = 0;
+  for (int i = 0; i < param.feat_height; i++) {
+    for (int j = 0; j < param.feat_width; j++) {
+      float cy = (i + param.offset[0]) * param.step;
+      float cx = (j + param.offset[1]) * param.step;
+      for (const auto &size : sizes) {
+        // 归一化后再求中心和宽高，和逐框解码时的计算顺序保持一致
+        float x_min = (cx - size.first / 2) / param.input_width;
+        float y_min = (cy - size.second / 2) / param.input_height;
+        float x_max = (cx + size.first / 2) / param.input_width;
+        float y_max = (cy + size.second / 2) / param.input_height;
+        SetAnchor(entry, index++, (x_max + x_min) / 2, (y_max + y_min) / 2,
+                  x_max - x_min, y_max - y_min);
+      }
+    }
+  }
+}
+
+static void BuildEfficientDet(AnchorEntry *entry) {
+  const EfficientDetAnchorParam &param = entry->efficientdet;
+  int stride = param.stride;
+  int size = stride * stride;
+  float x_ctr = 0.5 * (stride - 1.f);
+  float y_ctr = 0.5 * (stride - 1.f);
+  // base anchor: x1, y1, x2, y2
+  std::vector<float> base_anchors;
+  for (int r = 0; r < param.ratio_num; r++) {
+    double ratio = param.ratios[r];
+    for (int s = 0; s < param.scale_num; s++) {
+      double scale = param.scales[s];
+      double size_ratio = std::floor(size / ratio);
+      double new_w = std::floor(std::sqrt(size_ratio) + 0.5) * scale;
+      double new_h = std::floor(new_w / scale * ratio + 0.5) * scale;
+      base_anchors.push_back(x_ctr - 0.5f * (new_w - 1.f));
+      base_anchors.push_back(y_ctr - 0.5f * (new_h - 1.f));
+      base_anchors.push_back(x_ctr + 0.5f * (new_w - 1.f));
+      base_anchors.push_back(y_ctr + 0.5f * (new_h - 1.f));
+    }
+  }
+
+  int per_pixel = param.ratio_num * param.scale_num;
+  SetTable(entry, param.feat_height * param.feat_width * per_pixel);
+  int index = 0;
+  for (int i = 0; i < param.feat_height; ++i) {
+    for (int j = 0; j < param.feat_width; ++j) {
+      int ori_y = i * stride;
+      int ori_x = j * stride;
+      for (int k = 0; k < per_pixel; k++) {
+        const float *base = base_anchors.data() + k * 4;
+        float x1 = base[0] + ori_x;
+        float y1 = base[1] + ori_y;
+        float x2 = base[2] + ori_x;
+        float y2 = base[3] + ori_y;
+        float width = x2 - x1 + 1.f;
+        float height = y2 - y1 + 1.f;
+        SetAnchor(entry, index++, x1 + 0.5f * (width - 1.f),
+                  y1 + 0.5f * (height - 1.f), width, height);
+      }
+    }
+  }
+}
+
+const AnchorTable *SsdAnchorTableGet(const SsdAnchorParam *param) {
+  if (param == nullptr || param->input_height <= 0 ||
+      param->input_width <= 0 || param->feat_height <= 0 ||
+      param->feat_width <= 0 || param->ratio_num < 0 ||
+      param->ratio_num > ANCHOR_PARAM_MAX_NUM) {
+    printf("invalid ssd anchor param\n");
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(anchor_mutex);
+  for (auto *entry : anchor_cache) {
+    if (entry->type == ANCHOR_SSD && SameParam(entry->ssd, *param)) {
+      return &entry->table;
+    }
+  }
+  auto *entry = new AnchorEntry();
+  entry->type = ANCHOR_SSD;
+  entry->ssd = *param;
+  BuildSsd(entry);
+  anchor_cache.push_back(entry);
+  return &entry->table;
+}
+
+const AnchorTable *EfficientDetAnchorTableGet(
+    const EfficientDetAnchorParam *param) {
+  if (param == nullptr || param->feat_height <= 0 || param->feat_width <= 0 ||
+      param->stride <= 0 || param->scale_num <= 0 ||
+      param->scale_num > ANCHOR_PARAM_MAX_NUM || param->ratio_num <= 0 ||
+      param->ratio_num > ANCHOR_PARAM_MAX_NUM) {
+    printf("invalid efficientdet anchor param\n");
+    return nullptr;
+  }
+  std::lock_guard<std::mutex> lock(anchor_mutex);
+  for (auto *entry : anchor_cache) {
+    if (entry->type == ANCHOR_EFFICIENTDET &&
+        SameParam(entry->efficientdet, *param)) {
+      return &entry->table;
+    }
+  }
+  auto *entry = new AnchorEntry();
+  entry->type = ANCHOR_EFFICIENTDET;
+  entry->efficientdet = *param;
+  BuildEfficientDet(entry);
+  anchor_cache.push_back(entry);
+  return &entry->table;
+}
+
+void AnchorTableClear(void) {
+  std::lock_guard<std::mutex> lock(anchor_mutex);
+  for (auto *entry : anchor_cache) {
+    delete entry;
+  }
+  anchor_cache.clear();
+}
+
+void AnchorDecodeBoxes(const AnchorTable *table, const int32_t *indices,
+                       const float *deltas, int count,
+                       const float *variance, float size_offset,
+                       float *boxes) {
+  float32x4_t var_x = vdupq_n_f32(variance[0]);
+  float32x4_t var_y = vdupq_n_f32(variance[1]);
+  float32x4_t var_w = vdupq_n_f32(variance[2]);
+  float32x4_t var_h = vdupq_n_f32(variance[3]);
+  float32x4_t offset = vdupq_n_f32(size_offset);
+  float32x4_t half = vdupq_n_f32(0.5f);
+
+  for (int i = 0; i < count; i += 4) {
+    int lanes = std::min(4, count - i);
+    // 候选框的 anchor 不连续，先按下标取到连续的数组里，不足 4 个的补 0
+    float cx[4] = {0}, cy[4] = {0}, w[4] = {0}, h[4] = {0};
+    float delta[16] = {0};
+    for (int j = 0; j < lanes; j++) {
+      int index = indices[i + j];
+      cx[j] = table->cx[index];
+      cy[j] = table->cy[index];
+      w[j] = table->w[index];
+      h[j] = table->h[index];
+    }
+    std::copy(deltas + i * 4, deltas + (i + lanes) * 4, delta);
+
+    float32x4x4_t d = vld4q_f32(delta);
+    float32x4_t anchor_w = vld1q_f32(w);
+    float32x4_t anchor_h = vld1q_f32(h);
+    float32x4_t ctr_x =
+        vfmaq_f32(vld1q_f32(cx), vmulq_f32(d.val[0], var_x), anchor_w);
+    float32x4_t ctr_y =
+        vfmaq_f32(vld1q_f32(cy), vmulq_f32(d.val[1], var_y), anchor_h);
+
+    float scale[8];
+    vst1q_f32(scale, vmulq_f32(d.val[2], var_w));
+    vst1q_f32(scale + 4, vmulq_f32(d.val[3], var_h));
+    ActivationExpF32(scale, 8, scale);
+    float32x4_t half_w = vmulq_f32(
+        vsubq_f32(vmulq_f32(vld1q_f32(scale), anchor_w), offset), half);
+    float32x4_t half_h = vmulq_f32(
+        vsubq_f32(vmulq_f32(vld1q_f32(scale + 4), anchor_h), offset), half);
+
+    float32x4x4_t box;
+    box.val[0] = vsubq_f32(ctr_x, half_w);
+    box.val[1] = vsubq_f32(ctr_y, half_h);
+    box.val[2] = vaddq_f32(ctr_x, half_w);
+    box.val[3] = vaddq_f32(ctr_y, half_h);
+    if (lanes == 4) {
+      vst4q_f32(boxes + i * 4, box);
+    } else {
+      float out[16];
+      vst4q_f32(out, box);
+      std::copy(out, out + lanes * 4, boxes + i * 4);
+    }
+  }
+}
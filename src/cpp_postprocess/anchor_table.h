@@ -0,0 +1,99 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_ANCHOR_TABLE_H_
+#define _POST_PROCESS_ANCHOR_TABLE_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * SSD / EfficientDet 的 anchor（先验框）表
+ *
+ * 表按输入大小、特征图大小和检测头的 anchor 配置作为 key 缓存，同一个 key
+ * 只在第一次使用时生成，之后只读，多个线程、多个不同输入大小的模型可以同时使用。
+ * anchor 按结构体数组的方式分开存成 cx / cy / w / h 4 个 float 数组，
+ * 解码时 NEON 一次处理 4 个框。
+ */
+
+#define ANCHOR_PARAM_MAX_NUM 8
+
+typedef struct {
+  int count;            // anchor 个数，顺序为 (h, w, 每个位置的 anchor)
+  const float *cx;
+  const float *cy;
+  const float *w;
+  const float *h;
+} AnchorTable;
+
+/**
+ * SSD 一个输出层的先验框配置，生成的先验框按输入大小归一化到 [0, 1]
+ */
+typedef struct {
+  int input_height;
+  int input_width;
+  int feat_height;
+  int feat_width;
+  int step;
+  float min_size;
+  float max_size;       // <= 0 表示没有 sqrt(min_size * max_size) 的先验框
+  int ratio_num;
+  float ratios[ANCHOR_PARAM_MAX_NUM];   // 为 0 的项跳过
+  float offset[2];      // y, x
+} SsdAnchorParam;
+
+/**
+ * EfficientDet 一个输出层的 anchor 配置，anchor 为输入图像上的像素坐标
+ */
+typedef struct {
+  int input_height;
+  int input_width;
+  int feat_height;
+  int feat_width;
+  int stride;
+  int scale_num;
+  double scales[ANCHOR_PARAM_MAX_NUM];
+  int ratio_num;
+  double ratios[ANCHOR_PARAM_MAX_NUM];
+} EfficientDetAnchorParam;
+
+/**
+ * 获取 anchor 表，没有缓存时生成
+ * @return anchor 表，参数错误或者内存不足时返回 NULL
+ */
+const AnchorTable *SsdAnchorTableGet(const SsdAnchorParam *param);
+const AnchorTable *EfficientDetAnchorTableGet(
+    const EfficientDetAnchorParam *param);
+
+/**
+ * 释放所有缓存的 anchor 表，调用时不能有其他线程在使用 anchor 表
+ */
+void AnchorTableClear(void);
+
+/**
+ * 按 anchor 解码 (dx, dy, dw, dh) 形式的回归量：
+ *   cx' = variance[0] * dx * w + cx，w' = exp(variance[2] * dw) * w
+ *   xmin = cx' - 0.5 * (w' - size_offset)，xmax = cx' + 0.5 * (w' - size_offset)
+ * y 方向相同。SSD 的 size_offset 为 0，EfficientDet 的像素坐标为 1
+ * @param[in] indices: 每个框对应的 anchor 下标，count 个
+ * @param[in] deltas: 每个框的 dx, dy, dw, dh，count * 4 个
+ * @param[out] boxes: 每个框的 xmin, ymin, xmax, ymax，count * 4 个
+ */
+void AnchorDecodeBoxes(const AnchorTable *table, const int32_t *indices,
+                       const float *deltas, int count,
+                       const float *variance, float size_offset,
+                       float *boxes);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_ANCHOR_TABLE_H_
@@ -20,6 +20,8 @@
 
 
 #include "centernet_post_process.h"
+#include "activation.h"
+#include "heatmap_peak.h"
 
 #define BSWAP_32(x) static_cast<int32_t>(__builtin_bswap32(x))
 
@@ -84,15 +86,6 @@ struct DataNode {
   }
 };
 
-static float fastExp(float x) {
-  union {
-    uint32_t i;
-    float f;
-  } v;
-  v.i = (12102203.1616540672f * x + 1064807160.56887296f);
-  return v.f;
-}
-
 // order topK data in node
 static void top_k_helper(DataNode *node, int topk, int len) {
   std::priority_queue<int, std::vector<DataNode>, std::greater<DataNode>> heap;
@@ -238,10 +231,28 @@ typedef struct Detection {
   ~Detection() {}
 } Detection;
 
-std::vector<Detection> centernet_dets;
+/**
+ * 一个模型实例的后处理状态
+ */
+struct CenternetContext {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  // heatmap 峰值提取的中间内存，多帧之间复用
+  HeatmapPeakExtractor peak_extractor = {};
 
+  ~CenternetContext() { HeatmapPeakRelease(&peak_extractor); }
+};
+
+// 原有接口使用的默认上下文
+static CenternetContext default_centernet_context;
 
-void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor, CenternetPostProcessInfo_t *post_info, int layer){
+
+static int CenternetResnet101Decode(CenternetContext *context,
+                                    hbDNNTensor *nms_tensor,
+                                    hbDNNTensor *wh_tensor,
+                                    hbDNNTensor *reg_tensor,
+                                    CenternetPostProcessInfo_t *post_info,
+                                    int layer) {
 
   int h_index{2}, w_index{3}, c_index{1};
   int *shape = nms_tensor->properties.validShape.dimensionSize;
@@ -275,7 +286,7 @@ void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tens
     filter_func(nms_tensor, node, post_info->score_threshold, scales0);
   } else {
     printf("centernet unsupport shift dequantzie now!\n");
-    return;
+    return -1;
   }
 
   // topk sort
@@ -319,15 +330,15 @@ void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tens
       tmp_box[i].score = topk_score;
       tmp_box[i].id = topk_clses;
       tmp_box[i].class_name = default_ptq_centernet_config.class_names[topk_clses].c_str();
-      centernet_dets.push_back(tmp_box[i]);
+      context->dets.push_back(tmp_box[i]);
     }
   } else {
     printf("centernet unsupport now!\n");
-    return;
+    return -1;
   }
 
-  auto &detections = centernet_dets;
-  int det_num = centernet_dets.size();
+  auto &detections = context->dets;
+  int det_num = context->dets.size();
   printf("det.size(): %d", det_num);
   for (int i = 0; i < det_num; i++) {
     detections[i].bbox.xmin = detections[i].bbox.xmin * scale_x - offset_x;
@@ -336,407 +347,18 @@ void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tens
     detections[i].bbox.ymax = detections[i].bbox.ymax * scale_y - offset_y;
   }
 
-  return;
-
-}
-
-
-int NMSMaxPool2dDequanti(hbDNNTensor *tensor,
-                         std::vector<DataNode> &node,
-                         float &t_value,
-                         float *scale) {
-  int h_index{2}, w_index{3}, c_index{1};
-  int *shape = tensor->properties.validShape.dimensionSize;
-  int input_c = shape[c_index];
-  int input_h = shape[h_index];
-  int input_w = shape[w_index];
-
-  auto *raw_heat_map_data =
-      reinterpret_cast<int32_t *>(tensor->sysMem[0].virAddr);
-
-  std::vector<int> edge1 = {-1, +1, +input_w - 1, +input_w, +input_w + 1};
-
-  std::vector<int> edge2 = {
-      -1,
-      +1,
-      -input_w - 1,
-      -input_w,
-      -input_w + 1,
-  };
-
-  std::vector<int> edge3 = {
-      +1,
-      +input_w,
-      +input_w + 1,
-      -input_w,
-      -input_w + 1,
-  };
-
-  std::vector<int> edge4 = {
-      -1,
-      +input_w - 1,
-      +input_w,
-      -input_w - 1,
-      -input_w,
-  };
-
-  int pos[8] = {+1,
-                -1,
-                +input_w - 1,
-                +input_w,
-                +input_w + 1,
-                -input_w - 1,
-                -input_w,
-                -input_w + 1};
-
-  bool big_endian = false;
-
-  for (int c = 0; c < input_c; c++) {
-    int channel_offset = c * input_h * input_w;
-    int32_t *iptr = raw_heat_map_data + channel_offset;
-    float scale_value = scale[c];
-    // VLOG(EXAMPLE_REPORT) << "c: " << c << "; scale1:" << scale[c];
-    DataNode tmp_node;
-
-    std::vector<int32_t> point1(4, 0.f);
-    point1[0] = iptr[0];
-    point1[1] = iptr[1];
-    point1[2] = iptr[input_w + 0];
-    point1[3] = iptr[input_w + 1];
-    int i = 0;
-    for (; i < 4; ++i) {
-      if (point1[0] < point1[i]) break;
-    }
-    if (i == 4) {
-      tmp_node.value = DequantiScale(point1[0], big_endian, scale_value);
-      if (tmp_node.value > t_value) {
-        tmp_node.indx = channel_offset;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    std::vector<int32_t> point2(4, 0.f);
-    point2[0] = iptr[input_w - 2];
-    point2[1] = iptr[input_w - 1];  //
-    point2[2] = iptr[input_w + input_w - 2];
-    point2[3] = iptr[input_w + input_w - 1];
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point2[1] < point2[i]) break;
-    }
-    if (i == 4) {
-      tmp_node.value = DequantiScale(point2[1], big_endian, scale_value);  //
-      if (tmp_node.value > t_value) {
-        tmp_node.indx = channel_offset + input_w - 1;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    std::vector<int32_t> point3(4, 0.f);
-    point3[0] = iptr[(input_h - 2) * input_w + 0];
-    point3[1] = iptr[(input_h - 2) * input_w + 1];
-    point3[2] = iptr[(input_h - 1) * input_w + 0];  //
-    point3[3] = iptr[(input_h - 1) * input_w + 1];
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point3[2] < point3[i]) break;
-    }
-    if (i == 4) {
-      tmp_node.value = DequantiScale(point3[2], big_endian, scale_value);
-      if (tmp_node.value > t_value) {
-        tmp_node.indx = channel_offset + (input_h - 1) * input_w;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    std::vector<int32_t> point4(4, 0.f);
-    point4[0] = iptr[(input_h - 2) * input_w + (input_w - 2)];
-    point4[1] = iptr[(input_h - 2) * input_w + (input_w - 1)];
-    point4[2] = iptr[(input_h - 1) * input_w + (input_w - 2)];
-    point4[3] = iptr[(input_h - 1) * input_w + (input_w - 1)];  //
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point4[3] < point4[i]) break;
-    }
-    if (i == 4) {
-      tmp_node.value = DequantiScale(point4[3], big_endian, scale_value);
-      if (tmp_node.value > t_value) {
-        tmp_node.indx = channel_offset + (input_h - 1) * input_w + input_w - 1;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    // top + bottom
-    for (int w = 1; w < input_w - 1; ++w) {
-      i = 0;
-      int32_t cur_value = iptr[w];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[w + edge1[i]]) break;
-      }
-      if (i == 5) {
-        tmp_node.value = DequantiScale(cur_value, big_endian, scale_value);
-        if (tmp_node.value > t_value) {
-          tmp_node.indx = channel_offset + w;
-          node.emplace_back(tmp_node);
-        }
-      }
-
-      i = 0;
-      int cur_pos = (input_h - 1) * input_w + w;
-      cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[cur_pos + edge2[i]]) break;
-      }
-      if (i == 5) {
-        tmp_node.value = DequantiScale(cur_value, big_endian, scale_value);
-        if (tmp_node.value > t_value) {
-          tmp_node.indx = channel_offset + cur_pos;
-          node.emplace_back(tmp_node);
-        }
-      }
-    }
-
-    // left + right
-    for (int h = 1; h < input_h - 1; ++h) {
-      i = 0;
-      int cur_pos = h * input_w;
-      int32_t cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[cur_pos + edge3[i]]) break;
-      }
-      if (i == 5) {
-        tmp_node.value = DequantiScale(cur_value, big_endian, scale_value);
-        if (tmp_node.value > t_value) {
-          tmp_node.indx = channel_offset + cur_pos;
-          node.emplace_back(tmp_node);
-        }
-      }
-
-      i = 0;
-      cur_pos = h * input_w + input_w - 1;
-      cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[cur_pos + edge3[i]]) break;
-      }
-      if (i == 5) {
-        tmp_node.value = DequantiScale(cur_value, big_endian, scale_value);
-        if (tmp_node.value > t_value) {
-          tmp_node.indx = channel_offset + cur_pos;
-          node.emplace_back(tmp_node);
-        }
-      }
-    }
-
-    // center
-    for (int h = 1; h < input_h - 1; h++) {
-      int offset = h * input_w;
-      for (int w = 1; w < input_w - 1; w++) {
-        int cur_pos = offset + w;
-        int32_t cur_value = iptr[cur_pos];
-        i = 0;
-        for (; i < 8; ++i) {
-          if (cur_value < iptr[cur_pos + pos[i]]) break;
-        }
-        if (i == 8) {
-          tmp_node.value = DequantiScale(cur_value, big_endian, scale_value);
-          if (tmp_node.value > t_value) {
-            tmp_node.indx = channel_offset + cur_pos;
-            node.emplace_back(tmp_node);
-          }
-        }
-      }
-    }
-  }
   return 0;
 }
 
-int NMSMaxPool2d(hbDNNTensor *tensor,
-                 std::vector<DataNode> &node,
-                 float &t_value) {
-  int h_index{2}, w_index{3}, c_index{1};
-  int *shape = tensor->properties.validShape.dimensionSize;
-  int input_c = shape[c_index];
-  int input_h = shape[h_index];
-  int input_w = shape[w_index];
-
-  float *raw_heat_map_data =
-      reinterpret_cast<float *>(tensor->sysMem[0].virAddr);
-
-  std::vector<int> edge1 = {-1, +1, +input_w - 1, +input_w, +input_w + 1};
-
-  std::vector<int> edge2 = {
-      -1,
-      +1,
-      -input_w - 1,
-      -input_w,
-      -input_w + 1,
-  };
-
-  std::vector<int> edge3 = {
-      +1,
-      +input_w,
-      +input_w + 1,
-      -input_w,
-      -input_w + 1,
-  };
-
-  std::vector<int> edge4 = {
-      -1,
-      +input_w - 1,
-      +input_w,
-      -input_w - 1,
-      -input_w,
-  };
-
-  int pos[8] = {+1,
-                -1,
-                +input_w - 1,
-                +input_w,
-                +input_w + 1,
-                -input_w - 1,
-                -input_w,
-                -input_w + 1};
-
-  for (int c = 0; c < input_c; c++) {
-    int channel_offset = c * input_h * input_w;
-    float *iptr = raw_heat_map_data + channel_offset;
-    DataNode tmp_node;
-
-    std::vector<float> point1(4, 0.f);
-    point1[0] = iptr[0];  //
-    point1[1] = iptr[1];
-    point1[2] = iptr[input_w + 0];
-    point1[3] = iptr[input_w + 1];
-    int i = 0;
-    for (; i < 4; ++i) {
-      if (point1[0] < point1[i]) break;
-    }
-    if (i == 4 && point1[0] > t_value) {
-      tmp_node.indx = channel_offset;
-      tmp_node.value = point1[0];
-      node.emplace_back(tmp_node);
-    }
-
-    std::vector<float> point2(4, 0.f);
-    point2[0] = iptr[input_w - 2];
-    point2[1] = iptr[input_w - 1];  //
-    point2[2] = iptr[input_w + input_w - 2];
-    point2[3] = iptr[input_w + input_w - 1];
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point2[1] < point2[i]) break;
-    }
-    if (i == 4 && point2[1] > t_value) {
-      tmp_node.indx = channel_offset + input_w - 1;
-      tmp_node.value = point2[1];  //
-      node.emplace_back(tmp_node);
-    }
-
-    std::vector<float> point3(4, 0.f);
-    point3[0] = iptr[(input_h - 2) * input_w + 0];
-    point3[1] = iptr[(input_h - 2) * input_w + 1];
-    point3[2] = iptr[(input_h - 1) * input_w + 0];  //
-    point3[3] = iptr[(input_h - 1) * input_w + 1];
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point3[2] < point3[i]) break;
-    }
-    if (i == 4 && point3[2] > t_value) {
-      tmp_node.indx = channel_offset + (input_h - 1) * input_w;
-      tmp_node.value = point3[2];
-      node.emplace_back(tmp_node);
-    }
-
-    std::vector<float> point4(4, 0.f);
-    point4[0] = iptr[(input_h - 2) * input_w + (input_w - 2)];
-    point4[1] = iptr[(input_h - 2) * input_w + (input_w - 1)];
-    point4[2] = iptr[(input_h - 1) * input_w + (input_w - 2)];
-    point4[3] = iptr[(input_h - 1) * input_w + (input_w - 1)];  //
-    i = 0;
-    for (; i < 4; ++i) {
-      if (point4[3] < point4[i]) break;
-    }
-    if (i == 4 && point4[3] > t_value) {
-      tmp_node.indx = channel_offset + (input_h - 1) * input_w + input_w - 1;
-      tmp_node.value = point4[3];
-      node.emplace_back(tmp_node);
-    }
-
-    // top + bottom
-    for (int w = 1; w < input_w - 1; ++w) {
-      i = 0;
-      float cur_value = iptr[w];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[w + edge1[i]]) break;
-      }
-      if (i == 5 && cur_value > t_value) {
-        tmp_node.indx = channel_offset + w;
-        tmp_node.value = cur_value;
-        node.emplace_back(tmp_node);
-      }
-
-      i = 0;
-      int cur_pos = (input_h - 1) * input_w + w;
-      cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[cur_pos + edge2[i]]) break;
-      }
-      if (i == 5 && cur_value > t_value) {
-        tmp_node.indx = channel_offset + cur_pos;
-        tmp_node.value = cur_value;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    // left + right
-    for (int h = 1; h < input_h - 1; ++h) {
-      i = 0;
-      int cur_pos = h * input_w;
-      float cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (cur_value < iptr[cur_pos + edge3[i]]) break;
-      }
-      if (i == 5 && cur_value > t_value) {
-        tmp_node.indx = channel_offset + cur_pos;
-        tmp_node.value = cur_value;
-        node.emplace_back(tmp_node);
-      }
-
-      i = 0;
-      cur_pos = h * input_w + input_w - 1;
-      cur_value = iptr[cur_pos];
-      for (; i < 5; ++i) {
-        if (iptr[cur_pos] < iptr[cur_pos + edge4[i]]) break;
-      }
-      if (i == 5 && cur_value > t_value) {
-        tmp_node.indx = channel_offset + cur_pos;
-        tmp_node.value = cur_value;
-        node.emplace_back(tmp_node);
-      }
-    }
-
-    // center
-    for (int h = 1; h < input_h - 1; h++) {
-      int offset = h * input_w;
-      for (int w = 1; w < input_w - 1; w++) {
-        int cur_pos = offset + w;
-        float cur_value = iptr[cur_pos];
-        i = 0;
-        for (; i < 8; ++i) {
-          if (cur_value < iptr[cur_pos + pos[i]]) break;
-        }
-        if (i == 8 && cur_value > t_value) {
-          tmp_node.indx = channel_offset + cur_pos;
-          tmp_node.value = cur_value;
-          node.emplace_back(tmp_node);
-        }
-      }
-    }
-  }
-  return 0;
+void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor, CenternetPostProcessInfo_t *post_info, int layer){
+  CenternetResnet101Decode(&default_centernet_context, nms_tensor, wh_tensor,
+                           reg_tensor, post_info, layer);
 }
 
-void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor, CenternetPostProcessInfo_t *post_info, int layer) {
+
+static int CenternetDecode(CenternetContext *context, hbDNNTensor *nms_tensor,
+                           hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor,
+                           CenternetPostProcessInfo_t *post_info, int layer) {
 
   int h_index{2}, w_index{3}, c_index{1};
   int *shape = nms_tensor->properties.validShape.dimensionSize;
@@ -762,39 +384,55 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
   // Determine whether the model contains a dequnatize node by the first tensor
   auto quanti_type = nms_tensor->properties.quantiType;
 
-  std::vector<DataNode> node;
   float t_value =
       log(post_info->score_threshold / (1.f - post_info->score_threshold));  // ln (2.f/3.f)
+  int topk;
   if (quanti_type == hbDNNQuantiType::NONE) {
-    NMSMaxPool2d(nms_tensor, node, t_value);
+    topk = HeatmapPeakExtract(
+        &context->peak_extractor,
+        reinterpret_cast<float *>(nms_tensor->sysMem[0].virAddr),
+        shape[c_index], shape[h_index], shape[w_index], t_value,
+        post_info->nms_top_k);
   } else if (quanti_type == hbDNNQuantiType::SCALE) {
     auto &scales0 = nms_tensor->properties.scale.scaleData;
-    NMSMaxPool2dDequanti(nms_tensor, node, t_value, scales0);
+    topk = HeatmapPeakExtractQuanti(
+        &context->peak_extractor,
+        reinterpret_cast<int32_t *>(nms_tensor->sysMem[0].virAddr), scales0,
+        shape[c_index], shape[h_index], shape[w_index], t_value,
+        post_info->nms_top_k);
   } else {
     printf("centernet unsupport shift dequantzie now!\n");
-    return;
+    return -1;
   }
-
-  int topk = node.size() > post_info->nms_top_k ? post_info->nms_top_k : node.size();
-  if (topk != 0) top_k_helper(node.data(), topk, node.size());
+  if (topk < 0) {
+    return -1;
+  }
+  // 按得分从大到小排列
+  HeatmapPeak *node = context->peak_extractor.peaks;
 
   std::vector<float> reg_x(topk);
   std::vector<float> reg_y(topk);
   std::vector<Detection> tmp_box(topk);
 
+  // topk 个候选的 sigmoid 一次算完
+  std::vector<float> topk_scores(topk);
+  for (int i = 0; i < topk; i++) {
+    topk_scores[i] = node[i].value;
+  }
+  ActivationSigmoidF32(topk_scores.data(), topk, topk_scores.data());
+
   if (quanti_type == hbDNNQuantiType::NONE) {
     float *wh = reinterpret_cast<float *>(wh_tensor->sysMem[0].virAddr);
     float *reg = reinterpret_cast<float *>(reg_tensor->sysMem[0].virAddr);
 
     for (int i = 0; i < topk; i++) {
-      // float topk_score = 1.0 / (1.0 + exp(-node[i].value));
-      float topk_score = 1.0 / (1.0 + fastExp(-node[i].value));
+      float topk_score = topk_scores[i];
       if (topk_score <= post_info->score_threshold) {
         continue;
       }
 
-      int topk_clses = node[i].indx / area;
-      int topk_inds = node[i].indx % area;
+      int topk_clses = node[i].index / area;
+      int topk_inds = node[i].index % area;
       float topk_ys = static_cast<float>(topk_inds / shape[w_index]);
       float topk_xs = static_cast<float>(topk_inds % shape[w_index]);
 
@@ -809,7 +447,7 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
       tmp_box[i].score = topk_score;
       tmp_box[i].id = topk_clses;
       tmp_box[i].class_name = default_ptq_centernet_config.class_names[topk_clses].c_str();
-      centernet_dets.push_back(tmp_box[i]);
+      context->dets.push_back(tmp_box[i]);
     }
 
   } else if (quanti_type == hbDNNQuantiType::SCALE) {
@@ -818,14 +456,13 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
     int32_t *wh = reinterpret_cast<int32_t *>(wh_tensor->sysMem[0].virAddr);
 
     for (int i = 0; i < topk; i++) {
-      // float topk_score = 1.0 / (1.0 + exp(-node[i].value));
-      float topk_score = 1.0 / (1.0 + fastExp(-node[i].value));
+      float topk_score = topk_scores[i];
       if (topk_score <= post_info->score_threshold) {
         continue;
       }
 
-      int topk_clses = node[i].indx / area;
-      int topk_inds = node[i].indx % area;
+      int topk_clses = node[i].index / area;
+      int topk_inds = node[i].index % area;
       float topk_ys = static_cast<float>(topk_inds / shape[w_index]);
       float topk_xs = static_cast<float>(topk_inds % shape[w_index]);
 
@@ -848,15 +485,15 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
       tmp_box[i].score = topk_score;
       tmp_box[i].id = topk_clses;
       tmp_box[i].class_name = default_ptq_centernet_config.class_names[topk_clses].c_str();
-      centernet_dets.push_back(tmp_box[i]);
+      context->dets.push_back(tmp_box[i]);
     }
   } else {
     printf("centernet unsupport shift dequantzie now!\n");
-    return;
+    return -1;
   }
 
-  auto &detections = centernet_dets;
-  int det_num = centernet_dets.size();
+  auto &detections = context->dets;
+  int det_num = context->dets.size();
   printf("det.size(): %d\n", det_num);
   for (int i = 0; i < det_num; i++) {
     detections[i].bbox.xmin = detections[i].bbox.xmin * scale_x - offset_x;
@@ -865,19 +502,24 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
     detections[i].bbox.ymax = detections[i].bbox.ymax * scale_y - offset_y;
   }
 
-  return;
+  return 0;
+}
 
+void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor, CenternetPostProcessInfo_t *post_info, int layer) {
+  CenternetDecode(&default_centernet_context, nms_tensor, wh_tensor,
+                  reg_tensor, post_info, layer);
 }
 
-char* CenternetPostProcess(CenternetPostProcessInfo_t *post_info) {
+static char *CenternetEmit(CenternetContext *context,
+                           CenternetPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
 
   std::stringstream out_string;
-  std::vector<Detection> centernet_det_restuls;
+  std::vector<Detection> &centernet_det_restuls = context->results;
 
-  centernet_det_restuls = centernet_dets;
+  centernet_det_restuls = context->dets;
   // 算法结果转换成json格式
   int centernet_det_restuls_size = centernet_det_restuls.size();
   out_string << "\"centernet_result\": [";
@@ -893,8 +535,71 @@ char* CenternetPostProcess(CenternetPostProcessInfo_t *post_info) {
   str_dets[out_string.str().length()] = '\0';
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_dets: %s\n", str_dets);
-  centernet_dets.clear();
+  context->dets.clear();
   centernet_det_restuls.clear();
   return str_dets;
 }
 
+
+char* CenternetPostProcess(CenternetPostProcessInfo_t *post_info) {
+  return CenternetEmit(&default_centernet_context, post_info);
+}
+
+static void *CenternetContextCreate(void) {
+  return new CenternetContext();
+}
+
+static void CenternetContextDestroy(void *context) {
+  delete static_cast<CenternetContext *>(context);
+}
+
+// 每层 3 个输出：heatmap、wh、reg
+static int CenternetPluginDecode(void *context, hbDNNTensor *tensors,
+                                 int tensor_num, PostProcessInfo_t *post_info,
+                                 int layer) {
+  if (tensor_num < 3) {
+    printf("centernet needs 3 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return CenternetDecode(
+      static_cast<CenternetContext *>(context), &tensors[0], &tensors[1],
+      &tensors[2], reinterpret_cast<CenternetPostProcessInfo_t *>(post_info),
+      layer);
+}
+
+static int CenternetResnet101PluginDecode(void *context, hbDNNTensor *tensors,
+                                          int tensor_num,
+                                          PostProcessInfo_t *post_info,
+                                          int layer) {
+  if (tensor_num < 3) {
+    printf("centernet needs 3 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return CenternetResnet101Decode(
+      static_cast<CenternetContext *>(context), &tensors[0], &tensors[1],
+      &tensors[2], reinterpret_cast<CenternetPostProcessInfo_t *>(post_info),
+      layer);
+}
+
+static char *CenternetPluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return CenternetEmit(
+      static_cast<CenternetContext *>(context),
+      reinterpret_cast<CenternetPostProcessInfo_t *>(post_info));
+}
+
+static_assert(sizeof(CenternetPostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "CenternetPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *CenternetPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "centernet", CenternetContextCreate, CenternetContextDestroy,
+      CenternetPluginDecode, CenternetPluginEmit};
+  return &plugin;
+}
+
+const PostProcessPlugin_t *CenternetResnet101PostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "centernet_resnet101", CenternetContextCreate, CenternetContextDestroy,
+      CenternetResnet101PluginDecode, CenternetPluginEmit};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_CENTERNET_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -39,6 +40,12 @@ void CenternetdoProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTe
 
 void Centernet_resnet101_doProcess(hbDNNTensor *nms_tensor, hbDNNTensor *wh_tensor, hbDNNTensor *reg_tensor, CenternetPostProcessInfo_t *post_info, int layer);
 
+/**
+ * 注册表使用的插件，每层 3 个输出 tensor：heatmap、wh、reg
+ */
+const PostProcessPlugin_t *CenternetPostProcessPlugin(void);
+const PostProcessPlugin_t *CenternetResnet101PostProcessPlugin(void);
+
 
 #ifdef __cplusplus
 }
@@ -19,6 +19,7 @@
 #include <queue>
 
 #include "fcos_post_process.h"
+#include "quanti_filter.h"
 
 static inline uint32x4x4_t CalculateIndex(uint32_t idx,
                                           float32x4_t a,
@@ -223,7 +224,19 @@ typedef struct Detection {
   ~Detection() {}
 } Detection;
 
-std::vector<Detection> fcos_dets;
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 FcosPostProcess 时合并输出
+ */
+struct FcosContext {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  // SCALE 输出的整数阈值和按行过滤的候选位置，多帧之间复用
+  std::vector<int32_t> thresholds;
+  std::vector<int32_t> candidates;
+};
+
+// 原有接口使用的默认上下文
+static FcosContext default_fcos_context;
 
 static int get_tensor_hwc_index(hbDNNTensor *tensor,
                          int *h_index,
@@ -300,6 +313,7 @@ static void fcos_nms(std::vector<Detection> &input,
 }
 
 static void GetBboxAndScoresNHWC(
+    FcosContext *context,
     hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors,
     FcosPostProcessInfo_t *post_info, int layer) {
   int ori_h = post_info->ori_height;
@@ -368,12 +382,13 @@ static void GetBboxAndScoresNHWC(
       detection.score = tmp_score.score;
       detection.id = tmp_score.id;
       detection.class_name = fcos_config_.class_names[detection.id].c_str();
-      fcos_dets.push_back(detection);
+      context->dets.push_back(detection);
     }
   }
 }
 
 static void GetBboxAndScoresNCHW(
+    FcosContext *context,
     hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors,
     FcosPostProcessInfo_t *post_info, int layer) {
   int ori_h = post_info->ori_height;
@@ -442,12 +457,12 @@ static void GetBboxAndScoresNCHW(
       detection.score = tmp_score.score;
       detection.id = tmp_score.id;
       detection.class_name = fcos_config_.class_names[detection.id].c_str();
-      fcos_dets.push_back(detection);
+      context->dets.push_back(detection);
     }
   }
 }
 
-void GetBboxAndScoresScaleNCHW(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
+void GetBboxAndScoresScaleNCHW(FcosContext *context, hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
   int ori_h = post_info->ori_height;
   int ori_w = post_info->ori_width;
   int input_h = post_info->height;
@@ -503,12 +518,23 @@ void GetBboxAndScoresScaleNCHW(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tenso
   std::vector<std::vector<ScoreId>> mask_score(
       tensor_h, std::vector<ScoreId>(tensor_w, tmp));
 
+  // pre_thresh 换算成每个通道的整数阈值，按行扫描原始数据，
+  // 只对通过的位置做反量化
+  std::vector<int32_t> &cls_thresholds = context->thresholds;
+  cls_thresholds.resize(tensor_c);
+  QuantiValueThreshold(de_cls, tensor_c, pre_thresh, cls_thresholds.data());
+  std::vector<int32_t> &candidates = context->candidates;
+  candidates.resize(tensor_vw);
+
   for (int c = 0; c < tensor_c; c++) {
     int offset_c = c * aligned_hw;
     for (int h = 0; h < tensor_h; h++) {
       int ce_offset_h = h * tensor_w;
       int offset_h = offset_c + ce_offset_h;
-      for (int w = 0; w < tensor_vw; w++) {
+      int candidate_num = QuantiScanGE(cls_data + offset_h, tensor_vw,
+                                       cls_thresholds[c], candidates.data());
+      for (int i = 0; i < candidate_num; i++) {
+        int w = candidates[i];
         int score_offset = offset_h + w;
         float tmp_score = cls_data[score_offset] * de_cls[c];
         if (tmp_score <= mask_score[h][w].score) continue;
@@ -552,12 +578,12 @@ void GetBboxAndScoresScaleNCHW(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tenso
       detection.score = std::sqrt(tmp_score);
       detection.id = mask_score[h][w].id;
       detection.class_name = fcos_config_.class_names[detection.id].c_str();
-      fcos_dets.push_back(detection);
+      context->dets.push_back(detection);
     }
   }
 }
 
-void GetBboxAndScoresScaleNHWC(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
+void GetBboxAndScoresScaleNHWC(FcosContext *context, hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
   int ori_h = post_info->ori_height;
   int ori_w = post_info->ori_width;
   int input_h = post_info->height;
@@ -633,13 +659,13 @@ void GetBboxAndScoresScaleNHWC(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tenso
       detection.score = tmp_score.score;
       detection.id = tmp_score.id;
       detection.class_name = fcos_config_.class_names[detection.id].c_str();
-      fcos_dets.push_back(detection);
+      context->dets.push_back(detection);
     }
   }
 }
 
 //for community_qat_ support
-void GetBboxAndScoresScaleNHWC_V2(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
+void GetBboxAndScoresScaleNHWC_V2(FcosContext *context, hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
 
   // preprocess action is pad and resize
   auto *cls_data = reinterpret_cast<int32_t *>(cls_tensors->sysMem[0].virAddr);
@@ -661,14 +687,29 @@ void GetBboxAndScoresScaleNHWC_V2(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_te
   int32_t bbox_c_stride=bbox_tensors->properties.alignedShape.dimensionSize[3];
   int32_t ce_c_stride=ce_tensors->properties.alignedShape.dimensionSize[3];
 
+  // sqrt(sigmoid(cls) * sigmoid(ce)) > score_threshold 要求 sigmoid(cls) 和
+  // sigmoid(ce) 都大于 score_threshold^2，先在原始整数上过滤
+  float pre_score = post_info->score_threshold > 0.f
+                        ? post_info->score_threshold * post_info->score_threshold
+                        : 0.f;
+  int32_t ce_threshold;
+  QuantiSigmoidThreshold(ce_scale, 1, pre_score, &ce_threshold);
+  std::vector<int32_t> &cls_thresholds = context->thresholds;
+  cls_thresholds.resize(tensor_c);
+  QuantiSigmoidThreshold(cls_scale, tensor_c, pre_score, cls_thresholds.data());
 
   for (int h = 0; h < tensor_h; h++) {
     for (int w = 0; w < tensor_w; w++) {
       // get score
       int ce_offset = (h * tensor_w + w) * ce_c_stride;
+      int cls_offset = (h * tensor_w + w) * tensor_c;
+      if (ce_data[ce_offset] < ce_threshold ||
+          !QuantiAnyGE(cls_data + cls_offset, cls_thresholds.data(),
+                       tensor_c)) {
+        continue;
+      }
       float ce_data_offset =
           1.0 / (1.0 + exp(-ce_data[ce_offset] * ce_scale[0]));
-      int cls_offset = (h * tensor_w + w) * tensor_c;
       auto max_score_id =
           MaxScoreID(cls_data + cls_offset, cls_scale, tensor_c);
       // filter
@@ -698,47 +739,57 @@ void GetBboxAndScoresScaleNHWC_V2(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_te
       detection.score = score;
       detection.id = max_score_id.second;
       detection.class_name = fcos_config_.class_names[detection.id].c_str();
-      fcos_dets.push_back(detection);
+      context->dets.push_back(detection);
     }
   }
 
 }
 
-void FcosdoProcess(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
+static int FcosDecode(FcosContext *context, hbDNNTensor *cls_tensors,
+                      hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors,
+                      FcosPostProcessInfo_t *post_info, int layer) {
 
   auto quanti_type = cls_tensors->properties.quantiType;
 
   if (quanti_type == hbDNNQuantiType::SCALE) {
       if (cls_tensors->properties.tensorLayout == HB_DNN_LAYOUT_NHWC) {
-        // GetBboxAndScoresScaleNHWC(cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
-        GetBboxAndScoresScaleNHWC_V2(cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
+        // GetBboxAndScoresScaleNHWC(context, cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
+        GetBboxAndScoresScaleNHWC_V2(context, cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
       } else if (cls_tensors->properties.tensorLayout == HB_DNN_LAYOUT_NCHW) {
-        GetBboxAndScoresScaleNCHW(cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
+        GetBboxAndScoresScaleNCHW(context, cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
       } else {
         printf("tensor layout error.\n");
+        return -1;
       }
     } else if (quanti_type == hbDNNQuantiType::NONE) {
       if (cls_tensors->properties.tensorLayout == HB_DNN_LAYOUT_NHWC) {
-        GetBboxAndScoresNHWC(cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
+        GetBboxAndScoresNHWC(context, cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
       } else if (cls_tensors->properties.tensorLayout == HB_DNN_LAYOUT_NCHW) {
-        GetBboxAndScoresNCHW(cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
+        GetBboxAndScoresNCHW(context, cls_tensors, bbox_tensors, ce_tensors, post_info, layer);
       } else {
         printf("tensor layout error.\n");
+        return -1;
       }
     } else {
       printf("error quanti_type: %d\n", quanti_type);
+      return -1;
     }
+  return 0;
+}
 
+void FcosdoProcess(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) {
+  FcosDecode(&default_fcos_context, cls_tensors, bbox_tensors, ce_tensors,
+             post_info, layer);
 }
 
-char* FcosPostProcess(FcosPostProcessInfo_t *post_info) {
+static char *FcosEmit(FcosContext *context, FcosPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
 
-  std::vector<Detection> fcos_det_restuls;
+  std::vector<Detection> &fcos_det_restuls = context->results;
   // 计算交并比来合并检测框，传入交并比阈值和返回box数量
-  fcos_nms(fcos_dets, post_info->nms_threshold, post_info->nms_top_k, fcos_det_restuls, false);
+  fcos_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, fcos_det_restuls, false);
 
   std::stringstream out_string;
 
@@ -757,8 +808,56 @@ char* FcosPostProcess(FcosPostProcessInfo_t *post_info) {
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   /*printf("str_dets: %s\n", str_dets);*/
 
-  fcos_dets.clear();
+  context->dets.clear();
   fcos_det_restuls.clear();
   return str_dets;
 }
 
+
+char* FcosPostProcess(FcosPostProcessInfo_t *post_info) {
+  return FcosEmit(&default_fcos_context, post_info);
+}
+
+static void *FcosContextCreate(void) {
+  return new FcosContext();
+}
+
+static void FcosContextDestroy(void *context) {
+  delete static_cast<FcosContext *>(context);
+}
+
+// 每层 3 个输出：cls、bbox、centerness
+static int FcosPluginDecode(void *context, hbDNNTensor *tensors,
+                            int tensor_num, PostProcessInfo_t *post_info,
+                            int layer) {
+  if (tensor_num < 3) {
+    printf("fcos needs 3 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return FcosDecode(static_cast<FcosContext *>(context), &tensors[0],
+                    &tensors[1], &tensors[2],
+                    reinterpret_cast<FcosPostProcessInfo_t *>(post_info),
+                    layer);
+}
+
+static char *FcosPluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return FcosEmit(static_cast<FcosContext *>(context),
+                  reinterpret_cast<FcosPostProcessInfo_t *>(post_info));
+}
+
+static void FcosPluginMerge(void *context, void *worker) {
+  auto &dets = static_cast<FcosContext *>(context)->dets;
+  auto &worker_dets = static_cast<FcosContext *>(worker)->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+}
+
+static_assert(sizeof(FcosPostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "FcosPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *FcosPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "fcos", FcosContextCreate, FcosContextDestroy, FcosPluginDecode,
+      FcosPluginEmit, FcosPluginMerge};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_FCOS_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -38,6 +39,11 @@ typedef struct {
 
   void FcosdoProcess(hbDNNTensor *cls_tensors, hbDNNTensor *bbox_tensors, hbDNNTensor *ce_tensors, FcosPostProcessInfo_t *post_info, int layer) ;
 
+  /**
+   * 注册表使用的插件，每层 3 个输出 tensor：cls、bbox、centerness
+   */
+  const PostProcessPlugin_t *FcosPostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,270 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <limits>
+
+#include "heatmap_peak.h"
+#include "quanti_filter.h"
+
+template <typename T>
+struct PeakOps;
+
+template <>
+struct PeakOps<float> {
+  typedef float32x4_t Vec;
+  static Vec Load(const float *p) { return vld1q_f32(p); }
+  static void Store(float *p, Vec v) { vst1q_f32(p, v); }
+  static Vec Dup(float x) { return vdupq_n_f32(x); }
+  static Vec Max(Vec a, Vec b) { return vmaxq_f32(a, b); }
+  static uint32x4_t Eq(Vec a, Vec b) { return vceqq_f32(a, b); }
+  static uint32x4_t Ge(Vec a, Vec b) { return vcgeq_f32(a, b); }
+};
+
+template <>
+struct PeakOps<int32_t> {
+  typedef int32x4_t Vec;
+  static Vec Load(const int32_t *p) { return vld1q_s32(p); }
+  static void Store(int32_t *p, Vec v) { vst1q_s32(p, v); }
+  static Vec Dup(int32_t x) { return vdupq_n_s32(x); }
+  static Vec Max(Vec a, Vec b) { return vmaxq_s32(a, b); }
+  static uint32x4_t Eq(Vec a, Vec b) { return vceqq_s32(a, b); }
+  static uint32x4_t Ge(Vec a, Vec b) { return vcgeq_s32(a, b); }
+};
+
+void HeatmapPeakRelease(HeatmapPeakExtractor *extractor) {
+  free(extractor->rows);
+  free(extractor->thresholds);
+  free(extractor->peaks);
+  extractor->rows = nullptr;
+  extractor->row_bytes = 0;
+  extractor->thresholds = nullptr;
+  extractor->threshold_bytes = 0;
+  extractor->peaks = nullptr;
+  extractor->peak_capacity = 0;
+  extractor->peak_num = 0;
+}
+
+static void *ReserveBuffer(void **buffer, int *capacity, int size) {
+  if (*capacity < size) {
+    void *data = realloc(*buffer, size);
+    if (data == nullptr) {
+      printf("heatmap peak alloc failed, size: %d\n", size);
+      return nullptr;
+    }
+    *buffer = data;
+    *capacity = size;
+  }
+  return *buffer;
+}
+
+static int PushPeak(HeatmapPeakExtractor *extractor, float value,
+                    int32_t index) {
+  if (extractor->peak_num == extractor->peak_capacity) {
+    int capacity = std::max(256, extractor->peak_capacity * 2);
+    auto *peaks = static_cast<HeatmapPeak *>(
+        realloc(extractor->peaks, capacity * sizeof(HeatmapPeak)));
+    if (peaks == nullptr) {
+      return -1;
+    }
+    extractor->peaks = peaks;
+    extractor->peak_capacity = capacity;
+  }
+  extractor->peaks[extractor->peak_num].value = value;
+  extractor->peaks[extractor->peak_num].index = index;
+  extractor->peak_num++;
+  return 0;
+}
+
+template <typename T>
+static bool RowAnyGE(const T *row, int width, T threshold) {
+  typedef PeakOps<T> Ops;
+  int x = 0;
+  uint32x4_t hit = vdupq_n_u32(0);
+  typename Ops::Vec thr = Ops::Dup(threshold);
+  for (; x <= width - 4; x += 4) {
+    hit = vorrq_u32(hit, Ops::Ge(Ops::Load(row + x), thr));
+  }
+  if (vmaxvq_u32(hit) != 0) {
+    return true;
+  }
+  for (; x < width; x++) {
+    if (row[x] >= threshold) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// 一行的水平 3 邻域最大值，结果按行号缓存在 3 行的环形缓冲中
+template <typename T>
+static const T *RowMax(HeatmapPeakExtractor *extractor, const T *plane,
+                       int y, int width) {
+  typedef PeakOps<T> Ops;
+  int slot = y % 3;
+  T *out = static_cast<T *>(extractor->rows) + slot * width;
+  if (extractor->row_index[slot] == y) {
+    return out;
+  }
+  extractor->row_index[slot] = y;
+
+  const T *row = plane + y * width;
+  if (width == 1) {
+    out[0] = row[0];
+    return out;
+  }
+  out[0] = std::max(row[0], row[1]);
+  int x = 1;
+  for (; x <= width - 5; x += 4) {
+    typename Ops::Vec value =
+        Ops::Max(Ops::Load(row + x - 1), Ops::Load(row + x));
+    Ops::Store(out + x, Ops::Max(value, Ops::Load(row + x + 1)));
+  }
+  for (; x < width - 1; x++) {
+    out[x] = std::max(std::max(row[x - 1], row[x]), row[x + 1]);
+  }
+  out[width - 1] = std::max(row[width - 2], row[width - 1]);
+  return out;
+}
+
+// raw_thresholds 为每个通道的 raw 阈值（>=），通过的点再用 dequanti 得到的值
+// 和 threshold 做精确比较（>）
+template <typename T, typename Dequanti>
+static int ExtractPeaks(HeatmapPeakExtractor *extractor, const T *data,
+                        const T *raw_thresholds, int channels, int height,
+                        int width, float threshold, int top_k,
+                        Dequanti dequanti) {
+  typedef PeakOps<T> Ops;
+  extractor->peak_num = 0;
+  if (channels <= 0 || height <= 0 || width <= 0 || top_k <= 0) {
+    return 0;
+  }
+
+  if (ReserveBuffer(&extractor->rows, &extractor->row_bytes,
+                    3 * width * sizeof(T)) == nullptr) {
+    return -1;
+  }
+
+  int area = height * width;
+  for (int c = 0; c < channels; c++) {
+    const T *plane = data + c * area;
+    T raw_threshold = raw_thresholds[c];
+    typename Ops::Vec thr = Ops::Dup(raw_threshold);
+    for (int i = 0; i < 3; i++) {
+      extractor->row_index[i] = -1;
+    }
+
+    for (int y = 0; y < height; y++) {
+      const T *row = plane + y * width;
+      // 先按阈值过滤，绝大多数行没有候选点，不需要做 max-pool
+      if (!RowAnyGE(row, width, raw_threshold)) {
+        continue;
+      }
+      const T *max_up =
+          y > 0 ? RowMax(extractor, plane, y - 1, width) : nullptr;
+      const T *max_cur = RowMax(extractor, plane, y, width);
+      const T *max_down =
+          y < height - 1 ? RowMax(extractor, plane, y + 1, width) : nullptr;
+
+      int x = 0;
+      for (; x < width; x += 4) {
+        int lanes = std::min(4, width - x);
+        uint32_t mask[4] = {0, 0, 0, 0};
+        if (lanes == 4) {
+          typename Ops::Vec pool = Ops::Load(max_cur + x);
+          if (max_up != nullptr) pool = Ops::Max(pool, Ops::Load(max_up + x));
+          if (max_down != nullptr) {
+            pool = Ops::Max(pool, Ops::Load(max_down + x));
+          }
+          typename Ops::Vec value = Ops::Load(row + x);
+          uint32x4_t peak =
+              vandq_u32(Ops::Eq(value, pool), Ops::Ge(value, thr));
+          if (vmaxvq_u32(peak) == 0) {
+            continue;
+          }
+          vst1q_u32(mask, peak);
+        } else {
+          for (int j = 0; j < lanes; j++) {
+            T pool = max_cur[x + j];
+            if (max_up != nullptr) pool = std::max(pool, max_up[x + j]);
+            if (max_down != nullptr) pool = std::max(pool, max_down[x + j]);
+            T value = row[x + j];
+            mask[j] = (value == pool && value >= raw_threshold) ? 1 : 0;
+          }
+        }
+        for (int j = 0; j < lanes; j++) {
+          if (mask[j] == 0) {
+            continue;
+          }
+          float value = dequanti(row[x + j], c);
+          if (value > threshold &&
+              PushPeak(extractor, value, c * area + y * width + x + j) != 0) {
+            printf("heatmap peak alloc failed, num: %d\n",
+                   extractor->peak_num);
+            return -1;
+          }
+        }
+      }
+    }
+  }
+
+  // 只在通过阈值的候选中选 topk
+  auto greater = [](const HeatmapPeak &a, const HeatmapPeak &b) {
+    return a.value > b.value || (a.value == b.value && a.index < b.index);
+  };
+  HeatmapPeak *peaks = extractor->peaks;
+  int num = extractor->peak_num;
+  if (num > top_k) {
+    std::nth_element(peaks, peaks + top_k, peaks + num, greater);
+    num = top_k;
+  }
+  std::sort(peaks, peaks + num, greater);
+  extractor->peak_num = num;
+  return num;
+}
+
+int HeatmapPeakExtract(HeatmapPeakExtractor *extractor, const float *data,
+                       int channels, int height, int width, float threshold,
+                       int top_k) {
+  // value > threshold 等价于 value >= threshold 的下一个 float
+  float raw_threshold =
+      std::nextafter(threshold, std::numeric_limits<float>::infinity());
+  auto *raw_thresholds = static_cast<float *>(
+      ReserveBuffer(&extractor->thresholds, &extractor->threshold_bytes,
+                    std::max(channels, 1) * sizeof(float)));
+  if (raw_thresholds == nullptr) {
+    return -1;
+  }
+  std::fill(raw_thresholds, raw_thresholds + std::max(channels, 0),
+            raw_threshold);
+  return ExtractPeaks(extractor, data, raw_thresholds, channels, height, width,
+                      threshold, top_k, [](float value, int) { return value; });
+}
+
+int HeatmapPeakExtractQuanti(HeatmapPeakExtractor *extractor,
+                             const int32_t *data, const float *scale,
+                             int channels, int height, int width,
+                             float threshold, int top_k) {
+  auto *raw_thresholds = static_cast<int32_t *>(
+      ReserveBuffer(&extractor->thresholds, &extractor->threshold_bytes,
+                    std::max(channels, 1) * sizeof(int32_t)));
+  if (raw_thresholds == nullptr) {
+    return -1;
+  }
+  QuantiValueThreshold(scale, channels, threshold, raw_thresholds);
+  return ExtractPeaks(extractor, data, raw_thresholds, channels, height, width,
+                      threshold, top_k,
+                      [scale](int32_t value, int c) {
+                        return static_cast<float>(value) * scale[c];
+                      });
+}
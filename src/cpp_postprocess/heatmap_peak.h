@@ -0,0 +1,71 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_HEATMAP_PEAK_H_
+#define _POST_PROCESS_HEATMAP_PEAK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * CenterNet 类 heatmap 的峰值提取（3x3 max-pool NMS + topk）
+ *
+ * 每一行先用 NEON 判断有没有超过阈值的点，没有就整行跳过；有的话才按需计算
+ * 上下三行的水平 3 邻域最大值（可分离的 3x3 max-pool，结果按行缓存），
+ * 等于 3x3 最大值且超过阈值的点为峰值。图像边界外的点不参与比较。
+ * 候选点只在通过阈值后才记录，最后在候选中选出 topk。
+ */
+
+typedef struct {
+  float value;          // 反量化后的值
+  int32_t index;        // c * height * width + y * width + x
+} HeatmapPeak;
+
+/**
+ * 中间结果和输出的内存，按需扩大，多帧之间复用。零初始化即可使用
+ */
+typedef struct {
+  void *rows;           // 3 行水平最大值
+  int row_bytes;
+  int row_index[3];
+  void *thresholds;     // 每个通道的 raw 阈值
+  int threshold_bytes;
+  HeatmapPeak *peaks;   // 输出，按 value 从大到小排序
+  int peak_capacity;
+  int peak_num;
+} HeatmapPeakExtractor;
+
+void HeatmapPeakRelease(HeatmapPeakExtractor *extractor);
+
+/**
+ * float heatmap，NCHW 排列
+ * @param[in] threshold: 峰值需要大于 threshold
+ * @param[in] top_k: 最多输出的个数
+ * @return 输出的峰值个数，结果在 extractor->peaks 中；失败返回 -1
+ */
+int HeatmapPeakExtract(HeatmapPeakExtractor *extractor, const float *data,
+                       int channels, int height, int width, float threshold,
+                       int top_k);
+
+/**
+ * SCALE 量化的 int32 heatmap，scale 为每个通道的反量化系数，
+ * 在整数上做 max-pool，只有候选点才反量化
+ */
+int HeatmapPeakExtractQuanti(HeatmapPeakExtractor *extractor,
+                             const int32_t *data, const float *scale,
+                             int channels, int height, int width,
+                             float threshold, int top_k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_HEATMAP_PEAK_H_
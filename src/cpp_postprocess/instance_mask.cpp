@@ -0,0 +1,155 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <cmath>
+#include <cstdio>
+#include <limits>
+
+#include "instance_mask.h"
+
+static inline float32x4_t LoadPrototype(const InstancePrototype_t *proto,
+                                        int64_t offset) {
+  if (proto->data_f32 != nullptr) {
+    return vld1q_f32(proto->data_f32 + offset);
+  }
+  return vcvtq_f32_s32(vld1q_s32(proto->data_s32 + offset));
+}
+
+static inline float PrototypeValue(const InstancePrototype_t *proto,
+                                   int64_t offset) {
+  if (proto->data_f32 != nullptr) {
+    return proto->data_f32[offset];
+  }
+  return static_cast<float>(proto->data_s32[offset]);
+}
+
+static float PixelLogit(const InstancePrototype_t *proto,
+                        const float *coefficients, int64_t offset) {
+  float sum = 0.f;
+  for (int k = 0; k < proto->channel; k++) {
+    sum += coefficients[k] *
+           PrototypeValue(proto, offset + k * proto->channel_step);
+  }
+  return sum;
+}
+
+// NHWC：一个像素的原型连续，4 个像素各自做点积，再用 vpaddq 归约到一个向量
+static float32x4_t DotPixels4(const InstancePrototype_t *proto,
+                              const float *coefficients, int64_t offset) {
+  float32x4_t acc[4];
+  for (int p = 0; p < 4; p++) {
+    acc[p] = vdupq_n_f32(0.f);
+  }
+  int k = 0;
+  for (; k <= proto->channel - 4; k += 4) {
+    float32x4_t coefficient = vld1q_f32(coefficients + k);
+    for (int p = 0; p < 4; p++) {
+      acc[p] = vfmaq_f32(
+          acc[p], LoadPrototype(proto, offset + p * proto->pixel_step + k),
+          coefficient);
+    }
+  }
+  float32x4_t sum =
+      vpaddq_f32(vpaddq_f32(acc[0], acc[1]), vpaddq_f32(acc[2], acc[3]));
+  if (k < proto->channel) {
+    float tail[4] = {0.f, 0.f, 0.f, 0.f};
+    for (int p = 0; p < 4; p++) {
+      for (int i = k; i < proto->channel; i++) {
+        tail[p] += coefficients[i] *
+                   PrototypeValue(proto, offset + p * proto->pixel_step + i);
+      }
+    }
+    sum = vaddq_f32(sum, vld1q_f32(tail));
+  }
+  return sum;
+}
+
+// NCHW：一个通道平面上相邻像素连续，逐个通道累加 4 个像素
+static float32x4_t AxpyPixels4(const InstancePrototype_t *proto,
+                               const float *coefficients, int64_t offset) {
+  float32x4_t acc = vdupq_n_f32(0.f);
+  for (int k = 0; k < proto->channel; k++) {
+    acc = vfmaq_f32(acc,
+                    LoadPrototype(proto, offset + k * proto->channel_step),
+                    vdupq_n_f32(coefficients[k]));
+  }
+  return acc;
+}
+
+int InstanceMaskCrop(const InstancePrototype_t *proto,
+                     const float *coefficients, int x0, int y0, int x1, int y1,
+                     float threshold, uint8_t *bitmap) {
+  if (proto == nullptr || coefficients == nullptr || bitmap == nullptr ||
+      (proto->data_f32 == nullptr) == (proto->data_s32 == nullptr)) {
+    printf("instance mask invalid param\n");
+    return -1;
+  }
+  if (x0 < 0 || y0 < 0 || x1 > proto->width || y1 > proto->height ||
+      x0 > x1 || y0 > y1) {
+    printf("instance mask crop [%d, %d, %d, %d] out of prototype %dx%d\n", x0,
+           y0, x1, y1, proto->width, proto->height);
+    return -1;
+  }
+
+  // sigmoid(x) > threshold 等价于 x > log(threshold / (1 - threshold))
+  float logit_threshold;
+  if (threshold <= 0) {
+    logit_threshold = -std::numeric_limits<float>::infinity();
+  } else if (threshold >= 1) {
+    logit_threshold = std::numeric_limits<float>::infinity();
+  } else {
+    logit_threshold = std::log(threshold / (1 - threshold));
+  }
+  float32x4_t limit = vdupq_n_f32(logit_threshold);
+
+  bool pixel_major = proto->channel_step == 1;
+  bool channel_major = proto->pixel_step == 1;
+  int width = x1 - x0;
+  for (int y = y0; y < y1; y++) {
+    uint8_t *row = bitmap + static_cast<int64_t>(y - y0) * width;
+    int64_t base = static_cast<int64_t>(y) * proto->row_step;
+    int x = x0;
+    if (pixel_major || channel_major) {
+      for (; x <= x1 - 4; x += 4) {
+        int64_t offset = base + static_cast<int64_t>(x) * proto->pixel_step;
+        float32x4_t logit = pixel_major
+                                ? DotPixels4(proto, coefficients, offset)
+                                : AxpyPixels4(proto, coefficients, offset);
+        uint32_t hit[4];
+        vst1q_u32(hit, vcgtq_f32(logit, limit));
+        for (int i = 0; i < 4; i++) {
+          row[x - x0 + i] = hit[i] & 1;
+        }
+      }
+    }
+    for (; x < x1; x++) {
+      int64_t offset = base + static_cast<int64_t>(x) * proto->pixel_step;
+      row[x - x0] = PixelLogit(proto, coefficients, offset) > logit_threshold;
+    }
+  }
+  return 0;
+}
+
+int InstanceMaskEncodeRle(const uint8_t *bitmap, int count, int *counts) {
+  int num = 0;
+  int run = 0;
+  uint8_t value = 0;
+  for (int i = 0; i < count; i++) {
+    uint8_t bit = bitmap[i] != 0;
+    if (bit != value) {
+      counts[num++] = run;
+      run = 0;
+      value = bit;
+    }
+    run++;
+  }
+  counts[num++] = run;
+  return num;
+}
@@ -0,0 +1,61 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_INSTANCE_MASK_H_
+#define _POST_PROCESS_INSTANCE_MASK_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * 基于原型的实例分割 mask（YOLACT、YOLOv8-seg 一类）
+ *
+ * 每个检测输出 channel 个 mask 系数，mask = sigmoid(系数 · 原型)。只对 NMS 后
+ * 保留的检测、只在检测框覆盖的原型区域内做矩阵乘，直接按阈值得到裁剪后的
+ * uint8 bitmap，不生成整张原型分辨率或者原图分辨率的 mask。
+ * sigmoid 单调，阈值换算成 logit 后直接比较，不逐像素计算 sigmoid。
+ */
+
+typedef struct {
+	const float *data_f32;        // float 原型，和 data_s32 二选一
+	const int32_t *data_s32;      // SCALE 量化的 int32 原型
+	int height;
+	int width;
+	int channel;                  // 每个像素的原型个数，等于 mask 系数个数
+	int pixel_step;               // 相邻像素之间的元素个数，NHWC 为对齐后的 C
+	int row_step;                 // 相邻行之间的元素个数
+	int channel_step;             // 相邻通道之间的元素个数，NHWC 为 1
+} InstancePrototype_t;
+
+/**
+ * 计算 [x0, x1) x [y0, y1) 区域的 mask
+ * @param[in] coefficients: channel 个系数；int32 原型时需要先乘以原型每个
+ *                          通道的反量化系数
+ * @param[in] threshold: sigmoid 之后的阈值，大于阈值的像素为 1
+ * @param[out] bitmap: (x1 - x0) * (y1 - y0) 个，按行排列，取值 0 / 1
+ * @return 0 if success
+ */
+int InstanceMaskCrop(const InstancePrototype_t *proto,
+                     const float *coefficients, int x0, int y0, int x1, int y1,
+                     float threshold, uint8_t *bitmap);
+
+/**
+ * 按行优先做游程编码，依次为 0、1 交替的长度，第一个为 0 的长度（可以为 0）
+ * @param[out] counts: 最多 count + 1 个
+ * @return counts 的个数
+ */
+int InstanceMaskEncodeRle(const uint8_t *bitmap, int count, int *counts);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_INSTANCE_MASK_H_
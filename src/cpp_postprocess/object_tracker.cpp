@@ -0,0 +1,419 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "object_tracker.h"
+
+// 卡尔曼滤波的噪声按框高的比例设置
+static const float kStdWeightPosition = 1.f / 20;
+static const float kStdWeightVelocity = 1.f / 160;
+
+/**
+ * 一维匀速模型：状态为 (位置, 速度)，观测为位置
+ * 观测向量 (cx, cy, w/h, h) 的 4 个分量噪声互不相关，8 维的卡尔曼滤波
+ * 等价于 4 个独立的一维滤波
+ */
+struct Kalman1D {
+  float x;
+  float v;
+  float p00, p01, p11;      // 协方差
+
+  void Init(float z, float std_x, float std_v) {
+    x = z;
+    v = 0;
+    p00 = std_x * std_x;
+    p01 = 0;
+    p11 = std_v * std_v;
+  }
+
+  void Predict(float std_x, float std_v) {
+    x += v;
+    // P = F P F^T + Q，F = [[1, 1], [0, 1]]
+    p00 += 2 * p01 + p11 + std_x * std_x;
+    p01 += p11;
+    p11 += std_v * std_v;
+  }
+
+  void Update(float z, float std_z) {
+    float s = p00 + std_z * std_z;
+    float k0 = p00 / s;
+    float k1 = p01 / s;
+    float residual = z - x;
+    x += k0 * residual;
+    v += k1 * residual;
+    p11 -= k1 * p01;
+    p01 -= k0 * p01;
+    p00 -= k0 * p00;
+  }
+};
+
+enum TrackState {
+  TRACK_NEW = 0,        // 还没有达到 min_hits
+  TRACK_TRACKED = 1,
+  TRACK_LOST = 2,
+};
+
+struct Track {
+  int track_id;
+  int class_id;
+  float score;
+  int hits;
+  int time_since_update;
+  TrackState state;
+  Kalman1D filter[4];       // cx, cy, w/h, h
+
+  float Height() const { return std::max(filter[3].x, 1e-3f); }
+
+  void Init(const TrackerBox_t &box) {
+    float w = box.xmax - box.xmin;
+    float h = std::max(box.ymax - box.ymin, 1e-3f);
+    float ph = kStdWeightPosition * h;
+    float vh = kStdWeightVelocity * h;
+    filter[0].Init((box.xmin + box.xmax) / 2, 2 * ph, 10 * vh);
+    filter[1].Init((box.ymin + box.ymax) / 2, 2 * ph, 10 * vh);
+    filter[2].Init(w / h, 1e-2f, 1e-5f);
+    filter[3].Init(h, 2 * ph, 10 * vh);
+    class_id = box.id;
+    score = box.score;
+    hits = 1;
+    time_since_update = 0;
+  }
+
+  void Predict() {
+    float ph = kStdWeightPosition * Height();
+    float vh = kStdWeightVelocity * Height();
+    filter[0].Predict(ph, vh);
+    filter[1].Predict(ph, vh);
+    filter[2].Predict(1e-2f, 1e-5f);
+    filter[3].Predict(ph, vh);
+    time_since_update++;
+  }
+
+  void Update(const TrackerBox_t &box) {
+    float w = box.xmax - box.xmin;
+    float h = std::max(box.ymax - box.ymin, 1e-3f);
+    float ph = kStdWeightPosition * Height();
+    filter[0].Update((box.xmin + box.xmax) / 2, ph);
+    filter[1].Update((box.ymin + box.ymax) / 2, ph);
+    filter[2].Update(w / h, 1e-1f);
+    filter[3].Update(h, ph);
+    score = box.score;
+    hits++;
+    time_since_update = 0;
+  }
+
+  TrackerBox_t Box() const {
+    float h = Height();
+    float w = filter[2].x * h;
+    TrackerBox_t box;
+    box.xmin = filter[0].x - w / 2;
+    box.ymin = filter[1].x - h / 2;
+    box.xmax = filter[0].x + w / 2;
+    box.ymax = filter[1].x + h / 2;
+    box.score = score;
+    box.id = class_id;
+    return box;
+  }
+
+  // 中心每帧的位移相对框高的比例
+  float Motion() const {
+    return std::sqrt(filter[0].v * filter[0].v + filter[1].v * filter[1].v) /
+           Height();
+  }
+};
+
+struct ObjectTracker_s {
+  TrackerConfig_t config;
+  std::vector<Track> tracks;
+  int next_id;
+  int frame_num;
+  int frames_since_detect;
+  // 关联时的中间结果，多帧之间复用
+  std::vector<TrackerBox_t> predicted;
+  std::vector<int> track_match;
+  std::vector<int> box_match;
+  struct Pair {
+    float iou;
+    int track;
+    int box;
+  };
+  std::vector<Pair> pairs;
+};
+
+void ObjectTrackerDefaultConfig(TrackerConfig_t *config) {
+  config->high_threshold = 0.5f;
+  config->low_threshold = 0.1f;
+  config->new_track_threshold = 0.6f;
+  config->match_iou = 0.2f;
+  config->low_match_iou = 0.5f;
+  config->min_hits = 2;
+  config->max_age = 30;
+  config->class_aware = 1;
+  config->detect_interval = 1;
+  config->max_detect_interval = 3;
+  config->motion_threshold = 0.05f;
+}
+
+ObjectTracker_t *ObjectTrackerCreate(const TrackerConfig_t *config) {
+  auto *tracker = new ObjectTracker_t();
+  if (config != nullptr) {
+    tracker->config = *config;
+  } else {
+    ObjectTrackerDefaultConfig(&tracker->config);
+  }
+  tracker->next_id = 1;
+  tracker->frame_num = 0;
+  tracker->frames_since_detect = 0;
+  return tracker;
+}
+
+void ObjectTrackerDestroy(ObjectTracker_t *tracker) {
+  delete tracker;
+}
+
+static float IoU(const TrackerBox_t &a, const TrackerBox_t &b) {
+  float w = std::min(a.xmax, b.xmax) - std::max(a.xmin, b.xmin);
+  float h = std::min(a.ymax, b.ymax) - std::max(a.ymin, b.ymin);
+  if (w <= 0 || h <= 0) {
+    return 0;
+  }
+  float inter = w * h;
+  float area_a = (a.xmax - a.xmin) * (a.ymax - a.ymin);
+  float area_b = (b.xmax - b.xmin) * (b.ymax - b.ymin);
+  return inter / (area_a + area_b - inter);
+}
+
+/**
+ * 贪心关联：满足条件的 (轨迹, 检测) 按 IoU 从大到小依次匹配
+ * track_filter / box_filter 为 true 的才参与，结果写入 track_match / box_match
+ */
+template <typename TrackFilter, typename BoxFilter>
+static void Associate(ObjectTracker_t *tracker, const TrackerBox_t *boxes,
+                      int box_num, float min_iou, TrackFilter track_filter,
+                      BoxFilter box_filter) {
+  auto &pairs = tracker->pairs;
+  pairs.clear();
+  int track_num = tracker->tracks.size();
+  for (int t = 0; t < track_num; t++) {
+    if (tracker->track_match[t] >= 0 || !track_filter(t)) {
+      continue;
+    }
+    for (int b = 0; b < box_num; b++) {
+      if (tracker->box_match[b] >= 0 || !box_filter(b)) {
+        continue;
+      }
+      if (tracker->config.class_aware &&
+          tracker->tracks[t].class_id != boxes[b].id) {
+        continue;
+      }
+      float iou = IoU(tracker->predicted[t], boxes[b]);
+      if (iou >= min_iou) {
+        pairs.push_back({iou, t, b});
+      }
+    }
+  }
+  std::sort(pairs.begin(), pairs.end(),
+            [](const ObjectTracker_s::Pair &a, const ObjectTracker_s::Pair &b) {
+              if (a.iou != b.iou) return a.iou > b.iou;
+              if (a.track != b.track) return a.track < b.track;
+              return a.box < b.box;
+            });
+  for (const auto &pair : pairs) {
+    if (tracker->track_match[pair.track] < 0 &&
+        tracker->box_match[pair.box] < 0) {
+      tracker->track_match[pair.track] = pair.box;
+      tracker->box_match[pair.box] = pair.track;
+    }
+  }
+}
+
+static void PredictTracks(ObjectTracker_t *tracker) {
+  for (auto &track : tracker->tracks) {
+    track.Predict();
+  }
+}
+
+// 删除丢失太久的轨迹，保持原有顺序
+static void RemoveTracks(ObjectTracker_t *tracker) {
+  auto &tracks = tracker->tracks;
+  int max_age = tracker->config.max_age;
+  tracks.erase(std::remove_if(tracks.begin(), tracks.end(),
+                              [max_age](const Track &track) {
+                                return track.time_since_update > max_age;
+                              }),
+               tracks.end());
+}
+
+int ObjectTrackerUpdate(ObjectTracker_t *tracker, const TrackerBox_t *boxes,
+                        int box_num) {
+  if (tracker == nullptr || (boxes == nullptr && box_num > 0)) {
+    return -1;
+  }
+  const TrackerConfig_t &config = tracker->config;
+  bool first_frame = tracker->frame_num == 0;
+  tracker->frame_num++;
+  tracker->frames_since_detect = 0;
+
+  PredictTracks(tracker);
+  int track_num = tracker->tracks.size();
+  tracker->predicted.resize(track_num);
+  for (int t = 0; t < track_num; t++) {
+    tracker->predicted[t] = tracker->tracks[t].Box();
+  }
+  tracker->track_match.assign(track_num, -1);
+  tracker->box_match.assign(box_num, -1);
+
+  // 第一轮：高分检测和所有轨迹
+  Associate(tracker, boxes, box_num, config.match_iou,
+            [](int) { return true; },
+            [&](int b) { return boxes[b].score >= config.high_threshold; });
+  // 第二轮：低分检测和剩下的已确认轨迹，低分检测多为被遮挡的目标
+  Associate(tracker, boxes, box_num, config.low_match_iou,
+            [&](int t) { return tracker->tracks[t].state != TRACK_NEW; },
+            [&](int b) {
+              return boxes[b].score >= config.low_threshold &&
+                     boxes[b].score < config.high_threshold;
+            });
+
+  for (int t = 0; t < track_num; t++) {
+    Track &track = tracker->tracks[t];
+    int b = tracker->track_match[t];
+    if (b >= 0) {
+      track.Update(boxes[b]);
+      if (track.state == TRACK_LOST ||
+          (track.state == TRACK_NEW && track.hits >= config.min_hits)) {
+        track.state = TRACK_TRACKED;
+      }
+    } else if (track.state == TRACK_NEW) {
+      // 新轨迹没有连续匹配，认为是误检
+      track.time_since_update = config.max_age + 1;
+    } else {
+      track.state = TRACK_LOST;
+    }
+  }
+  RemoveTracks(tracker);
+
+  for (int b = 0; b < box_num; b++) {
+    if (tracker->box_match[b] >= 0 ||
+        boxes[b].score < config.new_track_threshold) {
+      continue;
+    }
+    Track track;
+    track.Init(boxes[b]);
+    track.track_id = tracker->next_id++;
+    track.state = (first_frame || config.min_hits <= 1) ? TRACK_TRACKED
+                                                       : TRACK_NEW;
+    tracker->tracks.push_back(track);
+  }
+  return 0;
+}
+
+int ObjectTrackerPredict(ObjectTracker_t *tracker) {
+  if (tracker == nullptr) {
+    return -1;
+  }
+  tracker->frame_num++;
+  tracker->frames_since_detect++;
+  PredictTracks(tracker);
+  RemoveTracks(tracker);
+  return 0;
+}
+
+int ObjectTrackerShouldDetect(ObjectTracker_t *tracker) {
+  if (tracker == nullptr || tracker->frame_num == 0) {
+    return 1;
+  }
+  const TrackerConfig_t &config = tracker->config;
+  int interval = config.detect_interval;
+  if (interval <= 0) {
+    // 自适应：最快的目标每帧移动不超过 motion_threshold 个框高
+    float motion = 0;
+    for (const auto &track : tracker->tracks) {
+      if (track.state == TRACK_TRACKED) {
+        motion = std::max(motion, track.Motion());
+      }
+    }
+    interval = config.max_detect_interval;
+    if (motion > 0) {
+      interval = std::min<float>(interval, config.motion_threshold / motion);
+    }
+    interval = std::max(interval, 1);
+  }
+  return tracker->frames_since_detect + 1 >= interval;
+}
+
+int ObjectTrackerGetTracks(ObjectTracker_t *tracker, TrackerTrack_t *tracks,
+                           int max_num) {
+  if (tracker == nullptr) {
+    return 0;
+  }
+  int count = 0;
+  for (const auto &track : tracker->tracks) {
+    if (track.state != TRACK_TRACKED) {
+      continue;
+    }
+    if (tracks != nullptr && count < max_num) {
+      TrackerBox_t box = track.Box();
+      TrackerTrack_t &out = tracks[count];
+      out.track_id = track.track_id;
+      out.class_id = track.class_id;
+      out.score = track.score;
+      out.xmin = box.xmin;
+      out.ymin = box.ymin;
+      out.xmax = box.xmax;
+      out.ymax = box.ymax;
+      out.predicted = track.time_since_update > 0;
+      out.hits = track.hits;
+    }
+    count++;
+  }
+  return count;
+}
+
+int ObjectTrackerParseResult(const char *result, TrackerBox_t *boxes,
+                             int max_num) {
+  if (result == nullptr) {
+    return 0;
+  }
+  static const char kBbox[] = "\"bbox\":[";
+  static const char kScore[] = "\"score\":";
+  static const char kId[] = "\"id\":";
+  int count = 0;
+  const char *p = strstr(result, kBbox);
+  while (p != nullptr) {
+    const char *next = strstr(p + 1, kBbox);
+    TrackerBox_t box;
+    if (sscanf(p + sizeof(kBbox) - 1, "%f,%f,%f,%f", &box.xmin, &box.ymin,
+               &box.xmax, &box.ymax) != 4) {
+      printf("parse bbox failed\n");
+      return -1;
+    }
+    // score / id 只在当前目标内查找
+    const char *score = strstr(p, kScore);
+    const char *id = strstr(p, kId);
+    if (score == nullptr || id == nullptr || (next && score > next) ||
+        (next && id > next) ||
+        sscanf(score + sizeof(kScore) - 1, "%f", &box.score) != 1 ||
+        sscanf(id + sizeof(kId) - 1, "%d", &box.id) != 1) {
+      printf("parse score or id failed\n");
+      return -1;
+    }
+    if (boxes != nullptr && count < max_num) {
+      boxes[count] = box;
+    }
+    count++;
+    p = next;
+  }
+  return count;
+}
@@ -0,0 +1,119 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_OBJECT_TRACKER_H_
+#define _POST_PROCESS_OBJECT_TRACKER_H_
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * 多目标跟踪
+ *
+ * ByteTrack 方式的 IoU 关联：高分检测先和所有轨迹匹配，低分检测再和剩下的
+ * 轨迹匹配，减少遮挡时的 id 切换。每条轨迹用匀速模型的卡尔曼滤波预测
+ * (cx, cy, w/h, h)，没有运行检测的帧只做预测，检测可以隔帧运行。
+ *
+ * 典型用法，每帧：
+ *   if (ObjectTrackerShouldDetect(tracker)) {
+ *     推理 + 后处理，ObjectTrackerParseResult 得到检测框
+ *     ObjectTrackerUpdate(tracker, boxes, box_num);
+ *   } else {
+ *     ObjectTrackerPredict(tracker);
+ *   }
+ *   ObjectTrackerGetTracks(tracker, tracks, max_num);
+ *
+ * 一个 tracker 对应一路视频，同一个 tracker 同一时间只能在一个线程中使用。
+ */
+
+typedef struct {
+	float xmin;
+	float ymin;
+	float xmax;
+	float ymax;
+	float score;
+	int id;                       // 类别
+} TrackerBox_t;
+
+typedef struct {
+	int track_id;                 // 从 1 开始，同一个 tracker 中不重复
+	int class_id;
+	float score;                  // 最近一次匹配的检测得分
+	float xmin;
+	float ymin;
+	float xmax;
+	float ymax;
+	int predicted;                // 1 表示当前帧没有匹配的检测，框为预测值
+	int hits;                     // 匹配到检测的次数
+} TrackerTrack_t;
+
+typedef struct {
+	float high_threshold;         // 0.5，第一轮匹配使用的检测得分
+	float low_threshold;          // 0.1，低于该得分的检测丢弃
+	float new_track_threshold;    // 0.6，没有匹配的检测超过该得分时新建轨迹
+	float match_iou;              // 0.2，第一轮匹配的最小 IoU
+	float low_match_iou;          // 0.5，低分检测匹配的最小 IoU
+	int min_hits;                 // 2，匹配次数达到后才输出（第一次检测除外）
+	int max_age;                  // 30，连续多少帧没有匹配后删除轨迹
+	int class_aware;              // 1，只匹配类别相同的检测
+	int detect_interval;          // 1，每隔多少帧运行一次检测，0 表示自适应
+	int max_detect_interval;      // 3，自适应时的最大间隔
+	float motion_threshold;       // 0.05，自适应时中心每帧位移 / 框高的上限
+} TrackerConfig_t;
+
+typedef struct ObjectTracker_s ObjectTracker_t;
+
+void ObjectTrackerDefaultConfig(TrackerConfig_t *config);
+
+/**
+ * @param[in] config: NULL 时使用默认配置
+ */
+ObjectTracker_t *ObjectTrackerCreate(const TrackerConfig_t *config);
+
+void ObjectTrackerDestroy(ObjectTracker_t *tracker);
+
+/**
+ * 下一帧是否需要运行检测，第一帧总是返回 1
+ * 自适应时按跟踪目标的运动速度在 1 ~ max_detect_interval 之间选择间隔，
+ * 目标越快间隔越小
+ */
+int ObjectTrackerShouldDetect(ObjectTracker_t *tracker);
+
+/**
+ * 运行了检测的帧：预测所有轨迹，再和检测框关联
+ * @return 0 if success
+ */
+int ObjectTrackerUpdate(ObjectTracker_t *tracker, const TrackerBox_t *boxes,
+                        int box_num);
+
+/**
+ * 没有运行检测的帧：只按卡尔曼滤波预测所有轨迹
+ * @return 0 if success
+ */
+int ObjectTrackerPredict(ObjectTracker_t *tracker);
+
+/**
+ * 当前帧输出的轨迹（已确认且没有丢失太久）
+ * @return 轨迹总数，tracks 中最多写入 max_num 个
+ */
+int ObjectTrackerGetTracks(ObjectTracker_t *tracker, TrackerTrack_t *tracks,
+                           int max_num);
+
+/**
+ * 从检测后处理输出的 JSON 字符串中解析检测框（"bbox"、"score"、"id" 字段）
+ * @return 检测框总数，boxes 中最多写入 max_num 个
+ */
+int ObjectTrackerParseResult(const char *result, TrackerBox_t *boxes,
+                             int max_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_OBJECT_TRACKER_H_
@@ -0,0 +1,270 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <vector>
+
+#include "postprocess_registry.h"
+#include "thread_pool.h"
+#include "centernet_post_process.h"
+#include "fcos_post_process.h"
+#include "ptq_classification_post_process_method.h"
+#include "ptq_efficientdet_post_process.h"
+#include "ptq_ssd_post_process.h"
+#include "unet_post_process.h"
+#include "yolov3_post_process.h"
+#include "yolov5_post_process.h"
+#include "yolov8_post_process.h"
+
+// 多线程解码时，一个输出 tensor 超过这么多元素才按行切分
+#define POSTPROCESS_SLICE_ELEMENTS (256 * 1024)
+#define POSTPROCESS_MAX_SLICE_NUM 8
+
+struct LayerTask {
+  int layer;
+  int slice;
+  int slice_num;
+  int ret;
+};
+
+struct PostProcessContext_s {
+  const PostProcessPlugin_t *plugin;
+  void *context;
+  // PostProcessDecodeLayers 使用，每个任务一个 worker 上下文，多帧之间复用
+  std::vector<void *> workers;
+  std::vector<LayerTask> tasks;
+  std::vector<hbDNNTensor> layer_tensors;
+  int tensor_num;
+  PostProcessInfo_t *post_info;
+};
+
+static std::mutex registry_mutex;
+static std::vector<const PostProcessPlugin_t *> registry_plugins;
+
+static const PostProcessPlugin_t *FindPlugin(const char *name) {
+  for (auto *plugin : registry_plugins) {
+    if (strcmp(plugin->name, name) == 0) {
+      return plugin;
+    }
+  }
+  return nullptr;
+}
+
+static int AddPlugin(const PostProcessPlugin_t *plugin) {
+  if (plugin == nullptr || plugin->name == nullptr ||
+      plugin->create == nullptr || plugin->destroy == nullptr ||
+      plugin->decode == nullptr || plugin->emit == nullptr) {
+    printf("invalid post process plugin\n");
+    return -1;
+  }
+  if (FindPlugin(plugin->name) != nullptr) {
+    printf("post process plugin %s already registered\n", plugin->name);
+    return -1;
+  }
+  registry_plugins.push_back(plugin);
+  return 0;
+}
+
+// 调用时需要持有 registry_mutex
+static void RegisterBuiltins(void) {
+  static bool registered = false;
+  if (registered) {
+    return;
+  }
+  registered = true;
+  AddPlugin(Yolov3PostProcessPlugin());
+  AddPlugin(Yolov5PostProcessPlugin());
+  AddPlugin(Yolov8PostProcessPlugin());
+  AddPlugin(Yolov8SegPostProcessPlugin());
+  AddPlugin(FcosPostProcessPlugin());
+  AddPlugin(CenternetPostProcessPlugin());
+  AddPlugin(CenternetResnet101PostProcessPlugin());
+  AddPlugin(SsdPostProcessPlugin());
+  AddPlugin(EfficientdetPostProcessPlugin());
+  AddPlugin(ClassificationPostProcessPlugin());
+  AddPlugin(UnetPostProcessPlugin());
+}
+
+int PostProcessRegister(const PostProcessPlugin_t *plugin) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  RegisterBuiltins();
+  return AddPlugin(plugin);
+}
+
+int PostProcessPluginNames(const char **names, int max_num) {
+  std::lock_guard<std::mutex> lock(registry_mutex);
+  RegisterBuiltins();
+  int count = registry_plugins.size();
+  for (int i = 0; i < count && i < max_num; i++) {
+    names[i] = registry_plugins[i]->name;
+  }
+  return count;
+}
+
+PostProcessContext_t *PostProcessCreate(const char *name) {
+  if (name == nullptr) {
+    return nullptr;
+  }
+  const PostProcessPlugin_t *plugin;
+  {
+    std::lock_guard<std::mutex> lock(registry_mutex);
+    RegisterBuiltins();
+    plugin = FindPlugin(name);
+  }
+  if (plugin == nullptr) {
+    printf("post process plugin %s not found\n", name);
+    return nullptr;
+  }
+
+  void *context = plugin->create();
+  if (context == nullptr) {
+    printf("create post process context %s failed\n", name);
+    return nullptr;
+  }
+  auto *handle = new PostProcessContext_t();
+  handle->plugin = plugin;
+  handle->context = context;
+  return handle;
+}
+
+int PostProcessDecode(PostProcessContext_t *context, hbDNNTensor *tensors,
+                      int tensor_num, PostProcessInfo_t *post_info,
+                      int layer) {
+  if (context == nullptr || tensors == nullptr || post_info == nullptr) {
+    return -1;
+  }
+  return context->plugin->decode(context->context, tensors, tensor_num,
+                                 post_info, layer);
+}
+
+// 按元素个数切分，切分方式只和 tensor 大小有关，和线程数无关
+static int SliceNum(const PostProcessPlugin_t *plugin, hbDNNTensor *tensor) {
+  if (plugin->decode_slice == nullptr) {
+    return 1;
+  }
+  const auto &shape = tensor->properties.validShape;
+  int64_t elements = 1;
+  for (int i = 0; i < shape.numDimensions; i++) {
+    elements *= shape.dimensionSize[i];
+  }
+  int64_t slice_num = elements / POSTPROCESS_SLICE_ELEMENTS;
+  return std::min<int64_t>(std::max<int64_t>(slice_num, 1),
+                           POSTPROCESS_MAX_SLICE_NUM);
+}
+
+static void DecodeTask(void *arg, int index) {
+  auto *handle = static_cast<PostProcessContext_t *>(arg);
+  const PostProcessPlugin_t *plugin = handle->plugin;
+  LayerTask &task = handle->tasks[index];
+  hbDNNTensor *tensors =
+      handle->layer_tensors.data() + task.layer * handle->tensor_num;
+  void *worker = handle->workers[index];
+  if (task.slice_num > 1) {
+    task.ret = plugin->decode_slice(worker, tensors, handle->tensor_num,
+                                    handle->post_info, task.layer, task.slice,
+                                    task.slice_num);
+  } else {
+    task.ret = plugin->decode(worker, tensors, handle->tensor_num,
+                              handle->post_info, task.layer);
+  }
+}
+
+int PostProcessDecodeLayers(PostProcessContext_t *context, hbDNNTensor *tensors,
+                            const int *tensor_index, int tensor_num,
+                            int layer_num, PostProcessInfo_t *post_info) {
+  if (context == nullptr || tensors == nullptr || post_info == nullptr ||
+      tensor_num <= 0 || layer_num < 0) {
+    return -1;
+  }
+  const PostProcessPlugin_t *plugin = context->plugin;
+  auto &layer_tensors = context->layer_tensors;
+  layer_tensors.resize(layer_num * tensor_num);
+  for (int i = 0; i < layer_num * tensor_num; i++) {
+    layer_tensors[i] = tensors[tensor_index ? tensor_index[i] : i];
+  }
+
+  // 不支持合并的插件只能在自己的上下文中按层顺序解码
+  if (plugin->merge == nullptr) {
+    for (int layer = 0; layer < layer_num; layer++) {
+      int ret = plugin->decode(context->context,
+                               layer_tensors.data() + layer * tensor_num,
+                               tensor_num, post_info, layer);
+      if (ret != 0) {
+        return ret;
+      }
+    }
+    return 0;
+  }
+
+  auto &tasks = context->tasks;
+  tasks.clear();
+  for (int layer = 0; layer < layer_num; layer++) {
+    int slice_num = SliceNum(plugin, &layer_tensors[layer * tensor_num]);
+    for (int slice = 0; slice < slice_num; slice++) {
+      tasks.push_back({layer, slice, slice_num, 0});
+    }
+  }
+  int task_num = tasks.size();
+  while (static_cast<int>(context->workers.size()) < task_num) {
+    void *worker = plugin->create();
+    if (worker == nullptr) {
+      printf("create post process worker context %s failed\n", plugin->name);
+      return -1;
+    }
+    context->workers.push_back(worker);
+  }
+
+  context->tensor_num = tensor_num;
+  context->post_info = post_info;
+  ThreadPoolRun(DecodeTask, context, task_num);
+
+  // 按任务顺序合并，和单线程依次解码的顺序相同
+  int ret = 0;
+  for (int i = 0; i < task_num; i++) {
+    plugin->merge(context->context, context->workers[i]);
+    if (tasks[i].ret != 0) {
+      ret = tasks[i].ret;
+    }
+  }
+  return ret;
+}
+
+int PostProcessSetThreadNum(int thread_num) {
+  return ThreadPoolSetThreadNum(thread_num);
+}
+
+int PostProcessGetThreadNum(void) {
+  return ThreadPoolGetThreadNum();
+}
+
+char *PostProcessEmit(PostProcessContext_t *context,
+                      PostProcessInfo_t *post_info) {
+  if (context == nullptr || post_info == nullptr) {
+    return nullptr;
+  }
+  return context->plugin->emit(context->context, post_info);
+}
+
+void PostProcessFreeResult(char *result) {
+  free(result);
+}
+
+void PostProcessDestroy(PostProcessContext_t *context) {
+  if (context == nullptr) {
+    return;
+  }
+  context->plugin->destroy(context->context);
+  for (auto *worker : context->workers) {
+    context->plugin->destroy(worker);
+  }
+  delete context;
+}
@@ -0,0 +1,123 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_POSTPROCESS_REGISTRY_H_
+#define _POST_PROCESS_POSTPROCESS_REGISTRY_H_
+
+#include "dnn/hb_dnn.h"
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * 后处理插件注册表
+ *
+ * 每种模型的后处理按名字注册为一个插件，使用时为每个模型实例创建一个上下文，
+ * 检测结果和中间缓存都保存在上下文里，多帧之间复用。不同上下文之间没有共享的
+ * 可写状态，多个线程可以同时使用各自的上下文；同一个上下文同一时间只能在一个
+ * 线程中使用。
+ *
+ * 原有的 XdoProcess / XPostProcess 接口使用每种模型内部的一个默认上下文，
+ * 行为不变。
+ */
+
+// 和各个模型的 XPostProcessInfo_t 布局相同
+typedef struct {
+	int height;
+	int width;
+	int ori_height;
+	int ori_width;
+	float score_threshold;
+	float nms_threshold;
+	int nms_top_k;
+	int is_pad_resize;
+} PostProcessInfo_t;
+
+typedef struct {
+	const char *name;
+	void *(*create)(void);
+	void (*destroy)(void *context);
+	// 解码一个输出层，tensors 为这一层使用的 tensor_num 个输出，成功返回 0
+	int (*decode)(void *context, hbDNNTensor *tensors, int tensor_num,
+	              PostProcessInfo_t *post_info, int layer);
+	// 合并所有层的结果（NMS 等），返回 JSON 字符串并清空上下文中的结果
+	char *(*emit)(void *context, PostProcessInfo_t *post_info);
+	// 以下为可选项，用于 PostProcessDecodeLayers 多线程解码，不支持时为 NULL
+	// 把 worker 上下文中解码的结果按顺序追加到 context，并清空 worker
+	void (*merge)(void *context, void *worker);
+	// 按行把一层均分成 slice_num 份，只解码第 slice 份
+	int (*decode_slice)(void *context, hbDNNTensor *tensors, int tensor_num,
+	                    PostProcessInfo_t *post_info, int layer, int slice,
+	                    int slice_num);
+} PostProcessPlugin_t;
+
+typedef struct PostProcessContext_s PostProcessContext_t;
+
+/**
+ * 注册插件，plugin 指向的内容需要一直有效，名字重复时返回 -1
+ * 内置的模型（yolov3、yolov5、yolov8、yolov8_seg、fcos、centernet、
+ * centernet_resnet101、ssd、efficientdet、classification、unet）
+ * 在第一次使用注册表时自动注册
+ */
+int PostProcessRegister(const PostProcessPlugin_t *plugin);
+
+/**
+ * 获取已注册的插件名字
+ * @return 插件总数，names 中最多写入 max_num 个
+ */
+int PostProcessPluginNames(const char **names, int max_num);
+
+/**
+ * 创建上下文，没有对应名字的插件时返回 NULL
+ */
+PostProcessContext_t *PostProcessCreate(const char *name);
+
+int PostProcessDecode(PostProcessContext_t *context, hbDNNTensor *tensors,
+                      int tensor_num, PostProcessInfo_t *post_info, int layer);
+
+/**
+ * 一次解码 layer_num 层，和依次对每层调用 PostProcessDecode 的结果相同
+ * 插件支持 merge 时，各层（支持 decode_slice 时大的层再按行切分）作为独立的
+ * 任务交给共用的线程池，每个任务解码到自己的 worker 上下文，全部完成后按
+ * (层, 行) 的顺序合并，合并结果和线程数无关。worker 上下文随 context 复用。
+ * @param[in] tensors: 模型的输出 tensor
+ * @param[in] tensor_index: 第 i 层使用 tensors[tensor_index[i * tensor_num + j]]，
+ *                          j < tensor_num；为 NULL 时按 tensors 的顺序每层
+ *                          连续 tensor_num 个
+ * @return 0 if success
+ */
+int PostProcessDecodeLayers(PostProcessContext_t *context, hbDNNTensor *tensors,
+                            const int *tensor_index, int tensor_num,
+                            int layer_num, PostProcessInfo_t *post_info);
+
+/**
+ * 设置 PostProcessDecodeLayers 使用的线程数（包括调用线程），所有上下文共用，
+ * 1 表示不使用多线程。默认为 CPU 核数，最多 4
+ * 调用时不能有正在执行的 PostProcessDecodeLayers
+ * @return 0 if success
+ */
+int PostProcessSetThreadNum(int thread_num);
+
+int PostProcessGetThreadNum(void);
+
+/**
+ * @return malloc 的 JSON 字符串，使用 PostProcessFreeResult 释放
+ */
+char *PostProcessEmit(PostProcessContext_t *context,
+                      PostProcessInfo_t *post_info);
+
+void PostProcessFreeResult(char *result);
+
+void PostProcessDestroy(PostProcessContext_t *context);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_POSTPROCESS_REGISTRY_H_
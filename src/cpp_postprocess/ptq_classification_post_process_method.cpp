@@ -15,10 +15,13 @@
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
+#include <arm_neon.h>
+#include <cstring>
 
 // #include "utils/utils_log.h"
 
 #include "ptq_classification_post_process_method.h"
+#include "activation.h"
 
 /**
  * Config definition for classification
@@ -1071,55 +1074,292 @@ typedef struct Classification {
 } Classification;
 
 bool compareObjects(const Classification &lhs, const Classification &rhs) {
-  return (lhs.score > rhs.score);
+  return lhs.score > rhs.score || (lhs.score == rhs.score && lhs.id < rhs.id);
 }
 
-std::vector<Classification> classification_dets;
+/**
+ * 一个模型实例的后处理状态，多次 ClassificationDoProcess 的结果累加，
+ * 在 ClassificationPostProcess 时输出
+ */
+struct ClassificationContext {
+  std::vector<Classification> dets;
+  std::vector<ClassificationResult_t> results;
+};
+
+// 原有接口使用的默认上下文
+static ClassificationContext default_classification_context;
+
+template <typename DType>
+struct DequantiOps;
+
+// 每次处理 8 个元素，扩展成两组 int32
+template <>
+struct DequantiOps<int8_t> {
+  static void Load8(const int8_t *p, int32x4_t *lo, int32x4_t *hi) {
+    int16x8_t value = vmovl_s8(vld1_s8(p));
+    *lo = vmovl_s16(vget_low_s16(value));
+    *hi = vmovl_s16(vget_high_s16(value));
+  }
+};
+
+template <>
+struct DequantiOps<int16_t> {
+  static void Load8(const int16_t *p, int32x4_t *lo, int32x4_t *hi) {
+    int16x8_t value = vld1q_s16(p);
+    *lo = vmovl_s16(vget_low_s16(value));
+    *hi = vmovl_s16(vget_high_s16(value));
+  }
+};
+
+template <>
+struct DequantiOps<int32_t> {
+  static void Load8(const int32_t *p, int32x4_t *lo, int32x4_t *hi) {
+    *lo = vld1q_s32(p);
+    *hi = vld1q_s32(p + 4);
+  }
+};
+
+// scale 为 per-channel（len 个）或 per-tensor（scale_len 为 1）
+template <typename DType>
+static void DequantiScores(const DType *data, const float *scale,
+                           int scale_len, int len, float *out) {
+  bool per_channel = scale_len >= len;
+  float tensor_scale = scale_len > 0 ? scale[0] : 1.f;
+  float32x4_t vec_scale = vdupq_n_f32(tensor_scale);
+  int i = 0;
+  for (; i <= len - 8; i += 8) {
+    int32x4_t lo, hi;
+    DequantiOps<DType>::Load8(data + i, &lo, &hi);
+    float32x4_t scale_lo = per_channel ? vld1q_f32(scale + i) : vec_scale;
+    float32x4_t scale_hi = per_channel ? vld1q_f32(scale + i + 4) : vec_scale;
+    vst1q_f32(out + i, vmulq_f32(vcvtq_f32_s32(lo), scale_lo));
+    vst1q_f32(out + i + 4, vmulq_f32(vcvtq_f32_s32(hi), scale_hi));
+  }
+  for (; i < len; i++) {
+    out[i] = data[i] * (per_channel ? scale[i] : tensor_scale);
+  }
+}
+
+static int TensorElementSize(hbDNNTensor *tensor) {
+  switch (tensor->properties.tensorType) {
+    case HB_DNN_TENSOR_TYPE_S8:
+      return 1;
+    case HB_DNN_TENSOR_TYPE_S16:
+      return 2;
+    case HB_DNN_TENSOR_TYPE_S32:
+    case HB_DNN_TENSOR_TYPE_F32:
+      return 4;
+    default:
+      return 0;
+  }
+}
+
+/**
+ * 一个样本的类别得分转换成 float
+ * @param[in] sample: batch 中的样本序号
+ * @param[in] len: 类别数
+ * @param[in] stride: 相邻样本间隔的元素个数
+ */
+static int GetSampleScores(hbDNNTensor *tensor, int sample, int len,
+                           int stride, float *out) {
+  int element_size = TensorElementSize(tensor);
+  if (element_size == 0) {
+    printf("unsupported classification tensor type: %d\n",
+           tensor->properties.tensorType);
+    return -1;
+  }
+  auto *data = reinterpret_cast<uint8_t *>(tensor->sysMem[0].virAddr) +
+               static_cast<size_t>(sample) * stride * element_size;
+  auto tensor_type = tensor->properties.tensorType;
+  if (tensor_type == HB_DNN_TENSOR_TYPE_F32) {
+    memcpy(out, data, len * sizeof(float));
+    return 0;
+  }
+
+  // 整数输出：SCALE 量化按 scale 反量化，否则直接转换
+  const float *scale = nullptr;
+  int scale_len = 0;
+  if (tensor->properties.quantiType == SCALE) {
+    scale = tensor->properties.scale.scaleData;
+    scale_len = tensor->properties.scale.scaleLen;
+  }
+  if (tensor_type == HB_DNN_TENSOR_TYPE_S8) {
+    DequantiScores(reinterpret_cast<int8_t *>(data), scale, scale_len, len,
+                   out);
+  } else if (tensor_type == HB_DNN_TENSOR_TYPE_S16) {
+    DequantiScores(reinterpret_cast<int16_t *>(data), scale, scale_len, len,
+                   out);
+  } else {
+    DequantiScores(reinterpret_cast<int32_t *>(data), scale, scale_len, len,
+                   out);
+  }
+  return 0;
+}
+
+static bool GreaterResult(const ClassificationResult_t &lhs,
+                          const ClassificationResult_t &rhs) {
+  return lhs.score > rhs.score ||
+         (lhs.score == rhs.score && lhs.id < rhs.id);
+}
+
+/**
+ * 选出得分大于 threshold 的前 top_k 个，按得分从大到小排列
+ * 先用 NEON 按 4 个一组跳过不超过阈值的类别，再对候选做 nth_element，
+ * 只排序前 top_k 个，复杂度 O(n + k log k)
+ * @return 输出的个数
+ */
+static int SelectTopK(const float *scores, int count, float threshold,
+                      int top_k, std::vector<ClassificationResult_t> &candidates,
+                      ClassificationResult_t *out) {
+  candidates.clear();
+  if (top_k <= 0) {
+    return 0;
+  }
+  float32x4_t vec_threshold = vdupq_n_f32(threshold);
+  int i = 0;
+  for (; i <= count - 4; i += 4) {
+    uint32x4_t mask = vcgtq_f32(vld1q_f32(scores + i), vec_threshold);
+    if (vmaxvq_u32(mask) == 0) {
+      continue;
+    }
+    for (int j = 0; j < 4; j++) {
+      if (scores[i + j] > threshold) {
+        candidates.push_back({i + j, scores[i + j]});
+      }
+    }
+  }
+  for (; i < count; i++) {
+    if (scores[i] > threshold) {
+      candidates.push_back({i, scores[i]});
+    }
+  }
 
-void GetTopkResult(hbDNNTensor *tensor, ClassificationPostProcessInfo_t *post_info) {
+  int num = candidates.size();
+  if (num > top_k) {
+    std::nth_element(candidates.begin(), candidates.begin() + top_k,
+                     candidates.end(), GreaterResult);
+    num = top_k;
+  }
+  std::sort(candidates.begin(), candidates.begin() + num, GreaterResult);
+  std::copy(candidates.begin(), candidates.begin() + num, out);
+  return num;
+}
 
-  Classification classification;
+// 每个样本的类别数，以及相邻样本间隔的元素个数
+static void SampleShape(hbDNNTensor *tensor, int *len, int *stride) {
   int n_dim = tensor->properties.validShape.numDimensions;
-  int *shape = tensor->properties.validShape.dimensionSize;
-  int tensor_len{1};
+  int *valid_shape = tensor->properties.validShape.dimensionSize;
+  int *aligned_shape = tensor->properties.alignedShape.dimensionSize;
+  *len = 1;
+  *stride = 1;
   for (int i = 1; i < n_dim; i++) {
-    tensor_len *= shape[i];
+    *len *= valid_shape[i];
+    *stride *= aligned_shape[i];
   }
+}
 
-  for (auto i = 0; i < tensor_len; i++) {
-    float score = reinterpret_cast<float *>(tensor->sysMem[0].virAddr)[i];
-    classification.score = score;
-    classification.id = i;
-    classification.class_name = classification_config_.class_names[classification.id].c_str();
-    if (classification.score > post_info->score_threshold){
-          classification_dets.push_back(classification);
-    }
+static thread_local std::vector<float> sample_scores;
+static thread_local std::vector<ClassificationResult_t> topk_candidates;
+
+void GetTopkResult(ClassificationContext *context, hbDNNTensor *tensor,
+                   ClassificationPostProcessInfo_t *post_info) {
+  std::vector<Classification> &classification_dets = context->dets;
+  int tensor_len, stride;
+  SampleShape(tensor, &tensor_len, &stride);
+  int top_k = post_info->nms_top_k;
+  if (top_k <= 0) {
+    return;
   }
 
-  // 排序，根据对象的score从大到小排序  
-  std::sort(classification_dets.begin(), classification_dets.end(), compareObjects);  
+  sample_scores.resize(tensor_len);
+  if (GetSampleScores(tensor, 0, tensor_len, stride, sample_scores.data()) !=
+      0) {
+    return;
+  }
+  std::vector<ClassificationResult_t> &results = context->results;
+  results.resize(top_k);
+  int num = SelectTopK(sample_scores.data(), tensor_len,
+                       post_info->score_threshold, top_k, topk_candidates,
+                       results.data());
+  for (int i = 0; i < num; i++) {
+    classification_dets.push_back(Classification(
+        results[i].id, results[i].score,
+        classification_config_.class_names[results[i].id].c_str()));
+  }
 
-  // 如果对象数量超过top_k个，删除多余的对象，只保留前top_k个  
+  // 多次调用时结果累加，只保留得分最高的 top_k 个
   int classification_dets_size = classification_dets.size();
-  if (classification_dets_size > post_info->nms_top_k) {  
-      classification_dets.resize(post_info->nms_top_k);  
-  }  
-
+  if (classification_dets_size > top_k) {
+    std::nth_element(classification_dets.begin(),
+                     classification_dets.begin() + top_k,
+                     classification_dets.end(), compareObjects);
+    classification_dets.resize(top_k);
+  }
+  std::sort(classification_dets.begin(), classification_dets.end(),
+            compareObjects);
 }
 
 void ClassificationDoProcess(hbDNNTensor *tensors, ClassificationPostProcessInfo_t *post_info) {
 
-  GetTopkResult(tensors, post_info);
+  GetTopkResult(&default_classification_context, tensors, post_info);
 
 }
 
-char* ClassificationPostProcess(ClassificationPostProcessInfo_t *post_info) {
+int ClassificationTopK(hbDNNTensor *tensors, int tensor_num,
+                       ClassificationPostProcessInfo_t *post_info,
+                       int apply_softmax, ClassificationResult_t *results,
+                       int *result_num, int max_samples) {
+  if (tensors == nullptr || post_info == nullptr || results == nullptr ||
+      result_num == nullptr) {
+    return -1;
+  }
+  int top_k = post_info->nms_top_k;
+  int sample_num = 0;
+  for (int t = 0; t < tensor_num; t++) {
+    hbDNNTensor *tensor = tensors + t;
+    int len, stride;
+    SampleShape(tensor, &len, &stride);
+    int batch = tensor->properties.validShape.dimensionSize[0];
+    sample_scores.resize(len);
+    for (int b = 0; b < batch; b++) {
+      if (sample_num >= max_samples) {
+        printf("classification results overflow, max_samples: %d\n",
+               max_samples);
+        return sample_num;
+      }
+      if (GetSampleScores(tensor, b, len, stride, sample_scores.data()) != 0) {
+        return -1;
+      }
+      if (apply_softmax) {
+        ActivationSoftmaxF32(sample_scores.data(), len, sample_scores.data());
+      }
+      result_num[sample_num] =
+          SelectTopK(sample_scores.data(), len, post_info->score_threshold,
+                     top_k, topk_candidates,
+                     results + static_cast<size_t>(sample_num) *
+                                   std::max(top_k, 0));
+      sample_num++;
+    }
+  }
+  return sample_num;
+}
+
+const char *ClassificationLabelName(int id) {
+  int class_num = classification_config_.class_names.size();
+  if (id < 0 || id >= class_num) {
+    return nullptr;
+  }
+  return classification_config_.class_names[id].c_str();
+}
+
+static char *ClassificationEmit(ClassificationContext *context,
+                                ClassificationPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
 
   std::vector<Classification> classification_restuls;
-  classification_restuls = classification_dets;
+  classification_restuls = context->dets;
 
   std::stringstream out_string;
 
@@ -1138,8 +1378,54 @@ char* ClassificationPostProcess(ClassificationPostProcessInfo_t *post_info) {
   str_dets[out_string.str().length()] = '\0';
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_dets: %s\n", str_dets);
-  classification_dets.clear();
+  context->dets.clear();
   classification_restuls.clear();
   return str_dets;
 }
 
+char* ClassificationPostProcess(ClassificationPostProcessInfo_t *post_info) {
+  return ClassificationEmit(&default_classification_context, post_info);
+}
+
+static void *ClassificationContextCreate(void) {
+  return new ClassificationContext();
+}
+
+static void ClassificationContextDestroy(void *context) {
+  delete static_cast<ClassificationContext *>(context);
+}
+
+// 1 个输出，layer 不使用
+static int ClassificationPluginDecode(void *context, hbDNNTensor *tensors,
+                                      int tensor_num,
+                                      PostProcessInfo_t *post_info,
+                                      int layer) {
+  if (tensor_num < 1) {
+    printf("classification needs 1 tensor, got %d\n", tensor_num);
+    return -1;
+  }
+  GetTopkResult(
+      static_cast<ClassificationContext *>(context), &tensors[0],
+      reinterpret_cast<ClassificationPostProcessInfo_t *>(post_info));
+  return 0;
+}
+
+static char *ClassificationPluginEmit(void *context,
+                                      PostProcessInfo_t *post_info) {
+  return ClassificationEmit(
+      static_cast<ClassificationContext *>(context),
+      reinterpret_cast<ClassificationPostProcessInfo_t *>(post_info));
+}
+
+static_assert(sizeof(ClassificationPostProcessInfo_t) ==
+                  sizeof(PostProcessInfo_t),
+              "ClassificationPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *ClassificationPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "classification", ClassificationContextCreate,
+      ClassificationContextDestroy, ClassificationPluginDecode,
+      ClassificationPluginEmit};
+  return &plugin;
+}
+
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_CLASSIFICATION_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -37,6 +38,38 @@ char* ClassificationPostProcess(ClassificationPostProcessInfo_t *post_info);
 
 void ClassificationDoProcess(hbDNNTensor *tensors, ClassificationPostProcessInfo_t *post_info);
 
+typedef struct {
+	int id;
+	float score;
+} ClassificationResult_t;
+
+  /**
+   * 不生成 JSON 字符串的分类后处理，适合每帧对大量目标做分类的场景
+   * 反量化（和可选的 softmax）用 NEON 计算，只对超过 score_threshold 的类别
+   * 做部分选择，得到按得分从大到小排列的前 nms_top_k 个
+   * @param[in] tensors: tensor_num 个输出 tensor，每个输出的第 0 维为 batch，
+   *                     所有输出的所有样本依次处理
+   * @param[in] apply_softmax: 1 表示模型输出为 logits，反量化后先做 softmax
+   * @param[out] results: 每个样本占 nms_top_k 个位置
+   * @param[out] result_num: 每个样本实际输出的个数
+   * @param[in] max_samples: results 和 result_num 能容纳的样本数
+   * @return 处理的样本数，失败返回 -1
+   */
+int ClassificationTopK(hbDNNTensor *tensors, int tensor_num,
+                       ClassificationPostProcessInfo_t *post_info,
+                       int apply_softmax, ClassificationResult_t *results,
+                       int *result_num, int max_samples);
+
+  /**
+   * 类别名称，id 超出范围时返回 NULL
+   */
+const char *ClassificationLabelName(int id);
+
+  /**
+   * 注册表使用的插件，1 个输出 tensor，按 ClassificationDoProcess 处理
+   */
+const PostProcessPlugin_t *ClassificationPostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,6 +20,8 @@
 #include <cassert>
 
 #include "ptq_efficientdet_post_process.h"
+#include "anchor_table.h"
+#include "quanti_filter.h"
 
 /**
  * Config definition for EfficientDet
@@ -32,25 +34,6 @@ struct EfficientDetConfig {
   std::vector<std::string> class_names;
 };
 
-struct EDBaseAnchor {
-  EDBaseAnchor(float x1, float y1, float x2, float y2)
-      : x1_(x1), y1_(y1), x2_(x2), y2_(y2) {}
-  float x1_;
-  float y1_;
-  float x2_;
-  float y2_;
-};
-
-struct EDAnchor {
-  EDAnchor(float c_x, float c_y, float w, float h)
-      : c_x_(c_x), c_y_(c_y), w_(w), h_(h) {}
-  float c_x_;
-  float c_y_;
-  float w_;
-  float h_;
-};
-
-
 const int kEfficientDetClassNum = 80;
 
 EfficientDetConfig default_efficient_det_config = {
@@ -172,9 +155,6 @@ typedef struct Detection {
   ~Detection() {}
 } Detection;
 
-std::vector<Detection> efficient_det_dets;
-std::vector<Detection> efficient_det_restuls;
-static std::vector<std::vector<EDAnchor>> anchors_table;
 
 static void efficient_det_nms(std::vector<Detection> &input,
                float iou_threshold,
@@ -297,56 +277,76 @@ static std::pair<float, int> MaxScoreID(int32_t *input,
   return result_id_score;
 }
 
-int GetAnchors(std::vector<EDAnchor> &anchors,
-                                                 int layer,
-                                                 int feat_height,
-                                                 int feat_width) {
-  int stride = default_efficient_det_config.feature_strides[layer];
-  auto scales = default_efficient_det_config.anchor_scales[layer];
-  const auto &ratios = default_efficient_det_config.anchor_ratio;
-  int w = stride, h = stride;
-  int size = w * h;
-  float x_ctr = 0.5 * (w - 1.f);
-  float y_ctr = 0.5 * (h - 1.f);
-  // base anchor
-  std::vector<EDBaseAnchor> base_anchors;
-  for (const auto &ratio : ratios) {
-    for (const auto &scale : scales) {
-      double size_ratio = std::floor(size / ratio);
-      double new_w = std::floor(std::sqrt(size_ratio) + 0.5) * scale;
-      double new_h = std::floor(new_w / scale * ratio + 0.5) * scale;
-      base_anchors.push_back(EDBaseAnchor(x_ctr - 0.5f * (new_w - 1.f),
-                                          y_ctr - 0.5f * (new_h - 1.f),
-                                          x_ctr + 0.5f * (new_w - 1.f),
-                                          y_ctr + 0.5f * (new_h - 1.f)));
-    }
+// 通过得分阈值的候选框，所有候选收集完后统一按 anchor 解码
+struct EfficientDetCandidates {
+  std::vector<int32_t> anchor;
+  std::vector<float> delta;   // 每个候选 dx, dy, dw, dh
+  std::vector<int> id;
+  std::vector<float> score;
+
+  void Add(int32_t anchor_index, int class_id, float class_score, float dx,
+           float dy, float dw, float dh) {
+    anchor.push_back(anchor_index);
+    delta.insert(delta.end(), {dx, dy, dw, dh});
+    id.push_back(class_id);
+    score.push_back(class_score);
   }
 
-  for (int i = 0; i < feat_height; ++i) {
-    for (int j = 0; j < feat_width; ++j) {
-      auto ori_y = i * stride;
-      auto ori_x = j * stride;
-      for (const auto &base_anchor : base_anchors) {
-        float x1 = base_anchor.x1_ + ori_x;
-        float y1 = base_anchor.y1_ + ori_y;
-        float x2 = base_anchor.x2_ + ori_x;
-        float y2 = base_anchor.y2_ + ori_y;
-        float width = x2 - x1 + 1.f;
-        float height = y2 - y1 + 1.f;
-        float ctr_x = x1 + 0.5f * (width - 1.f);
-        float ctr_y = y1 + 0.5f * (height - 1.f);
-
-        anchors.push_back(EDAnchor(ctr_x, ctr_y, width, height));
-      }
-    }
+  void Clear() {
+    anchor.clear();
+    delta.clear();
+    id.clear();
+    score.clear();
+  }
+};
+
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 EfficientdetPostProcess 时合并
+ * 输出，中间内存多帧之间复用
+ */
+struct EfficientDetContext {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  EfficientDetCandidates candidates;
+  std::vector<float> boxes;
+};
+
+// 原有接口使用的默认上下文
+static EfficientDetContext default_efficient_det_context;
+
+static void EfficientDetDecodeCandidates(EfficientDetContext *context,
+                                         const AnchorTable *anchors,
+                                         float img_h, float img_w) {
+  static const float variance[4] = {1.f, 1.f, 1.f, 1.f};
+  const EfficientDetCandidates &candidates = context->candidates;
+  int count = candidates.anchor.size();
+  std::vector<float> &boxes = context->boxes;
+  boxes.resize(count * 4);
+  AnchorDecodeBoxes(anchors, candidates.anchor.data(),
+                    candidates.delta.data(), count, variance, 1.f,
+                    boxes.data());
+
+  for (int i = 0; i < count; i++) {
+    // python在这里需要对框做clip,  x >= 0 && x <= input_width...
+    const float *box = boxes.data() + i * 4;
+    Bbox bbox;
+    bbox.xmin = std::max(box[0], 0.f);
+    bbox.ymin = std::max(box[1], 0.f);
+    bbox.xmax = std::min(box[2], img_w);
+    bbox.ymax = std::min(box[3], img_h);
+
+    int max_id = candidates.id[i];
+    context->dets.push_back(Detection(
+        max_id, candidates.score[i], bbox,
+        default_efficient_det_config.class_names[max_id].c_str()));
   }
-  return 0;
 }
 
 int GetBboxAndScores(
+    EfficientDetContext *context,
     hbDNNTensor *c_tensor,
     hbDNNTensor *bbox_tensor,
-    std::vector<EDAnchor> &anchors,
+    const AnchorTable *anchors,
     int class_num,
     float img_h,
     float img_w,
@@ -368,6 +368,8 @@ int GetBboxAndScores(
   auto box_num = b_batch_size * b_hnum * b_wnum * anchor_num_per_pixel;
 
   auto quanti_type = bbox_tensor->properties.quantiType;
+  EfficientDetCandidates &candidates = context->candidates;
+  candidates.Clear();
 
   if (quanti_type == hbDNNQuantiType::NONE) {
     auto *raw_cls_data = reinterpret_cast<float *>(c_tensor->sysMem[0].virAddr);
@@ -445,48 +447,30 @@ int GetBboxAndScores(
 
       // aligned index
       int start = i * 4;
-      float dx = raw_box_data[start];
-      float dy = raw_box_data[start + 1];
-      float dw = raw_box_data[start + 2];
-      float dh = raw_box_data[start + 3];
-      float width = anchors[i].w_;
-      float height = anchors[i].h_;
-      float ctr_x = anchors[i].c_x_;
-      float ctr_y = anchors[i].c_y_;
-
-      float pred_ctr_x = dx * width + ctr_x;
-      float pred_ctr_y = dy * height + ctr_y;
-      float pred_w = std::exp(dw) * width;
-      float pred_h = std::exp(dh) * height;
-
-      // python在这里需要对框做clip,  x >= 0 && x <= input_width...
-      float xmin = (pred_ctr_x - 0.5f * (pred_w - 1.f));
-      float ymin = (pred_ctr_y - 0.5f * (pred_h - 1.f));
-      float xmax = (pred_ctr_x + 0.5f * (pred_w - 1.f));
-      float ymax = (pred_ctr_y + 0.5f * (pred_h - 1.f));
-
-      Bbox bbox;
-      bbox.xmin = std::max(xmin, 0.f);
-      bbox.ymin = std::max(ymin, 0.f);
-      bbox.xmax = std::min(xmax, img_w);
-      bbox.ymax = std::min(ymax, img_h);
-
-      efficient_det_dets.push_back(Detection(max_id,
-                                              max_score,
-                                              bbox,
-                                              default_efficient_det_config.class_names[max_id].c_str()));
+      candidates.Add(i, max_id, max_score, raw_box_data[start],
+                     raw_box_data[start + 1], raw_box_data[start + 2],
+                     raw_box_data[start + 3]);
     }
   } else {
     auto *raw_cls_data =
         reinterpret_cast<int32_t *>(c_tensor->sysMem[0].virAddr);
     auto *raw_box_data =
         reinterpret_cast<int32_t *>(bbox_tensor->sysMem[0].virAddr);
+    // cls 的 720 个 scale 对应的整数阈值，没有任何类别超过阈值的 anchor
+    // 直接跳过，不做反量化
+    float *cls_scale_data = c_tensor->properties.scale.scaleData;
+    std::vector<int32_t> cls_thresholds(720);
+    QuantiValueThreshold(cls_scale_data, 720, post_info->score_threshold,
+                         cls_thresholds.data());
     for (int i = 0; i < box_num; i++) {
       // score and cls
       uint32_t res_id_cur_anchor = i * class_num;
       int cls_scale_index = res_id_cur_anchor % 720;
+      if (!QuantiAnyGE(raw_cls_data + res_id_cur_anchor,
+                       cls_thresholds.data() + cls_scale_index, class_num)) {
+        continue;
+      }
       // cls scales for every box
-      float *cls_scale_data = c_tensor->properties.scale.scaleData;
       auto cls_scales = cls_scale_data + cls_scale_index;
       // 获取max_id and max_score;
       auto max_score_id =
@@ -503,42 +487,22 @@ int GetBboxAndScores(
       // box scales for every box
       float *box_scale_data = bbox_tensor->properties.scale.scaleData;
       auto box_scales = box_scale_data + scale_index;
-      float dx = raw_box_data[start] * box_scales[0];
-      float dy = raw_box_data[start + 1] * box_scales[1];
-      float dw = raw_box_data[start + 2] * box_scales[2];
-      float dh = raw_box_data[start + 3] * box_scales[3];
-      float width = anchors[i].w_;
-      float height = anchors[i].h_;
-      float ctr_x = anchors[i].c_x_;
-      float ctr_y = anchors[i].c_y_;
-
-      float pred_ctr_x = dx * width + ctr_x;
-      float pred_ctr_y = dy * height + ctr_y;
-      float pred_w = std::exp(dw) * width;
-      float pred_h = std::exp(dh) * height;
-
-      // python在这里需要对框做clip,  x >= 0 && x <= input_width...
-      float xmin = (pred_ctr_x - 0.5f * (pred_w - 1.f));
-      float ymin = (pred_ctr_y - 0.5f * (pred_h - 1.f));
-      float xmax = (pred_ctr_x + 0.5f * (pred_w - 1.f));
-      float ymax = (pred_ctr_y + 0.5f * (pred_h - 1.f));
-
-      Bbox bbox;
-      bbox.xmin = std::max(xmin, 0.f);
-      bbox.ymin = std::max(ymin, 0.f);
-      bbox.xmax = std::min(xmax, img_w);
-      bbox.ymax = std::min(ymax, img_h);
-
-      efficient_det_dets.push_back(Detection(max_id,
-                                    max_score,
-                                    bbox,
-                                    default_efficient_det_config.class_names[max_id].c_str()));
+      candidates.Add(i, max_id, max_score,
+                     raw_box_data[start] * box_scales[0],
+                     raw_box_data[start + 1] * box_scales[1],
+                     raw_box_data[start + 2] * box_scales[2],
+                     raw_box_data[start + 3] * box_scales[3]);
     }
   }
+  EfficientDetDecodeCandidates(context, anchors, img_h, img_w);
   return 0;
 }
 
-void EfficientdetdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, EfficientdetPostProcessInfo_t *post_info, int layer) {
+static int EfficientdetDecode(EfficientDetContext *context,
+                              hbDNNTensor *cls_tensor,
+                              hbDNNTensor *bbox_tensor,
+                              EfficientdetPostProcessInfo_t *post_info,
+                              int layer) {
 
   float origin_height = post_info->ori_height;
   float origin_width = post_info->ori_width;
@@ -563,24 +527,40 @@ void EfficientdetdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, Ef
 
   int height = bbox_tensor->properties.alignedShape.dimensionSize[1];
   int width = bbox_tensor->properties.alignedShape.dimensionSize[2];
-  int layer_num = default_efficient_det_config.feature_strides.size();
-  if (anchors_table.empty()) {
-    // Note: note thread safe
-    anchors_table.resize(layer_num);
-    printf("init anchors_table.\n");
+  EfficientDetAnchorParam anchor_param = {};
+  anchor_param.input_height = input_height;
+  anchor_param.input_width = input_width;
+  anchor_param.feat_height = height;
+  anchor_param.feat_width = width;
+  anchor_param.stride = default_efficient_det_config.feature_strides[layer];
+  const auto &scales = default_efficient_det_config.anchor_scales[layer];
+  const auto &ratios = default_efficient_det_config.anchor_ratio;
+  anchor_param.scale_num = std::min<int>(scales.size(), ANCHOR_PARAM_MAX_NUM);
+  std::copy(scales.begin(), scales.begin() + anchor_param.scale_num,
+            anchor_param.scales);
+  anchor_param.ratio_num = std::min<int>(ratios.size(), ANCHOR_PARAM_MAX_NUM);
+  std::copy(ratios.begin(), ratios.begin() + anchor_param.ratio_num,
+            anchor_param.ratios);
+  const AnchorTable *anchors = EfficientDetAnchorTableGet(&anchor_param);
+  if (anchors == nullptr) {
+    return -1;
   }
-  GetAnchors(anchors_table[layer], layer, height, width);
-
-  std::vector<EDAnchor> &anchors = anchors_table[layer];
-  GetBboxAndScores(cls_tensor, bbox_tensor, anchors, kEfficientDetClassNum, new_h, new_w, post_info);
+  return GetBboxAndScores(context, cls_tensor, bbox_tensor, anchors,
+                          kEfficientDetClassNum, new_h, new_w, post_info);
+}
 
+void EfficientdetdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, EfficientdetPostProcessInfo_t *post_info, int layer) {
+  EfficientdetDecode(&default_efficient_det_context, cls_tensor, bbox_tensor,
+                     post_info, layer);
 }
 
 
-char* EfficientdetPostProcess(EfficientdetPostProcessInfo_t *post_info) {
+static char *EfficientdetEmit(EfficientDetContext *context,
+                              EfficientdetPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
+  std::vector<Detection> &efficient_det_restuls = context->results;
   std::stringstream out_string;
 
   float origin_height = post_info->ori_height;
@@ -603,7 +583,7 @@ char* EfficientdetPostProcess(EfficientdetPostProcessInfo_t *post_info) {
     h_ratio = scale;
   }
 
-  efficient_det_nms(efficient_det_dets, post_info->nms_threshold, post_info->nms_top_k, efficient_det_restuls, false);
+  efficient_det_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, efficient_det_restuls, false);
 
   if (efficient_det_restuls.size() > post_info->nms_top_k) {
     efficient_det_restuls.resize(post_info->nms_top_k);
@@ -635,8 +615,59 @@ char* EfficientdetPostProcess(EfficientdetPostProcessInfo_t *post_info) {
   str_dets[out_string.str().length()] = '\0';
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_dets: %s\n", str_dets);
-  efficient_det_dets.clear();
+  context->dets.clear();
   efficient_det_restuls.clear();
   return str_dets;
 }
 
+
+char* EfficientdetPostProcess(EfficientdetPostProcessInfo_t *post_info) {
+  return EfficientdetEmit(&default_efficient_det_context, post_info);
+}
+
+static void *EfficientdetContextCreate(void) {
+  return new EfficientDetContext();
+}
+
+static void EfficientdetContextDestroy(void *context) {
+  delete static_cast<EfficientDetContext *>(context);
+}
+
+// 每层 2 个输出：cls、bbox
+static int EfficientdetPluginDecode(void *context, hbDNNTensor *tensors,
+                                    int tensor_num,
+                                    PostProcessInfo_t *post_info, int layer) {
+  if (tensor_num < 2) {
+    printf("efficientdet needs 2 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return EfficientdetDecode(
+      static_cast<EfficientDetContext *>(context), &tensors[0], &tensors[1],
+      reinterpret_cast<EfficientdetPostProcessInfo_t *>(post_info), layer);
+}
+
+static char *EfficientdetPluginEmit(void *context,
+                                    PostProcessInfo_t *post_info) {
+  return EfficientdetEmit(
+      static_cast<EfficientDetContext *>(context),
+      reinterpret_cast<EfficientdetPostProcessInfo_t *>(post_info));
+}
+
+static void EfficientdetPluginMerge(void *context, void *worker) {
+  auto &dets = static_cast<EfficientDetContext *>(context)->dets;
+  auto &worker_dets = static_cast<EfficientDetContext *>(worker)->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+}
+
+static_assert(sizeof(EfficientdetPostProcessInfo_t) ==
+                  sizeof(PostProcessInfo_t),
+              "EfficientdetPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *EfficientdetPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "efficientdet", EfficientdetContextCreate, EfficientdetContextDestroy,
+      EfficientdetPluginDecode, EfficientdetPluginEmit,
+      EfficientdetPluginMerge};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_EFFICIENTDET_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -37,6 +38,11 @@ char* EfficientdetPostProcess(EfficientdetPostProcessInfo_t *post_info);
 
 void EfficientdetdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, EfficientdetPostProcessInfo_t *post_info, int layer);
 
+/**
+ * 注册表使用的插件，每层 2 个输出 tensor：cls、bbox
+ */
+const PostProcessPlugin_t *EfficientdetPostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -20,15 +20,8 @@
 #include <cassert>
 
 #include "ptq_ssd_post_process.h"
-
-inline float fastExp(float x) {
-  union {
-    uint32_t i;
-    float f;
-  } v;
-  v.i = (12102203.1616540672f * x + 1064807160.56887296f);
-  return v.f;
-}
+#include "activation.h"
+#include "anchor_table.h"
 
 #define BSWAP_32(x) static_cast<int32_t>(__builtin_bswap32(x))
 
@@ -112,20 +105,6 @@ inline size_t argmax(ForwardIterator first, ForwardIterator last) {
 }
 
 
-typedef struct Anchor {
-  float cx{0.0};
-  float cy{0.0};
-  float w{0.0};
-  float h{0.0};
-  Anchor(float cx, float cy, float w, float h) : cx(cx), cy(cy), w(w), h(h) {}
-
-  friend std::ostream &operator<<(std::ostream &os, const Anchor &anchor) {
-    os << "[" << anchor.cx << "," << anchor.cy << "," << anchor.w << ","
-       << anchor.h << "]";
-    return os;
-  }
-} Anchor;
-
 /**
  * Bounding box definition
  */
@@ -188,9 +167,6 @@ static float DequantiScale(int32_t data,
   return static_cast<float>(r_int32(data, big_endian)) * scale_value;
 }
 
-std::vector<Detection> ssd_dets;
-std::vector<Detection> ssd_det_restuls;
-std::vector<std::vector<Anchor>> anchors_table;
 
 #define NMS_MAX_INPUT (400)
 void ssd_nms(std::vector<Detection> &input,
@@ -252,38 +228,83 @@ void ssd_nms(std::vector<Detection> &input,
   }
 }
 
-int SsdAnchors(std::vector<Anchor> &anchors, int layer, int layer_height, int layer_width) {
-  int step = default_ssd_config.step[layer];
-  float min_size = default_ssd_config.anchor_size[layer].first;
-  float max_size = default_ssd_config.anchor_size[layer].second;
-  auto &anchor_ratio = default_ssd_config.anchor_ratio[layer];
-  for (int i = 0; i < layer_height; i++) {
-    for (int j = 0; j < layer_width; j++) {
-      float cy = (i + default_ssd_config.offset[0]) * step;
-      float cx = (j + default_ssd_config.offset[1]) * step;
-      anchors.emplace_back(Anchor(cx, cy, min_size, min_size));
-      if (max_size > 0) {
-        anchors.emplace_back(Anchor(cx,
-                                    cy,
-                                    std::sqrt(max_size * min_size),
-                                    std::sqrt(max_size * min_size)));
-      }
-      for (int k = 0; k < 4; k++) {
-        if (anchor_ratio[k] == 0) continue;
-        float sr = std::sqrt(anchor_ratio[k]);
-        float w = min_size * sr;
-        float h = min_size / sr;
-        anchors.emplace_back(Anchor(cx, cy, w, h));
-      }
-    }
+// 通过得分阈值的候选框，所有候选收集完后统一按 anchor 解码
+struct SsdCandidates {
+  std::vector<int32_t> anchor;
+  std::vector<float> delta;   // 每个候选 dx, dy, dw, dh
+  std::vector<int> id;
+  std::vector<float> score;
+
+  void Add(int32_t anchor_index, int class_id, float class_score, float dx,
+           float dy, float dw, float dh) {
+    anchor.push_back(anchor_index);
+    delta.insert(delta.end(), {dx, dy, dw, dh});
+    id.push_back(class_id);
+    score.push_back(class_score);
+  }
+
+  void Clear() {
+    anchor.clear();
+    delta.clear();
+    id.clear();
+    score.clear();
+  }
+};
+
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 SsdPostProcess 时合并输出，
+ * 中间内存多帧之间复用
+ */
+struct SsdContext {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  SsdCandidates candidates;
+  std::vector<float> boxes;
+  std::vector<float> cls_exp;
+};
+
+// 原有接口使用的默认上下文
+static SsdContext default_ssd_context;
+
+static void SsdDecodeCandidates(SsdContext *context,
+                                const AnchorTable *anchors,
+                                SsdPostProcessInfo_t *post_info) {
+  const SsdCandidates &candidates = context->candidates;
+  int count = candidates.anchor.size();
+  std::vector<float> &boxes = context->boxes;
+  boxes.resize(count * 4);
+  AnchorDecodeBoxes(anchors, candidates.anchor.data(),
+                    candidates.delta.data(), count,
+                    default_ssd_config.std.data(), 0.f, boxes.data());
+
+  for (int i = 0; i < count; i++) {
+    const float *box = boxes.data() + i * 4;
+    auto xmin_org = static_cast<double>(box[0]) * post_info->ori_width;
+    auto ymin_org = static_cast<double>(box[1]) * post_info->ori_height;
+    auto xmax_org = static_cast<double>(box[2]) * post_info->ori_width;
+    auto ymax_org = static_cast<double>(box[3]) * post_info->ori_height;
+
+    xmin_org = std::max(xmin_org, 0.0);
+    xmax_org = std::min(xmax_org, post_info->ori_width - 1.0);
+    ymin_org = std::max(ymin_org, 0.0);
+    ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
+
+    if (xmax_org <= 0 || ymax_org <= 0) continue;
+    if (xmin_org > xmax_org || ymin_org > ymax_org) continue;
+
+    int max_id = candidates.id[i];
+    Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
+    context->dets.emplace_back(Detection(
+        max_id, candidates.score[i], bbox,
+        default_ssd_config.class_names[max_id].c_str()));
   }
-  return 0;
 }
 
 int GetBboxAndScoresQuantiNONE(
+    SsdContext *context,
     hbDNNTensor *bbox_tensor,
     hbDNNTensor *cls_tensor,
-    std::vector<Anchor> &anchors,
+    const AnchorTable *anchors,
     int class_num, SsdPostProcessInfo_t *post_info) {
   int *shape = cls_tensor->properties.validShape.dimensionSize;
   //uint32_t c_batch_size = shape[0];
@@ -307,31 +328,24 @@ int GetBboxAndScoresQuantiNONE(
   auto *raw_box_data =
       reinterpret_cast<float *>(bbox_tensor->sysMem[0].virAddr);
 
+  // 一个 anchor 所有类别的 exp，softmax 的分子
+  std::vector<float> &cls_exp = context->cls_exp;
+  cls_exp.resize(class_num);
+  SsdCandidates &candidates = context->candidates;
+  candidates.Clear();
+
   for (int i = 0; i < box_num; i++) {
     uint32_t res_id_cur_anchor = i * class_num;
     // get softmax sum
     double sum = 0;
     int max_id = 0;
-    // TODO(@horizon.ai): fastExp only affect the final score value
-    // confirm whether it affects the accuracy
-    bool is_performance_ = true;
-    double background_score;
-    if (is_performance_) {
-      background_score = fastExp(
-          raw_cls_data[res_id_cur_anchor + default_ssd_config.background_index]);
-    } else {
-      background_score = std::exp(
-          raw_cls_data[res_id_cur_anchor + default_ssd_config.background_index]);
-    }
+    ActivationExpF32(raw_cls_data + res_id_cur_anchor, class_num,
+                     cls_exp.data());
+    double background_score = cls_exp[default_ssd_config.background_index];
 
     double max_score = 0;
     for (int cls = 0; cls < class_num; ++cls) {
-      float cls_score;
-      if (is_performance_) {
-        cls_score = fastExp(raw_cls_data[res_id_cur_anchor + cls]);
-      } else {
-        cls_score = std::exp(raw_cls_data[res_id_cur_anchor + cls]);
-      }
+      float cls_score = cls_exp[cls];
       /* 1. scores should be larger than background score, or else will not be
       selected
       2. For Location for class_name, to add background to class-names list when
@@ -353,49 +367,35 @@ int GetBboxAndScoresQuantiNONE(
     }
 
     int start = i * 4;
-    float dx = raw_box_data[start];
-    float dy = raw_box_data[start + 1];
-    float dw = raw_box_data[start + 2];
-    float dh = raw_box_data[start + 3];
-
-    auto x_min = (anchors[i].cx - anchors[i].w / 2) / post_info->width;
-    auto y_min = (anchors[i].cy - anchors[i].h / 2) / post_info->height;
-    auto x_max = (anchors[i].cx + anchors[i].w / 2) / post_info->width;
-    auto y_max = (anchors[i].cy + anchors[i].h / 2) / post_info->height;
-
-    auto prior_w = x_max - x_min;
-    auto prior_h = y_max - y_min;
-    auto prior_center_x = (x_max + x_min) / 2;
-    auto prior_center_y = (y_max + y_min) / 2;
-    auto decode_x = default_ssd_config.std[0] * dx * prior_w + prior_center_x;
-    auto decode_y = default_ssd_config.std[1] * dy * prior_h + prior_center_y;
-    auto decode_w = std::exp(default_ssd_config.std[2] * dw) * prior_w;
-    auto decode_h = std::exp(default_ssd_config.std[3] * dh) * prior_h;
-
-    auto xmin_org = (decode_x - decode_w * 0.5) * post_info->ori_width;
-    auto ymin_org = (decode_y - decode_h * 0.5) * post_info->ori_height;
-    auto xmax_org = (decode_x + decode_w * 0.5) * post_info->ori_width;
-    auto ymax_org = (decode_y + decode_h * 0.5) * post_info->ori_height;
-
-    xmin_org = std::max(xmin_org, 0.0);
-    xmax_org = std::min(xmax_org, post_info->ori_width - 1.0);
-    ymin_org = std::max(ymin_org, 0.0);
-    ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
+    candidates.Add(i, max_id, max_score, raw_box_data[start],
+                   raw_box_data[start + 1], raw_box_data[start + 2],
+                   raw_box_data[start + 3]);
+  }
+  SsdDecodeCandidates(context, anchors, post_info);
+  return 0;
+}
 
-    if (xmax_org <= 0 || ymax_org <= 0) continue;
-    if (xmin_org > xmax_org || ymin_org > ymax_org) continue;
+// int8 输出按通道查表，其他位宽反量化后用多项式计算 exp
+static void ClsExp(const int8_t *data, float *scale, int count,
+                   int first_channel, const ActivationLut *lut, float *out) {
+  ActivationLutS8Channels(lut, data, count, first_channel, out);
+}
 
-    Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-    ssd_dets.emplace_back(Detection(
-        (int)max_id, max_score, bbox, default_ssd_config.class_names[max_id].c_str()));
+template <typename DType>
+static void ClsExp(const DType *data, float *scale, int count,
+                   int first_channel, const ActivationLut *lut, float *out) {
+  for (int i = 0; i < count; i++) {
+    out[i] = DequantiScale(data[i], false, scale[i]);
   }
-  return 0;
+  ActivationExpF32(out, count, out);
 }
 
+template <typename DType>
 int GetBboxAndScoresQuantiSCALE(
+    SsdContext *context,
     hbDNNTensor *bbox_tensor,
     hbDNNTensor *cls_tensor,
-    std::vector<Anchor> &anchors,
+    const AnchorTable *anchors,
     int class_num, SsdPostProcessInfo_t *post_info) {
   int h_idx{1}, w_idx{2}, c_idx{3};
 
@@ -408,8 +408,7 @@ int GetBboxAndScoresQuantiSCALE(
   int32_t bbox_c_aligned =
       bbox_tensor->properties.alignedShape.dimensionSize[c_idx];
 
-  int32_t *bbox_data =
-      reinterpret_cast<int32_t *>(bbox_tensor->sysMem[0].virAddr);
+  DType *bbox_data = reinterpret_cast<DType *>(bbox_tensor->sysMem[0].virAddr);
   float *bbox_scale = bbox_tensor->properties.scale.scaleData;
 
   // cls shape
@@ -420,31 +419,38 @@ int GetBboxAndScoresQuantiSCALE(
   int32_t cls_c_aligned =
       cls_tensor->properties.alignedShape.dimensionSize[c_idx];
 
-  int32_t *cls_data =
-      reinterpret_cast<int32_t *>(cls_tensor->sysMem[0].virAddr);
+  DType *cls_data = reinterpret_cast<DType *>(cls_tensor->sysMem[0].virAddr);
   float *cls_scale = cls_tensor->properties.scale.scaleData;
 
   auto stride = cls_c_valid / class_num;
   auto bbox_num_pred = bbox_c_valid / stride;
 
-  bool is_performance_ = true;
+  const ActivationLut *lut = nullptr;
+  if (cls_tensor->properties.tensorType == HB_DNN_TENSOR_TYPE_S8) {
+    lut = ActivationLutGet(ACTIVATION_EXP, cls_scale, cls_c_valid);
+    if (lut == nullptr) {
+      return -1;
+    }
+  }
+  std::vector<float> &cls_exp = context->cls_exp;
+  cls_exp.resize(class_num);
+  SsdCandidates &candidates = context->candidates;
+  candidates.Clear();
 
   for (int h = 0; h < bbox_h; ++h) {
     for (int w = 0; w < bbox_w; ++w) {
       for (int k = 0; k < stride; ++k) {
-        int32_t *cur_cls_data = cls_data + k * class_num;
+        DType *cur_cls_data = cls_data + k * class_num;
         float *cur_cls_scale = cls_scale + k * class_num;
-        float tmp = DequantiScale(cur_cls_data[0], false, cur_cls_scale[0]);
+        ClsExp(cur_cls_data, cur_cls_scale, class_num, k * class_num, lut,
+               cls_exp.data());
 
-        double background_score =
-            is_performance_ ? fastExp(tmp) : std::exp(tmp);
+        double background_score = cls_exp[0];
         double sum = 0;
         int max_id = 0;
         double max_score = 0;
         for (int index = 0; index < class_num; ++index) {
-          tmp = DequantiScale(cur_cls_data[index], false, cur_cls_scale[index]);
-
-          float cls_score = is_performance_ ? fastExp(tmp) : std::exp(tmp);
+          float cls_score = cls_exp[index];
 
           sum += cls_score;
           if (index != 0 && cls_score > max_score &&
@@ -459,85 +465,89 @@ int GetBboxAndScoresQuantiSCALE(
           continue;
         }
 
-        int32_t *cur_bbox_data = bbox_data + k * bbox_num_pred;
+        DType *cur_bbox_data = bbox_data + k * bbox_num_pred;
         float *cur_bbox_scale = bbox_scale + k * bbox_num_pred;
         float dx = DequantiScale(cur_bbox_data[0], false, cur_bbox_scale[0]);
         float dy = DequantiScale(cur_bbox_data[1], false, cur_bbox_scale[1]);
         float dw = DequantiScale(cur_bbox_data[2], false, cur_bbox_scale[2]);
         float dh = DequantiScale(cur_bbox_data[3], false, cur_bbox_scale[3]);
 
-        int i = h * bbox_w * stride + w * stride + k;
-        auto x_min = (anchors[i].cx - anchors[i].w / 2) / post_info->width;
-        auto y_min = (anchors[i].cy - anchors[i].h / 2) / post_info->height;
-        auto x_max = (anchors[i].cx + anchors[i].w / 2) / post_info->width;
-        auto y_max = (anchors[i].cy + anchors[i].h / 2) / post_info->height;
-
-        auto prior_w = x_max - x_min;
-        auto prior_h = y_max - y_min;
-        auto prior_center_x = (x_max + x_min) / 2;
-        auto prior_center_y = (y_max + y_min) / 2;
-        auto decode_x = default_ssd_config.std[0] * dx * prior_w + prior_center_x;
-        auto decode_y = default_ssd_config.std[1] * dy * prior_h + prior_center_y;
-        auto decode_w = std::exp(default_ssd_config.std[2] * dw) * prior_w;
-        auto decode_h = std::exp(default_ssd_config.std[3] * dh) * prior_h;
-
-        auto xmin_org = (decode_x - decode_w * 0.5) * post_info->ori_width;
-        auto ymin_org = (decode_y - decode_h * 0.5) * post_info->ori_height;
-        auto xmax_org = (decode_x + decode_w * 0.5) * post_info->ori_width;
-        auto ymax_org = (decode_y + decode_h * 0.5) * post_info->ori_height;
-
-        xmin_org = std::max(xmin_org, 0.0);
-        xmax_org = std::min(xmax_org, post_info->ori_width - 1.0);
-        ymin_org = std::max(ymin_org, 0.0);
-        ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
-
-        if (xmax_org <= 0 || ymax_org <= 0) continue;
-        if (xmin_org > xmax_org || ymin_org > ymax_org) continue;
-
-        Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-        ssd_dets.emplace_back(Detection((int)max_id,
-                                    max_score,
-                                    bbox,
-                                    default_ssd_config.class_names[max_id].c_str()));
+        candidates.Add(h * bbox_w * stride + w * stride + k, max_id,
+                       max_score, dx, dy, dw, dh);
       }
       bbox_data = bbox_data + bbox_c_aligned;
       cls_data = cls_data + cls_c_aligned;
     }
   }
+  ActivationLutPut(lut);
+  SsdDecodeCandidates(context, anchors, post_info);
   return 0;
 }
 
 
-void SsddoProcess(hbDNNTensor *bbox_tensor, hbDNNTensor *cls_tensor, SsdPostProcessInfo_t *post_info, int layer) {
+static int SsdDecode(SsdContext *context, hbDNNTensor *bbox_tensor,
+                     hbDNNTensor *cls_tensor, SsdPostProcessInfo_t *post_info,
+                     int layer) {
 
   int height = bbox_tensor->properties.alignedShape.dimensionSize[1];
   int width = bbox_tensor->properties.alignedShape.dimensionSize[2];
-  int layer_num = default_ssd_config.step.size();
-  if (anchors_table.empty()) {
-    // Note: note thread safe
-    anchors_table.resize(layer_num);
-    printf("init anchors_table.\n");
+  SsdAnchorParam anchor_param = {};
+  anchor_param.input_height = post_info->height;
+  anchor_param.input_width = post_info->width;
+  anchor_param.feat_height = height;
+  anchor_param.feat_width = width;
+  anchor_param.step = default_ssd_config.step[layer];
+  anchor_param.min_size = default_ssd_config.anchor_size[layer].first;
+  anchor_param.max_size = default_ssd_config.anchor_size[layer].second;
+  const auto &anchor_ratio = default_ssd_config.anchor_ratio[layer];
+  anchor_param.ratio_num =
+      std::min<int>(anchor_ratio.size(), ANCHOR_PARAM_MAX_NUM);
+  std::copy(anchor_ratio.begin(), anchor_ratio.begin() + anchor_param.ratio_num,
+            anchor_param.ratios);
+  anchor_param.offset[0] = default_ssd_config.offset[0];
+  anchor_param.offset[1] = default_ssd_config.offset[1];
+  const AnchorTable *anchors = SsdAnchorTableGet(&anchor_param);
+  if (anchors == nullptr) {
+    return -1;
   }
-  SsdAnchors(anchors_table[layer], layer, height, width);
 
   auto quanti_type = bbox_tensor->properties.quantiType;
   if (quanti_type == hbDNNQuantiType::SCALE) {
-    GetBboxAndScoresQuantiSCALE(bbox_tensor, cls_tensor, anchors_table[layer], default_ssd_config.class_num + 1, post_info);
+    // bbox 和 cls 输出的数据类型需要一致
+    auto tensor_type = cls_tensor->properties.tensorType;
+    if (bbox_tensor->properties.tensorType != tensor_type) {
+      printf("bbox and cls tensor type mismatch: %d, %d\n",
+             bbox_tensor->properties.tensorType, tensor_type);
+      return -1;
+    } else if (tensor_type == HB_DNN_TENSOR_TYPE_S8) {
+      GetBboxAndScoresQuantiSCALE<int8_t>(context, bbox_tensor, cls_tensor, anchors, default_ssd_config.class_num + 1, post_info);
+    } else if (tensor_type == HB_DNN_TENSOR_TYPE_S16) {
+      GetBboxAndScoresQuantiSCALE<int16_t>(context, bbox_tensor, cls_tensor, anchors, default_ssd_config.class_num + 1, post_info);
+    } else {
+      GetBboxAndScoresQuantiSCALE<int32_t>(context, bbox_tensor, cls_tensor, anchors, default_ssd_config.class_num + 1, post_info);
+    }
   } else if (quanti_type == hbDNNQuantiType::NONE) {
-    GetBboxAndScoresQuantiNONE(bbox_tensor, cls_tensor, anchors_table[layer], default_ssd_config.class_num + 1, post_info);
+    GetBboxAndScoresQuantiNONE(context, bbox_tensor, cls_tensor, anchors, default_ssd_config.class_num + 1, post_info);
   } else {
     printf("error quanti_type: %d\n", quanti_type);
+    return -1;
   }
+  return 0;
 }
 
+void SsddoProcess(hbDNNTensor *bbox_tensor, hbDNNTensor *cls_tensor, SsdPostProcessInfo_t *post_info, int layer) {
+  SsdDecode(&default_ssd_context, bbox_tensor, cls_tensor, post_info, layer);
+}
 
-char* SsdPostProcess(SsdPostProcessInfo_t *post_info) {
+
+static char *SsdEmit(SsdContext *context, SsdPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
+  std::vector<Detection> &ssd_det_restuls = context->results;
 
   // 计算交并比来合并检测框，传入交并比阈值(0.65)和返回box数量(5000)
-  ssd_nms(ssd_dets, post_info->nms_threshold, post_info->nms_top_k, ssd_det_restuls, false);
+  ssd_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, ssd_det_restuls, false);
   std::stringstream out_string;
 
   // 算法结果转换成json格式
@@ -555,8 +565,54 @@ char* SsdPostProcess(SsdPostProcessInfo_t *post_info) {
   str_dets[out_string.str().length()] = '\0';
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_dets: %s\n", str_dets);
-  ssd_dets.clear();
+  context->dets.clear();
   ssd_det_restuls.clear();
   return str_dets;
 }
 
+
+char* SsdPostProcess(SsdPostProcessInfo_t *post_info) {
+  return SsdEmit(&default_ssd_context, post_info);
+}
+
+static void *SsdContextCreate(void) {
+  return new SsdContext();
+}
+
+static void SsdContextDestroy(void *context) {
+  delete static_cast<SsdContext *>(context);
+}
+
+// 每层 2 个输出：bbox、cls
+static int SsdPluginDecode(void *context, hbDNNTensor *tensors, int tensor_num,
+                           PostProcessInfo_t *post_info, int layer) {
+  if (tensor_num < 2) {
+    printf("ssd needs 2 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return SsdDecode(static_cast<SsdContext *>(context), &tensors[0],
+                   &tensors[1],
+                   reinterpret_cast<SsdPostProcessInfo_t *>(post_info), layer);
+}
+
+static char *SsdPluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return SsdEmit(static_cast<SsdContext *>(context),
+                 reinterpret_cast<SsdPostProcessInfo_t *>(post_info));
+}
+
+static void SsdPluginMerge(void *context, void *worker) {
+  auto &dets = static_cast<SsdContext *>(context)->dets;
+  auto &worker_dets = static_cast<SsdContext *>(worker)->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+}
+
+static_assert(sizeof(SsdPostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "SsdPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *SsdPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "ssd", SsdContextCreate, SsdContextDestroy, SsdPluginDecode,
+      SsdPluginEmit, SsdPluginMerge};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_SSD_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -37,6 +38,11 @@ char* SsdPostProcess(SsdPostProcessInfo_t *post_info);
 
 void SsddoProcess(hbDNNTensor *bbox_tensor, hbDNNTensor *cls_tensor, SsdPostProcessInfo_t *post_info, int layer);
 
+/**
+ * 注册表使用的插件，每层 2 个输出 tensor：bbox、cls
+ */
+const PostProcessPlugin_t *SsdPostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
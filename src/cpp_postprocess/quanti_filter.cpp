@@ -0,0 +1,102 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <cmath>
+#include <limits>
+
+#include "quanti_filter.h"
+
+static int32_t RawThreshold(float scale, double value) {
+  // scale <= 0 时反量化不再是单调递增的，不做过滤
+  if (!(scale > 0.f) || std::isnan(value)) {
+    return std::numeric_limits<int32_t>::min();
+  }
+  // 多留一个量化步长，抵消 float 乘法的舍入误差
+  double raw = std::floor(value / scale) - 1.0;
+  if (raw <= std::numeric_limits<int32_t>::min()) {
+    return std::numeric_limits<int32_t>::min();
+  }
+  if (raw >= std::numeric_limits<int32_t>::max()) {
+    return std::numeric_limits<int32_t>::max();
+  }
+  return static_cast<int32_t>(raw);
+}
+
+void QuantiValueThreshold(const float *scale, int count, float threshold,
+                          int32_t *thresholds) {
+  for (int i = 0; i < count; i++) {
+    thresholds[i] = RawThreshold(scale[i], threshold);
+  }
+}
+
+void QuantiSigmoidThreshold(const float *scale, int count, float score,
+                            int32_t *thresholds) {
+  if (!(score > 0.f && score < 1.f)) {
+    for (int i = 0; i < count; i++) {
+      thresholds[i] = std::numeric_limits<int32_t>::min();
+    }
+    return;
+  }
+  // sigmoid(x) >= score  <=>  x >= ln(score / (1 - score))
+  double logit = std::log(static_cast<double>(score) / (1.0 - score));
+  for (int i = 0; i < count; i++) {
+    thresholds[i] = RawThreshold(scale[i], logit);
+  }
+}
+
+int QuantiAnyGE(const int32_t *data, const int32_t *thresholds, int count) {
+  int i = 0;
+  uint32x4_t hit = vdupq_n_u32(0);
+  for (; i <= count - 8; i += 8) {
+    uint32x4_t ge0 = vcgeq_s32(vld1q_s32(data + i), vld1q_s32(thresholds + i));
+    uint32x4_t ge1 =
+        vcgeq_s32(vld1q_s32(data + i + 4), vld1q_s32(thresholds + i + 4));
+    hit = vorrq_u32(hit, vorrq_u32(ge0, ge1));
+  }
+  for (; i <= count - 4; i += 4) {
+    hit = vorrq_u32(hit,
+                    vcgeq_s32(vld1q_s32(data + i), vld1q_s32(thresholds + i)));
+  }
+  if (vmaxvq_u32(hit) != 0) {
+    return 1;
+  }
+  for (; i < count; i++) {
+    if (data[i] >= thresholds[i]) {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+int QuantiScanGE(const int32_t *data, int count, int32_t threshold,
+                 int32_t *indices) {
+  int num = 0;
+  int i = 0;
+  int32x4_t thr = vdupq_n_s32(threshold);
+  for (; i <= count - 8; i += 8) {
+    uint32x4_t ge0 = vcgeq_s32(vld1q_s32(data + i), thr);
+    uint32x4_t ge1 = vcgeq_s32(vld1q_s32(data + i + 4), thr);
+    // 绝大多数元素都在阈值以下，整组没有通过时直接跳过
+    if (vmaxvq_u32(vorrq_u32(ge0, ge1)) == 0) {
+      continue;
+    }
+    for (int j = i; j < i + 8; j++) {
+      if (data[j] >= threshold) {
+        indices[num++] = j;
+      }
+    }
+  }
+  for (; i < count; i++) {
+    if (data[i] >= threshold) {
+      indices[num++] = i;
+    }
+  }
+  return num;
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_QUANTI_FILTER_H_
+#define _POST_PROCESS_QUANTI_FILTER_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * SCALE 量化输出在整数域上做阈值预过滤
+ *
+ * 反量化 (raw * scale) 和 sigmoid 都是单调的，得分阈值可以针对每个通道
+ * 换算成一个 int32 阈值，先用 NEON 直接比较原始整数，只有通过的候选才做
+ * 反量化和精确的得分计算。换算结果是保守的（向下取整再留一个量化步长），
+ * 预过滤只会多放过候选，不会丢掉原本能通过阈值的结果。
+ */
+
+/**
+ * 反量化值的阈值：raw * scale[i] > threshold 的元素一定满足 raw >= thresholds[i]
+ * @param[in] scale: 每个通道的反量化系数
+ * @param[in] count: 通道数
+ * @param[in] threshold: 反量化后的阈值
+ * @param[out] thresholds: 每个通道的整数阈值
+ */
+void QuantiValueThreshold(const float *scale, int count, float threshold,
+                          int32_t *thresholds);
+
+/**
+ * sigmoid 得分的阈值：sigmoid(raw * scale[i]) >= score 的元素一定满足
+ * raw >= thresholds[i]。score 不在 (0, 1) 区间时不做过滤
+ */
+void QuantiSigmoidThreshold(const float *scale, int count, float score,
+                            int32_t *thresholds);
+
+/**
+ * 是否有任意一个 data[i] >= thresholds[i]，用于一个 anchor 的所有类别
+ * @return 1: 有，0: 没有
+ */
+int QuantiAnyGE(const int32_t *data, const int32_t *thresholds, int count);
+
+/**
+ * 扫描一段连续数据，记录 data[i] >= threshold 的下标，
+ * 用于 NCHW 排列的一个通道平面
+ * @param[out] indices: 至少 count 个元素
+ * @return 通过的个数
+ */
+int QuantiScanGE(const int32_t *data, int count, int32_t threshold,
+                 int32_t *indices);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_QUANTI_FILTER_H_
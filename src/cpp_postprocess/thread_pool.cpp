@@ -0,0 +1,149 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <algorithm>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "thread_pool.h"
+
+#define THREAD_POOL_MAX_THREAD_NUM 16
+
+struct ThreadPoolJob {
+  ThreadPoolTask task;
+  void *arg;
+  int task_num;
+  int next;         // 下一个要领取的任务编号
+  int finished;     // 已经完成的任务数
+};
+
+struct ThreadPoolState {
+  std::mutex mutex;
+  std::condition_variable cv;         // 有新任务或者需要退出
+  std::condition_variable job_cv;     // 有任务完成
+  std::deque<ThreadPoolJob *> jobs;
+  std::vector<std::thread> workers;
+  int thread_num = 0;
+  bool stop = false;
+};
+
+// 进程退出时工作线程可能还在等待任务，线程池的状态不析构
+static ThreadPoolState &pool = *new ThreadPoolState();
+static thread_local bool in_pool_task = false;
+
+static int DefaultThreadNum(void) {
+  int num = std::thread::hardware_concurrency();
+  return std::min(std::max(num, 1), 4);
+}
+
+// 领取一个任务，调用时需要持有 pool.mutex；job 中的任务都已领取时返回 -1
+static int TakeTask(ThreadPoolJob *job) {
+  if (job->next >= job->task_num) {
+    return -1;
+  }
+  int task = job->next++;
+  if (job->next == job->task_num) {
+    pool.jobs.erase(std::find(pool.jobs.begin(), pool.jobs.end(), job));
+  }
+  return task;
+}
+
+static void RunTask(std::unique_lock<std::mutex> &lock, ThreadPoolJob *job,
+                    int task) {
+  lock.unlock();
+  in_pool_task = true;
+  job->task(job->arg, task);
+  in_pool_task = false;
+  lock.lock();
+  if (++job->finished == job->task_num) {
+    pool.job_cv.notify_all();
+  }
+}
+
+static void WorkerLoop(void) {
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  while (true) {
+    pool.cv.wait(lock, [] { return pool.stop || !pool.jobs.empty(); });
+    if (pool.stop) {
+      return;
+    }
+    ThreadPoolJob *job = pool.jobs.front();
+    RunTask(lock, job, TakeTask(job));
+  }
+}
+
+// 调用时需要持有 pool.mutex
+static void StopWorkers(std::unique_lock<std::mutex> &lock) {
+  pool.stop = true;
+  pool.cv.notify_all();
+  std::vector<std::thread> workers;
+  workers.swap(pool.workers);
+  lock.unlock();
+  for (auto &worker : workers) {
+    worker.join();
+  }
+  lock.lock();
+  pool.stop = false;
+}
+
+// 调用时需要持有 pool.mutex
+static void StartWorkers(void) {
+  if (pool.thread_num == 0) {
+    pool.thread_num = DefaultThreadNum();
+  }
+  while (static_cast<int>(pool.workers.size()) < pool.thread_num - 1) {
+    pool.workers.emplace_back(WorkerLoop);
+  }
+}
+
+int ThreadPoolSetThreadNum(int thread_num) {
+  if (thread_num < 1 || thread_num > THREAD_POOL_MAX_THREAD_NUM) {
+    printf("invalid thread num: %d\n", thread_num);
+    return -1;
+  }
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  if (!pool.workers.empty()) {
+    StopWorkers(lock);
+  }
+  pool.thread_num = thread_num;
+  return 0;
+}
+
+int ThreadPoolGetThreadNum(void) {
+  std::lock_guard<std::mutex> lock(pool.mutex);
+  return pool.thread_num == 0 ? DefaultThreadNum() : pool.thread_num;
+}
+
+void ThreadPoolRun(ThreadPoolTask task, void *arg, int task_num) {
+  if (task_num <= 0) {
+    return;
+  }
+  std::unique_lock<std::mutex> lock(pool.mutex);
+  if (task_num == 1 || in_pool_task || pool.thread_num == 1) {
+    lock.unlock();
+    for (int i = 0; i < task_num; i++) {
+      task(arg, i);
+    }
+    return;
+  }
+
+  StartWorkers();
+  ThreadPoolJob job = {task, arg, task_num, 0, 0};
+  pool.jobs.push_back(&job);
+  pool.cv.notify_all();
+  // 调用线程也领取任务，工作线程都在忙时不会等待
+  int index;
+  while ((index = TakeTask(&job)) >= 0) {
+    RunTask(lock, &job, index);
+  }
+  pool.job_cv.wait(lock, [&job] { return job.finished == job.task_num; });
+}
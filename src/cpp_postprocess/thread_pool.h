@@ -0,0 +1,50 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_THREAD_POOL_H_
+#define _POST_PROCESS_THREAD_POOL_H_
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * 后处理共用的线程池
+ *
+ * 整个进程只有一个线程池，工作线程在第一次有并行任务时创建，之后一直复用，
+ * 不会每次调用都创建线程。调用 ThreadPoolRun 的线程也参与执行任务，
+ * 并行度为 thread_num 时只创建 thread_num - 1 个工作线程。
+ * 多个线程可以同时调用 ThreadPoolRun，任务在线程池中交替执行。
+ */
+
+typedef void (*ThreadPoolTask)(void *arg, int task);
+
+/**
+ * 设置并行度，1 表示所有任务都在调用线程中顺序执行
+ * 已有的工作线程会先退出再按新的个数创建，调用时不能有正在执行的任务
+ * @return 0 if success
+ */
+int ThreadPoolSetThreadNum(int thread_num);
+
+/**
+ * 当前的并行度，默认为 CPU 核数，最多 4
+ */
+int ThreadPoolGetThreadNum(void);
+
+/**
+ * 执行 task(arg, 0) ... task(arg, task_num - 1)，全部完成后返回
+ * 任务的执行顺序和所在线程不确定，结果需要按任务编号保存
+ * 在线程池的任务中再次调用时直接在当前线程顺序执行
+ */
+void ThreadPoolRun(ThreadPoolTask task, void *arg, int task_num);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_THREAD_POOL_H_
@@ -27,8 +27,8 @@ typedef struct Segmentation {
   int32_t height;
 }Segmentation;
 
-
-Segmentation Segmentation_dets;
+// 每个模型实例一个 Segmentation 作为后处理上下文，原有接口使用默认上下文
+static Segmentation default_unet_context;
 
 static inline uint32x4x4_t CalculateIndex(uint32_t idx,
                                           float32x4_t a,
@@ -95,17 +95,18 @@ static std::pair<float, int> MaxScoreID(int32_t *input,
   return result_id_score;
 }
 
-int PostProcessNone(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int layer) {
+int PostProcessNone(Segmentation *context, hbDNNTensor *tensors,
+                    UnetPostProcessInfo_t *post_info, int layer) {
 
   int height = tensors->properties.validShape.dimensionSize[1];
   int width = tensors->properties.validShape.dimensionSize[2];
   int channel = tensors->properties.validShape.dimensionSize[3];
 
   float *data = reinterpret_cast<float *>(tensors->sysMem[0].virAddr);
-  Segmentation_dets.seg.resize(height * width);
-  Segmentation_dets.width = width;
-  Segmentation_dets.height = height;
-  Segmentation_dets.num_classes = layer;
+  context->seg.resize(height * width);
+  context->width = width;
+  context->height = height;
+  context->num_classes = layer;
 
   // argmax, operate in NHWC format
   for (int h = 0; h < height; ++h) {
@@ -119,13 +120,14 @@ int PostProcessNone(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int
           top_index = c;
         }
       }
-      Segmentation_dets.seg[h * width + w] = top_index;
+      context->seg[h * width + w] = top_index;
     }
   }
   return 0;
 }
 
-int PostProcessScale(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int layer) {
+int PostProcessScale(Segmentation *context, hbDNNTensor *tensors,
+                     UnetPostProcessInfo_t *post_info, int layer) {
 
   // get shape
   int height = tensors->properties.validShape.dimensionSize[1];
@@ -135,10 +137,10 @@ int PostProcessScale(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int
   int c_stride = tensors->properties.alignedShape.dimensionSize[3];
 
   int32_t *data = reinterpret_cast<int32_t *>(tensors->sysMem[0].virAddr);
-  Segmentation_dets.seg.resize(height * width);
-  Segmentation_dets.width = width;
-  Segmentation_dets.height = height;
-  Segmentation_dets.num_classes = layer;
+  context->seg.resize(height * width);
+  context->width = width;
+  context->height = height;
+  context->num_classes = layer;
 
   // argmax, operate in NHWC format
   for (int h = 0; h < height; ++h) {
@@ -149,25 +151,32 @@ int PostProcessScale(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int
       auto max_score_id = MaxScoreID(c_data, scale, channel);
       top_score = max_score_id.first;
       top_index = max_score_id.second;
-      Segmentation_dets.seg[h * width + w] = top_index;
+      context->seg[h * width + w] = top_index;
     }
   }
   return 0;
 }
 
-void UnetdoProcess(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int layer) {
+static int UnetDecode(Segmentation *context, hbDNNTensor *tensors,
+                      UnetPostProcessInfo_t *post_info, int layer) {
 
   if (tensors->properties.quantiType == hbDNNQuantiType::SCALE) {
-    PostProcessScale(tensors, post_info, layer);
+    return PostProcessScale(context, tensors, post_info, layer);
   } else if (tensors->properties.quantiType == hbDNNQuantiType::NONE) {
-    PostProcessNone(tensors, post_info, layer);
+    return PostProcessNone(context, tensors, post_info, layer);
   } else {
     printf("error quanti_type: %d\n" ,tensors->properties.quantiType);
+    return -1;
   }
 }
 
+void UnetdoProcess(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int layer) {
+  UnetDecode(&default_unet_context, tensors, post_info, layer);
+}
 
-char* UnetPostProcess(UnetPostProcessInfo_t *post_info) {
+
+static char *UnetEmit(Segmentation *context,
+                      UnetPostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
@@ -176,10 +185,10 @@ char* UnetPostProcess(UnetPostProcessInfo_t *post_info) {
 
   // 算法结果转换成json格式
   out_string << "\"unet_result\": [";
-  for (i = 0; i < Segmentation_dets.seg.size(); i++) {
-  	auto det_ret = Segmentation_dets.seg[i];
+  for (i = 0; i < context->seg.size(); i++) {
+  	auto det_ret = context->seg[i];
   	out_string << std::to_string(det_ret);
-  	if (i < Segmentation_dets.seg.size() - 1)
+  	if (i < context->seg.size() - 1)
 		out_string << ",";
   }
   out_string << "]" << std::endl;
@@ -189,7 +198,46 @@ char* UnetPostProcess(UnetPostProcessInfo_t *post_info) {
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   /*printf("str_dets: %s\n", str_dets);*/
 
-  Segmentation_dets.seg.clear();
+  context->seg.clear();
   return str_dets;
 }
 
+char* UnetPostProcess(UnetPostProcessInfo_t *post_info) {
+  return UnetEmit(&default_unet_context, post_info);
+}
+
+static void *UnetContextCreate(void) {
+  return new Segmentation();
+}
+
+static void UnetContextDestroy(void *context) {
+  delete static_cast<Segmentation *>(context);
+}
+
+// 1 个输出，layer 为类别数
+static int UnetPluginDecode(void *context, hbDNNTensor *tensors,
+                            int tensor_num, PostProcessInfo_t *post_info,
+                            int layer) {
+  if (tensor_num < 1) {
+    printf("unet needs 1 tensor, got %d\n", tensor_num);
+    return -1;
+  }
+  return UnetDecode(static_cast<Segmentation *>(context), &tensors[0],
+                    reinterpret_cast<UnetPostProcessInfo_t *>(post_info),
+                    layer);
+}
+
+static char *UnetPluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return UnetEmit(static_cast<Segmentation *>(context),
+                  reinterpret_cast<UnetPostProcessInfo_t *>(post_info));
+}
+
+static_assert(sizeof(UnetPostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "UnetPostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *UnetPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "unet", UnetContextCreate, UnetContextDestroy, UnetPluginDecode,
+      UnetPluginEmit};
+  return &plugin;
+}
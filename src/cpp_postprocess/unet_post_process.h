@@ -10,6 +10,7 @@
 #define _POST_PROCESS_UNET_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -37,6 +38,11 @@ typedef struct {
 
   void UnetdoProcess(hbDNNTensor *tensors, UnetPostProcessInfo_t *post_info, int layer);
 
+  /**
+   * 注册表使用的插件，1 个输出 tensor，layer 为类别数
+   */
+  const PostProcessPlugin_t *UnetPostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -17,6 +17,7 @@
 #include <algorithm>
 
 #include "yolov3_post_process.h"
+#include "quanti_filter.h"
 
 /**
  * Config definition for Yolov3
@@ -145,7 +146,17 @@ typedef struct Detection {
   ~Detection() {}
 } Detection;
 
-std::vector<Detection> yolov3_dets;
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 Yolov3PostProcess 时合并输出
+ */
+struct Yolov3Context {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  std::vector<int32_t> thresholds;    // SCALE 输出的整数阈值，多帧之间复用
+};
+
+// 原有接口使用的默认上下文
+static Yolov3Context default_yolov3_context;
 
 #define NMS_MAX_INPUT (400)
 
@@ -215,9 +226,12 @@ float DequantiScale(int32_t data,
 }
 
 void PostProcessQuantiScaleNHWC(
+    Yolov3Context *context,
     hbDNNTensor *tensor,
     Yolov3PostProcessInfo_t *post_info,
-    int layer) {
+    int layer,
+    int slice,
+    int slice_num) {
   auto *data = reinterpret_cast<int32_t *>(tensor->sysMem[0].virAddr);
   float *scale = tensor->properties.scale.scaleData;
   int num_classes = default_yolov3_config.class_num;
@@ -245,7 +259,21 @@ void PostProcessQuantiScaleNHWC(
   printf("channel_aligned: %d\n", channel_aligned);
 
   int anchors_size = anchors.size();
-  for (int32_t h = 0; h < height; h++) {
+
+  // confidence = sigmoid(obj) * sigmoid(cls) >= score_threshold 要求两者
+  // 都不小于 score_threshold，先换算成整数阈值在原始数据上过滤
+  std::vector<int32_t> &thresholds = context->thresholds;
+  thresholds.resize(anchors_size * num_pred);
+  for (int k = 0; k < anchors_size; k++) {
+    QuantiSigmoidThreshold(scale + k * num_pred + 4, num_classes + 1,
+                           post_info->score_threshold,
+                           thresholds.data() + k * num_pred + 4);
+  }
+
+  int row_begin = height * slice / slice_num;
+  int row_end = height * (slice + 1) / slice_num;
+  data += row_begin * width * channel_aligned;
+  for (int32_t h = row_begin; h < row_end; h++) {
     for (int32_t w = 0; w < width; w++) {
       for (int k = 0; k < anchors_size; k++) {
         double anchor_x = anchors[k].first;
@@ -253,6 +281,12 @@ void PostProcessQuantiScaleNHWC(
 
         int32_t *cur_data = data + k * num_pred;
         float *cur_scale = scale + k * num_pred;
+        int32_t *cur_thresholds = thresholds.data() + k * num_pred;
+        if (cur_data[4] < cur_thresholds[4] ||
+            !QuantiAnyGE(cur_data + 5, cur_thresholds + 5, num_classes)) {
+          continue;
+        }
+
         float objness = DequantiScale(cur_data[4], false, cur_scale[4]);
 
         for (int index = 0; index < num_classes; ++index) {
@@ -307,7 +341,7 @@ void PostProcessQuantiScaleNHWC(
         ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
 
         Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-        yolov3_dets.push_back(Detection((int)id,
+        context->dets.push_back(Detection((int)id,
                                  confidence,
                                  bbox,
                                  default_yolov3_config.class_names[(int)id].c_str()));
@@ -318,9 +352,12 @@ void PostProcessQuantiScaleNHWC(
 }
 
 void PostProcessQuantiNoneNHWC(
+    Yolov3Context *context,
     hbDNNTensor *tensor,
     Yolov3PostProcessInfo_t *post_info,
-    int layer) {
+    int layer,
+    int slice,
+    int slice_num) {
   auto *data = reinterpret_cast<float *>(tensor->sysMem[0].virAddr);
   int num_classes = default_yolov3_config.class_num;
   int stride = default_yolov3_config.strides[layer];
@@ -342,7 +379,10 @@ void PostProcessQuantiNoneNHWC(
   int width = tensor->properties.validShape.dimensionSize[2];
 
   int anchors_size = anchors.size();
-  for (int32_t h = 0; h < height; h++) {
+  int row_begin = height * slice / slice_num;
+  int row_end = height * (slice + 1) / slice_num;
+  data += row_begin * width * num_pred * anchors_size;
+  for (int32_t h = row_begin; h < row_end; h++) {
     for (int32_t w = 0; w < width; w++) {
       for (int k = 0; k < anchors_size; k++) {
         double anchor_x = anchors[k].first;
@@ -400,7 +440,7 @@ void PostProcessQuantiNoneNHWC(
         ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
 
         Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-        yolov3_dets.push_back(Detection((int)id,
+        context->dets.push_back(Detection((int)id,
                                  confidence,
                                  bbox,
                                  default_yolov3_config.class_names[(int)id].c_str()));
@@ -411,6 +451,7 @@ void PostProcessQuantiNoneNHWC(
 }
 
 void PostProcessNCHW(
+    Yolov3Context *context,
     hbDNNTensor *tensor,
     Yolov3PostProcessInfo_t *post_info,
     int layer) {
@@ -499,7 +540,7 @@ void PostProcessNCHW(
         ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
 
         Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-        yolov3_dets.push_back(Detection((int)id,
+        context->dets.push_back(Detection((int)id,
                                  confidence,
                                  bbox,
                                  default_yolov3_config.class_names[(int)id].c_str()));
@@ -510,42 +551,60 @@ void PostProcessNCHW(
 
 
 void PostProcessNHWC(
+    Yolov3Context *context,
     hbDNNTensor *tensor,
     Yolov3PostProcessInfo_t *post_info,
-    int layer) {
+    int layer,
+    int slice,
+    int slice_num) {
   auto quanti_type = tensor->properties.quantiType;
   if (quanti_type == hbDNNQuantiType::SCALE) {
-    PostProcessQuantiScaleNHWC(tensor, post_info, layer);
+    PostProcessQuantiScaleNHWC(context, tensor, post_info, layer, slice,
+                               slice_num);
   } else if (quanti_type == hbDNNQuantiType::NONE) {
-    PostProcessQuantiNoneNHWC(tensor, post_info, layer);
+    PostProcessQuantiNoneNHWC(context, tensor, post_info, layer, slice,
+                              slice_num);
   } else {
     printf("PostProcessNHWC quanti_type : %d\n",  quanti_type);
   }
 }
 
 
-void Yolov3doProcess(hbDNNTensor *tensor, Yolov3PostProcessInfo_t *post_info, int layer) {
-
+// 按行把一层均分成 slice_num 份，只解码第 slice 份的行
+static int Yolov3Decode(Yolov3Context *context, hbDNNTensor *tensor,
+                        Yolov3PostProcessInfo_t *post_info, int layer,
+                        int slice, int slice_num) {
   if (tensor->properties.quantizeAxis == 3) {
-    PostProcessNHWC(tensor, post_info, layer);
+    PostProcessNHWC(context, tensor, post_info, layer, slice, slice_num);
   } else if (tensor->properties.quantizeAxis == 1) {
-    PostProcessNCHW(tensor, post_info, layer);
+    // NCHW 按 anchor 在外层遍历，按行切分会改变结果的顺序，整层在第 0 份解码
+    if (slice == 0) {
+      PostProcessNCHW(context, tensor, post_info, layer);
+    }
   } else {
     printf("tensor layout error.\n");
+    return -1;
   }
+  return 0;
+}
+
+void Yolov3doProcess(hbDNNTensor *tensor, Yolov3PostProcessInfo_t *post_info, int layer) {
+
+  Yolov3Decode(&default_yolov3_context, tensor, post_info, layer, 0, 1);
 }
 
 
 // Yolov3 输出tensor格式
 // 3次下采样得到三组缩小后的gred，然后对每个gred进行三次预测，最后输出结果
-char* Yolov3PostProcess(Yolov3PostProcessInfo_t *post_info) {
+static char *Yolov3Emit(Yolov3Context *context,
+                        Yolov3PostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_yolov3_dets;
-  std::vector<Detection> det_restuls;
+  std::vector<Detection> &det_restuls = context->results;
 
   // 计算交并比来合并检测框，传入交并比阈值(0.65)和返回box数量(5000)
-  yolov3_nms(yolov3_dets, post_info->nms_threshold, post_info->nms_top_k, det_restuls, false);
+  yolov3_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, det_restuls, false);
   std::stringstream out_string;
 
   // 算法结果转换成json格式
@@ -563,8 +622,66 @@ char* Yolov3PostProcess(Yolov3PostProcessInfo_t *post_info) {
   str_yolov3_dets[out_string.str().length()] = '\0';
   snprintf(str_yolov3_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_yolov3_dets: %s\n", str_yolov3_dets);
-  yolov3_dets.clear();
+  context->dets.clear();
   det_restuls.clear();
   return str_yolov3_dets;
 }
 
+char* Yolov3PostProcess(Yolov3PostProcessInfo_t *post_info) {
+  return Yolov3Emit(&default_yolov3_context, post_info);
+}
+
+static void *Yolov3ContextCreate(void) {
+  return new Yolov3Context();
+}
+
+static void Yolov3ContextDestroy(void *context) {
+  delete static_cast<Yolov3Context *>(context);
+}
+
+static int Yolov3PluginDecode(void *context, hbDNNTensor *tensors,
+                              int tensor_num, PostProcessInfo_t *post_info,
+                              int layer) {
+  if (tensor_num < 1) {
+    printf("yolov3 needs 1 tensor per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return Yolov3Decode(static_cast<Yolov3Context *>(context), tensors,
+                      reinterpret_cast<Yolov3PostProcessInfo_t *>(post_info),
+                      layer, 0, 1);
+}
+
+static int Yolov3PluginDecodeSlice(void *context, hbDNNTensor *tensors,
+                                   int tensor_num,
+                                   PostProcessInfo_t *post_info, int layer,
+                                   int slice, int slice_num) {
+  if (tensor_num < 1) {
+    printf("yolov3 needs 1 tensor per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return Yolov3Decode(static_cast<Yolov3Context *>(context), tensors,
+                      reinterpret_cast<Yolov3PostProcessInfo_t *>(post_info),
+                      layer, slice, slice_num);
+}
+
+static void Yolov3PluginMerge(void *context, void *worker) {
+  auto &dets = static_cast<Yolov3Context *>(context)->dets;
+  auto &worker_dets = static_cast<Yolov3Context *>(worker)->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+}
+
+static char *Yolov3PluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return Yolov3Emit(static_cast<Yolov3Context *>(context),
+                    reinterpret_cast<Yolov3PostProcessInfo_t *>(post_info));
+}
+
+static_assert(sizeof(Yolov3PostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "Yolov3PostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *Yolov3PostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "yolov3", Yolov3ContextCreate, Yolov3ContextDestroy, Yolov3PluginDecode,
+      Yolov3PluginEmit, Yolov3PluginMerge, Yolov3PluginDecodeSlice};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_YOLOV3_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -42,6 +43,11 @@ char* Yolov3PostProcess(Yolov3PostProcessInfo_t *post_info);
 
 void Yolov3doProcess(hbDNNTensor *tensor, Yolov3PostProcessInfo_t *post_info, int layer);
 
+/**
+ * 注册表使用的插件，每层 1 个输出 tensor
+ */
+const PostProcessPlugin_t *Yolov3PostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
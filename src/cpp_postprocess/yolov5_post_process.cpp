@@ -22,6 +22,7 @@
 // #include "utils/utils_log.h"
 
 #include "yolov5_post_process.h"
+#include "quanti_filter.h"
 
 #define BSWAP_32(x) static_cast<int32_t>(__builtin_bswap32(x))
 
@@ -191,8 +192,17 @@ typedef struct Detection {
   ~Detection() {}
 } Detection;
 
-std::vector<Detection> dets;
-std::vector<Detection> det_restuls;
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 Yolov5PostProcess 时合并输出
+ */
+struct Yolov5Context {
+  std::vector<Detection> dets;
+  std::vector<Detection> results;
+  std::vector<int32_t> thresholds;    // SCALE 输出的整数阈值，多帧之间复用
+};
+
+// 原有接口使用的默认上下文
+static Yolov5Context default_yolov5_context;
 
 
 static float DequantiScale(int32_t data, bool big_endian, float &scale_value) {
@@ -273,7 +283,10 @@ static void yolov5_nms(std::vector<Detection> &input,
   }
 }
 
-void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, int layer) {
+// 按行把一层均分成 slice_num 份，只解码第 slice 份的行
+static int Yolov5Decode(Yolov5Context *context, hbDNNTensor *tensor,
+                        Yolov5PostProcessInfo_t *post_info, int layer,
+                        int slice, int slice_num) {
 
   // 80个分类
   int num_classes = default_yolov5_config.class_num;
@@ -313,10 +326,13 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
 
   int anchor_num = anchors.size();
   auto quanti_type = tensor->properties.quantiType;
+  int row_begin = height * slice / slice_num;
+  int row_end = height * (slice + 1) / slice_num;
 
   if (quanti_type == hbDNNQuantiType::NONE) {
     auto *data = reinterpret_cast<float *>(tensor->sysMem[0].virAddr);
-    for (int32_t h = 0; h < height; h++) {
+    data += row_begin * width * num_pred * anchor_num;
+    for (int32_t h = row_begin; h < row_end; h++) {
       for (int32_t w = 0; w < width; w++) {
         for (int k = 0; k < anchor_num; k++) {
           double anchor_x = anchors[k].first;
@@ -385,7 +401,7 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
 
           // 实际在原图上的box，添加到检测结果中
           Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-          dets.emplace_back((int)id,
+          context->dets.emplace_back((int)id,
                     confidence,
                     bbox,
                     default_yolov5_config.class_names[(int)id].c_str());
@@ -398,7 +414,20 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
     auto *data = reinterpret_cast<int32_t *>(tensor->sysMem[0].virAddr);
     auto dequantize_scale_ptr = reinterpret_cast<float *>(tensor->properties.scale.scaleData);
     bool big_endian = false;
-    for (int32_t h = 0; h < height; h++) {
+
+    // objness 和最大类别的 sigmoid 都不能低于 score_threshold，
+    // 先在原始整数上过滤，只有通过的 anchor 才做反量化
+    std::vector<int32_t> &thresholds = context->thresholds;
+    thresholds.resize(anchor_num * num_pred);
+    for (int k = 0; k < anchor_num; k++) {
+      QuantiSigmoidThreshold(dequantize_scale_ptr + k * num_pred + 4,
+                             num_classes + 1, post_info->score_threshold,
+                             thresholds.data() + k * num_pred + 4);
+    }
+
+    // SCALE 输出每个位置之后多一个对齐的元素
+    data += row_begin * width * (num_pred * anchor_num + 1);
+    for (int32_t h = row_begin; h < row_end; h++) {
       for (int32_t w = 0; w < width; w++) {
         for (int k = 0; k < anchor_num; k++) {
           double anchor_x = anchors[k].first;
@@ -406,6 +435,12 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
           int32_t *cur_data = data + k * num_pred;
           int offset = num_pred * k;
 
+          if (cur_data[4] < thresholds[offset + 4] ||
+              !QuantiAnyGE(cur_data + 5, thresholds.data() + offset + 5,
+                           num_classes)) {
+            continue;
+          }
+
           float objness = DequantiScale(
               cur_data[4], big_endian, *(dequantize_scale_ptr + offset + 4));
 
@@ -481,7 +516,7 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
           ymax_org = std::max(ymax_org, 0.0);
 
           Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
-          dets.emplace_back((int)id,
+          context->dets.emplace_back((int)id,
                             confidence,
                             bbox,
                             default_yolov5_config.class_names[(int)id].c_str());
@@ -509,21 +544,28 @@ void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, in
     }
   } else {
     printf("yolov5x unsupport shift dequantzie now!\n");
-    return;
+    return -1;
   }
+  return 0;
+}
+
+void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, int layer) {
+  Yolov5Decode(&default_yolov5_context, tensor, post_info, layer, 0, 1);
 }
 
 
 
 // Yolov5 输出tensor格式
 // 3次下采样得到三组缩小后的gred，然后对每个gred进行三次预测，最后输出结果
-char* Yolov5PostProcess(Yolov5PostProcessInfo_t *post_info) {
+static char *Yolov5Emit(Yolov5Context *context,
+                        Yolov5PostProcessInfo_t *post_info) {
 
   int i = 0;
   char *str_dets;
+  std::vector<Detection> &det_restuls = context->results;
 
   // 计算交并比来合并检测框，传入交并比阈值(0.65)和返回box数量(5000)
-  yolov5_nms(dets, post_info->nms_threshold, post_info->nms_top_k, det_restuls, false);
+  yolov5_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, det_restuls, false);
   std::stringstream out_string;
 
   // 算法结果转换成json格式
@@ -541,8 +583,67 @@ char* Yolov5PostProcess(Yolov5PostProcessInfo_t *post_info) {
   str_dets[out_string.str().length()] = '\0';
   snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
   // printf("str_dets: %s\n", str_dets);
-  dets.clear();
+  context->dets.clear();
   det_restuls.clear();
   return str_dets;
 }
 
+
+char* Yolov5PostProcess(Yolov5PostProcessInfo_t *post_info) {
+  return Yolov5Emit(&default_yolov5_context, post_info);
+}
+
+static void *Yolov5ContextCreate(void) {
+  return new Yolov5Context();
+}
+
+static void Yolov5ContextDestroy(void *context) {
+  delete static_cast<Yolov5Context *>(context);
+}
+
+static int Yolov5PluginDecode(void *context, hbDNNTensor *tensors,
+                              int tensor_num, PostProcessInfo_t *post_info,
+                              int layer) {
+  if (tensor_num < 1) {
+    printf("yolov5 needs 1 tensor per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return Yolov5Decode(static_cast<Yolov5Context *>(context), tensors,
+                      reinterpret_cast<Yolov5PostProcessInfo_t *>(post_info),
+                      layer, 0, 1);
+}
+
+static int Yolov5PluginDecodeSlice(void *context, hbDNNTensor *tensors,
+                                   int tensor_num,
+                                   PostProcessInfo_t *post_info, int layer,
+                                   int slice, int slice_num) {
+  if (tensor_num < 1) {
+    printf("yolov5 needs 1 tensor per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return Yolov5Decode(static_cast<Yolov5Context *>(context), tensors,
+                      reinterpret_cast<Yolov5PostProcessInfo_t *>(post_info),
+                      layer, slice, slice_num);
+}
+
+static void Yolov5PluginMerge(void *context, void *worker) {
+  auto &dets = static_cast<Yolov5Context *>(context)->dets;
+  auto &worker_dets = static_cast<Yolov5Context *>(worker)->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+}
+
+static char *Yolov5PluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return Yolov5Emit(static_cast<Yolov5Context *>(context),
+                    reinterpret_cast<Yolov5PostProcessInfo_t *>(post_info));
+}
+
+static_assert(sizeof(Yolov5PostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "Yolov5PostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *Yolov5PostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "yolov5", Yolov5ContextCreate, Yolov5ContextDestroy, Yolov5PluginDecode,
+      Yolov5PluginEmit, Yolov5PluginMerge, Yolov5PluginDecodeSlice};
+  return &plugin;
+}
@@ -10,6 +10,7 @@
 #define _POST_PROCESS_YOLOV5_POST_PROCESS_H_
 
 #include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
 
 #ifdef __cplusplus
   extern "C"{
@@ -37,6 +38,11 @@ typedef struct {
 
   void Yolov5doProcess(hbDNNTensor *tensor, Yolov5PostProcessInfo_t *post_info, int layer);
 
+  /**
+   * 注册表使用的插件，每层 1 个输出 tensor
+   */
+  const PostProcessPlugin_t *Yolov5PostProcessPlugin(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,938 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#include <arm_neon.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "activation.h"
+#include "instance_mask.h"
+#include "quanti_filter.h"
+#include "thread_pool.h"
+#include "yolov8_post_process.h"
+
+/**
+ * Config definition for Yolov8
+ */
+struct Yolov8Config {
+  std::vector<int> strides;
+  int reg_max;              // 每条边的 DFL bin 个数
+  int class_num;
+  int mask_channel;         // 分割模型每个检测的 mask 系数个数
+  float mask_threshold;     // mask sigmoid 之后的阈值
+  std::vector<std::string> class_names;
+};
+
+Yolov8Config default_yolov8_config = {
+    {8, 16, 32},
+    16,
+    80,
+    32,
+    0.5f,
+    {"person",        "bicycle",      "car",
+     "motorcycle",    "airplane",     "bus",
+     "train",         "truck",        "boat",
+     "traffic light", "fire hydrant", "stop sign",
+     "parking meter", "bench",        "bird",
+     "cat",           "dog",          "horse",
+     "sheep",         "cow",          "elephant",
+     "bear",          "zebra",        "giraffe",
+     "backpack",      "umbrella",     "handbag",
+     "tie",           "suitcase",     "frisbee",
+     "skis",          "snowboard",    "sports ball",
+     "kite",          "baseball bat", "baseball glove",
+     "skateboard",    "surfboard",    "tennis racket",
+     "bottle",        "wine glass",   "cup",
+     "fork",          "knife",        "spoon",
+     "bowl",          "banana",       "apple",
+     "sandwich",      "orange",       "broccoli",
+     "carrot",        "hot dog",      "pizza",
+     "donut",         "cake",         "chair",
+     "couch",         "potted plant", "bed",
+     "dining table",  "toilet",       "tv",
+     "laptop",        "mouse",        "remote",
+     "keyboard",      "cell phone",   "microwave",
+     "oven",          "toaster",      "sink",
+     "refrigerator",  "book",         "clock",
+     "vase",          "scissors",     "teddy bear",
+     "hair drier",    "toothbrush"}};
+
+/**
+ * Bounding box definition
+ */
+typedef struct Bbox {
+  float xmin;
+  float ymin;
+  float xmax;
+  float ymax;
+
+  Bbox() {}
+
+  Bbox(float xmin, float ymin, float xmax, float ymax)
+      : xmin(xmin), ymin(ymin), xmax(xmax), ymax(ymax) {}
+
+  friend std::ostream &operator<<(std::ostream &os, const Bbox &bbox) {
+    os << "[" << std::fixed << std::setprecision(6) << bbox.xmin << ","
+       << bbox.ymin << "," << bbox.xmax << "," << bbox.ymax << "]";
+    return os;
+  }
+} Bbox;
+
+typedef struct Yolov8Detection {
+  int id;
+  float score;
+  Bbox bbox;
+  const char *class_name;
+  int mask_index = -1;                  // 分割模型中系数和输入坐标框的序号
+  const std::string *mask = nullptr;    // 分割模型 NMS 之后生成的 mask
+  Yolov8Detection() {}
+
+  Yolov8Detection(int id, float score, Bbox bbox, const char *class_name)
+      : id(id), score(score), bbox(bbox), class_name(class_name) {}
+
+  friend bool operator>(const Yolov8Detection &lhs,
+                        const Yolov8Detection &rhs) {
+    return (lhs.score > rhs.score);
+  }
+
+  friend std::ostream &operator<<(std::ostream &os,
+                                  const Yolov8Detection &det) {
+    os << "{"
+       << R"("bbox")"
+       << ":" << det.bbox << ","
+       << R"("score")"
+       << ":" << det.score << ","
+       << R"("id")"
+       << ":" << det.id << ","
+       << R"("name")"
+       << ":\"" << default_yolov8_config.class_names[det.id] << "\"";
+    if (det.mask != nullptr) {
+      os << ","
+         << R"("mask")"
+         << ":" << *det.mask;
+    }
+    os << "}";
+    return os;
+  }
+} Yolov8Detection;
+
+/**
+ * 一个模型实例的后处理状态，各层的检测结果在 Yolov8PostProcess 时合并输出，
+ * 中间内存多帧之间复用
+ */
+struct Yolov8Context {
+  explicit Yolov8Context(bool segmentation = false)
+      : segmentation(segmentation) {}
+
+  bool segmentation;
+  std::vector<Yolov8Detection> dets;
+  std::vector<Yolov8Detection> results;
+  std::vector<int32_t> thresholds;    // SCALE 输出每个类别的整数阈值
+  std::vector<uint32_t> pass;         // [1, C, N] 排列时每个位置是否通过阈值
+  std::vector<float> bins;            // 一个位置反量化后的 DFL bin
+  std::vector<float> dfl;             // DFL softmax 的中间结果
+
+  // 分割模型：每个检测在模型输入上的坐标框和 mask 系数，mask_index 为序号
+  std::vector<Bbox> input_boxes;
+  std::vector<float> coefficients;
+  InstancePrototype_t prototype = {};
+  const float *prototype_scale = nullptr;   // int32 原型每个通道的反量化系数
+  std::vector<std::string> masks;
+};
+
+// 原有接口使用的默认上下文
+static Yolov8Context default_yolov8_context;
+static Yolov8Context default_yolov8_seg_context(true);
+
+/**
+ * 模型输入坐标和原图坐标的换算，is_pad_resize 时宽高使用相同的缩放比例，
+ * 两边填充相同的宽度
+ */
+struct Yolov8Letterbox {
+  double w_ratio;
+  double h_ratio;
+  double w_padding;
+  double h_padding;
+
+  explicit Yolov8Letterbox(const Yolov8PostProcessInfo_t *post_info) {
+    h_ratio = post_info->height * 1.0 / post_info->ori_height;
+    w_ratio = post_info->width * 1.0 / post_info->ori_width;
+    double resize_ratio = std::min(w_ratio, h_ratio);
+    if (post_info->is_pad_resize) {
+      w_ratio = resize_ratio;
+      h_ratio = resize_ratio;
+    }
+    w_padding = (post_info->width - w_ratio * post_info->ori_width) / 2.0;
+    h_padding = (post_info->height - h_ratio * post_info->ori_height) / 2.0;
+  }
+
+  double OriginX(double x) const { return (x - w_padding) / w_ratio; }
+  double OriginY(double y) const { return (y - h_padding) / h_ratio; }
+};
+
+/**
+ * 输出中一组通道（类别或者 DFL bin）的排列
+ * 第 a 个位置的第 c 个通道在 data[a * anchor_step + c * channel_step]
+ */
+struct Yolov8Head {
+  const float *data_f32;
+  const int32_t *data_s32;
+  const float *scale;       // SCALE 量化时每个通道的系数
+  int anchor_step;
+  int channel_step;
+
+  float Value(int anchor, int channel) const {
+    int64_t offset =
+        static_cast<int64_t>(anchor) * anchor_step + channel * channel_step;
+    if (data_f32 != nullptr) {
+      return data_f32[offset];
+    }
+    return static_cast<float>(data_s32[offset]) * scale[channel];
+  }
+};
+
+/**
+ * 网格上连续的一段位置：第 a 个位置在输出中的下标为 first + a，
+ * 网格坐标为 (a % grid_width, a / grid_width)
+ */
+struct Yolov8Grid {
+  int first;
+  int grid_width;
+  int stride;
+};
+
+static void yolov8_nms(std::vector<Yolov8Detection> &input,
+               float iou_threshold,
+               int top_k,
+               std::vector<Yolov8Detection> &result,
+               bool suppress) {
+  // sort order by score desc
+  std::stable_sort(input.begin(), input.end(),
+                   std::greater<Yolov8Detection>());
+
+  std::vector<bool> skip(input.size(), false);
+
+  // pre-calculate boxes area
+  std::vector<float> areas;
+  areas.reserve(input.size());
+  for (size_t i = 0; i < input.size(); i++) {
+    float width = input[i].bbox.xmax - input[i].bbox.xmin;
+    float height = input[i].bbox.ymax - input[i].bbox.ymin;
+    areas.push_back(width * height);
+  }
+
+  int count = 0;
+  for (size_t i = 0; count < top_k && i < skip.size(); i++) {
+    if (skip[i]) {
+      continue;
+    }
+    skip[i] = true;
+    ++count;
+
+    for (size_t j = i + 1; j < skip.size(); ++j) {
+      if (skip[j]) {
+        continue;
+      }
+      if (suppress == false) {
+        if (input[i].id != input[j].id) {
+          continue;
+        }
+      }
+
+      // intersection area
+      float xx1 = std::max(input[i].bbox.xmin, input[j].bbox.xmin);
+      float yy1 = std::max(input[i].bbox.ymin, input[j].bbox.ymin);
+      float xx2 = std::min(input[i].bbox.xmax, input[j].bbox.xmax);
+      float yy2 = std::min(input[i].bbox.ymax, input[j].bbox.ymax);
+
+      if (xx2 > xx1 && yy2 > yy1) {
+        float area_intersection = (xx2 - xx1) * (yy2 - yy1);
+        float iou_ratio =
+            area_intersection / (areas[j] + areas[i] - area_intersection);
+        if (iou_ratio > iou_threshold) {
+          skip[j] = true;
+        }
+      }
+    }
+    result.push_back(input[i]);
+  }
+}
+
+/**
+ * 4 条边各 reg_max 个 bin 的 softmax 期望 sum(i * softmax(x)_i)
+ * 每条边先减去最大值，4 条边的 exp 一次用 NEON 计算
+ */
+static void DflDecode(const float *bins, int reg_max, float *dfl,
+                      float *distance) {
+  for (int side = 0; side < 4; side++) {
+    const float *x = bins + side * reg_max;
+    float max_value = x[0];
+    int i = 0;
+    if (reg_max >= 4) {
+      float32x4_t max = vld1q_f32(x);
+      for (i = 4; i <= reg_max - 4; i += 4) {
+        max = vmaxq_f32(max, vld1q_f32(x + i));
+      }
+      max_value = vmaxvq_f32(max);
+    }
+    for (; i < reg_max; i++) {
+      max_value = std::max(max_value, x[i]);
+    }
+    float32x4_t max = vdupq_n_f32(max_value);
+    float *y = dfl + side * reg_max;
+    for (i = 0; i <= reg_max - 4; i += 4) {
+      vst1q_f32(y + i, vsubq_f32(vld1q_f32(x + i), max));
+    }
+    for (; i < reg_max; i++) {
+      y[i] = x[i] - max_value;
+    }
+  }
+  ActivationExpF32(dfl, 4 * reg_max, dfl);
+
+  static const float kIndex[4] = {0.f, 1.f, 2.f, 3.f};
+  for (int side = 0; side < 4; side++) {
+    const float *y = dfl + side * reg_max;
+    float32x4_t sum = vdupq_n_f32(0.f);
+    float32x4_t weighted = vdupq_n_f32(0.f);
+    float32x4_t index = vld1q_f32(kIndex);
+    float32x4_t four = vdupq_n_f32(4.f);
+    int i = 0;
+    for (; i <= reg_max - 4; i += 4) {
+      float32x4_t value = vld1q_f32(y + i);
+      sum = vaddq_f32(sum, value);
+      weighted = vfmaq_f32(weighted, value, index);
+      index = vaddq_f32(index, four);
+    }
+    float total = vaddvq_f32(sum);
+    float expectation = vaddvq_f32(weighted);
+    for (; i < reg_max; i++) {
+      total += y[i];
+      expectation += y[i] * i;
+    }
+    distance[side] = expectation / total;
+  }
+}
+
+// 连续 count 个 float 的最大值
+static float MaxF32(const float *data, int count) {
+  float max_value = std::numeric_limits<float>::lowest();
+  int i = 0;
+  if (count >= 4) {
+    float32x4_t max = vld1q_f32(data);
+    for (i = 4; i <= count - 4; i += 4) {
+      max = vmaxq_f32(max, vld1q_f32(data + i));
+    }
+    max_value = vmaxvq_f32(max);
+  }
+  for (; i < count; i++) {
+    max_value = std::max(max_value, data[i]);
+  }
+  return max_value;
+}
+
+/**
+ * [1, C, N] 排列时逐个类别平面比较，记录 [begin, end) 中哪些位置有类别通过
+ * 阈值；float 输出比较 logit，int32 输出比较每个类别的整数阈值
+ */
+static void ScanClassPlanes(Yolov8Context *context, const Yolov8Head &cls,
+                            int class_num, float logit_threshold, int begin,
+                            int end) {
+  int count = end - begin;
+  std::vector<uint32_t> &pass = context->pass;
+  pass.assign(count, 0);
+  for (int c = 0; c < class_num; c++) {
+    int64_t plane = static_cast<int64_t>(c) * cls.channel_step + begin;
+    int i = 0;
+    if (cls.data_f32 != nullptr) {
+      const float *data = cls.data_f32 + plane;
+      float32x4_t threshold = vdupq_n_f32(logit_threshold);
+      for (; i <= count - 4; i += 4) {
+        uint32x4_t hit = vcgeq_f32(vld1q_f32(data + i), threshold);
+        vst1q_u32(pass.data() + i, vorrq_u32(vld1q_u32(pass.data() + i), hit));
+      }
+      for (; i < count; i++) {
+        pass[i] |= data[i] >= logit_threshold;
+      }
+    } else {
+      const int32_t *data = cls.data_s32 + plane;
+      int32_t raw_threshold = context->thresholds[c];
+      int32x4_t threshold = vdupq_n_s32(raw_threshold);
+      for (; i <= count - 4; i += 4) {
+        uint32x4_t hit = vcgeq_s32(vld1q_s32(data + i), threshold);
+        vst1q_u32(pass.data() + i, vorrq_u32(vld1q_u32(pass.data() + i), hit));
+      }
+      for (; i < count; i++) {
+        pass[i] |= data[i] >= raw_threshold;
+      }
+    }
+  }
+}
+
+/**
+ * 解码网格上 [begin, end) 的位置，先按类别得分过滤，
+ * 只有通过阈值的位置才计算 DFL 和检测框；mask 不为空时同时保存 mask 系数
+ */
+static void DecodeAnchors(Yolov8Context *context, const Yolov8Head &cls,
+                          const Yolov8Head &box, const Yolov8Head *mask,
+                          const Yolov8Grid &grid, int begin, int end,
+                          Yolov8PostProcessInfo_t *post_info) {
+  int class_num = default_yolov8_config.class_num;
+  int reg_max = default_yolov8_config.reg_max;
+  float score_threshold = post_info->score_threshold;
+  // sigmoid(x) >= score_threshold 等价于 x >= logit(score_threshold)，
+  // 预过滤留一点余量，通过后再用 sigmoid 精确比较
+  float logit_threshold = std::numeric_limits<float>::lowest();
+  if (score_threshold > 0 && score_threshold < 1) {
+    logit_threshold =
+        std::log(score_threshold / (1 - score_threshold)) - 1e-4f;
+  } else if (score_threshold >= 1) {
+    return;
+  }
+  if (cls.data_s32 != nullptr) {
+    context->thresholds.resize(class_num);
+    QuantiSigmoidThreshold(cls.scale, class_num, score_threshold,
+                           context->thresholds.data());
+  }
+  bool planar = cls.channel_step != 1;
+  if (planar) {
+    ScanClassPlanes(context, cls, class_num, logit_threshold,
+                    grid.first + begin, grid.first + end);
+  }
+
+  Yolov8Letterbox letterbox(post_info);
+  context->bins.resize(4 * reg_max);
+  context->dfl.resize(4 * reg_max);
+  for (int a = begin; a < end; a++) {
+    int anchor = grid.first + a;
+    if (planar) {
+      if (context->pass[a - begin] == 0) {
+        continue;
+      }
+    } else if (cls.data_f32 != nullptr) {
+      const float *row = cls.data_f32 + anchor * cls.anchor_step;
+      if (MaxF32(row, class_num) < logit_threshold) {
+        continue;
+      }
+    } else {
+      const int32_t *row = cls.data_s32 + anchor * cls.anchor_step;
+      if (!QuantiAnyGE(row, context->thresholds.data(), class_num)) {
+        continue;
+      }
+    }
+
+    int id = 0;
+    float max_logit = cls.Value(anchor, 0);
+    for (int c = 1; c < class_num; c++) {
+      float logit = cls.Value(anchor, c);
+      if (logit > max_logit) {
+        max_logit = logit;
+        id = c;
+      }
+    }
+    float confidence = 1.f / (1.f + std::exp(-max_logit));
+    if (confidence < score_threshold) {
+      continue;
+    }
+
+    const float *bins;
+    if (box.data_f32 != nullptr && box.channel_step == 1) {
+      bins = box.data_f32 + anchor * box.anchor_step;
+    } else {
+      for (int c = 0; c < 4 * reg_max; c++) {
+        context->bins[c] = box.Value(anchor, c);
+      }
+      bins = context->bins.data();
+    }
+    float distance[4];
+    DflDecode(bins, reg_max, context->dfl.data(), distance);
+
+    float center_x = a % grid.grid_width + 0.5f;
+    float center_y = a / grid.grid_width + 0.5f;
+    double xmin = (center_x - distance[0]) * grid.stride;
+    double ymin = (center_y - distance[1]) * grid.stride;
+    double xmax = (center_x + distance[2]) * grid.stride;
+    double ymax = (center_y + distance[3]) * grid.stride;
+
+    double xmin_org = letterbox.OriginX(xmin);
+    double xmax_org = letterbox.OriginX(xmax);
+    double ymin_org = letterbox.OriginY(ymin);
+    double ymax_org = letterbox.OriginY(ymax);
+    if (xmax_org <= 0 || ymax_org <= 0) {
+      continue;
+    }
+
+    xmin_org = std::max(xmin_org, 0.0);
+    xmax_org = std::min(xmax_org, post_info->ori_width - 1.0);
+    ymin_org = std::max(ymin_org, 0.0);
+    ymax_org = std::min(ymax_org, post_info->ori_height - 1.0);
+    if (xmin_org > xmax_org || ymin_org > ymax_org) {
+      continue;
+    }
+
+    Bbox bbox(xmin_org, ymin_org, xmax_org, ymax_org);
+    context->dets.emplace_back(id, confidence, bbox,
+                               default_yolov8_config.class_names[id].c_str());
+    if (mask != nullptr) {
+      context->dets.back().mask_index = context->input_boxes.size();
+      context->input_boxes.emplace_back(xmin, ymin, xmax, ymax);
+      for (int c = 0; c < default_yolov8_config.mask_channel; c++) {
+        context->coefficients.push_back(mask->Value(anchor, c));
+      }
+    }
+  }
+}
+
+// float 或者 SCALE 量化的 int32 输出，first_channel 为这组通道在输出中的起始通道
+static int InitHead(hbDNNTensor *tensor, int first_channel, int anchor_step,
+                    int channel_step, Yolov8Head *head) {
+  auto quanti_type = tensor->properties.quantiType;
+  const char *data = reinterpret_cast<const char *>(tensor->sysMem[0].virAddr);
+  head->anchor_step = anchor_step;
+  head->channel_step = channel_step;
+  head->data_f32 = nullptr;
+  head->data_s32 = nullptr;
+  head->scale = nullptr;
+  if (quanti_type == hbDNNQuantiType::NONE) {
+    head->data_f32 = reinterpret_cast<const float *>(data) +
+                     first_channel * channel_step;
+  } else if (quanti_type == hbDNNQuantiType::SCALE &&
+             tensor->properties.tensorType == HB_DNN_TENSOR_TYPE_S32) {
+    head->data_s32 = reinterpret_cast<const int32_t *>(data) +
+                     first_channel * channel_step;
+    head->scale = tensor->properties.scale.scaleData + first_channel;
+  } else {
+    printf("yolov8 unsupported output, quanti_type: %d, tensor_type: %d\n",
+           quanti_type, tensor->properties.tensorType);
+    return -1;
+  }
+  return 0;
+}
+
+/**
+ * 分开输出的一层，按行把一层均分成 slice_num 份，只解码第 slice 份的行
+ * mask_tensor 为分割模型的 mask 系数输出，检测模型为 NULL
+ */
+static int Yolov8Decode(Yolov8Context *context, hbDNNTensor *cls_tensor,
+                        hbDNNTensor *bbox_tensor, hbDNNTensor *mask_tensor,
+                        Yolov8PostProcessInfo_t *post_info, int layer,
+                        int slice, int slice_num) {
+  if (layer < 0 || layer >= static_cast<int>(default_yolov8_config.strides.size())) {
+    printf("yolov8 layer error: %d\n", layer);
+    return -1;
+  }
+  int class_num = default_yolov8_config.class_num;
+  int reg_max = default_yolov8_config.reg_max;
+  auto &cls_shape = cls_tensor->properties.validShape.dimensionSize;
+  auto &box_shape = bbox_tensor->properties.validShape.dimensionSize;
+  int height = cls_shape[1];
+  int width = cls_shape[2];
+  if (cls_shape[3] != class_num || box_shape[3] != 4 * reg_max ||
+      box_shape[1] != height || box_shape[2] != width) {
+    printf("yolov8 output shape error, cls: [%d, %d, %d], bbox: [%d, %d, %d]\n",
+           cls_shape[1], cls_shape[2], cls_shape[3], box_shape[1],
+           box_shape[2], box_shape[3]);
+    return -1;
+  }
+
+  Yolov8Head cls, box;
+  if (InitHead(cls_tensor, 0,
+               cls_tensor->properties.alignedShape.dimensionSize[3], 1,
+               &cls) != 0 ||
+      InitHead(bbox_tensor, 0,
+               bbox_tensor->properties.alignedShape.dimensionSize[3], 1,
+               &box) != 0) {
+    return -1;
+  }
+  Yolov8Head mask;
+  if (mask_tensor != nullptr) {
+    auto &mask_shape = mask_tensor->properties.validShape.dimensionSize;
+    if (mask_shape[1] != height || mask_shape[2] != width ||
+        mask_shape[3] != default_yolov8_config.mask_channel) {
+      printf("yolov8 mask coefficient shape error: [%d, %d, %d]\n",
+             mask_shape[1], mask_shape[2], mask_shape[3]);
+      return -1;
+    }
+    if (InitHead(mask_tensor, 0,
+                 mask_tensor->properties.alignedShape.dimensionSize[3], 1,
+                 &mask) != 0) {
+      return -1;
+    }
+  }
+  Yolov8Grid grid = {0, width, default_yolov8_config.strides[layer]};
+  int row_begin = height * slice / slice_num;
+  int row_end = height * (slice + 1) / slice_num;
+  DecodeAnchors(context, cls, box, mask_tensor ? &mask : nullptr, grid,
+                row_begin * width, row_end * width, post_info);
+  return 0;
+}
+
+/**
+ * 记录分割模型的原型输出 [1, Hp, Wp, 32] 或 [1, 32, Hp, Wp]，
+ * Emit 时才读取原型数据
+ */
+static int Yolov8SetPrototype(Yolov8Context *context, hbDNNTensor *tensor) {
+  auto &shape = tensor->properties.validShape.dimensionSize;
+  auto &aligned = tensor->properties.alignedShape.dimensionSize;
+  InstancePrototype_t &proto = context->prototype;
+  if (tensor->properties.tensorLayout == HB_DNN_LAYOUT_NCHW) {
+    proto.channel = shape[1];
+    proto.height = shape[2];
+    proto.width = shape[3];
+    proto.pixel_step = 1;
+    proto.row_step = aligned[3];
+    proto.channel_step = aligned[2] * aligned[3];
+  } else {
+    proto.height = shape[1];
+    proto.width = shape[2];
+    proto.channel = shape[3];
+    proto.pixel_step = aligned[3];
+    proto.row_step = aligned[2] * aligned[3];
+    proto.channel_step = 1;
+  }
+  if (proto.channel != default_yolov8_config.mask_channel) {
+    printf("yolov8 prototype channel error: %d\n", proto.channel);
+    proto.data_f32 = nullptr;
+    proto.data_s32 = nullptr;
+    return -1;
+  }
+
+  Yolov8Head head;
+  if (InitHead(tensor, 0, 0, 0, &head) != 0) {
+    proto.data_f32 = nullptr;
+    proto.data_s32 = nullptr;
+    return -1;
+  }
+  proto.data_f32 = head.data_f32;
+  proto.data_s32 = head.data_s32;
+  context->prototype_scale = head.scale;
+  return 0;
+}
+
+static int Yolov8SegDecode(Yolov8Context *context, hbDNNTensor *cls_tensor,
+                           hbDNNTensor *bbox_tensor, hbDNNTensor *mask_tensor,
+                           hbDNNTensor *proto_tensor,
+                           Yolov8PostProcessInfo_t *post_info, int layer,
+                           int slice, int slice_num) {
+  if (Yolov8SetPrototype(context, proto_tensor) != 0) {
+    return -1;
+  }
+  return Yolov8Decode(context, cls_tensor, bbox_tensor, mask_tensor, post_info,
+                      layer, slice, slice_num);
+}
+
+// 合并输出，所有位置均分成 slice_num 份，只解码第 slice 份
+static int Yolov8DecodeConcat(Yolov8Context *context, hbDNNTensor *tensor,
+                              Yolov8PostProcessInfo_t *post_info, int slice,
+                              int slice_num) {
+  int class_num = default_yolov8_config.class_num;
+  int reg_max = default_yolov8_config.reg_max;
+  int channels = 4 * reg_max + class_num;
+  auto &shape = tensor->properties.validShape.dimensionSize;
+  auto &aligned = tensor->properties.alignedShape.dimensionSize;
+  int anchor_num, anchor_step, channel_step;
+  if (shape[2] == channels) {
+    // [1, N, C]
+    anchor_num = shape[1];
+    anchor_step = aligned[2];
+    channel_step = 1;
+  } else if (shape[1] == channels) {
+    // [1, C, N]
+    anchor_num = shape[2];
+    anchor_step = 1;
+    channel_step = aligned[2];
+  } else {
+    printf("yolov8 concat output shape error: [%d, %d, %d]\n", shape[0],
+           shape[1], shape[2]);
+    return -1;
+  }
+
+  Yolov8Head cls, box;
+  if (InitHead(tensor, 0, anchor_step, channel_step, &box) != 0 ||
+      InitHead(tensor, 4 * reg_max, anchor_step, channel_step, &cls) != 0) {
+    return -1;
+  }
+
+  int begin = static_cast<int64_t>(anchor_num) * slice / slice_num;
+  int end = static_cast<int64_t>(anchor_num) * (slice + 1) / slice_num;
+  int first = 0;
+  for (int stride : default_yolov8_config.strides) {
+    int grid_h = post_info->height / stride;
+    int grid_w = post_info->width / stride;
+    Yolov8Grid grid = {first, grid_w, stride};
+    int level_begin = std::max(begin - first, 0);
+    int level_end = std::min(end - first, grid_h * grid_w);
+    if (level_begin < level_end) {
+      DecodeAnchors(context, cls, box, nullptr, grid, level_begin, level_end,
+                    post_info);
+    }
+    first += grid_h * grid_w;
+  }
+  if (first != anchor_num) {
+    printf("yolov8 anchor num mismatch, output: %d, input size: %d\n",
+           anchor_num, first);
+    return -1;
+  }
+  return 0;
+}
+
+void Yolov8doProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, Yolov8PostProcessInfo_t *post_info, int layer) {
+  Yolov8Decode(&default_yolov8_context, cls_tensor, bbox_tensor, nullptr,
+               post_info, layer, 0, 1);
+}
+
+void Yolov8SegdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, hbDNNTensor *mask_tensor, hbDNNTensor *proto_tensor, Yolov8PostProcessInfo_t *post_info, int layer) {
+  Yolov8SegDecode(&default_yolov8_seg_context, cls_tensor, bbox_tensor,
+                  mask_tensor, proto_tensor, post_info, layer, 0, 1);
+}
+
+struct Yolov8MaskJob {
+  Yolov8Context *context;
+  Yolov8PostProcessInfo_t *post_info;
+};
+
+/**
+ * NMS 之后一个检测的 mask：检测框换算到原型分辨率后向外取整作为裁剪区域，
+ * 输出区域在原图上的坐标、大小和行优先的游程编码
+ */
+static void Yolov8MaskTask(void *arg, int index) {
+  auto *job = static_cast<Yolov8MaskJob *>(arg);
+  Yolov8Context *context = job->context;
+  const InstancePrototype_t &proto = context->prototype;
+  int mask_channel = default_yolov8_config.mask_channel;
+  const Yolov8Detection &det = context->results[index];
+  const Bbox &box = context->input_boxes[det.mask_index];
+
+  std::vector<float> coefficients(
+      context->coefficients.begin() + det.mask_index * mask_channel,
+      context->coefficients.begin() + (det.mask_index + 1) * mask_channel);
+  if (context->prototype_scale != nullptr) {
+    for (int c = 0; c < mask_channel; c++) {
+      coefficients[c] *= context->prototype_scale[c];
+    }
+  }
+
+  double x_scale = proto.width * 1.0 / job->post_info->width;
+  double y_scale = proto.height * 1.0 / job->post_info->height;
+  int x0 = std::max(static_cast<int>(std::floor(box.xmin * x_scale)), 0);
+  int y0 = std::max(static_cast<int>(std::floor(box.ymin * y_scale)), 0);
+  int x1 = std::min(static_cast<int>(std::ceil(box.xmax * x_scale)),
+                    proto.width);
+  int y1 = std::min(static_cast<int>(std::ceil(box.ymax * y_scale)),
+                    proto.height);
+  x1 = std::max(x1, x0);
+  y1 = std::max(y1, y0);
+  int width = x1 - x0;
+  int height = y1 - y0;
+
+  std::vector<uint8_t> bitmap(width * height);
+  std::vector<int> counts(width * height + 1);
+  // 计算失败时输出全为背景的 mask，保证游程之和等于 width * height
+  int count_num = 1;
+  counts[0] = width * height;
+  if (InstanceMaskCrop(&proto, coefficients.data(), x0, y0, x1, y1,
+                       default_yolov8_config.mask_threshold,
+                       bitmap.data()) == 0) {
+    count_num = InstanceMaskEncodeRle(bitmap.data(), bitmap.size(),
+                                      counts.data());
+  }
+
+  Yolov8Letterbox letterbox(job->post_info);
+  Bbox rect(letterbox.OriginX(x0 / x_scale), letterbox.OriginY(y0 / y_scale),
+            letterbox.OriginX(x1 / x_scale), letterbox.OriginY(y1 / y_scale));
+  std::stringstream out_string;
+  out_string << "{"
+             << R"("rect")"
+             << ":" << rect << ","
+             << R"("size")"
+             << ":[" << width << "," << height << "],"
+             << R"("rle")"
+             << ":[";
+  for (int i = 0; i < count_num; i++) {
+    out_string << counts[i];
+    if (i < count_num - 1)
+      out_string << ",";
+  }
+  out_string << "]}";
+  context->masks[index] = out_string.str();
+}
+
+void Yolov8doProcessConcat(hbDNNTensor *tensor, Yolov8PostProcessInfo_t *post_info) {
+  Yolov8DecodeConcat(&default_yolov8_context, tensor, post_info, 0, 1);
+}
+
+static char *Yolov8Emit(Yolov8Context *context,
+                        Yolov8PostProcessInfo_t *post_info) {
+
+  int i = 0;
+  char *str_dets;
+  std::vector<Yolov8Detection> &det_restuls = context->results;
+
+  yolov8_nms(context->dets, post_info->nms_threshold, post_info->nms_top_k, det_restuls, false);
+  int det_restuls_size = det_restuls.size();
+  if (context->segmentation) {
+    // 只对 NMS 之后的检测生成 mask，每个检测一个线程池任务
+    context->masks.assign(det_restuls_size, std::string());
+    Yolov8MaskJob job = {context, post_info};
+    ThreadPoolRun(Yolov8MaskTask, &job, det_restuls_size);
+    for (i = 0; i < det_restuls_size; i++) {
+      det_restuls[i].mask = &context->masks[i];
+    }
+  }
+  std::stringstream out_string;
+
+  // 算法结果转换成json格式
+  if (context->segmentation) {
+    out_string << "\"yolov8_seg_result\": [";
+  } else {
+    out_string << "\"yolov8_result\": [";
+  }
+  for (i = 0; i < det_restuls_size; i++) {
+    out_string << det_restuls[i];
+    if (i < det_restuls_size - 1)
+      out_string << ",";
+  }
+  out_string << "]" << std::endl;
+
+  str_dets = (char *)malloc(out_string.str().length() + 1);
+  str_dets[out_string.str().length()] = '\0';
+  snprintf(str_dets, out_string.str().length(), "%s", out_string.str().c_str());
+  context->dets.clear();
+  det_restuls.clear();
+  context->input_boxes.clear();
+  context->coefficients.clear();
+  context->masks.clear();
+  return str_dets;
+}
+
+char* Yolov8PostProcess(Yolov8PostProcessInfo_t *post_info) {
+  return Yolov8Emit(&default_yolov8_context, post_info);
+}
+
+char* Yolov8SegPostProcess(Yolov8PostProcessInfo_t *post_info) {
+  return Yolov8Emit(&default_yolov8_seg_context, post_info);
+}
+
+static void *Yolov8ContextCreate(void) {
+  return new Yolov8Context();
+}
+
+static void *Yolov8SegContextCreate(void) {
+  return new Yolov8Context(true);
+}
+
+static void Yolov8ContextDestroy(void *context) {
+  delete static_cast<Yolov8Context *>(context);
+}
+
+static int Yolov8PluginDecodeSlice(void *context, hbDNNTensor *tensors,
+                                   int tensor_num,
+                                   PostProcessInfo_t *post_info, int layer,
+                                   int slice, int slice_num) {
+  auto *yolov8_context = static_cast<Yolov8Context *>(context);
+  auto *info = reinterpret_cast<Yolov8PostProcessInfo_t *>(post_info);
+  if (tensor_num == 1) {
+    return Yolov8DecodeConcat(yolov8_context, tensors, info, slice,
+                              slice_num);
+  } else if (tensor_num == 2) {
+    return Yolov8Decode(yolov8_context, &tensors[0], &tensors[1], nullptr,
+                        info, layer, slice, slice_num);
+  }
+  printf("yolov8 needs 2 tensors per layer or 1 concat tensor, got %d\n",
+         tensor_num);
+  return -1;
+}
+
+static int Yolov8PluginDecode(void *context, hbDNNTensor *tensors,
+                              int tensor_num, PostProcessInfo_t *post_info,
+                              int layer) {
+  return Yolov8PluginDecodeSlice(context, tensors, tensor_num, post_info,
+                                 layer, 0, 1);
+}
+
+static int Yolov8SegPluginDecodeSlice(void *context, hbDNNTensor *tensors,
+                                      int tensor_num,
+                                      PostProcessInfo_t *post_info, int layer,
+                                      int slice, int slice_num) {
+  if (tensor_num != 4) {
+    printf("yolov8_seg needs 4 tensors per layer, got %d\n", tensor_num);
+    return -1;
+  }
+  return Yolov8SegDecode(static_cast<Yolov8Context *>(context), &tensors[0],
+                         &tensors[1], &tensors[2], &tensors[3],
+                         reinterpret_cast<Yolov8PostProcessInfo_t *>(post_info),
+                         layer, slice, slice_num);
+}
+
+static int Yolov8SegPluginDecode(void *context, hbDNNTensor *tensors,
+                                 int tensor_num, PostProcessInfo_t *post_info,
+                                 int layer) {
+  return Yolov8SegPluginDecodeSlice(context, tensors, tensor_num, post_info,
+                                    layer, 0, 1);
+}
+
+static char *Yolov8PluginEmit(void *context, PostProcessInfo_t *post_info) {
+  return Yolov8Emit(static_cast<Yolov8Context *>(context),
+                    reinterpret_cast<Yolov8PostProcessInfo_t *>(post_info));
+}
+
+static void Yolov8PluginMerge(void *context, void *worker) {
+  auto *yolov8_context = static_cast<Yolov8Context *>(context);
+  auto *yolov8_worker = static_cast<Yolov8Context *>(worker);
+  // mask 序号加上已经合并的检测个数
+  int offset = yolov8_context->input_boxes.size();
+  for (auto &det : yolov8_worker->dets) {
+    if (det.mask_index >= 0) {
+      det.mask_index += offset;
+    }
+  }
+  auto &dets = yolov8_context->dets;
+  auto &worker_dets = yolov8_worker->dets;
+  dets.insert(dets.end(), worker_dets.begin(), worker_dets.end());
+  worker_dets.clear();
+
+  auto &boxes = yolov8_context->input_boxes;
+  auto &worker_boxes = yolov8_worker->input_boxes;
+  boxes.insert(boxes.end(), worker_boxes.begin(), worker_boxes.end());
+  worker_boxes.clear();
+  auto &coefficients = yolov8_context->coefficients;
+  auto &worker_coefficients = yolov8_worker->coefficients;
+  coefficients.insert(coefficients.end(), worker_coefficients.begin(),
+                      worker_coefficients.end());
+  worker_coefficients.clear();
+  if (yolov8_context->segmentation) {
+    yolov8_context->prototype = yolov8_worker->prototype;
+    yolov8_context->prototype_scale = yolov8_worker->prototype_scale;
+  }
+}
+
+static_assert(sizeof(Yolov8PostProcessInfo_t) == sizeof(PostProcessInfo_t),
+              "Yolov8PostProcessInfo_t must match PostProcessInfo_t");
+
+const PostProcessPlugin_t *Yolov8PostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "yolov8", Yolov8ContextCreate, Yolov8ContextDestroy, Yolov8PluginDecode,
+      Yolov8PluginEmit, Yolov8PluginMerge, Yolov8PluginDecodeSlice};
+  return &plugin;
+}
+
+const PostProcessPlugin_t *Yolov8SegPostProcessPlugin(void) {
+  static const PostProcessPlugin_t plugin = {
+      "yolov8_seg", Yolov8SegContextCreate, Yolov8ContextDestroy,
+      Yolov8SegPluginDecode, Yolov8PluginEmit, Yolov8PluginMerge,
+      Yolov8SegPluginDecodeSlice};
+  return &plugin;
+}
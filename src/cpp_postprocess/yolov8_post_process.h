@@ -0,0 +1,89 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+#ifndef _POST_PROCESS_YOLOV8_POST_PROCESS_H_
+#define _POST_PROCESS_YOLOV8_POST_PROCESS_H_
+
+#include "dnn/hb_dnn.h"
+#include "postprocess_registry.h"
+
+#ifdef __cplusplus
+  extern "C"{
+#endif
+
+/**
+ * YOLOv8 一类 anchor-free、DFL（distribution focal loss）回归的检测头
+ *
+ * 每个位置输出 num_classes 个类别 logits 和 4 * 16 个 DFL bin，
+ * 4 条边 (l, t, r, b) 的距离为各自 16 个 bin 的 softmax 期望。
+ * 支持两种输出排列：
+ *   分开输出：每个 stride (8, 16, 32) 两个 NHWC 输出，
+ *             cls [1, H, W, 80]，bbox [1, H, W, 64]
+ *   合并输出：一个输出 [1, N, 144] 或 [1, 144, N]，每个位置先 64 个 DFL bin
+ *             再 80 个类别，N 个位置按 stride 8、16、32 依次排列
+ * 输出为 float 或者 SCALE 量化的 int32。
+ */
+
+typedef struct {
+	int height;
+	int width;
+	int ori_height;
+	int ori_width;
+	float score_threshold; // 0.25
+	float nms_threshold; // 0.7
+	int nms_top_k; // 300
+	int is_pad_resize;
+} Yolov8PostProcessInfo_t;
+
+  /**
+   * Post process
+   * @param[in] post_info: 后处理参数
+   * @return 所有层检测结果的 JSON 字符串
+   */
+  char* Yolov8PostProcess(Yolov8PostProcessInfo_t *post_info);
+
+  /**
+   * 分开输出时解码一层，layer 为 stride 的序号
+   */
+  void Yolov8doProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, Yolov8PostProcessInfo_t *post_info, int layer);
+
+  /**
+   * 合并输出时解码所有位置
+   */
+  void Yolov8doProcessConcat(hbDNNTensor *tensor, Yolov8PostProcessInfo_t *post_info);
+
+  /**
+   * 注册表使用的插件，每层 2 个输出 tensor：cls、bbox；
+   * 合并输出时只有 1 层 1 个 tensor
+   */
+  const PostProcessPlugin_t *Yolov8PostProcessPlugin(void);
+
+  /**
+   * YOLOv8-seg 实例分割，在分开输出的基础上每个 stride 多一个 mask 系数输出
+   * [1, H, W, 32]，另有一个原型输出 [1, 160, 160, 32]（NHWC）或
+   * [1, 32, 160, 160]（NCHW）。NMS 之后只对保留的检测在框内计算 mask，
+   * 每个检测增加 "mask" 字段：
+   *   "rect": 裁剪区域在原图上的坐标，"size": 裁剪区域在原型上的 [宽, 高]，
+   *   "rle": 行优先、从 0 开始交替的游程编码
+   * 原型 tensor 的数据在 Yolov8SegPostProcess 之前需要保持有效
+   */
+  char* Yolov8SegPostProcess(Yolov8PostProcessInfo_t *post_info);
+
+  void Yolov8SegdoProcess(hbDNNTensor *cls_tensor, hbDNNTensor *bbox_tensor, hbDNNTensor *mask_tensor, hbDNNTensor *proto_tensor, Yolov8PostProcessInfo_t *post_info, int layer);
+
+  /**
+   * 每层 4 个输出 tensor：cls、bbox、mask 系数、原型（各层使用同一个原型，
+   * 可以用 PostProcessDecodeLayers 的 tensor_index 指定）
+   */
+  const PostProcessPlugin_t *Yolov8SegPostProcessPlugin(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  // _POST_PROCESS_YOLOV8_POST_PROCESS_H_
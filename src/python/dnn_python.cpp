@@ -24,6 +24,11 @@
 #include <unordered_map>
 #include <vector>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
 #include "dnn_python.h"
 
 using namespace std;
@@ -54,6 +59,14 @@ std::string TensorType[] = {"Y",
 
 std::map<int, std::string> TensorLayout = {{0, "NHWC"}, {2, "NCHW"}, {255, "NONE"}};
 
+#define DNN_STATS_ALPHA 0.1f
+
+// 每个 BPU 核的利用率由所有模型共享，模型和核的统计数据都由 g_stats_mutex 保护。
+// 只统计指定了核（bpuCoreId 1、2）的任务；bpuCoreId 0 由运行时选核，不知道实际在哪个核上执行，
+// g_core_load[0] 不使用
+static load_stats_t g_core_load[DNN_CORE_NUM];
+static std::mutex g_stats_mutex;
+
 /**
  * C++ => Python
  * Convert buffer to numpy array
@@ -548,9 +561,8 @@ static void release_model_tensor(Model_Object *model_obj)
     if (model_obj->m_inputs != nullptr) {
         // 释放输入张量数组的内存
         for (int i = 0; i < model_obj->m_input_count; ++i) {
-            if (model_obj->m_inputs[i].sysMem != nullptr) {
-                hbSysFreeMem(model_obj->m_inputs[i].sysMem);
-            }
+            tensor_pool_free(&model_obj->m_inputs[i].sysMem[0]);
+            tensor_pool_free(&model_obj->m_inputs[i].sysMem[1]);
         }
         free(model_obj->m_inputs);
         model_obj->m_inputs = nullptr;
@@ -559,9 +571,7 @@ static void release_model_tensor(Model_Object *model_obj)
     if (model_obj->m_outputs != nullptr) {
         // 释放输出张量数组的内存
         for (int i = 0; i < model_obj->m_output_count; ++i) {
-            if (model_obj->m_outputs[i].sysMem != nullptr) {
-                hbSysFreeMem(model_obj->m_outputs[i].sysMem);
-            }
+            tensor_pool_free(&model_obj->m_outputs[i].sysMem[0]);
         }
         free(model_obj->m_outputs);
         model_obj->m_outputs = nullptr;
@@ -583,14 +593,53 @@ static PyObject *Model_new(PyTypeObject *type, PyObject *args, PyObject *kwargs)
         self->m_outputs = nullptr;
 
         self->m_estimate_latency = 0;
+        for (int32_t i = 0; i < DNN_CORE_NUM; i++) {
+            latency_stats_init(&self->m_latency[i], DNN_STATS_ALPHA);
+            latency_stats_init(&self->m_queue_wait[i], DNN_STATS_ALPHA);
+        }
+
+        self->m_model_addr = nullptr;
+        self->m_model_size = 0;
+        self->m_inputs_obj = nullptr;
+        self->m_outputs_obj = nullptr;
+        self->m_warmup_thread = nullptr;
+
+        self->m_preproc = nullptr;
+        memset(&self->m_preproc_config, 0, sizeof(self->m_preproc_config));
+        self->m_preproc_src_w = 0;
+        self->m_preproc_src_h = 0;
     }
 
     return (PyObject *)self;
 }
 
+// 等待后台预热推理结束，之后才能改写输入输出张量
+static void wait_model_warmup(Model_Object *model_obj)
+{
+    if (model_obj->m_warmup_thread != nullptr) {
+        model_obj->m_warmup_thread->join();
+        delete model_obj->m_warmup_thread;
+        model_obj->m_warmup_thread = nullptr;
+    }
+}
+
 static void Model_dealloc(Model_Object *self)
 {
+    wait_model_warmup(self);
+    Py_XDECREF(self->m_inputs_obj);
+    Py_XDECREF(self->m_outputs_obj);
+    image_preproc_destroy(self->m_preproc);
+    self->m_preproc = nullptr;
     release_model_tensor(self);
+    if (self->m_packed_dnn_handle != nullptr) {
+        hbDNNRelease(self->m_packed_dnn_handle);
+        self->m_packed_dnn_handle = nullptr;
+    }
+    if (self->m_model_addr != nullptr) {
+        munmap(self->m_model_addr, self->m_model_size);
+        self->m_model_addr = nullptr;
+    }
+    tensor_pool_trim(TENSOR_POOL_KEEP_BYTES);
     self->ob_base.ob_type->tp_free(self);
 }
 
@@ -614,7 +663,7 @@ static PyObject *model_get_model_name(Model_Object *self, void *closure) {
 }
 
 
-static PyObject* model_get_tensor_inputs(Model_Object *self, void *closure) {
+static PyObject* build_tensor_inputs(Model_Object *self) {
     // 获取模型的输入张量列表，这里假设 inputs 是一个列表，存储了 PyDNNTensor 对象的引用
     PyObject *inputs_list = PyList_New(0);
     if (!inputs_list) {
@@ -642,7 +691,59 @@ static PyObject* model_get_tensor_inputs(Model_Object *self, void *closure) {
     return inputs_list;
 }
 
-static PyObject* model_get_tensor_outputs(Model_Object *self, void *closure) {
+static PyObject* model_get_tensor_inputs(Model_Object *self, void *closure) {
+    // 返回的张量直接引用 m_inputs，调用者可能马上写入，不能和预热推理同时进行
+    wait_model_warmup(self);
+    if (self->m_inputs_obj != nullptr) {
+        return PyList_GetSlice(self->m_inputs_obj, 0, self->m_input_count);
+    }
+    return build_tensor_inputs(self);
+}
+
+// 按照张量类型返回每个元素的字节数
+static int32_t tensor_elem_size(int32_t tensor_type) {
+    switch (tensor_type) {
+        case HB_DNN_TENSOR_TYPE_F16:
+        case HB_DNN_TENSOR_TYPE_S16:
+        case HB_DNN_TENSOR_TYPE_U16:
+            return 2;
+        case HB_DNN_TENSOR_TYPE_F32:
+        case HB_DNN_TENSOR_TYPE_S32:
+        case HB_DNN_TENSOR_TYPE_U32:
+            return 4;
+        case HB_DNN_TENSOR_TYPE_F64:
+        case HB_DNN_TENSOR_TYPE_S64:
+        case HB_DNN_TENSOR_TYPE_U64:
+            return 8;
+        default:
+            return 1;
+    }
+}
+
+// 批量张量中相邻两个样本之间的字节数，批量维度固定是第 0 维
+static int32_t tensor_sample_stride(const hbDNNTensorProperties *properties) {
+    const int32_t *dims = properties->validShape.dimensionSize;
+    int32_t batch = dims[0] > 0 ? dims[0] : 1;
+
+    if (properties->tensorType == HB_DNN_IMG_TYPE_NV12) {
+        return dims[2] * dims[3] * 3 / 2;
+    }
+    if (properties->alignedByteSize > 0) {
+        return properties->alignedByteSize / batch;
+    }
+
+    int32_t size = tensor_elem_size(properties->tensorType);
+    for (int32_t i = 1; i < properties->validShape.numDimensions; i++) {
+        size *= dims[i];
+    }
+    return size;
+}
+
+/**
+ * @brief 创建输出张量列表
+ * @param sample 小于 0 时返回整个批量的输出；否则只返回第 sample 个样本，张量第 0 维为 1
+ */
+static PyObject* get_tensor_outputs(Model_Object *self, int32_t sample) {
     // 获取模型的输出张量列表，这里假设 outputs 是一个列表，存储了 PyDNNTensor 对象的引用
     PyObject *outputs_list = PyList_New(0);
     if (!outputs_list) {
@@ -662,6 +763,14 @@ static PyObject* model_get_tensor_outputs(Model_Object *self, void *closure) {
         // 初始化 PyDNNTensor 对象的属性
         dnn_tensor->properties = self->m_outputs[i].properties;
         dnn_tensor->buffer = self->m_outputs[i].sysMem[0].virAddr;
+        if (sample >= 0) {
+            hbDNNTensorProperties &properties = dnn_tensor->properties;
+            int32_t stride = tensor_sample_stride(&properties);
+            dnn_tensor->buffer = (uint8_t *)dnn_tensor->buffer + sample * stride;
+            properties.validShape.dimensionSize[0] = 1;
+            properties.alignedShape.dimensionSize[0] = 1;
+            properties.alignedByteSize = stride;
+        }
         GetOutputName(self->m_dnn_handle, i, dnn_tensor->name);
 
         // 将张量对象添加到列表中
@@ -677,34 +786,129 @@ static PyObject* model_get_tensor_outputs(Model_Object *self, void *closure) {
     return outputs_list;
 }
 
+static PyObject* model_get_tensor_outputs(Model_Object *self, void *closure) {
+    wait_model_warmup(self);
+    if (self->m_outputs_obj != nullptr) {
+        return PyList_GetSlice(self->m_outputs_obj, 0, self->m_output_count);
+    }
+    return get_tensor_outputs(self, -1);
+}
+
 static PyObject* model_get_estimate_latency(Model_Object *self, void *closure) {
     // 将延迟时间转换为 Python 整数对象并返回
     return PyLong_FromLong(self->m_estimate_latency);
 }
 
-static int32_t forward(Model_Object *model_obj, unsigned char *data_ptr, int32_t data_size, int32_t core_id, int32_t priority) {
-    int32_t ret = 0;
-    uint32_t input_count = model_obj->m_input_count;
+static PyObject* build_latency_dict(const latency_stats_t *stats, const char *prefix, PyObject *dict) {
+    const float percents[] = {50.0f, 90.0f, 99.0f};
+    char key[64];
 
-    for (uint32_t index = 0; index < input_count; index++) {
-        hbDNNTensor *input_tensor = &model_obj->m_inputs[index];
-        auto tensor_type = static_cast<hbDNNDataType>(input_tensor->properties.tensorType);
+    snprintf(key, sizeof(key), "%s_ewma_us", prefix);
+    PyObject *value = PyFloat_FromDouble(stats->ewma);
+    if (value == NULL || PyDict_SetItemString(dict, key, value) != 0) {
+        Py_XDECREF(value);
+        return NULL;
+    }
+    Py_DECREF(value);
 
-        // 将数据拷贝到输入张量的系统内存中
-        if (tensor_type == HB_DNN_IMG_TYPE_NV12_SEPARATE) {
-            memcpy(input_tensor->sysMem[0].virAddr, data_ptr, data_size / 3 * 2);
-            memcpy(input_tensor->sysMem[1].virAddr, data_ptr + data_size / 3 * 2, data_size / 3);
-            hbSysFlushMem(&input_tensor->sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
-            hbSysFlushMem(&input_tensor->sysMem[1], HB_SYS_MEM_CACHE_CLEAN);
-        } else if (tensor_type == HB_DNN_IMG_TYPE_Y || tensor_type == HB_DNN_IMG_TYPE_NV12) {
-            memcpy(input_tensor->sysMem[0].virAddr, data_ptr, data_size);
-            hbSysFlushMem(&input_tensor->sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
-        } else {
-            NumpyCopyHelper(input_tensor, data_ptr, data_size);
-            hbSysFlushMem(&input_tensor->sysMem[0], HB_SYS_MEM_CACHE_CLEAN);
+    for (size_t i = 0; i < sizeof(percents) / sizeof(percents[0]); i++) {
+        snprintf(key, sizeof(key), "%s_p%d_us", prefix, (int)percents[i]);
+        value = PyLong_FromLong(latency_stats_percentile(stats, percents[i]));
+        if (value == NULL || PyDict_SetItemString(dict, key, value) != 0) {
+            Py_XDECREF(value);
+            return NULL;
         }
+        Py_DECREF(value);
     }
 
+    return dict;
+}
+
+// {bpuCoreId: {...}}，只包含推理过的 bpuCoreId。
+// 0 是所有不指定核的推理的汇总，可能分布在两个核上，没有 utilization
+static PyObject* model_get_latency_stats(Model_Object *self, void *closure) {
+    latency_stats_t latency[DNN_CORE_NUM];
+    latency_stats_t queue_wait[DNN_CORE_NUM];
+    float utilization[DNN_CORE_NUM];
+    int64_t now = latency_stats_now_us();
+
+    // 先在锁内拷贝一份，构建 Python 对象时不持有锁
+    {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        memcpy(latency, self->m_latency, sizeof(latency));
+        memcpy(queue_wait, self->m_queue_wait, sizeof(queue_wait));
+        for (int32_t i = 0; i < DNN_CORE_NUM; i++) {
+            utilization[i] = load_stats_utilization(&g_core_load[i], now);
+        }
+    }
+
+    PyObject *result = PyDict_New();
+    if (result == NULL) {
+        return NULL;
+    }
+
+    for (int32_t i = 0; i < DNN_CORE_NUM; i++) {
+        if (latency[i].total == 0) {
+            continue;
+        }
+        PyObject *core = Py_BuildValue("{s:L,s:i}", "count", (long long)latency[i].total,
+            "latency_min_us", latency_stats_min(&latency[i]));
+        if (core != NULL && i != 0) {
+            PyObject *value = PyFloat_FromDouble(utilization[i]);
+            if (value == NULL || PyDict_SetItemString(core, "utilization", value) != 0) {
+                Py_CLEAR(core);
+            }
+            Py_XDECREF(value);
+        }
+        if (core == NULL
+                || build_latency_dict(&latency[i], "latency", core) == NULL
+                || build_latency_dict(&queue_wait[i], "queue_wait", core) == NULL) {
+            Py_XDECREF(core);
+            Py_DECREF(result);
+            return NULL;
+        }
+
+        PyObject *key = PyLong_FromLong(i);
+        int ret = key == NULL ? -1 : PyDict_SetItem(result, key, core);
+        Py_XDECREF(key);
+        Py_DECREF(core);
+        if (ret != 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+/**
+ * 记录一次推理的耗时。排队时间无法直接观测，用窗口内的最小耗时近似纯执行时间，
+ * 超出的部分算作等待（BPU 被其他任务占用或者调度延迟）。
+ * 核的忙碌区间只记录指定了核的任务，core_id 0 的任务只计入模型自己的汇总统计。
+ */
+static void record_infer_latency(Model_Object *model_obj, int32_t core_id, int64_t submit_us, int64_t done_us) {
+    if (core_id < 0 || core_id >= DNN_CORE_NUM) {
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(g_stats_mutex);
+    latency_stats_t *latency = &model_obj->m_latency[core_id];
+    int32_t elapsed = (int32_t)(done_us - submit_us);
+
+    latency_stats_add(latency, elapsed);
+    int32_t exec_us = latency_stats_min(latency);
+    latency_stats_add(&model_obj->m_queue_wait[core_id], elapsed - exec_us);
+    if (core_id != 0) {
+        load_stats_add(&g_core_load[core_id], done_us - exec_us, done_us);
+    }
+
+    model_obj->m_estimate_latency = (int32_t)((latency->ewma + 999.0f) / 1000.0f);
+}
+
+// 输入张量已经准备好，执行推理并等待结果
+static int32_t infer_model(Model_Object *model_obj, int32_t core_id, int32_t priority, bool record) {
+    int32_t ret = 0;
+    int64_t submit_us = latency_stats_now_us();
     hbDNNTaskHandle_t task_handle = NULL;
     hbDNNInferCtrlParam ctrl_param;
     HB_DNN_INITIALIZE_INFER_CTRL_PARAM(&ctrl_param);
@@ -727,9 +931,13 @@ static int32_t forward(Model_Object *model_obj, unsigned char *data_ptr, int32_t
         return -1;
     }
 
+    if (record) {
+        record_infer_latency(model_obj, core_id, submit_us, latency_stats_now_us());
+    }
+
     // 确保 CPU 从 DDR 中读取数据之后再使用输出张量数据
     for (int32_t i = 0; i < model_obj->m_output_count; i++) {
-        hbSysFlushMem(&output[i].sysMem[0], HB_SYS_MEM_CACHE_INVALIDATE);
+        tensor_pool_flush(&output[i].sysMem[0], 0, output[i].properties.alignedByteSize, HB_SYS_MEM_CACHE_INVALIDATE);
     }
 
     // 释放任务句柄
@@ -744,20 +952,219 @@ static int32_t forward(Model_Object *model_obj, unsigned char *data_ptr, int32_t
     return 0;
 }
 
+static int32_t forward(Model_Object *model_obj, unsigned char *data_ptr, int32_t data_size, int32_t core_id, int32_t priority) {
+    uint32_t input_count = model_obj->m_input_count;
+
+    for (uint32_t index = 0; index < input_count; index++) {
+        hbDNNTensor *input_tensor = &model_obj->m_inputs[index];
+        auto tensor_type = static_cast<hbDNNDataType>(input_tensor->properties.tensorType);
+
+        // 将数据拷贝到输入张量的系统内存中
+        if (tensor_type == HB_DNN_IMG_TYPE_NV12_SEPARATE) {
+            memcpy(input_tensor->sysMem[0].virAddr, data_ptr, data_size / 3 * 2);
+            memcpy(input_tensor->sysMem[1].virAddr, data_ptr + data_size / 3 * 2, data_size / 3);
+            tensor_pool_flush(&input_tensor->sysMem[0], 0, data_size / 3 * 2, HB_SYS_MEM_CACHE_CLEAN);
+            tensor_pool_flush(&input_tensor->sysMem[1], 0, data_size / 3, HB_SYS_MEM_CACHE_CLEAN);
+        } else if (tensor_type == HB_DNN_IMG_TYPE_Y || tensor_type == HB_DNN_IMG_TYPE_NV12) {
+            memcpy(input_tensor->sysMem[0].virAddr, data_ptr, data_size);
+            tensor_pool_flush(&input_tensor->sysMem[0], 0, data_size, HB_SYS_MEM_CACHE_CLEAN);
+        } else {
+            NumpyCopyHelper(input_tensor, data_ptr, data_size);
+            tensor_pool_flush(&input_tensor->sysMem[0], 0, data_size, HB_SYS_MEM_CACHE_CLEAN);
+        }
+    }
+
+    return infer_model(model_obj, core_id, priority, true);
+}
+
+// 把一个样本拷贝到批量输入张量的第 index 个位置
+static int32_t copy_sample(hbDNNTensor *input_tensor, int32_t index, const unsigned char *data, int32_t data_size) {
+    hbDNNTensorProperties *properties = &input_tensor->properties;
+    uint8_t *dst = (uint8_t *)input_tensor->sysMem[0].virAddr;
+
+    if (properties->tensorType == HB_DNN_IMG_TYPE_NV12_SEPARATE) {
+        // Y 和 UV 分别放在两块内存里，每块内存中按样本顺序排列
+        int32_t y_size = properties->validShape.dimensionSize[2] * properties->validShape.dimensionSize[3];
+        if (data_size != y_size * 3 / 2) {
+            return -1;
+        }
+        memcpy(dst + index * y_size, data, y_size);
+        memcpy((uint8_t *)input_tensor->sysMem[1].virAddr + index * (y_size / 2), data + y_size, y_size / 2);
+        return 0;
+    }
+
+    int32_t stride = tensor_sample_stride(properties);
+    if (data_size > stride) {
+        return -1;
+    }
+    memcpy(dst + index * stride, data, data_size);
+    // 样本比对齐后的大小短时补 0，不能留下上一次推理的数据
+    if (data_size < stride) {
+        memset(dst + index * stride + data_size, 0, stride - data_size);
+    }
+    return 0;
+}
+
+/**
+ * 批量推理（forward(samples, batch=True)）：samples 中每个元素是一个样本，
+ * 多输入模型时每个元素是按输入顺序排列的列表。
+ * 所有样本拷贝进同一个批量输入张量后只提交一次任务，返回按样本拆分的输出列表。
+ * 样本数少于模型的批量大小时，剩余位置保留上一次的数据，它们的输出直接丢弃。
+ */
+static PyObject *Model_forward_batch(Model_Object *self, PyObject *samples, int32_t core_id, int32_t priority)
+{
+    int32_t batch = self->m_inputs[0].properties.validShape.dimensionSize[0];
+    Py_ssize_t count = PySequence_Size(samples);
+    std::vector<PyArrayObject *> arrays;
+    int32_t ret = 0;
+
+    if (count <= 0 || count > batch) {
+        PyErr_Format(PyExc_ValueError, "Expected 1 to %d samples, got %zd", batch, count);
+        return NULL;
+    }
+
+    for (Py_ssize_t i = 0; i < count && ret == 0; i++) {
+        PyObject *sample = PySequence_GetItem(samples, i);
+        if (sample == NULL) {
+            ret = -1;
+            break;
+        }
+        if (self->m_input_count > 1 && PySequence_Size(sample) != self->m_input_count) {
+            PyErr_Format(PyExc_ValueError, "Sample %zd must be a list of %d inputs", i, self->m_input_count);
+            Py_DECREF(sample);
+            ret = -1;
+            break;
+        }
+
+        for (int32_t j = 0; j < self->m_input_count; j++) {
+            PyObject *item = sample;
+            if (self->m_input_count > 1) {
+                item = PySequence_GetItem(sample, j);
+                if (item == NULL) {
+                    ret = -1;
+                    break;
+                }
+            }
+
+            // 图像输入按 uint8 处理，其余张量按数组原始的字节拷贝
+            int32_t tensor_type = self->m_inputs[j].properties.tensorType;
+            int npy_type = tensor_type <= HB_DNN_IMG_TYPE_BGR ? NPY_UBYTE : NPY_NOTYPE;
+            PyArrayObject *array = (PyArrayObject *)PyArray_FROM_OTF(item, npy_type, NPY_ARRAY_IN_ARRAY);
+            if (self->m_input_count > 1) {
+                Py_DECREF(item);
+            }
+            if (array == NULL) {
+                ret = -1;
+                break;
+            }
+            arrays.push_back(array);
+        }
+        Py_DECREF(sample);
+    }
+
+    if (ret == 0) {
+        Py_BEGIN_ALLOW_THREADS
+        for (Py_ssize_t i = 0; i < count && ret == 0; i++) {
+            for (int32_t j = 0; j < self->m_input_count; j++) {
+                PyArrayObject *array = arrays[i * self->m_input_count + j];
+                ret = copy_sample(&self->m_inputs[j], (int32_t)i,
+                    (const unsigned char *)PyArray_DATA(array), (int32_t)PyArray_NBYTES(array));
+                if (ret != 0) {
+                    break;
+                }
+            }
+        }
+        if (ret == 0) {
+            // 只刷新写入了样本的部分
+            for (int32_t j = 0; j < self->m_input_count; j++) {
+                hbDNNTensor *input_tensor = &self->m_inputs[j];
+                if (input_tensor->properties.tensorType == HB_DNN_IMG_TYPE_NV12_SEPARATE) {
+                    int32_t y_size = input_tensor->properties.validShape.dimensionSize[2]
+                        * input_tensor->properties.validShape.dimensionSize[3];
+                    tensor_pool_flush(&input_tensor->sysMem[0], 0, count * y_size, HB_SYS_MEM_CACHE_CLEAN);
+                    tensor_pool_flush(&input_tensor->sysMem[1], 0, count * y_size / 2, HB_SYS_MEM_CACHE_CLEAN);
+                } else {
+                    tensor_pool_flush(&input_tensor->sysMem[0], 0,
+                        count * tensor_sample_stride(&input_tensor->properties), HB_SYS_MEM_CACHE_CLEAN);
+                }
+            }
+            ret = infer_model(self, core_id, priority, true) == 0 ? 0 : -2;
+        }
+        Py_END_ALLOW_THREADS
+
+        if (ret == -1) {
+            PyErr_SetString(PyExc_ValueError, "Sample size does not match the model input");
+        } else if (ret == -2) {
+            PyErr_SetString(PyExc_RuntimeError, "Model forward failed");
+        }
+    }
+
+    for (size_t i = 0; i < arrays.size(); i++) {
+        Py_DECREF(arrays[i]);
+    }
+    if (ret != 0) {
+        return NULL;
+    }
+
+    PyObject *results = PyList_New(count);
+    if (results == NULL) {
+        return NULL;
+    }
+    for (Py_ssize_t i = 0; i < count; i++) {
+        PyObject *outputs = get_tensor_outputs(self, (int32_t)i);
+        if (outputs == NULL) {
+            Py_DECREF(results);
+            return NULL;
+        }
+        PyList_SET_ITEM(results, i, outputs);
+    }
+
+    return results;
+}
+
 static PyObject *Model_forward(Model_Object *self, PyObject *args, PyObject *kwargs)
 {
     PyObject *arg_obj = NULL;
     int core_id = 0;
     int priority = 0;
+    int batch = 0;
 
     // 定义参数的关键字
-    static const char *keywords[] = {"arg", "core_id", "priority", NULL};
+    static const char *keywords[] = {"arg", "core_id", "priority", "batch", NULL};
 
     // 解析参数
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|ii", const_cast<char **>(keywords), &arg_obj, &core_id, &priority)) {
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|iip", const_cast<char **>(keywords), &arg_obj, &core_id, &priority, &batch)) {
         Py_RETURN_NONE;
     }
 
+    wait_model_warmup(self);
+
+    // batch=True 时 arg 是样本列表，按批量推理处理
+    if (batch) {
+        if (!PyList_Check(arg_obj) && !PyTuple_Check(arg_obj)) {
+            PyErr_SetString(PyExc_TypeError, "batch=True expects a list of samples");
+            return NULL;
+        }
+        return Model_forward_batch(self, arg_obj, core_id, priority);
+    }
+
+    // 多输入模型的一个样本：按输入顺序排列的列表
+    if (self->m_input_count > 1 && (PyList_Check(arg_obj) || PyTuple_Check(arg_obj))) {
+        PyObject *samples = PyTuple_Pack(1, arg_obj);
+        if (samples == NULL) {
+            return NULL;
+        }
+        PyObject *results = Model_forward_batch(self, samples, core_id, priority);
+        Py_DECREF(samples);
+        if (results == NULL) {
+            return NULL;
+        }
+        PyObject *outputs = PyList_GET_ITEM(results, 0);
+        Py_INCREF(outputs);
+        Py_DECREF(results);
+        return outputs;
+    }
+
     // 将 Python 对象转换为 NumPy 数组
     PyArrayObject* arg_array = (PyArrayObject*)PyArray_FROM_OTF(arg_obj, NPY_UBYTE, NPY_ARRAY_IN_ARRAY);
     if (arg_array == NULL) {
@@ -794,17 +1201,185 @@ static PyObject *Model_forward(Model_Object *self, PyObject *args, PyObject *kwa
     return model_get_tensor_outputs(self, NULL);
 }
 
+// 根据模型第 0 个输入的类型和排布确定预处理的输出格式和尺寸
+static int32_t get_preproc_output(Model_Object *model_obj, image_preproc_config_t *config)
+{
+    hbDNNTensorProperties *properties = &model_obj->m_inputs[0].properties;
+    int32_t *dims = properties->validShape.dimensionSize;
+    int32_t nhwc = (properties->tensorLayout == HB_DNN_LAYOUT_NHWC);
+
+    switch (properties->tensorType) {
+    case HB_DNN_IMG_TYPE_NV12:
+    case HB_DNN_IMG_TYPE_NV12_SEPARATE:
+        config->format = PREPROC_FMT_NV12;
+        break;
+    case HB_DNN_IMG_TYPE_RGB:
+        config->format = nhwc ? PREPROC_FMT_RGB : PREPROC_FMT_RGB_PLANAR;
+        break;
+    case HB_DNN_IMG_TYPE_BGR:
+        config->format = nhwc ? PREPROC_FMT_BGR : PREPROC_FMT_BGR_PLANAR;
+        break;
+    default:
+        return -1;
+    }
+
+    config->dst_height = nhwc ? dims[1] : dims[2];
+    config->dst_width = nhwc ? dims[2] : dims[3];
+    return 0;
+}
+
+// 把任意尺寸的 NV12 图像裁剪、缩放、填充后直接写入输入张量，然后执行推理
+static int32_t forward_frame(Model_Object *model_obj, const color_nv12_image_t *src,
+    int32_t core_id, int32_t priority)
+{
+    hbDNNTensor *input_tensor = &model_obj->m_inputs[0];
+    uint8_t *dst[3] = {(uint8_t *)input_tensor->sysMem[0].virAddr, NULL, NULL};
+    int32_t separate = (input_tensor->properties.tensorType == HB_DNN_IMG_TYPE_NV12_SEPARATE);
+
+    if (separate) {
+        dst[1] = (uint8_t *)input_tensor->sysMem[1].virAddr;
+    }
+
+    if (image_preproc_run(model_obj->m_preproc, src, dst) != 0) {
+        return -1;
+    }
+
+    const image_preproc_config_t *config = &model_obj->m_preproc->config;
+    if (separate) {
+        int32_t y_size = config->dst_width * config->dst_height;
+        tensor_pool_flush(&input_tensor->sysMem[0], 0, y_size, HB_SYS_MEM_CACHE_CLEAN);
+        tensor_pool_flush(&input_tensor->sysMem[1], 0, y_size / 2, HB_SYS_MEM_CACHE_CLEAN);
+    } else {
+        tensor_pool_flush(&input_tensor->sysMem[0], 0, image_preproc_output_size(config), HB_SYS_MEM_CACHE_CLEAN);
+    }
+
+    return infer_model(model_obj, core_id, priority, true);
+}
+
+static PyObject *Model_forward_frame(Model_Object *self, PyObject *args, PyObject *kwargs)
+{
+    PyObject *img_obj = NULL;
+    PyObject *crop_obj = NULL;
+    int width = 0;
+    int height = 0;
+    int keep_ratio = 1;
+    int center = 1;
+    int pad = 114;
+    int core_id = 0;
+    int priority = 0;
+    image_preproc_config_t config;
+    image_preproc_transform_t transform;
+    color_nv12_image_t src;
+    Py_buffer view;
+    int32_t ret = 0;
+
+    static const char *keywords[] = {"img", "width", "height", "keep_ratio", "center",
+        "pad", "crop", "core_id", "priority", NULL};
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "Oii|iiiOii", const_cast<char **>(keywords),
+            &img_obj, &width, &height, &keep_ratio, &center, &pad, &crop_obj, &core_id, &priority)) {
+        return NULL;
+    }
+
+    if (self->m_input_count != 1) {
+        PyErr_SetString(PyExc_ValueError, "forward_frame only supports models with one input");
+        return NULL;
+    }
+
+    wait_model_warmup(self);
+
+    memset(&config, 0, sizeof(config));
+    if (get_preproc_output(self, &config) != 0) {
+        PyErr_SetString(PyExc_ValueError, "Model input must be NV12, RGB or BGR image");
+        return NULL;
+    }
+    if (crop_obj != NULL && crop_obj != Py_None) {
+        if (!PyArg_ParseTuple(crop_obj, "iiii", &config.crop_x, &config.crop_y,
+                &config.crop_w, &config.crop_h)) {
+            return NULL;
+        }
+    }
+    config.keep_ratio = keep_ratio;
+    config.center = center;
+    config.pad_rgb[0] = config.pad_rgb[1] = config.pad_rgb[2] = (uint8_t)pad;
+    config.std = COLOR_STD_BT601;
+    config.range = COLOR_RANGE_LIMITED;
+
+    if (PyObject_GetBuffer(img_obj, &view, PyBUF_SIMPLE) != 0) {
+        return NULL;
+    }
+    if (width <= 0 || height <= 0 || view.len < (Py_ssize_t)width * height * 3 / 2) {
+        PyBuffer_Release(&view);
+        PyErr_SetString(PyExc_ValueError, "Image size does not match width and height");
+        return NULL;
+    }
+
+    // 源尺寸或者预处理参数变化时重新计算缩放表
+    if (self->m_preproc == nullptr || self->m_preproc_src_w != width || self->m_preproc_src_h != height
+            || memcmp(&self->m_preproc_config, &config, sizeof(config)) != 0) {
+        image_preproc_destroy(self->m_preproc);
+        self->m_preproc = image_preproc_create(width, height, &config);
+        if (self->m_preproc == nullptr) {
+            PyBuffer_Release(&view);
+            PyErr_SetString(PyExc_ValueError, "Invalid preprocess parameters");
+            return NULL;
+        }
+        self->m_preproc_config = config;
+        self->m_preproc_src_w = width;
+        self->m_preproc_src_h = height;
+    }
+
+    src.y = (const uint8_t *)view.buf;
+    src.uv = src.y + width * height;
+    src.width = width;
+    src.height = height;
+    src.y_stride = width;
+    src.uv_stride = width;
+
+    Py_BEGIN_ALLOW_THREADS
+    ret = forward_frame(self, &src, core_id, priority);
+    Py_END_ALLOW_THREADS
+
+    PyBuffer_Release(&view);
+
+    if (ret != 0) {
+        PyErr_SetString(PyExc_RuntimeError, "Model forward failed");
+        return NULL;
+    }
+
+    PyObject *outputs = model_get_tensor_outputs(self, NULL);
+    if (outputs == NULL) {
+        return NULL;
+    }
+
+    image_preproc_get_transform(self->m_preproc, &transform);
+    PyObject *transform_dict = Py_BuildValue("{s:f,s:f,s:i,s:i,s:i,s:i,s:i,s:i}",
+        "scale_x", transform.scale_x, "scale_y", transform.scale_y,
+        "pad_left", transform.pad_left, "pad_top", transform.pad_top,
+        "resized_w", transform.resized_w, "resized_h", transform.resized_h,
+        "crop_x", transform.crop_x, "crop_y", transform.crop_y);
+    if (transform_dict == NULL) {
+        Py_DECREF(outputs);
+        return NULL;
+    }
+
+    return Py_BuildValue("(NN)", outputs, transform_dict);
+}
+
 // PyGetSetDef 定义成员属性，使用 getter 函数获取属性值
 static PyGetSetDef ModelGetSet[] = {
     {"name", (getter)model_get_model_name, NULL, "Model Name", NULL},
     {"inputs", (getter)model_get_tensor_inputs, NULL, "Model Inputs", NULL},
     {"outputs", (getter)model_get_tensor_outputs, NULL, "Model Outputs", NULL},
     {"estimate_latency", (getter)model_get_estimate_latency, NULL, "Estimate latency", NULL},
+    {"latency_stats", (getter)model_get_latency_stats, NULL, "Measured latency per bpuCoreId, 0 aggregates tasks not pinned to a core", NULL},
     {NULL} /* Sentinel */
 };
 
 static struct PyMethodDef Model_Methods[] = {
     {"forward", (PyCFunction)Model_forward, METH_VARARGS | METH_KEYWORDS, "Run Model"},
+    {"forward_frame", (PyCFunction)Model_forward_frame, METH_VARARGS | METH_KEYWORDS,
+        "Resize/letterbox an NV12 frame into the model input and run model"},
     {NULL, NULL, 0, NULL},
 };
 
@@ -861,7 +1436,7 @@ static int32_t prepare_model_tensor(PyObject *self , Model_Object *model_obj)
     hbDNNGetOutputCount(&model_obj->m_output_count, dnn_handle);
 
     // 为输入张量数组分配空间
-    model_obj->m_inputs = (hbDNNTensor *)malloc(sizeof(hbDNNTensor) * model_obj->m_input_count);
+    model_obj->m_inputs = (hbDNNTensor *)calloc(model_obj->m_input_count, sizeof(hbDNNTensor));
     if (model_obj->m_inputs == NULL) {
         // 内存分配失败
         return -1;
@@ -871,10 +1446,20 @@ static int32_t prepare_model_tensor(PyObject *self , Model_Object *model_obj)
         // alloc input tensor
         hbDNNGetInputTensorProperties(&properties, dnn_handle, i);
         model_obj->m_inputs[i].properties = properties;
-        hbSysAllocCachedMem(model_obj->m_inputs[i].sysMem,
-            properties.validShape.dimensionSize[0] * ALIGN_16(properties.validShape.dimensionSize[1]) *
-            properties.validShape.dimensionSize[2] * ALIGN_16(properties.validShape.dimensionSize[3]));
-        if (model_obj->m_inputs[i].sysMem == NULL) {
+        // 批量模型按 alignedByteSize 排列各个样本，分配的内存不能小于它
+        int32_t input_size = properties.validShape.dimensionSize[0] * ALIGN_16(properties.validShape.dimensionSize[1]) *
+            properties.validShape.dimensionSize[2] * ALIGN_16(properties.validShape.dimensionSize[3]);
+        if (input_size < properties.alignedByteSize) {
+            input_size = properties.alignedByteSize;
+        }
+        ret = tensor_pool_alloc(model_obj->name, TENSOR_POOL_INPUT, TENSOR_POOL_INDEX(i, 0),
+            input_size, &model_obj->m_inputs[i].sysMem[0]);
+        // NV12_SEPARATE 的 UV 放在第二块内存中
+        if (ret == 0 && properties.tensorType == HB_DNN_IMG_TYPE_NV12_SEPARATE) {
+            ret = tensor_pool_alloc(model_obj->name, TENSOR_POOL_INPUT, TENSOR_POOL_INDEX(i, 1),
+                input_size / 2, &model_obj->m_inputs[i].sysMem[1]);
+        }
+        if (ret != 0) {
             // 内存分配失败，释放之前已分配的内存
             release_model_tensor(model_obj);
             return -1;
@@ -882,7 +1467,7 @@ static int32_t prepare_model_tensor(PyObject *self , Model_Object *model_obj)
     }
 
     // 为输出张量数组分配空间
-    model_obj->m_outputs = (hbDNNTensor *)malloc(sizeof(hbDNNTensor) * model_obj->m_output_count);
+    model_obj->m_outputs = (hbDNNTensor *)calloc(model_obj->m_output_count, sizeof(hbDNNTensor));
     if (model_obj->m_outputs == NULL) {
         // 内存分配失败，释放之前已分配的内存
         release_model_tensor(model_obj);
@@ -893,8 +1478,9 @@ static int32_t prepare_model_tensor(PyObject *self , Model_Object *model_obj)
         // alloc output tensor
         hbDNNGetOutputTensorProperties(&properties, dnn_handle, i);
         model_obj->m_outputs[i].properties = properties;
-        hbSysAllocCachedMem(model_obj->m_outputs[i].sysMem, properties.alignedByteSize);
-        if (model_obj->m_outputs[i].sysMem == NULL) {
+        ret = tensor_pool_alloc(model_obj->name, TENSOR_POOL_OUTPUT, TENSOR_POOL_INDEX(i, 0),
+            properties.alignedByteSize, &model_obj->m_outputs[i].sysMem[0]);
+        if (ret != 0) {
             // 内存分配失败，释放之前已分配的内存
             release_model_tensor(model_obj);
             return -1;
@@ -904,36 +1490,59 @@ static int32_t prepare_model_tensor(PyObject *self , Model_Object *model_obj)
     return ret;
 }
 
-Model_Object* create_and_load_model(PyObject *self , const char* model_file) {
-    // 创建一个 Model 对象
-    Model_Object* model = (Model_Object *)Model_new(&ModelType, NULL, NULL);
-    if (model == NULL) {
-        return NULL;
+/**
+ * 映射模型文件并初始化模型和输入输出张量。
+ * 只调用 BPU 接口，不访问 Python 对象，可以在释放 GIL 之后的线程中并行执行；
+ * 失败时已经申请的资源由 Model_dealloc 释放。
+ */
+static int32_t load_model_file(Model_Object *model, const char *model_file, const char **error)
+{
+    struct stat st;
+    int fd = open(model_file, O_RDONLY);
+    if (fd < 0) {
+        *error = "open model file failed";
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+        close(fd);
+        *error = "invalid model file";
+        return -1;
     }
 
+    // 直接映射文件，模型数据不经过堆内存中转
+    void *addr = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED) {
+        *error = "mmap model file failed";
+        return -1;
+    }
+    madvise(addr, st.st_size, MADV_WILLNEED);
+    model->m_model_addr = addr;
+    model->m_model_size = st.st_size;
+
     // 第一步加载模型
     hbPackedDNNHandle_t packed_dnn_handle;
-    if (hbDNNInitializeFromFiles(&packed_dnn_handle, &model_file, 1) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "hbDNNInitializeFromFiles failed");
-        Py_DECREF(model);
-        return NULL;
+    const void *model_data = addr;
+    int32_t model_size = (int32_t)st.st_size;
+    if (hbDNNInitializeFromDDR(&packed_dnn_handle, &model_data, &model_size, 1) != 0) {
+        *error = "hbDNNInitializeFromDDR failed";
+        return -1;
     }
+    model->m_packed_dnn_handle = packed_dnn_handle;
 
     // 第二步获取模型名称
     const char **model_name_list;
     int32_t model_count = 0;
     if (hbDNNGetModelNameList(&model_name_list, &model_count, packed_dnn_handle) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "hbDNNGetModelNameList failed");
-        Py_DECREF(model);
-        return NULL;
+        *error = "hbDNNGetModelNameList failed";
+        return -1;
     }
 
     // 第三步获取 dnn_handle
     hbDNNHandle_t dnn_handle;
     if (hbDNNGetModelHandle(&dnn_handle, packed_dnn_handle, model_name_list[0]) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "hbDNNGetModelHandle failed");
-        Py_DECREF(model);
-        return NULL;
+        *error = "hbDNNGetModelHandle failed";
+        return -1;
     }
 
     // 初始化 Model 对象的属性
@@ -943,27 +1552,33 @@ Model_Object* create_and_load_model(PyObject *self , const char* model_file) {
         model->name[len] = '\0'; // 手动添加 null 结尾
     }
     model->m_estimate_latency = 100;  // 设置估计延迟为 100
-    model->m_packed_dnn_handle = packed_dnn_handle;
     model->m_dnn_handle = dnn_handle;
 
     // 准备模型张量
-    if (prepare_model_tensor(self , model) != 0) {
-        PyErr_SetString(PyExc_RuntimeError, "prepare_model_tensor failed");
-        Py_DECREF(model);
-        return NULL;
+    if (prepare_model_tensor(NULL, model) != 0) {
+        *error = "prepare_model_tensor failed";
+        return -1;
     }
 
-    return model;
+    return 0;
+}
+
+// 用一次空推理完成 BPU 第一次运行的初始化，避免第一帧的延迟变长
+static void warmup_model(Model_Object *model)
+{
+    // 第一次推理包含初始化的开销，不计入耗时统计
+    infer_model(model, 0, 0, false);
 }
 
 static PyObject *Dnnpy_load(PyObject *self, PyObject *args, PyObject *kwargs)
 {
     PyObject *model_file_arg = nullptr;
+    int warmup = 1;
 
     // 解析参数
-    static const char *keywords[] = {"model_file", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O", const_cast<char **>(keywords), &model_file_arg)) {
-        Py_RETURN_NONE;
+    static const char *keywords[] = {"model_file", "warmup", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "O|p", const_cast<char **>(keywords), &model_file_arg, &warmup)) {
+        return NULL;
     }
 
     // 检查传入参数的类型
@@ -972,60 +1587,177 @@ static PyObject *Dnnpy_load(PyObject *self, PyObject *args, PyObject *kwargs)
         model_file_arg = Py_BuildValue("[O]", model_file_arg);
         if (model_file_arg == nullptr) {
             PyErr_SetString(PyExc_RuntimeError, "Failed to create model file list");
-            Py_RETURN_NONE;
+            return NULL;
         }
-    } else if (!PyList_Check(model_file_arg)) {
+    } else if (PyList_Check(model_file_arg)) {
+        Py_INCREF(model_file_arg);
+    } else {
         // 参数既不是字符串也不是列表，返回错误
         PyErr_SetString(PyExc_TypeError, "model_file must be a string or a list");
-        Py_RETURN_NONE;
-    }
-
-
-    // 创建一个空的模型列表
-    PyObject *model_list = PyList_New(0);
-    if (model_list == NULL) {
-        PyErr_SetString(PyExc_RuntimeError, "Failed to create model list");
-        Py_RETURN_NONE;
+        return NULL;
     }
 
-    // 遍历加载模型文件并创建模型对象
     Py_ssize_t num_files = PyList_Size(model_file_arg);
+    std::vector<const char *> model_files(num_files);
+    std::vector<Model_Object *> models(num_files, nullptr);
+    std::vector<const char *> errors(num_files, nullptr);
+    PyObject *model_list = NULL;
+    bool failed = false;
+
     for (Py_ssize_t i = 0; i < num_files; ++i) {
         PyObject *model_file_obj = PyList_GetItem(model_file_arg, i);
         if (!PyUnicode_Check(model_file_obj)) {
             PyErr_SetString(PyExc_TypeError, "model_file must be a string or a list of strings");
-            Py_DECREF(model_list);
-            Py_RETURN_NONE;
+            goto exit;
+        }
+        model_files[i] = PyUnicode_AsUTF8(model_file_obj);
+        if (model_files[i] == NULL) {
+            goto exit;
         }
-        const char *model_file = PyUnicode_AsUTF8(model_file_obj);
-        if (model_file == NULL) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to convert model file path to UTF-8");
-            Py_DECREF(model_list);
-            Py_RETURN_NONE;
+        models[i] = (Model_Object *)Model_new(&ModelType, NULL, NULL);
+        if (models[i] == NULL) {
+            goto exit;
         }
+    }
+
+    // 各个模型互不相关，每个模型一个线程并行映射和初始化
+    Py_BEGIN_ALLOW_THREADS
+    if (num_files == 1) {
+        load_model_file(models[0], model_files[0], &errors[0]);
+    } else {
+        std::vector<std::thread> threads;
+        for (Py_ssize_t i = 0; i < num_files; ++i) {
+            threads.emplace_back(load_model_file, models[i], model_files[i], &errors[i]);
+        }
+        for (auto &thread : threads) {
+            thread.join();
+        }
+    }
+    Py_END_ALLOW_THREADS
 
-        // 创建并加载模型，省略部分代码
-        Model_Object *model = create_and_load_model(self , model_file);
-        if (model == NULL) {
-            Py_DECREF(model_list);
-            Py_RETURN_NONE;
+    for (Py_ssize_t i = 0; i < num_files; ++i) {
+        if (errors[i] != nullptr) {
+            PyErr_Format(PyExc_RuntimeError, "%s: %s", model_files[i], errors[i]);
+            goto exit;
+        }
+    }
+
+    // 创建一个空的模型列表
+    model_list = PyList_New(0);
+    if (model_list == NULL) {
+        goto exit;
+    }
+
+    for (Py_ssize_t i = 0; i < num_files; ++i) {
+        Model_Object *model = models[i];
+
+        // 输入输出张量的属性在加载之后不再变化，提前构建好
+        model->m_inputs_obj = build_tensor_inputs(model);
+        model->m_outputs_obj = get_tensor_outputs(model, -1);
+        if (model->m_inputs_obj == NULL || model->m_outputs_obj == NULL) {
+            failed = true;
+            break;
         }
 
         // 将 Model 对象添加到模型列表中
         if (PyList_Append(model_list, (PyObject *)model) != 0) {
-            PyErr_SetString(PyExc_RuntimeError, "Failed to append Model object to model list");
-            Py_DECREF(model);
-            Py_DECREF(model_list);
-            Py_RETURN_NONE;
+            failed = true;
+            break;
         }
     }
 
+    if (!failed && warmup) {
+        for (Py_ssize_t i = 0; i < num_files; ++i) {
+            models[i]->m_warmup_thread = new std::thread(warmup_model, models[i]);
+        }
+    }
+
+exit:
+    for (Py_ssize_t i = 0; i < num_files; ++i) {
+        Py_XDECREF(models[i]);
+    }
+    Py_DECREF(model_file_arg);
+    if (PyErr_Occurred()) {
+        Py_XDECREF(model_list);
+        return NULL;
+    }
+
     // 返回模型列表
     return model_list;
 }
 
+// {bpuCoreId: {"utilization": 0~1, "tasks": n}}，统计所有模型指定在 core0(1)、core1(2) 上的负载，
+// 不指定核（bpuCoreId 0）的任务不知道在哪个核上执行，不计入
+static PyObject *Dnnpy_core_stats(PyObject *self, PyObject *args)
+{
+    load_stats_t load[DNN_CORE_NUM];
+    int64_t now = latency_stats_now_us();
+
+    {
+        std::lock_guard<std::mutex> lock(g_stats_mutex);
+        memcpy(load, g_core_load, sizeof(load));
+    }
+
+    PyObject *result = PyDict_New();
+    if (result == NULL) {
+        return NULL;
+    }
+    for (int32_t i = 1; i < DNN_CORE_NUM; i++) {
+        PyObject *core = Py_BuildValue("{s:f,s:L}", "utilization", load_stats_utilization(&load[i], now),
+            "tasks", (long long)load[i].tasks);
+        PyObject *key = PyLong_FromLong(i);
+        int ret = (core == NULL || key == NULL) ? -1 : PyDict_SetItem(result, key, core);
+        Py_XDECREF(core);
+        Py_XDECREF(key);
+        if (ret != 0) {
+            Py_DECREF(result);
+            return NULL;
+        }
+    }
+
+    return result;
+}
+
+// 张量内存池的使用情况，in_use 在所有模型释放之后应该为 0
+static PyObject *Dnnpy_tensor_pool_stats(PyObject *self, PyObject *args)
+{
+    tensor_pool_stats_t stats;
+
+    tensor_pool_get_stats(&stats);
+    return Py_BuildValue("{s:i,s:L,s:i,s:L,s:L,s:L}",
+        "in_use_count", stats.in_use_count, "in_use_bytes", (long long)stats.in_use_bytes,
+        "free_count", stats.free_count, "free_bytes", (long long)stats.free_bytes,
+        "ion_allocs", (long long)stats.ion_allocs, "reuses", (long long)stats.reuses);
+}
+
+// 把池中空闲的内存还给 ION，最多保留 keep_bytes
+static PyObject *Dnnpy_tensor_pool_trim(PyObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"keep_bytes", NULL};
+    long long keep_bytes = 0;
+
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|L", const_cast<char **>(keywords), &keep_bytes)) {
+        return NULL;
+    }
+    Py_BEGIN_ALLOW_THREADS
+    tensor_pool_trim(keep_bytes);
+    Py_END_ALLOW_THREADS
+    Py_RETURN_NONE;
+}
+
+// 打印还没有释放的张量内存，返回块数
+static PyObject *Dnnpy_tensor_pool_dump(PyObject *self, PyObject *args)
+{
+    return PyLong_FromLong(tensor_pool_dump());
+}
+
 static PyMethodDef dnnpy_methods[] = {
     {"load", (PyCFunction)Dnnpy_load, METH_VARARGS | METH_KEYWORDS, "Load model"},
+    {"core_stats", (PyCFunction)Dnnpy_core_stats, METH_NOARGS, "Utilization of BPU cores 1 and 2 from tasks pinned to them"},
+    {"tensor_pool_stats", (PyCFunction)Dnnpy_tensor_pool_stats, METH_NOARGS, "Tensor memory pool usage"},
+    {"tensor_pool_trim", (PyCFunction)Dnnpy_tensor_pool_trim, METH_VARARGS | METH_KEYWORDS,
+        "Release idle pooled tensor memory, keeping at most keep_bytes"},
+    {"tensor_pool_dump", (PyCFunction)Dnnpy_tensor_pool_dump, METH_NOARGS, "Log unreleased tensor memory"},
     {NULL, NULL, 0, NULL},
 };
 
@@ -1042,6 +1774,10 @@ static PyObject* init_module(PyObject* m) {
     // 初始化 NumPy 库
     import_array();
 
+    for (int32_t i = 0; i < DNN_CORE_NUM; i++) {
+        load_stats_init(&g_core_load[i], 0.5f);
+    }
+
     if (m == NULL) {
         return NULL;
     }
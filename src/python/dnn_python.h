@@ -6,12 +6,17 @@
 #include <map>
 #include <memory>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include "dnn/hb_dnn.h"
 #include "dnn/hb_sys.h"
 #include "dnn/hb_dnn_ext.h"
 
+#include "image_preproc.h"
+#include "latency_stats.h"
+#include "tensor_pool.h"
+
 #define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
 #include <Python.h>
 #include <structmember.h>
@@ -27,6 +32,9 @@ extern std::map<int, std::string> Layout;
 
 #define ALIGN_16(v) ((v + (16 - 1)) / 16 * 16)
 
+// hbDNNInferCtrlParam.bpuCoreId 的取值个数：0 任意核，1 core0，2 core1
+#define DNN_CORE_NUM 3
+
 void HB_CHECK_SUCCESS(int32_t value, char *errmsg)
 {
     /*value can be call of function*/
@@ -78,7 +86,23 @@ typedef struct {
     hbDNNTensor *m_inputs;
     int32_t m_output_count;
     hbDNNTensor *m_outputs;
-    int32_t m_estimate_latency;
+    int32_t m_estimate_latency;     // 推理耗时的 EWMA，单位 ms（向上取整），还没有推理过时为 100
+    // 按 bpuCoreId 统计的提交到完成的耗时和排队等待时间，单位 us，0 是不指定核的推理的汇总
+    latency_stats_t m_latency[DNN_CORE_NUM];
+    latency_stats_t m_queue_wait[DNN_CORE_NUM];
+    // 模型文件通过 mmap 映射，模型释放之后再解除映射
+    void *m_model_addr;
+    size_t m_model_size;
+    // 加载时构建好的输入输出张量列表，inputs/outputs 属性返回它们的浅拷贝
+    PyObject *m_inputs_obj;
+    PyObject *m_outputs_obj;
+    // 后台预热推理线程，第一次推理前等待它结束
+    std::thread *m_warmup_thread;
+    // forward_frame 使用的预处理句柄，源图像尺寸或者参数变化时重新创建
+    image_preproc_t *m_preproc;
+    image_preproc_config_t m_preproc_config;
+    int32_t m_preproc_src_w;
+    int32_t m_preproc_src_h;
 } Model_Object;
 
 #ifdef __cplusplus
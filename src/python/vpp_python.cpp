@@ -20,11 +20,14 @@
 #include <Python.h>
 
 #include "utils_log.h"
+#include "color_convert.h"
 
 #include "vpp_python.h"
 #include "vpp_display.h"
 #include "vpp_camera.h"
 #include "vpp_codec.h"
+#include "vpp_sync_group.h"
+#include "vpp_shm_sink.h"
 
 using namespace spdev;
 using namespace std;
@@ -359,6 +362,24 @@ extern "C"
 			dst_width, dst_height, crop_x, crop_y, crop_width, crop_height, rotate));
 	}
 
+	PyObject *Camera_set_buf_num(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		if (!(self->pobj && self->pframe)) {
+			PyErr_SetString(PyExc_Exception, "camera not inited");
+			return Py_BuildValue("i", -1);
+		}
+
+		int output_buf_num = 0, fb_buf_num = 2;
+		VPPCamera *cam = (VPPCamera *)self->pobj;
+		static char *kwlist[] = {(char *)"output_buf_num", (char *)"fb_buf_num", NULL};
+
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "i|i", kwlist,
+			&output_buf_num, &fb_buf_num))
+			return Py_BuildValue("i", -1);
+
+		return Py_BuildValue("i", cam->SetBufferNum(output_buf_num, fb_buf_num));
+	}
+
 	PyObject *Camera_close_cam(libsppydev_Object *self)
 	{
 		if (!(self->pobj && self->pframe))
@@ -861,6 +882,125 @@ extern "C"
 		return Py_BuildValue("i", pobj->SetGraphWord(x, y, PyBytes_AsString(str_obj), flush, (uint32_t)color, line_width));
 	}
 
+	static PyObject *Display_set_graph_batch(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		VPPDisplay *pobj = (VPPDisplay *)self->pobj;
+		PyObject *items = nullptr, *seq = nullptr, *item = nullptr;
+		vp_overlay_list_t list;
+		const char *kind = nullptr, *str = nullptr;
+		int x0, y0, x1, y1, line_width;
+		unsigned long color;
+		int ret = 0;
+		static char *kwlist[] = {(char *)"items", NULL};
+
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "display not inited");
+			return Py_BuildValue("i", -1);
+		}
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "O", kwlist, &items))
+		{
+			return Py_BuildValue("i", -1);
+		}
+
+		seq = PySequence_Fast(items, "items must be a list of tuples");
+		if (seq == nullptr)
+		{
+			return Py_BuildValue("i", -1);
+		}
+
+		vp_overlay_list_init(&list);
+		for (Py_ssize_t i = 0; (ret == 0) && (i < PySequence_Fast_GET_SIZE(seq)); i++)
+		{
+			item = PySequence_Fast_GET_ITEM(seq, i);
+			if (!PyTuple_Check(item) || (PyTuple_Size(item) < 1) ||
+				!PyUnicode_Check(PyTuple_GET_ITEM(item, 0)))
+			{
+				PyErr_SetString(PyExc_TypeError, "item must be a tuple like (\"rect\", x0, y0, x1, y1)");
+				ret = -1;
+				break;
+			}
+			kind = PyUnicode_AsUTF8(PyTuple_GET_ITEM(item, 0));
+			color = 0xffff0000;
+			line_width = (strcmp(kind, "rect") == 0) ? 4 : 1;
+			if (strcmp(kind, "rect") == 0)
+			{
+				if (!PyArg_ParseTuple(item, "siiii|ki", &kind, &x0, &y0, &x1, &y1, &color, &line_width))
+					ret = -1;
+				else
+					ret = vp_overlay_add_box(&list, x0, y0, x1, y1, (uint32_t)color, line_width);
+			}
+			else if (strcmp(kind, "fill") == 0)
+			{
+				if (!PyArg_ParseTuple(item, "siiii|k", &kind, &x0, &y0, &x1, &y1, &color))
+					ret = -1;
+				else
+					ret = vp_overlay_add_fill(&list, x0, y0, x1, y1, (uint32_t)color);
+			}
+			else if (strcmp(kind, "word") == 0)
+			{
+				if (!PyArg_ParseTuple(item, "siiy|ki", &kind, &x0, &y0, &str, &color, &line_width))
+					ret = -1;
+				else
+					ret = vp_overlay_add_text(&list, x0, y0, str, (uint32_t)color, line_width);
+			}
+			else
+			{
+				PyErr_Format(PyExc_ValueError, "unknown osd item type: %s", kind);
+				ret = -1;
+			}
+		}
+		Py_DECREF(seq);
+
+		if (ret == 0)
+		{
+			ret = pobj->SetGraphBatch(&list);
+		}
+		vp_overlay_list_deinit(&list);
+
+		if (PyErr_Occurred())
+		{
+			return NULL;
+		}
+		return Py_BuildValue("i", ret);
+	}
+
+	static PyObject *Display_blend_osd(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		PyObject *img_obj = nullptr;
+		Py_buffer view;
+		ImageFrame frame;
+		int32_t ret = 0;
+		static char *kwlist[] = {(char *)"img", NULL};
+
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "display not inited");
+			return Py_BuildValue("i", -1);
+		}
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "O", kwlist, &img_obj))
+		{
+			return Py_BuildValue("i", -1);
+		}
+		// 原地修改图像，需要 bytearray 这类可写的 buffer
+		if (PyObject_GetBuffer(img_obj, &view, PyBUF_WRITABLE) != 0)
+		{
+			return NULL;
+		}
+
+		memset(&frame, 0, sizeof(ImageFrame));
+		frame.data[0] = (uint8_t *)view.buf;
+		frame.data_size[0] = view.len;
+		frame.plane_count = 1;
+
+		Py_BEGIN_ALLOW_THREADS
+		ret = ((VPPDisplay *)self->pobj)->BlendOsd(&frame);
+		Py_END_ALLOW_THREADS
+
+		PyBuffer_Release(&view);
+		return Py_BuildValue("i", ret);
+	}
+
 	static PyObject *Display_close(libsppydev_Object *self)
 	{
 		if (!self->pobj)
@@ -872,6 +1012,306 @@ extern "C"
 		return Py_BuildValue("i", ((VPPDisplay *)self->pobj)->Close());
 	}
 
+	static PyObject *SyncGroup_new(PyTypeObject *type, PyObject *args, PyObject *kw)
+	{
+		libsppydev_Object *self = (libsppydev_Object *)type->tp_alloc(type, 0);
+		self->pobj = nullptr;
+		self->pframe = nullptr;
+		self->refs = nullptr;
+		return (PyObject *)self;
+	}
+
+	static void SyncGroup_dealloc(libsppydev_Object *self)
+	{
+		if (self->pobj)
+		{
+			// 先停止同步线程，再释放对源模块的引用
+			Py_BEGIN_ALLOW_THREADS
+			delete static_cast<VPPSyncGroup *>(self->pobj);
+			Py_END_ALLOW_THREADS
+			self->pobj = nullptr;
+		}
+		Py_CLEAR(self->refs);
+
+		self->ob_base.ob_type->tp_free(self);
+	}
+
+	static int32_t SyncGroup_init(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		if (self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "__init__ already called");
+			return -1;
+		}
+		self->pobj = new VPPSyncGroup();
+		self->object = VPP_MODULE_DEFAULT;
+
+		return 0;
+	}
+
+	// 模块类型对象定义在后面
+	static bool is_vpp_module(PyObject *obj);
+
+	static PyObject *SyncGroup_add(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		libsppydev_Object *src_obj = nullptr;
+		int32_t chn = 0, ret = 0;
+		VPPSyncGroup *group = (VPPSyncGroup *)self->pobj;
+		static char *kwlist[] = {(char *)"module", (char *)"chn", NULL};
+
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "O|i", kwlist, &src_obj, &chn))
+			return Py_BuildValue("i", -1);
+
+		if (!is_vpp_module((PyObject *)src_obj)) {
+			PyErr_Format(PyExc_TypeError, "module must be a Camera, Encoder, Decoder, Display or ShmSink, not %s",
+				Py_TYPE((PyObject *)src_obj)->tp_name);
+			return nullptr;
+		}
+
+		if ((group == nullptr) || (src_obj->pobj == nullptr)) {
+			PyErr_SetString(PyExc_Exception, "sync group or module not inited");
+			return Py_BuildValue("i", -1);
+		}
+
+		ret = group->AddSource((VPPModule *)src_obj->pobj, chn);
+		if (ret < 0)
+			return Py_BuildValue("i", ret);
+
+		// 同步组只保存模块指针，这里持有源模块的引用，保证它们比同步组活得久
+		if (self->refs == nullptr) {
+			self->refs = PyList_New(0);
+			if (self->refs == nullptr)
+				return nullptr;
+		}
+		if (PyList_Append(self->refs, (PyObject *)src_obj) != 0)
+			return nullptr;
+
+		return Py_BuildValue("i", ret);
+	}
+
+	static PyObject *SyncGroup_start(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		long long tolerance = 5000;
+		int32_t policy = VPP_SYNC_DROP_STALE, depth = 2;
+		VPPSyncGroup *group = (VPPSyncGroup *)self->pobj;
+		static char *kwlist[] = {(char *)"tolerance", (char *)"policy",
+			(char *)"depth", NULL};
+
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "|Lii", kwlist,
+			&tolerance, &policy, &depth))
+			return Py_BuildValue("i", -1);
+
+		if (group == nullptr) {
+			PyErr_SetString(PyExc_Exception, "sync group not inited");
+			return Py_BuildValue("i", -1);
+		}
+
+		group->SetTolerance(tolerance);
+		group->SetDropPolicy((VPP_SYNC_DROP_POLICY_E)policy);
+		if (group->SetQueueDepth(depth) != 0)
+			return Py_BuildValue("i", -1);
+
+		return Py_BuildValue("i", group->Start());
+	}
+
+	static PyObject *SyncGroup_stop(libsppydev_Object *self)
+	{
+		VPPSyncGroup *group = (VPPSyncGroup *)self->pobj;
+
+		if (group == nullptr) {
+			PyErr_SetString(PyExc_Exception, "sync group not inited");
+			return nullptr;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		group->Stop();
+		Py_END_ALLOW_THREADS
+
+		Py_RETURN_NONE;
+	}
+
+	static PyObject *SyncGroup_get_frames(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		int32_t timeout = 2000, ret = 0;
+		VPPSyncGroup *group = (VPPSyncGroup *)self->pobj;
+		vector<ImageFrame> frames;
+		PyObject *list_obj = nullptr, *img_obj = nullptr, *uv_obj = nullptr;
+		static char *kwlist[] = {(char *)"timeout", NULL};
+
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "|i", kwlist, &timeout))
+			Py_RETURN_NONE;
+
+		if (group == nullptr) {
+			PyErr_SetString(PyExc_Exception, "sync group not inited");
+			return nullptr;
+		}
+
+		Py_BEGIN_ALLOW_THREADS
+		ret = group->GetFrameSet(frames, timeout);
+		Py_END_ALLOW_THREADS
+		if (ret != 0)
+			Py_RETURN_NONE;
+
+		// 返回 [(img, timestamp), ...]，顺序与 add 的顺序一致
+		list_obj = PyList_New(frames.size());
+		for (size_t i = 0; i < frames.size(); i++) {
+			img_obj = PyBytes_FromStringAndSize((const char *)frames[i].data[0],
+				frames[i].data_size[0]);
+			if (frames[i].plane_count == 2) {
+				uv_obj = PyBytes_FromStringAndSize((const char *)frames[i].data[1],
+					frames[i].data_size[1]);
+				PyBytes_ConcatAndDel(&img_obj, uv_obj);
+			}
+			PyList_SetItem(list_obj, i, Py_BuildValue("(NL)", img_obj,
+				(long long)frames[i].image_timestamp));
+		}
+		group->ReturnFrameSet(frames);
+
+		return list_obj;
+	}
+
+	static PyObject *SyncGroup_get_stats(libsppydev_Object *self)
+	{
+		VPPSyncGroup *group = (VPPSyncGroup *)self->pobj;
+		vpp_sync_stats_t stats;
+		PyObject *list_obj = nullptr;
+
+		if (group == nullptr) {
+			PyErr_SetString(PyExc_Exception, "sync group not inited");
+			return nullptr;
+		}
+
+		group->GetStats(&stats);
+		list_obj = PyList_New(stats.sources.size());
+		for (size_t i = 0; i < stats.sources.size(); i++) {
+			PyList_SetItem(list_obj, i, Py_BuildValue("{s:L,s:L,s:L,s:L}",
+				"received", (long long)stats.sources[i].received,
+				"matched", (long long)stats.sources[i].matched,
+				"drop_stale", (long long)stats.sources[i].drop_stale,
+				"drop_overflow", (long long)stats.sources[i].drop_overflow));
+		}
+
+		return Py_BuildValue("{s:L,s:N}", "frame_sets", (long long)stats.frame_sets,
+			"sources", list_obj);
+	}
+
+	static PyObject *ShmSink_new(PyTypeObject *type, PyObject *args, PyObject *kw)
+	{
+		libsppydev_Object *self = (libsppydev_Object *)type->tp_alloc(type, 0);
+		self->pobj = nullptr;
+		self->pframe = nullptr;
+		return (PyObject *)self;
+	}
+
+	static void ShmSink_dealloc(libsppydev_Object *self)
+	{
+		if (self->pobj)
+		{
+			delete static_cast<VPPShmSink *>(self->pobj);
+			self->pobj = nullptr;
+		}
+		if (self->pframe)
+		{
+			delete static_cast<ImageFrame *>(self->pframe);
+			self->pframe = nullptr;
+		}
+
+		self->ob_base.ob_type->tp_free(self);
+	}
+
+	static int32_t ShmSink_init(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		if (self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "__init__ already called");
+			return -1;
+		}
+
+		self->pobj = static_cast<void *>(new VPPShmSink());
+		self->pframe = new ImageFrame();
+
+		self->object = VPP_SHM_SINK;
+
+		return 0;
+	}
+
+	static PyObject *ShmSink_open(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		const char *name = SHM_FRAME_DEFAULT_NAME;
+		int width = 1920, height = 1080, slots = 3;
+		static char *kwlist[] = {(char *)"width", (char *)"height", (char *)"name",
+			(char *)"slots", NULL};
+
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "shm sink not inited");
+			return Py_BuildValue("i", -1);
+		}
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "|iisi", kwlist, &width, &height, &name, &slots))
+		{
+			return Py_BuildValue("i", -1);
+		}
+
+		return Py_BuildValue("i", ((VPPShmSink *)self->pobj)->Open(name, width, height, slots));
+	}
+
+	static PyObject *ShmSink_set_img(libsppydev_Object *self, PyObject *args, PyObject *kw)
+	{
+		Py_buffer img;
+		int32_t ret = 0;
+		static char *kwlist[] = {(char *)"img", NULL};
+
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "shm sink not inited");
+			return Py_BuildValue("i", -1);
+		}
+		// 通过 buffer 协议接收 bytes、bytearray、numpy 数组等，不是连续内存时抛出 TypeError
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "y*", kwlist, &img))
+		{
+			return nullptr;
+		}
+
+		memset(self->pframe, 0, sizeof(ImageFrame));
+		self->pframe->data[0] = (uint8_t *)img.buf;
+		self->pframe->data_size[0] = img.len;
+		self->pframe->plane_count = 1;
+
+		Py_BEGIN_ALLOW_THREADS
+		ret = ((VPPShmSink *)self->pobj)->SetImageFrame(self->pframe);
+		Py_END_ALLOW_THREADS
+		PyBuffer_Release(&img);
+
+		return Py_BuildValue("i", ret);
+	}
+
+	static PyObject *ShmSink_get_stats(libsppydev_Object *self)
+	{
+		vpp_shm_sink_stats_t stats;
+
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "shm sink not inited");
+			return Py_BuildValue("i", -1);
+		}
+
+		((VPPShmSink *)self->pobj)->GetStats(&stats);
+
+		return Py_BuildValue("{s:L,s:L,s:L}", "published", (long long)stats.published,
+			"dropped", (long long)stats.dropped, "bytes", (long long)stats.bytes);
+	}
+
+	static PyObject *ShmSink_close(libsppydev_Object *self)
+	{
+		if (!self->pobj)
+		{
+			PyErr_SetString(PyExc_Exception, "shm sink not inited");
+			return Py_BuildValue("i", -1);
+		}
+
+		return Py_BuildValue("i", ((VPPShmSink *)self->pobj)->Close());
+	}
+
 	static PyObject *Module_bind(libsppydev_Object *self, PyObject *args, PyObject *kw)
 	{
 		libsppydev_Object *src_obj = nullptr, *dst_obj = nullptr;
@@ -906,15 +1346,90 @@ extern "C"
 		return Py_BuildValue("i", dst_mod->UnBind(src_mod));
 	}
 
+	static PyObject *Module_nv12_to_rgb(PyObject *self, PyObject *args, PyObject *kw)
+	{
+		PyObject *img_obj = nullptr, *out_obj = nullptr;
+		int width = 0, height = 0, format = COLOR_FMT_RGB, std = COLOR_STD_BT601;
+		int full_range = 0, dst_width = 0, dst_height = 0, threads = 0;
+		int32_t out_size = 0, ret = 0;
+		color_nv12_image_t src;
+		color_rgb_image_t dst;
+		color_convert_param_t param;
+		uint8_t *out_data = nullptr;
+		static char *kwlist[] = {(char *)"img", (char *)"width", (char *)"height",
+			(char *)"format", (char *)"std", (char *)"full_range",
+			(char *)"dst_width", (char *)"dst_height", (char *)"threads", NULL};
+
+		if (!PyArg_ParseTupleAndKeywords(args, kw, "Oii|iiiiii", kwlist, &img_obj,
+				&width, &height, &format, &std, &full_range, &dst_width, &dst_height, &threads))
+			Py_RETURN_NONE;
+
+		if (!PyBytes_Check(img_obj)) {
+			PyErr_SetString(PyExc_TypeError, "img must be bytes");
+			return NULL;
+		}
+		if (PyBytes_Size(img_obj) < (Py_ssize_t)width * height * 3 / 2) {
+			PyErr_SetString(PyExc_ValueError, "img size less than nv12 format size");
+			return NULL;
+		}
+
+		dst_width = (dst_width > 0) ? dst_width : width;
+		dst_height = (dst_height > 0) ? dst_height : height;
+		out_size = color_rgb_image_size((color_fmt_e)format, dst_width, dst_height);
+		if (out_size <= 0) {
+			PyErr_SetString(PyExc_ValueError, "invalid format");
+			return NULL;
+		}
+
+		out_obj = PyBytes_FromStringAndSize(NULL, out_size);
+		if (out_obj == nullptr)
+			return NULL;
+		out_data = (uint8_t *)PyBytes_AsString(out_obj);
+
+		memset(&src, 0, sizeof(src));
+		src.y = (const uint8_t *)PyBytes_AsString(img_obj);
+		src.uv = src.y + width * height;
+		src.width = width;
+		src.height = height;
+
+		memset(&dst, 0, sizeof(dst));
+		dst.width = dst_width;
+		dst.height = dst_height;
+		dst.format = (color_fmt_e)format;
+		dst.data[0] = out_data;
+		if (dst.format == COLOR_FMT_RGB_PLANAR) {
+			dst.data[1] = out_data + dst_width * dst_height;
+			dst.data[2] = out_data + dst_width * dst_height * 2;
+		}
+
+		param.std = (color_std_e)std;
+		param.range = full_range ? COLOR_RANGE_FULL : COLOR_RANGE_LIMITED;
+		param.threads = threads;
+
+		Py_BEGIN_ALLOW_THREADS
+		ret = color_nv12_to_rgb(&src, &dst, &param);
+		Py_END_ALLOW_THREADS
+
+		if (ret != 0) {
+			Py_DECREF(out_obj);
+			PyErr_SetString(PyExc_ValueError, "nv12 color convert failed");
+			return NULL;
+		}
+
+		return out_obj;
+	}
+
 #define M_DOC_STRING         \
 	"bind(module, module)\n" \
-	"unbind(module, module)\n"
+	"unbind(module, module)\n" \
+	"nv12_to_rgb(img, width, height, format, std, full_range, dst_width, dst_height, threads)\n"
 
 	static const char *__g_m_doc_str = M_DOC_STRING;
 
 	static struct PyMethodDef Camera_Methods[] = {
 		{"open_cam", (PyCFunction)Camera_open_cam, METH_VARARGS | METH_KEYWORDS, "Open camera and start video stream"},
 		{"open_vps", (PyCFunction)Camera_open_vps, METH_VARARGS | METH_KEYWORDS, "Open vps process"},
+		{"set_buf_num", (PyCFunction)Camera_set_buf_num, METH_VARARGS | METH_KEYWORDS, "Set vps buffer num, call before open_cam/open_vps"},
 		{"close_cam", (PyCFunction)Camera_close_cam, METH_NOARGS, "Stop video stream and close camera"},
 		{"get_img", (PyCFunction)Camera_get_img, METH_VARARGS | METH_KEYWORDS, "Get image from the channel"},
 		{"set_img", (PyCFunction)Camera_set_img, METH_VARARGS | METH_KEYWORDS, "Set image to the vps"},
@@ -1072,6 +1587,8 @@ extern "C"
 		{"set_img", (PyCFunction)Display_set_img, METH_VARARGS | METH_KEYWORDS, "Set display image"},
 		{"set_graph_rect", (PyCFunction)Display_set_graph_rect, METH_VARARGS | METH_KEYWORDS, "Set display grapth rect"},
 		{"set_graph_word", (PyCFunction)Display_set_graph_word, METH_VARARGS | METH_KEYWORDS, "Set display grapth word"},
+		{"set_graph_batch", (PyCFunction)Display_set_graph_batch, METH_VARARGS | METH_KEYWORDS, "Replace the whole osd layer with a list of rect/fill/word items"},
+		{"blend_osd", (PyCFunction)Display_blend_osd, METH_VARARGS | METH_KEYWORDS, "Burn the osd layer into a writable nv12 image in place"},
 		{"close", (PyCFunction)Display_close, METH_NOARGS, "Closes Display."},
 		{nullptr, nullptr, 0, nullptr},
 	};
@@ -1118,9 +1635,121 @@ extern "C"
 		0,                                                /* tp_free */
 	};
 
+	static PyMethodDef SyncGroup_methods[] = {
+		{"add", (PyCFunction)SyncGroup_add, METH_VARARGS | METH_KEYWORDS, "Add a camera to the sync group"},
+		{"start", (PyCFunction)SyncGroup_start, METH_VARARGS | METH_KEYWORDS, "Start sync group with tolerance/policy/depth"},
+		{"stop", (PyCFunction)SyncGroup_stop, METH_NOARGS, "Stop sync group"},
+		{"get_frames", (PyCFunction)SyncGroup_get_frames, METH_VARARGS | METH_KEYWORDS, "Get one timestamp synchronized frame set"},
+		{"get_stats", (PyCFunction)SyncGroup_get_stats, METH_NOARGS, "Get matched and dropped frame counters"},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	static PyTypeObject libsppydev_SyncGroupType = {
+		PyVarObject_HEAD_INIT(&libsppydev_SyncGroupType, 0) /* ob_size */
+		"libsppydev.SyncGroup",                             /* tp_name */
+		sizeof(libsppydev_Object),                          /* tp_basicsize */
+		0,                                                  /* tp_itemsize */
+		(destructor)SyncGroup_dealloc,                      /* tp_dealloc */
+		0,                                                  /* tp_print */
+		0,                                                  /* tp_getattr */
+		0,                                                  /* tp_setattr */
+		0,                                                  /* tp_compare */
+		0,                                                  /* tp_repr */
+		0,                                                  /* tp_as_number */
+		0,                                                  /* tp_as_sequence */
+		0,                                                  /* tp_as_mapping */
+		0,                                                  /* tp_hash */
+		0,                                                  /* tp_call */
+		0,                                                  /* tp_str */
+		0,                                                  /* tp_getattro */
+		0,                                                  /* tp_setattro */
+		0,                                                  /* tp_as_buffer */
+		Py_TPFLAGS_DEFAULT,                                 /* tp_flags */
+		"SyncGroup object.",                                /* tp_doc */
+		0,                                                  /* tp_traverse */
+		0,                                                  /* tp_clear */
+		0,                                                  /* tp_richcompare */
+		0,                                                  /* tp_weaklistoffset */
+		0,                                                  /* tp_iter */
+		0,                                                  /* tp_iternext */
+		SyncGroup_methods,                                  /* tp_methods */
+		0,                                                  /* tp_members */
+		0,                                                  /* tp_getset */
+		0,                                                  /* tp_base */
+		0,                                                  /* tp_dict */
+		0,                                                  /* tp_descr_get */
+		0,                                                  /* tp_descr_set */
+		0,                                                  /* tp_dictoffset */
+		(initproc)SyncGroup_init,                           /* tp_init */
+		0,                                                  /* tp_alloc */
+		(newfunc)SyncGroup_new,                             /* tp_new */
+		0,                                                  /* tp_free */
+	};
+
+	static PyMethodDef ShmSink_methods[] = {
+		{"open", (PyCFunction)ShmSink_open, METH_VARARGS | METH_KEYWORDS, "Create the shared memory frame ring"},
+		{"set_img", (PyCFunction)ShmSink_set_img, METH_VARARGS | METH_KEYWORDS, "Publish one nv12 image"},
+		{"get_stats", (PyCFunction)ShmSink_get_stats, METH_NOARGS, "Get published and dropped frame counters"},
+		{"close", (PyCFunction)ShmSink_close, METH_NOARGS, "Close and unlink the shared memory"},
+		{nullptr, nullptr, 0, nullptr},
+	};
+
+	static PyTypeObject libsppydev_ShmSinkType = {
+		PyVarObject_HEAD_INIT(&libsppydev_ShmSinkType, 0) /* ob_size */
+		"libsppydev.ShmSink",                             /* tp_name */
+		sizeof(libsppydev_Object),                        /* tp_basicsize */
+		0,                                                /* tp_itemsize */
+		(destructor)ShmSink_dealloc,                      /* tp_dealloc */
+		0,                                                /* tp_print */
+		0,                                                /* tp_getattr */
+		0,                                                /* tp_setattr */
+		0,                                                /* tp_compare */
+		0,                                                /* tp_repr */
+		0,                                                /* tp_as_number */
+		0,                                                /* tp_as_sequence */
+		0,                                                /* tp_as_mapping */
+		0,                                                /* tp_hash */
+		0,                                                /* tp_call */
+		0,                                                /* tp_str */
+		0,                                                /* tp_getattro */
+		0,                                                /* tp_setattro */
+		0,                                                /* tp_as_buffer */
+		Py_TPFLAGS_DEFAULT,                               /* tp_flags */
+		"ShmSink object.",                                /* tp_doc */
+		0,                                                /* tp_traverse */
+		0,                                                /* tp_clear */
+		0,                                                /* tp_richcompare */
+		0,                                                /* tp_weaklistoffset */
+		0,                                                /* tp_iter */
+		0,                                                /* tp_iternext */
+		ShmSink_methods,                                  /* tp_methods */
+		0,                                                /* tp_members */
+		0,                                                /* tp_getset */
+		0,                                                /* tp_base */
+		0,                                                /* tp_dict */
+		0,                                                /* tp_descr_get */
+		0,                                                /* tp_descr_set */
+		0,                                                /* tp_dictoffset */
+		(initproc)ShmSink_init,                           /* tp_init */
+		0,                                                /* tp_alloc */
+		(newfunc)ShmSink_new,                             /* tp_new */
+		0,                                                /* tp_free */
+	};
+
+	static bool is_vpp_module(PyObject *obj)
+	{
+		return PyObject_TypeCheck(obj, &libsppydev_CameraType) ||
+			PyObject_TypeCheck(obj, &libsppydev_EncoderType) ||
+			PyObject_TypeCheck(obj, &libsppydev_DecoderType) ||
+			PyObject_TypeCheck(obj, &libsppydev_DisplayType) ||
+			PyObject_TypeCheck(obj, &libsppydev_ShmSinkType);
+	}
+
 	static PyMethodDef libsppydev_methods[] = {
 		{"bind", (PyCFunction)Module_bind, METH_VARARGS | METH_KEYWORDS, "Bind two module."},
 		{"unbind", (PyCFunction)Module_unbind, METH_VARARGS | METH_KEYWORDS, "Unbind two module."},
+		{"nv12_to_rgb", (PyCFunction)Module_nv12_to_rgb, METH_VARARGS | METH_KEYWORDS,
+			"Convert nv12 to rgba(0)/rgb(1)/bgr(2)/planar rgb(3), std 0: bt601 1: bt709."},
 		{nullptr, nullptr, 0, nullptr},
 	};
 
@@ -1144,6 +1773,8 @@ extern "C"
 		libsppydev_EncoderType.ob_base = ob_base;
 		libsppydev_DecoderType.ob_base = ob_base;
 		libsppydev_DisplayType.ob_base = ob_base;
+		libsppydev_SyncGroupType.ob_base = ob_base;
+		libsppydev_ShmSinkType.ob_base = ob_base;
 
 		if (PyType_Ready(&libsppydev_CameraType) < 0)
 		{
@@ -1165,15 +1796,29 @@ extern "C"
 			return nullptr;
 		}
 
+		if (PyType_Ready(&libsppydev_SyncGroupType) < 0)
+		{
+			return nullptr;
+		}
+
+		if (PyType_Ready(&libsppydev_ShmSinkType) < 0)
+		{
+			return nullptr;
+		}
+
 		Py_INCREF(&libsppydev_CameraType);
 		Py_INCREF(&libsppydev_EncoderType);
 		Py_INCREF(&libsppydev_DecoderType);
 		Py_INCREF(&libsppydev_DisplayType);
+		Py_INCREF(&libsppydev_SyncGroupType);
+		Py_INCREF(&libsppydev_ShmSinkType);
 
 		PyModule_AddObject(m, "Camera", (PyObject *)&libsppydev_CameraType);
 		PyModule_AddObject(m, "Encoder", (PyObject *)&libsppydev_EncoderType);
 		PyModule_AddObject(m, "Decoder", (PyObject *)&libsppydev_DecoderType);
 		PyModule_AddObject(m, "Display", (PyObject *)&libsppydev_DisplayType);
+		PyModule_AddObject(m, "SyncGroup", (PyObject *)&libsppydev_SyncGroupType);
+		PyModule_AddObject(m, "ShmSink", (PyObject *)&libsppydev_ShmSinkType);
 
 		return m;
 	}
@@ -46,6 +46,7 @@ namespace spdev
 		void *pobj;
 		ImageFrame *pframe;
 		VPP_Object_e object;
+		PyObject *refs; // 生命周期内需要保持引用的其他 Python 对象，例如 SyncGroup 的源模块
 	} libsppydev_Object;
 
 }
@@ -0,0 +1,163 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+/*
+ * 共享内存送显（VPPShmSink / libsrcampy.ShmSink）的读者工具：
+ * 挂载共享内存环，统计帧率、丢帧和发布到读取的延迟，可选把 NV12 原始数据写到文件或者标准输出，
+ * 例如：shm_frame_reader -o - | ffplay -f rawvideo -pixel_format nv12 -video_size 1920x1080 -
+ * 写者退出后自动等待重新挂载。
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <getopt.h>
+
+#include "shm_frame_ring.h"
+
+#define READER_TIMEOUT_MS 1000
+#define READER_REOPEN_US (500 * 1000)
+
+static volatile sig_atomic_t s_exit = 0;
+
+static void signal_handler(int signo)
+{
+    (void)signo;
+    s_exit = 1;
+}
+
+static int64_t now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+        "Usage: %s [-n name] [-o file|-] [-c count]\n"
+        "  -n name   shared memory name, default %s\n"
+        "  -o file   write raw frames to file, '-' for stdout\n"
+        "  -c count  exit after reading count frames\n", prog, SHM_FRAME_DEFAULT_NAME);
+}
+
+int main(int argc, char **argv)
+{
+    const char *name = SHM_FRAME_DEFAULT_NAME, *output = NULL;
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_meta_t meta;
+    FILE *out = NULL;
+    uint8_t *buf = NULL;
+    uint64_t last_seq = 0, prev_seq = 0, frames = 0, drops = 0;
+    uint64_t period_frames = 0, period_drops = 0;
+    int64_t count = 0, latency = 0, latency_sum = 0, latency_max = 0, period_start = 0;
+    int32_t opt = 0, ret = 0;
+
+    while ((opt = getopt(argc, argv, "n:o:c:h")) != -1) {
+        switch (opt) {
+        case 'n':
+            name = optarg;
+            break;
+        case 'o':
+            output = optarg;
+            break;
+        case 'c':
+            count = atoll(optarg);
+            break;
+        default:
+            usage(argv[0]);
+            return (opt == 'h') ? 0 : -1;
+        }
+    }
+
+    if (output != NULL) {
+        out = (strcmp(output, "-") == 0) ? stdout : fopen(output, "wb");
+        if (out == NULL) {
+            fprintf(stderr, "open %s failed\n", output);
+            return -1;
+        }
+    }
+
+    memset(&meta, 0, sizeof(meta));
+    signal(SIGINT, signal_handler);
+    signal(SIGTERM, signal_handler);
+
+    period_start = now_ns();
+    while (!s_exit && (count == 0 || (int64_t)frames < count)) {
+        if (ring == NULL) {
+            ring = shm_frame_ring_open(name);
+            if (ring == NULL) {
+                usleep(READER_REOPEN_US);
+                continue;
+            }
+            buf = (uint8_t *)realloc(buf, ring->header->slot_size);
+            if (buf == NULL) {
+                fprintf(stderr, "alloc %u bytes failed\n", ring->header->slot_size);
+                break;
+            }
+            last_seq = 0;
+            fprintf(stderr, "attached to %s, %u slots of %u bytes, producer pid %d\n",
+                ring->name, ring->header->slot_count, ring->header->slot_size,
+                ring->header->producer_pid);
+        }
+
+        prev_seq = last_seq;
+        ret = shm_frame_ring_read(ring, &last_seq, &meta, buf,
+            ring->header->slot_size, READER_TIMEOUT_MS);
+        if (ret == SHM_FRAME_RING_ERROR) {
+            // buf 按 slot_size 分配，这里出错说明共享内存内容不可信，重新挂载也会再次失败
+            fprintf(stderr, "read %s failed\n", ring->name);
+            break;
+        }
+        if (ret == SHM_FRAME_RING_CLOSED) {
+            fprintf(stderr, "producer closed, waiting for it to come back\n");
+            shm_frame_ring_close(ring);
+            ring = NULL;
+            continue;
+        }
+
+        if (ret == SHM_FRAME_RING_NEW_FRAME) {
+            // 读者总是取最新帧，frame_seq 不连续说明中间的帧被跳过；挂载之前的帧不算丢帧
+            if (prev_seq > 0 && meta.frame_seq > prev_seq + 1)
+                period_drops += meta.frame_seq - prev_seq - 1;
+            frames++;
+            period_frames++;
+            latency = now_ns() - meta.publish_ns;
+            latency_sum += latency;
+            latency_max = (latency > latency_max) ? latency : latency_max;
+            if (out != NULL && fwrite(buf, 1, meta.data_size, out) != meta.data_size) {
+                fprintf(stderr, "write frame failed\n");
+                break;
+            }
+        }
+
+        if (now_ns() - period_start >= 1000000000LL) {
+            fprintf(stderr, "%dx%d fps %llu, dropped %llu, latency avg %.3f ms max %.3f ms\n",
+                meta.width, meta.height, (unsigned long long)period_frames,
+                (unsigned long long)period_drops,
+                period_frames ? latency_sum / 1e6 / period_frames : 0.0, latency_max / 1e6);
+            drops += period_drops;
+            period_frames = 0;
+            period_drops = 0;
+            latency_sum = 0;
+            latency_max = 0;
+            period_start = now_ns();
+        }
+    }
+
+    fprintf(stderr, "read %llu frames, dropped %llu\n",
+        (unsigned long long)frames, (unsigned long long)(drops + period_drops));
+
+    shm_frame_ring_close(ring);
+    free(buf);
+    if (out != NULL && out != stdout)
+        fclose(out);
+
+    return (ret == SHM_FRAME_RING_ERROR) ? -1 : 0;
+}
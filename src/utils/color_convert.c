@@ -0,0 +1,473 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils_log.h"
+#include "color_convert.h"
+
+#define COLOR_CONVERT_MAX_THREADS 8
+#define COLOR_CONVERT_DEFAULT_THREADS 4
+// 小于该像素数的图像单线程转换，线程创建的开销比收益大
+#define COLOR_CONVERT_MT_MIN_PIXELS (640 * 480)
+
+enum {
+    CONVERT_SCALE_NONE = 0,     // 输出与输入同尺寸
+    CONVERT_SCALE_HALF = 1,     // 输出为输入的一半，Y 取 2x2 均值，UV 正好一一对应
+    CONVERT_SCALE_NEAREST = 2,  // 其他尺寸，最近邻
+};
+
+/* 定点系数：Y 为 Q7，其余为 Q6，标量与 NEON 路径使用同一套系数，结果逐位一致
+ * R = Y' + rv * V
+ * G = Y' - gu * U - gv * V
+ * B = Y' + bu * U
+ * 其中 Y' = ((Y * ycoef) >> 1) - yoff，U/V 已经减去 128
+ */
+typedef struct {
+    uint8_t ycoef;
+    int16_t yoff;
+    int16_t rv;
+    int16_t gu;
+    int16_t gv;
+    int16_t bu;
+} color_coef_t;
+
+static const color_coef_t s_color_coefs[2][2] = {
+    // BT.601: limited, full
+    { {149, 1192, 102, 25, 52, 129}, {128, 0, 90, 22, 46, 113} },
+    // BT.709: limited, full
+    { {149, 1192, 115, 14, 34, 135}, {128, 0, 101, 12, 30, 119} },
+};
+
+typedef struct {
+    const color_nv12_image_t *src;
+    const color_rgb_image_t *dst;
+    const color_coef_t *coef;
+    const int32_t *xmap;
+    int32_t y_stride;
+    int32_t uv_stride;
+    int32_t dst_stride[3];
+    int32_t scale_mode;
+    int32_t row_start;
+    int32_t row_end;
+} convert_job_t;
+
+static inline uint8_t clamp_u8(int32_t value)
+{
+    return (value < 0) ? 0 : ((value > 255) ? 255 : (uint8_t)value);
+}
+
+static inline void convert_pixel(const color_coef_t *c, int32_t y, int32_t u, int32_t v,
+    uint8_t **out, int32_t x, color_fmt_e format)
+{
+    int32_t yc = ((y * c->ycoef) >> 1) - c->yoff;
+    uint8_t r, g, b;
+
+    u -= 128;
+    v -= 128;
+    r = clamp_u8((yc + c->rv * v + 32) >> 6);
+    g = clamp_u8((yc - c->gu * u - c->gv * v + 32) >> 6);
+    b = clamp_u8((yc + c->bu * u + 32) >> 6);
+
+    switch (format) {
+    case COLOR_FMT_RGBA:
+        out[0][x * 4 + 0] = r;
+        out[0][x * 4 + 1] = g;
+        out[0][x * 4 + 2] = b;
+        out[0][x * 4 + 3] = 255;
+        break;
+    case COLOR_FMT_RGB:
+        out[0][x * 3 + 0] = r;
+        out[0][x * 3 + 1] = g;
+        out[0][x * 3 + 2] = b;
+        break;
+    case COLOR_FMT_BGR:
+        out[0][x * 3 + 0] = b;
+        out[0][x * 3 + 1] = g;
+        out[0][x * 3 + 2] = r;
+        break;
+    case COLOR_FMT_RGB_PLANAR:
+        out[0][x] = r;
+        out[1][x] = g;
+        out[2][x] = b;
+        break;
+    }
+}
+
+#if defined(__ARM_NEON)
+static inline void store_rgb_u8x16(uint8_t **out, int32_t x, color_fmt_e format,
+    uint8x16_t r, uint8x16_t g, uint8x16_t b)
+{
+    uint8x16x4_t rgba;
+    uint8x16x3_t rgb;
+
+    switch (format) {
+    case COLOR_FMT_RGBA:
+        rgba.val[0] = r;
+        rgba.val[1] = g;
+        rgba.val[2] = b;
+        rgba.val[3] = vdupq_n_u8(255);
+        vst4q_u8(out[0] + x * 4, rgba);
+        break;
+    case COLOR_FMT_RGB:
+        rgb.val[0] = r;
+        rgb.val[1] = g;
+        rgb.val[2] = b;
+        vst3q_u8(out[0] + x * 3, rgb);
+        break;
+    case COLOR_FMT_BGR:
+        rgb.val[0] = b;
+        rgb.val[1] = g;
+        rgb.val[2] = r;
+        vst3q_u8(out[0] + x * 3, rgb);
+        break;
+    case COLOR_FMT_RGB_PLANAR:
+        vst1q_u8(out[0] + x, r);
+        vst1q_u8(out[1] + x, g);
+        vst1q_u8(out[2] + x, b);
+        break;
+    }
+}
+
+static inline void store_rgb_u8x8(uint8_t **out, int32_t x, color_fmt_e format,
+    uint8x8_t r, uint8x8_t g, uint8x8_t b)
+{
+    uint8x8x4_t rgba;
+    uint8x8x3_t rgb;
+
+    switch (format) {
+    case COLOR_FMT_RGBA:
+        rgba.val[0] = r;
+        rgba.val[1] = g;
+        rgba.val[2] = b;
+        rgba.val[3] = vdup_n_u8(255);
+        vst4_u8(out[0] + x * 4, rgba);
+        break;
+    case COLOR_FMT_RGB:
+        rgb.val[0] = r;
+        rgb.val[1] = g;
+        rgb.val[2] = b;
+        vst3_u8(out[0] + x * 3, rgb);
+        break;
+    case COLOR_FMT_BGR:
+        rgb.val[0] = b;
+        rgb.val[1] = g;
+        rgb.val[2] = r;
+        vst3_u8(out[0] + x * 3, rgb);
+        break;
+    case COLOR_FMT_RGB_PLANAR:
+        vst1_u8(out[0] + x, r);
+        vst1_u8(out[1] + x, g);
+        vst1_u8(out[2] + x, b);
+        break;
+    }
+}
+
+static inline int16x8_t luma_q6(uint8x8_t y, uint8x8_t ycoef, int16x8_t yoff)
+{
+    return vsubq_s16(vreinterpretq_s16_u16(vshrq_n_u16(vmull_u8(y, ycoef), 1)), yoff);
+}
+
+// 同尺寸转换，每次处理 16 个像素（8 组 UV）
+static int32_t convert_row_1x_neon(const uint8_t *y_row, const uint8_t *uv_row,
+    int32_t width, uint8_t **out, color_fmt_e format, const color_coef_t *c)
+{
+    uint8x8_t ycoef = vdup_n_u8(c->ycoef);
+    uint8x8_t bias = vdup_n_u8(128);
+    int16x8_t yoff = vdupq_n_s16(c->yoff);
+    int32_t x = 0;
+
+    for (x = 0; x + 16 <= width; x += 16) {
+        uint8x16_t y = vld1q_u8(y_row + x);
+        uint8x8x2_t uv = vld2_u8(uv_row + x);
+        int16x8_t u = vreinterpretq_s16_u16(vsubl_u8(uv.val[0], bias));
+        int16x8_t v = vreinterpretq_s16_u16(vsubl_u8(uv.val[1], bias));
+        int16x8x2_t rv = vzipq_s16(vmulq_n_s16(v, c->rv), vmulq_n_s16(v, c->rv));
+        int16x8_t guv_half = vmlaq_n_s16(vmulq_n_s16(u, c->gu), v, c->gv);
+        int16x8x2_t guv = vzipq_s16(guv_half, guv_half);
+        int16x8x2_t bu = vzipq_s16(vmulq_n_s16(u, c->bu), vmulq_n_s16(u, c->bu));
+        int16x8_t yl = luma_q6(vget_low_u8(y), ycoef, yoff);
+        int16x8_t yh = luma_q6(vget_high_u8(y), ycoef, yoff);
+        uint8x16_t r, g, b;
+
+        // 饱和加减后再带舍入右移，溢出的情况本来就会被截断到 255，结果与标量一致
+        r = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(yl, rv.val[0]), 6),
+                        vqrshrun_n_s16(vqaddq_s16(yh, rv.val[1]), 6));
+        g = vcombine_u8(vqrshrun_n_s16(vqsubq_s16(yl, guv.val[0]), 6),
+                        vqrshrun_n_s16(vqsubq_s16(yh, guv.val[1]), 6));
+        b = vcombine_u8(vqrshrun_n_s16(vqaddq_s16(yl, bu.val[0]), 6),
+                        vqrshrun_n_s16(vqaddq_s16(yh, bu.val[1]), 6));
+        store_rgb_u8x16(out, x, format, r, g, b);
+    }
+
+    return x;
+}
+
+// 缩小一半，每次输出 8 个像素，Y 取 2x2 均值
+static int32_t convert_row_2x_neon(const uint8_t *y_row0, const uint8_t *y_row1,
+    const uint8_t *uv_row, int32_t dst_width, uint8_t **out, color_fmt_e format,
+    const color_coef_t *c)
+{
+    uint8x8_t ycoef = vdup_n_u8(c->ycoef);
+    uint8x8_t bias = vdup_n_u8(128);
+    int16x8_t yoff = vdupq_n_s16(c->yoff);
+    int32_t x = 0;
+
+    for (x = 0; x + 8 <= dst_width; x += 8) {
+        uint16x8_t sum = vpaddlq_u8(vld1q_u8(y_row0 + 2 * x));
+        uint8x8x2_t uv = vld2_u8(uv_row + 2 * x);
+        int16x8_t u, v, yv;
+
+        sum = vpadalq_u8(sum, vld1q_u8(y_row1 + 2 * x));
+        yv = luma_q6(vrshrn_n_u16(sum, 2), ycoef, yoff);
+        u = vreinterpretq_s16_u16(vsubl_u8(uv.val[0], bias));
+        v = vreinterpretq_s16_u16(vsubl_u8(uv.val[1], bias));
+
+        store_rgb_u8x8(out, x, format,
+            vqrshrun_n_s16(vqaddq_s16(yv, vmulq_n_s16(v, c->rv)), 6),
+            vqrshrun_n_s16(vqsubq_s16(yv, vmlaq_n_s16(vmulq_n_s16(u, c->gu), v, c->gv)), 6),
+            vqrshrun_n_s16(vqaddq_s16(yv, vmulq_n_s16(u, c->bu)), 6));
+    }
+
+    return x;
+}
+#endif
+
+static void convert_rows(convert_job_t *job)
+{
+    const color_nv12_image_t *src = job->src;
+    const color_rgb_image_t *dst = job->dst;
+    const color_coef_t *c = job->coef;
+    const uint8_t *y_row0 = NULL, *y_row1 = NULL, *uv_row = NULL;
+    uint8_t *out[3] = {NULL, NULL, NULL};
+    int32_t row = 0, x = 0, sx = 0, sy = 0, y = 0;
+
+    for (row = job->row_start; row < job->row_end; row++) {
+        out[0] = dst->data[0] + row * job->dst_stride[0];
+        if (dst->format == COLOR_FMT_RGB_PLANAR) {
+            out[1] = dst->data[1] + row * job->dst_stride[1];
+            out[2] = dst->data[2] + row * job->dst_stride[2];
+        }
+
+        switch (job->scale_mode) {
+        case CONVERT_SCALE_NONE:
+            y_row0 = src->y + row * job->y_stride;
+            uv_row = src->uv + (row / 2) * job->uv_stride;
+            x = 0;
+#if defined(__ARM_NEON)
+            x = convert_row_1x_neon(y_row0, uv_row, dst->width, out, dst->format, c);
+#endif
+            for (; x < dst->width; x++)
+                convert_pixel(c, y_row0[x], uv_row[x & ~1], uv_row[(x & ~1) + 1],
+                    out, x, dst->format);
+            break;
+        case CONVERT_SCALE_HALF:
+            y_row0 = src->y + (row * 2) * job->y_stride;
+            y_row1 = y_row0 + job->y_stride;
+            uv_row = src->uv + row * job->uv_stride;
+            x = 0;
+#if defined(__ARM_NEON)
+            x = convert_row_2x_neon(y_row0, y_row1, uv_row, dst->width, out, dst->format, c);
+#endif
+            for (; x < dst->width; x++) {
+                y = (y_row0[2 * x] + y_row0[2 * x + 1] +
+                     y_row1[2 * x] + y_row1[2 * x + 1] + 2) >> 2;
+                convert_pixel(c, y, uv_row[2 * x], uv_row[2 * x + 1], out, x, dst->format);
+            }
+            break;
+        default:
+            sy = (int32_t)(((int64_t)row * src->height) / dst->height);
+            y_row0 = src->y + sy * job->y_stride;
+            uv_row = src->uv + (sy / 2) * job->uv_stride;
+            for (x = 0; x < dst->width; x++) {
+                sx = job->xmap[x];
+                convert_pixel(c, y_row0[sx], uv_row[sx & ~1], uv_row[(sx & ~1) + 1],
+                    out, x, dst->format);
+            }
+            break;
+        }
+    }
+}
+
+static void *convert_worker(void *arg)
+{
+    convert_rows((convert_job_t *)arg);
+    return NULL;
+}
+
+static int32_t default_stride(color_fmt_e format, int32_t width)
+{
+    switch (format) {
+    case COLOR_FMT_RGBA:
+        return width * 4;
+    case COLOR_FMT_RGB:
+    case COLOR_FMT_BGR:
+        return width * 3;
+    default:
+        return width;
+    }
+}
+
+static int32_t select_thread_num(const color_nv12_image_t *src, const color_rgb_image_t *dst,
+    const color_convert_param_t *param)
+{
+    int32_t threads = (param != NULL) ? param->threads : 0;
+    long cpus = 0;
+
+    if (threads <= 0) {
+        if ((src->width * src->height) < COLOR_CONVERT_MT_MIN_PIXELS)
+            return 1;
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        threads = (cpus > 0) ? (int32_t)cpus : 1;
+        if (threads > COLOR_CONVERT_DEFAULT_THREADS)
+            threads = COLOR_CONVERT_DEFAULT_THREADS;
+    }
+    if (threads > COLOR_CONVERT_MAX_THREADS)
+        threads = COLOR_CONVERT_MAX_THREADS;
+    // 每个线程至少分到 2 行，保证同尺寸转换时每段都从偶数行开始
+    if (threads > dst->height / 2)
+        threads = (dst->height / 2 > 0) ? dst->height / 2 : 1;
+
+    return threads;
+}
+
+void color_nv12_convert_row(const uint8_t *y_row, const uint8_t *uv_row, int32_t width,
+    uint8_t *const out[3], color_fmt_e format, const color_convert_param_t *param)
+{
+    const color_coef_t *c = &s_color_coefs[0][0];
+    uint8_t *rows[3] = {out[0], out[1], out[2]};
+    int32_t x = 0;
+
+    if (param != NULL) {
+        c = &s_color_coefs[(param->std == COLOR_STD_BT709) ? COLOR_STD_BT709 : COLOR_STD_BT601]
+            [(param->range == COLOR_RANGE_FULL) ? COLOR_RANGE_FULL : COLOR_RANGE_LIMITED];
+    }
+
+#if defined(__ARM_NEON)
+    x = convert_row_1x_neon(y_row, uv_row, width, rows, format, c);
+#endif
+    for (; x < width; x++)
+        convert_pixel(c, y_row[x], uv_row[x & ~1], uv_row[(x & ~1) + 1], rows, x, format);
+}
+
+int32_t color_rgb_image_size(color_fmt_e format, int32_t width, int32_t height)
+{
+    switch (format) {
+    case COLOR_FMT_RGBA:
+        return width * height * 4;
+    case COLOR_FMT_RGB:
+    case COLOR_FMT_BGR:
+    case COLOR_FMT_RGB_PLANAR:
+        return width * height * 3;
+    default:
+        return -1;
+    }
+}
+
+int32_t color_nv12_to_rgb(const color_nv12_image_t *src, color_rgb_image_t *dst,
+    const color_convert_param_t *param)
+{
+    convert_job_t jobs[COLOR_CONVERT_MAX_THREADS];
+    pthread_t tids[COLOR_CONVERT_MAX_THREADS];
+    int32_t created[COLOR_CONVERT_MAX_THREADS];
+    int32_t *xmap = NULL;
+    color_std_e std = COLOR_STD_BT601;
+    color_range_e range = COLOR_RANGE_LIMITED;
+    int32_t threads = 1, rows_per_thread = 0, scale_mode = CONVERT_SCALE_NONE;
+    int32_t i = 0;
+
+    if ((src == NULL) || (dst == NULL) || (src->y == NULL) || (src->uv == NULL) ||
+        (dst->data[0] == NULL)) {
+        LOGE_print("invalid color convert image\n");
+        return -1;
+    }
+    if ((src->width <= 0) || (src->height <= 0) || (src->width & 1) || (src->height & 1)) {
+        LOGE_print("invalid nv12 size %dx%d\n", src->width, src->height);
+        return -1;
+    }
+    if ((dst->width <= 0) || (dst->height <= 0) ||
+        (dst->width > src->width) || (dst->height > src->height)) {
+        LOGE_print("invalid output size %dx%d for input %dx%d\n",
+            dst->width, dst->height, src->width, src->height);
+        return -1;
+    }
+    if ((dst->format < COLOR_FMT_RGBA) || (dst->format > COLOR_FMT_RGB_PLANAR) ||
+        ((dst->format == COLOR_FMT_RGB_PLANAR) && ((dst->data[1] == NULL) || (dst->data[2] == NULL)))) {
+        LOGE_print("invalid output format %d\n", dst->format);
+        return -1;
+    }
+
+    if (param != NULL) {
+        std = (param->std == COLOR_STD_BT709) ? COLOR_STD_BT709 : COLOR_STD_BT601;
+        range = (param->range == COLOR_RANGE_FULL) ? COLOR_RANGE_FULL : COLOR_RANGE_LIMITED;
+    }
+
+    if ((dst->width == src->width) && (dst->height == src->height)) {
+        scale_mode = CONVERT_SCALE_NONE;
+    } else if ((dst->width * 2 == src->width) && (dst->height * 2 == src->height)) {
+        scale_mode = CONVERT_SCALE_HALF;
+    } else {
+        scale_mode = CONVERT_SCALE_NEAREST;
+        xmap = (int32_t *)malloc(dst->width * sizeof(int32_t));
+        if (xmap == NULL) {
+            LOGE_print("malloc xmap failed\n");
+            return -1;
+        }
+        for (i = 0; i < dst->width; i++)
+            xmap[i] = (int32_t)(((int64_t)i * src->width) / dst->width);
+    }
+
+    memset(&jobs[0], 0, sizeof(convert_job_t));
+    jobs[0].src = src;
+    jobs[0].dst = dst;
+    jobs[0].coef = &s_color_coefs[std][range];
+    jobs[0].xmap = xmap;
+    jobs[0].scale_mode = scale_mode;
+    jobs[0].y_stride = (src->y_stride > 0) ? src->y_stride : src->width;
+    jobs[0].uv_stride = (src->uv_stride > 0) ? src->uv_stride : jobs[0].y_stride;
+    for (i = 0; i < 3; i++) {
+        jobs[0].dst_stride[i] = (dst->stride[i] > 0) ?
+            dst->stride[i] : default_stride(dst->format, dst->width);
+    }
+
+    threads = select_thread_num(src, dst, param);
+    // 按偶数行切分，同尺寸转换时每段的 UV 行不会跨段
+    rows_per_thread = ((dst->height + threads - 1) / threads + 1) & ~1;
+    for (i = 0; i < threads; i++) {
+        if (i > 0)
+            jobs[i] = jobs[0];
+        jobs[i].row_start = i * rows_per_thread;
+        jobs[i].row_end = jobs[i].row_start + rows_per_thread;
+        if (jobs[i].row_end > dst->height)
+            jobs[i].row_end = dst->height;
+        created[i] = 0;
+    }
+
+    // 第 0 段在调用线程中执行，其余段各起一个线程，创建失败时退回到调用线程执行
+    for (i = 1; i < threads; i++) {
+        if (jobs[i].row_start >= jobs[i].row_end)
+            continue;
+        created[i] = (pthread_create(&tids[i], NULL, convert_worker, &jobs[i]) == 0);
+        if (!created[i])
+            convert_rows(&jobs[i]);
+    }
+    convert_rows(&jobs[0]);
+    for (i = 1; i < threads; i++) {
+        if (created[i])
+            pthread_join(tids[i], NULL);
+    }
+
+    free(xmap);
+
+    return 0;
+}
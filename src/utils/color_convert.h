@@ -0,0 +1,87 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#ifndef COLOR_CONVERT_H_
+#define COLOR_CONVERT_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    COLOR_FMT_RGBA = 0,       // 打包 RGBA8888，alpha 固定为 255
+    COLOR_FMT_RGB = 1,        // 打包 RGB888
+    COLOR_FMT_BGR = 2,        // 打包 BGR888，与 OpenCV 默认格式一致
+    COLOR_FMT_RGB_PLANAR = 3, // R/G/B 三个平面，data[0..2] 分别为三个平面
+} color_fmt_e;
+
+typedef enum {
+    COLOR_STD_BT601 = 0,
+    COLOR_STD_BT709 = 1,
+} color_std_e;
+
+typedef enum {
+    COLOR_RANGE_LIMITED = 0,  // Y: 16~235, UV: 16~240
+    COLOR_RANGE_FULL = 1,     // Y/UV: 0~255
+} color_range_e;
+
+typedef struct {
+    const uint8_t *y;
+    const uint8_t *uv;        // 交织的 UV 平面
+    int32_t width;
+    int32_t height;
+    int32_t y_stride;         // 0 表示等于 width
+    int32_t uv_stride;        // 0 表示等于 y_stride
+} color_nv12_image_t;
+
+typedef struct {
+    uint8_t *data[3];         // 打包格式只使用 data[0]
+    int32_t width;            // 输出尺寸，小于输入时在转换的同时缩放
+    int32_t height;
+    int32_t stride[3];        // 每行字节数，0 表示紧密排列
+    color_fmt_e format;
+} color_rgb_image_t;
+
+typedef struct {
+    color_std_e std;
+    color_range_e range;
+    int32_t threads;          // 行切分的线程数，0 表示按照图像大小和 CPU 核数自动选择
+} color_convert_param_t;
+
+/**
+ * @brief NV12 转 RGBA/RGB/BGR/平面 RGB
+ *        输出尺寸与输入相同或者正好是输入的一半时走 NEON 路径（一半时 Y 做 2x2 均值），
+ *        其他尺寸使用最近邻缩放
+ * @param [in] src     NV12 输入，宽高需要为偶数
+ * @param [out] dst    输出图像，内存由调用者分配
+ * @param [in] param   色彩标准、范围和线程数，为 NULL 时使用 BT.601 limited range、自动线程数
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t color_nv12_to_rgb(const color_nv12_image_t *src, color_rgb_image_t *dst,
+    const color_convert_param_t *param);
+
+/**
+ * @brief 转换一行 NV12，输出宽度与输入相同，供需要逐行处理的模块（例如模型输入预处理）使用
+ * @param [in] uv_row   与 y_row 对应的交织 UV 行
+ * @param [out] out     打包格式时 out[0] 为输出行，COLOR_FMT_RGB_PLANAR 时为 R/G/B 三个平面的行
+ * @param [in] param    色彩标准和范围，为 NULL 时使用 BT.601 limited range
+ */
+void color_nv12_convert_row(const uint8_t *y_row, const uint8_t *uv_row, int32_t width,
+    uint8_t *const out[3], color_fmt_e format, const color_convert_param_t *param);
+
+/**
+ * @brief 计算输出图像按紧密排列时需要的内存大小
+ */
+int32_t color_rgb_image_size(color_fmt_e format, int32_t width, int32_t height);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COLOR_CONVERT_H_
@@ -0,0 +1,482 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils_log.h"
+#include "image_preproc.h"
+
+// 双线性插值权重为 Q7，水平、垂直两次插值后右移 14 位
+#define PREPROC_WEIGHT_BITS 7
+#define PREPROC_WEIGHT_ONE (1 << PREPROC_WEIGHT_BITS)
+
+static int32_t preproc_is_planar(image_preproc_fmt_e format)
+{
+    return (format == PREPROC_FMT_RGB_PLANAR) || (format == PREPROC_FMT_BGR_PLANAR);
+}
+
+static int32_t preproc_default_stride(const image_preproc_config_t *config)
+{
+    if (config->dst_stride > 0)
+        return config->dst_stride;
+    if ((config->format == PREPROC_FMT_RGB) || (config->format == PREPROC_FMT_BGR))
+        return config->dst_width * 3;
+    return config->dst_width;
+}
+
+int32_t image_preproc_output_size(const image_preproc_config_t *config)
+{
+    int32_t stride = 0;
+
+    if (config == NULL)
+        return -1;
+
+    stride = preproc_default_stride(config);
+    switch (config->format) {
+    case PREPROC_FMT_NV12:
+        return stride * config->dst_height * 3 / 2;
+    case PREPROC_FMT_RGB:
+    case PREPROC_FMT_BGR:
+        return stride * config->dst_height;
+    case PREPROC_FMT_RGB_PLANAR:
+    case PREPROC_FMT_BGR_PLANAR:
+        return stride * config->dst_height * 3;
+    default:
+        return -1;
+    }
+}
+
+/* 按像素中心对齐计算 dst_len 个输出位置在 src_len 个源像素上的坐标和权重，
+ * interleave 为 2 时表示交织的 UV，每个输出位置展开成 U、V 两项
+ */
+static int32_t preproc_build_table(image_preproc_table_t *tab, int32_t src_len, int32_t dst_len,
+    int32_t offset, int32_t interleave)
+{
+    double scale = (double)src_len / dst_len, pos = 0;
+    int32_t i = 0, c = 0, p0 = 0, p1 = 0, w = 0;
+
+    tab->count = dst_len * interleave;
+    tab->pos0 = (int32_t *)malloc(tab->count * sizeof(int32_t));
+    tab->pos1 = (int32_t *)malloc(tab->count * sizeof(int32_t));
+    tab->weight = (uint8_t *)malloc(tab->count);
+    if ((tab->pos0 == NULL) || (tab->pos1 == NULL) || (tab->weight == NULL)) {
+        LOGE_print("malloc resize table of %d failed\n", tab->count);
+        return -1;
+    }
+
+    for (i = 0; i < dst_len; i++) {
+        pos = (i + 0.5) * scale - 0.5;
+        pos = (pos > 0) ? pos : 0;
+        p0 = (int32_t)pos;
+        w = (int32_t)((pos - p0) * PREPROC_WEIGHT_ONE + 0.5);
+        if (w >= PREPROC_WEIGHT_ONE) {
+            p0++;
+            w = 0;
+        }
+        p0 = (p0 < src_len - 1) ? p0 : src_len - 1;
+        p1 = (p0 + 1 < src_len) ? p0 + 1 : p0;
+        for (c = 0; c < interleave; c++) {
+            tab->pos0[i * interleave + c] = (offset + p0) * interleave + c;
+            tab->pos1[i * interleave + c] = (offset + p1) * interleave + c;
+            tab->weight[i * interleave + c] = (uint8_t)w;
+        }
+    }
+
+    return 0;
+}
+
+static void preproc_free_table(image_preproc_table_t *tab)
+{
+    free(tab->pos0);
+    free(tab->pos1);
+    free(tab->weight);
+    memset(tab, 0, sizeof(image_preproc_table_t));
+}
+
+static int32_t preproc_init_plane(image_preproc_plane_t *plane, int32_t src_w, int32_t src_h,
+    int32_t dst_w, int32_t dst_h, int32_t off_x, int32_t off_y, int32_t interleave)
+{
+    if ((preproc_build_table(&plane->xtab, src_w, dst_w, off_x, interleave) != 0) ||
+        (preproc_build_table(&plane->ytab, src_h, dst_h, off_y, 1) != 0))
+        return -1;
+
+    plane->rows[0] = (uint16_t *)malloc(plane->xtab.count * sizeof(uint16_t));
+    plane->rows[1] = (uint16_t *)malloc(plane->xtab.count * sizeof(uint16_t));
+    if ((plane->rows[0] == NULL) || (plane->rows[1] == NULL)) {
+        LOGE_print("malloc resize rows failed\n");
+        return -1;
+    }
+    plane->row_index[0] = -1;
+    plane->row_index[1] = -1;
+
+    return 0;
+}
+
+static void preproc_deinit_plane(image_preproc_plane_t *plane)
+{
+    preproc_free_table(&plane->xtab);
+    preproc_free_table(&plane->ytab);
+    free(plane->rows[0]);
+    free(plane->rows[1]);
+    memset(plane, 0, sizeof(image_preproc_plane_t));
+}
+
+void image_preproc_destroy(image_preproc_t *pp)
+{
+    if (pp == NULL)
+        return;
+
+    preproc_deinit_plane(&pp->planes[0]);
+    preproc_deinit_plane(&pp->planes[1]);
+    free(pp->y_row);
+    free(pp->uv_row);
+    free(pp);
+}
+
+image_preproc_t *image_preproc_create(int32_t src_width, int32_t src_height,
+    const image_preproc_config_t *config)
+{
+    image_preproc_t *pp = NULL;
+    image_preproc_config_t cfg;
+    image_preproc_transform_t *t = NULL;
+    double scale = 0;
+    int32_t r = 0, g = 0, b = 0;
+
+    if ((config == NULL) || (src_width <= 0) || (src_height <= 0) ||
+        (src_width & 1) || (src_height & 1)) {
+        LOGE_print("invalid preprocess source %dx%d\n", src_width, src_height);
+        return NULL;
+    }
+    if ((config->dst_width < 2) || (config->dst_height < 2) ||
+        (config->format < PREPROC_FMT_NV12) || (config->format > PREPROC_FMT_BGR_PLANAR) ||
+        ((config->format == PREPROC_FMT_NV12) && ((config->dst_width & 1) || (config->dst_height & 1)))) {
+        LOGE_print("invalid preprocess output %dx%d format %d\n",
+            config->dst_width, config->dst_height, config->format);
+        return NULL;
+    }
+
+    cfg = *config;
+    if ((cfg.crop_w <= 0) || (cfg.crop_h <= 0)) {
+        cfg.crop_x = 0;
+        cfg.crop_y = 0;
+        cfg.crop_w = src_width;
+        cfg.crop_h = src_height;
+    }
+    cfg.crop_x &= ~1;
+    cfg.crop_y &= ~1;
+    cfg.crop_w &= ~1;
+    cfg.crop_h &= ~1;
+    if ((cfg.crop_x < 0) || (cfg.crop_y < 0) || (cfg.crop_w < 2) || (cfg.crop_h < 2) ||
+        (cfg.crop_x + cfg.crop_w > src_width) || (cfg.crop_y + cfg.crop_h > src_height)) {
+        LOGE_print("invalid crop (%d, %d, %d, %d) for source %dx%d\n",
+            config->crop_x, config->crop_y, config->crop_w, config->crop_h, src_width, src_height);
+        return NULL;
+    }
+    cfg.dst_stride = preproc_default_stride(&cfg);
+
+    pp = (image_preproc_t *)calloc(1, sizeof(image_preproc_t));
+    if (pp == NULL) {
+        LOGE_print("malloc preprocess handle failed\n");
+        return NULL;
+    }
+    pp->config = cfg;
+    pp->src_width = src_width;
+    pp->src_height = src_height;
+    pp->uv_row_index = -1;
+
+    // 缩放后的内容区域和填充区域都对齐到偶数，UV 与 Y 的对应关系不会错位
+    t = &pp->transform;
+    if (cfg.keep_ratio) {
+        scale = (double)cfg.dst_width / cfg.crop_w;
+        if ((double)cfg.dst_height / cfg.crop_h < scale)
+            scale = (double)cfg.dst_height / cfg.crop_h;
+        t->resized_w = (int32_t)(cfg.crop_w * scale + 0.5) & ~1;
+        t->resized_h = (int32_t)(cfg.crop_h * scale + 0.5) & ~1;
+    } else {
+        t->resized_w = cfg.dst_width & ~1;
+        t->resized_h = cfg.dst_height & ~1;
+    }
+    t->resized_w = (t->resized_w > 2) ? t->resized_w : 2;
+    t->resized_h = (t->resized_h > 2) ? t->resized_h : 2;
+    if (cfg.keep_ratio && cfg.center) {
+        t->pad_left = ((cfg.dst_width - t->resized_w) / 2) & ~1;
+        t->pad_top = ((cfg.dst_height - t->resized_h) / 2) & ~1;
+    }
+    t->scale_x = (float)t->resized_w / cfg.crop_w;
+    t->scale_y = (float)t->resized_h / cfg.crop_h;
+    t->crop_x = cfg.crop_x;
+    t->crop_y = cfg.crop_y;
+    pp->identity = (t->resized_w == cfg.crop_w) && (t->resized_h == cfg.crop_h);
+
+    if ((preproc_init_plane(&pp->planes[0], cfg.crop_w, cfg.crop_h, t->resized_w, t->resized_h,
+            cfg.crop_x, cfg.crop_y, 1) != 0) ||
+        (preproc_init_plane(&pp->planes[1], cfg.crop_w / 2, cfg.crop_h / 2,
+            t->resized_w / 2, t->resized_h / 2, cfg.crop_x / 2, cfg.crop_y / 2, 2) != 0)) {
+        image_preproc_destroy(pp);
+        return NULL;
+    }
+
+    if (cfg.format != PREPROC_FMT_NV12) {
+        pp->y_row = (uint8_t *)malloc(t->resized_w);
+        pp->uv_row = (uint8_t *)malloc(t->resized_w);
+        if ((pp->y_row == NULL) || (pp->uv_row == NULL)) {
+            LOGE_print("malloc preprocess rows failed\n");
+            image_preproc_destroy(pp);
+            return NULL;
+        }
+    }
+
+    // NV12 输出的填充色按 BT.601 limited range 换算
+    r = cfg.pad_rgb[0];
+    g = cfg.pad_rgb[1];
+    b = cfg.pad_rgb[2];
+    pp->pad_yuv[0] = (uint8_t)(((66 * r + 129 * g + 25 * b + 128) >> 8) + 16);
+    pp->pad_yuv[1] = (uint8_t)(((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128);
+    pp->pad_yuv[2] = (uint8_t)(((112 * r - 94 * g - 18 * b + 128) >> 8) + 128);
+
+    return pp;
+}
+
+void image_preproc_get_transform(const image_preproc_t *pp, image_preproc_transform_t *transform)
+{
+    if ((pp != NULL) && (transform != NULL))
+        *transform = pp->transform;
+}
+
+void image_preproc_to_source(const image_preproc_transform_t *transform, float *x, float *y)
+{
+    *x = (*x - transform->pad_left) / transform->scale_x + transform->crop_x;
+    *y = (*y - transform->pad_top) / transform->scale_y + transform->crop_y;
+}
+
+// 水平插值一行源数据，结果为 Q7，最近两行留在缓存里，放大时相邻输出行可以复用
+static const uint16_t *preproc_hrow(image_preproc_plane_t *plane, const uint8_t *base,
+    int32_t stride, int32_t row, int32_t keep)
+{
+    const image_preproc_table_t *xt = &plane->xtab;
+    const uint8_t *src = base + row * stride;
+    uint16_t *out = NULL;
+    int32_t slot = 0, i = 0, w = 0;
+
+    if (plane->row_index[0] == row)
+        return plane->rows[0];
+    if (plane->row_index[1] == row)
+        return plane->rows[1];
+
+    slot = (plane->row_index[0] == keep) ? 1 : 0;
+    out = plane->rows[slot];
+    for (i = 0; i < xt->count; i++) {
+        w = xt->weight[i];
+        out[i] = (uint16_t)(src[xt->pos0[i]] * (PREPROC_WEIGHT_ONE - w) + src[xt->pos1[i]] * w);
+    }
+    plane->row_index[slot] = row;
+
+    return out;
+}
+
+static void preproc_vblend(const uint16_t *r0, const uint16_t *r1, int32_t w,
+    uint8_t *out, int32_t count)
+{
+    int32_t i = 0;
+
+#if defined(__ARM_NEON)
+    uint16_t w0 = (uint16_t)(PREPROC_WEIGHT_ONE - w), w1 = (uint16_t)w;
+
+    for (; i + 8 <= count; i += 8) {
+        uint16x8_t a = vld1q_u16(r0 + i);
+        uint16x8_t b = vld1q_u16(r1 + i);
+        uint32x4_t lo = vmlal_n_u16(vmull_n_u16(vget_low_u16(a), w0), vget_low_u16(b), w1);
+        uint32x4_t hi = vmlal_n_u16(vmull_n_u16(vget_high_u16(a), w0), vget_high_u16(b), w1);
+
+        vst1_u8(out + i, vmovn_u16(vcombine_u16(vrshrn_n_u32(lo, 14), vrshrn_n_u32(hi, 14))));
+    }
+#endif
+    for (; i < count; i++)
+        out[i] = (uint8_t)((r0[i] * (PREPROC_WEIGHT_ONE - w) + r1[i] * w + (1 << 13)) >> 14);
+}
+
+// 输出缩放后内容区域的第 index 行
+static void preproc_resize_row(const image_preproc_t *pp, image_preproc_plane_t *plane,
+    const uint8_t *base, int32_t stride, int32_t index, uint8_t *out)
+{
+    const image_preproc_table_t *yt = &plane->ytab;
+    const uint16_t *r0 = NULL, *r1 = NULL;
+    int32_t w = yt->weight[index];
+
+    if (pp->identity) {
+        memcpy(out, base + yt->pos0[index] * stride + plane->xtab.pos0[0], plane->xtab.count);
+        return;
+    }
+
+    r0 = preproc_hrow(plane, base, stride, yt->pos0[index], -1);
+    r1 = (w == 0) ? r0 : preproc_hrow(plane, base, stride, yt->pos1[index], yt->pos0[index]);
+    preproc_vblend(r0, r1, w, out, plane->xtab.count);
+}
+
+static void preproc_fill_pairs(uint8_t *dst, int32_t pairs, uint8_t u, uint8_t v)
+{
+    int32_t i = 0;
+
+    for (i = 0; i < pairs; i++) {
+        dst[2 * i] = u;
+        dst[2 * i + 1] = v;
+    }
+}
+
+static void preproc_run_nv12(image_preproc_t *pp, const color_nv12_image_t *src,
+    int32_t y_stride, int32_t uv_stride, uint8_t *dst_y, uint8_t *dst_uv)
+{
+    const image_preproc_config_t *cfg = &pp->config;
+    const image_preproc_transform_t *t = &pp->transform;
+    int32_t right = cfg->dst_width - t->pad_left - t->resized_w;
+    int32_t row = 0;
+    uint8_t *out = NULL;
+
+    for (row = 0; row < cfg->dst_height; row++) {
+        out = dst_y + row * cfg->dst_stride;
+        if ((row < t->pad_top) || (row >= t->pad_top + t->resized_h)) {
+            memset(out, pp->pad_yuv[0], cfg->dst_width);
+            continue;
+        }
+        memset(out, pp->pad_yuv[0], t->pad_left);
+        preproc_resize_row(pp, &pp->planes[0], src->y, y_stride, row - t->pad_top,
+            out + t->pad_left);
+        memset(out + t->pad_left + t->resized_w, pp->pad_yuv[0], right);
+    }
+
+    for (row = 0; row < cfg->dst_height / 2; row++) {
+        out = dst_uv + row * cfg->dst_stride;
+        if ((row < t->pad_top / 2) || (row >= (t->pad_top + t->resized_h) / 2)) {
+            preproc_fill_pairs(out, cfg->dst_width / 2, pp->pad_yuv[1], pp->pad_yuv[2]);
+            continue;
+        }
+        preproc_fill_pairs(out, t->pad_left / 2, pp->pad_yuv[1], pp->pad_yuv[2]);
+        preproc_resize_row(pp, &pp->planes[1], src->uv, uv_stride, row - t->pad_top / 2,
+            out + t->pad_left);
+        preproc_fill_pairs(out + t->pad_left + t->resized_w, right / 2,
+            pp->pad_yuv[1], pp->pad_yuv[2]);
+    }
+}
+
+// 打包格式的填充：pixel 为输出顺序的三个分量
+static void preproc_fill_packed(uint8_t *dst, int32_t count, const uint8_t pixel[3])
+{
+    int32_t i = 0;
+
+    for (i = 0; i < count; i++) {
+        dst[3 * i] = pixel[0];
+        dst[3 * i + 1] = pixel[1];
+        dst[3 * i + 2] = pixel[2];
+    }
+}
+
+static void preproc_run_rgb(image_preproc_t *pp, const color_nv12_image_t *src,
+    int32_t y_stride, int32_t uv_stride, uint8_t *const planes[3])
+{
+    const image_preproc_config_t *cfg = &pp->config;
+    const image_preproc_transform_t *t = &pp->transform;
+    int32_t planar = preproc_is_planar(cfg->format);
+    int32_t bgr = (cfg->format == PREPROC_FMT_BGR) || (cfg->format == PREPROC_FMT_BGR_PLANAR);
+    int32_t bpp = planar ? 1 : 3;
+    int32_t right = cfg->dst_width - t->pad_left - t->resized_w;
+    int32_t row = 0, i = 0, ch = 0, index = 0;
+    color_convert_param_t param;
+    uint8_t pixel[3], *out[3] = {NULL, NULL, NULL}, *rows[3] = {NULL, NULL, NULL};
+
+    memset(&param, 0, sizeof(param));
+    param.std = cfg->std;
+    param.range = cfg->range;
+    for (i = 0; i < 3; i++)
+        pixel[i] = cfg->pad_rgb[bgr ? 2 - i : i];
+
+    pp->uv_row_index = -1;
+    for (row = 0; row < cfg->dst_height; row++) {
+        for (i = 0; i < (planar ? 3 : 1); i++)
+            out[i] = planes[i] + row * cfg->dst_stride;
+
+        if ((row < t->pad_top) || (row >= t->pad_top + t->resized_h)) {
+            if (planar) {
+                for (i = 0; i < 3; i++)
+                    memset(out[i], pixel[i], cfg->dst_width);
+            } else {
+                preproc_fill_packed(out[0], cfg->dst_width, pixel);
+            }
+            continue;
+        }
+
+        index = row - t->pad_top;
+        preproc_resize_row(pp, &pp->planes[0], src->y, y_stride, index, pp->y_row);
+        if (pp->uv_row_index != index / 2) {
+            preproc_resize_row(pp, &pp->planes[1], src->uv, uv_stride, index / 2, pp->uv_row);
+            pp->uv_row_index = index / 2;
+        }
+
+        if (planar) {
+            for (i = 0; i < 3; i++) {
+                memset(out[i], pixel[i], t->pad_left);
+                memset(out[i] + t->pad_left + t->resized_w, pixel[i], right);
+            }
+            // BGR 平面只需要交换 R、B 两个平面的指针
+            for (i = 0; i < 3; i++) {
+                ch = bgr ? 2 - i : i;
+                rows[i] = out[ch] + t->pad_left;
+            }
+            color_nv12_convert_row(pp->y_row, pp->uv_row, t->resized_w, rows,
+                COLOR_FMT_RGB_PLANAR, &param);
+        } else {
+            preproc_fill_packed(out[0], t->pad_left, pixel);
+            preproc_fill_packed(out[0] + (t->pad_left + t->resized_w) * bpp, right, pixel);
+            rows[0] = out[0] + t->pad_left * bpp;
+            color_nv12_convert_row(pp->y_row, pp->uv_row, t->resized_w, rows,
+                bgr ? COLOR_FMT_BGR : COLOR_FMT_RGB, &param);
+        }
+    }
+}
+
+int32_t image_preproc_run(image_preproc_t *pp, const color_nv12_image_t *src,
+    uint8_t *const dst[3])
+{
+    const image_preproc_config_t *cfg = NULL;
+    uint8_t *planes[3] = {NULL, NULL, NULL};
+    int32_t y_stride = 0, uv_stride = 0, plane_size = 0, i = 0;
+
+    if ((pp == NULL) || (src == NULL) || (src->y == NULL) || (src->uv == NULL) ||
+        (dst == NULL) || (dst[0] == NULL)) {
+        LOGE_print("invalid preprocess parameter\n");
+        return -1;
+    }
+    cfg = &pp->config;
+    if ((src->width != pp->src_width) || (src->height != pp->src_height)) {
+        LOGE_print("source size %dx%d mismatch preprocess handle %dx%d\n",
+            src->width, src->height, pp->src_width, pp->src_height);
+        return -1;
+    }
+
+    y_stride = (src->y_stride > 0) ? src->y_stride : src->width;
+    uv_stride = (src->uv_stride > 0) ? src->uv_stride : y_stride;
+    // 每帧都是新的数据，缓存的水平插值结果作废
+    for (i = 0; i < 2; i++) {
+        pp->planes[i].row_index[0] = -1;
+        pp->planes[i].row_index[1] = -1;
+    }
+
+    plane_size = cfg->dst_stride * cfg->dst_height;
+    planes[0] = dst[0];
+    for (i = 1; i < 3; i++)
+        planes[i] = (dst[i] != NULL) ? dst[i] : planes[i - 1] + plane_size;
+
+    if (cfg->format == PREPROC_FMT_NV12)
+        preproc_run_nv12(pp, src, y_stride, uv_stride, planes[0], planes[1]);
+    else
+        preproc_run_rgb(pp, src, y_stride, uv_stride, planes);
+
+    return 0;
+}
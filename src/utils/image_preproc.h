@@ -0,0 +1,136 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#ifndef IMAGE_PREPROC_H_
+#define IMAGE_PREPROC_H_
+
+#include <stdint.h>
+
+#include "color_convert.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 模型输入预处理：任意尺寸的 NV12 图像经过裁剪、缩放、letterbox 填充和可选的颜色转换，
+ * 直接写入模型输入 tensor 的内存。
+ *
+ * 缩放使用双线性插值，源坐标和 Q7 权重在 image_preproc_create 时按源尺寸和配置算好，
+ * 之后每帧只做查表、水平插值和 NEON 垂直插值；输出为 RGB/BGR 时在每一行缩放完成后
+ * 立即转换，不产生中间图像。
+ */
+
+typedef enum {
+    PREPROC_FMT_NV12 = 0,           // Y 平面 + 交织的 UV 平面
+    PREPROC_FMT_RGB = 1,            // NHWC
+    PREPROC_FMT_BGR = 2,            // NHWC
+    PREPROC_FMT_RGB_PLANAR = 3,     // NCHW
+    PREPROC_FMT_BGR_PLANAR = 4,     // NCHW
+} image_preproc_fmt_e;
+
+typedef struct {
+    int32_t crop_x;                 // 源图像上的裁剪区域，crop_w/crop_h 为 0 时使用整幅图像
+    int32_t crop_y;                 // NV12 的 UV 按 2x2 采样，裁剪区域会对齐到偶数
+    int32_t crop_w;
+    int32_t crop_h;
+    int32_t dst_width;              // 模型输入尺寸
+    int32_t dst_height;
+    int32_t dst_stride;             // 输出每行字节数，0 表示紧密排列
+    image_preproc_fmt_e format;
+    int32_t keep_ratio;             // 1: 保持宽高比缩放，其余部分填充（letterbox）；0: 拉伸
+    int32_t center;                 // keep_ratio 时 1 表示居中，0 表示靠左上角
+    uint8_t pad_rgb[3];             // 填充颜色，YOLO 系列通常为 114
+    color_std_e std;                // 输出 RGB/BGR 时使用的色彩标准和范围
+    color_range_e range;
+} image_preproc_config_t;
+
+/* 模型坐标与源图像坐标的换算：
+ *   x_model = (x_src - crop_x) * scale_x + pad_left
+ *   x_src = (x_model - pad_left) / scale_x + crop_x
+ */
+typedef struct {
+    float scale_x;
+    float scale_y;
+    int32_t pad_left;
+    int32_t pad_top;
+    int32_t resized_w;              // 图像内容在模型输入中占的区域
+    int32_t resized_h;
+    int32_t crop_x;
+    int32_t crop_y;
+} image_preproc_transform_t;
+
+// 一个方向上的缩放表：每个输出位置对应的两个源坐标和第二个源的 Q7 权重
+typedef struct {
+    int32_t *pos0;
+    int32_t *pos1;
+    uint8_t *weight;
+    int32_t count;
+} image_preproc_table_t;
+
+// 一个平面（Y 或者交织的 UV）的缩放表和最近两行水平插值的结果
+typedef struct {
+    image_preproc_table_t xtab;
+    image_preproc_table_t ytab;
+    uint16_t *rows[2];
+    int32_t row_index[2];
+} image_preproc_plane_t;
+
+typedef struct {
+    image_preproc_config_t config;
+    image_preproc_transform_t transform;
+    int32_t src_width;
+    int32_t src_height;
+    int32_t identity;               // 不需要缩放，直接拷贝
+    image_preproc_plane_t planes[2];
+    uint8_t *y_row;                 // 输出 RGB/BGR 时缩放后的一行 Y 和 UV
+    uint8_t *uv_row;
+    int32_t uv_row_index;
+    uint8_t pad_yuv[3];
+} image_preproc_t;
+
+/**
+ * @brief 按源图像尺寸和配置创建预处理句柄，预先计算缩放表，之后每帧复用
+ * @param [in] src_width   源 NV12 图像宽度，需要为偶数
+ * @param [in] src_height  源 NV12 图像高度，需要为偶数
+ *
+ * @return 成功返回句柄，失败返回 NULL
+ */
+image_preproc_t *image_preproc_create(int32_t src_width, int32_t src_height,
+    const image_preproc_config_t *config);
+
+void image_preproc_destroy(image_preproc_t *pp);
+
+/**
+ * @brief 处理一帧
+ * @param [in] src    NV12 输入，尺寸需要与创建时一致
+ * @param [out] dst   输出内存：NV12 时 dst[0] 为 Y、dst[1] 为 UV；平面格式时为三个平面；
+ *                    打包格式只使用 dst[0]。dst[1]、dst[2] 为 NULL 时紧跟在前一个平面之后
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t image_preproc_run(image_preproc_t *pp, const color_nv12_image_t *src,
+    uint8_t *const dst[3]);
+
+/**
+ * @brief 获取坐标换算参数，后处理用它把模型输出的框还原到源图像上
+ */
+void image_preproc_get_transform(const image_preproc_t *pp, image_preproc_transform_t *transform);
+
+/**
+ * @brief 把模型输入上的坐标还原到源图像上
+ */
+void image_preproc_to_source(const image_preproc_transform_t *transform, float *x, float *y);
+
+/**
+ * @brief 输出需要的内存大小（按 dst_stride 计算）
+ */
+int32_t image_preproc_output_size(const image_preproc_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMAGE_PREPROC_H_
@@ -0,0 +1,174 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "latency_stats.h"
+
+int64_t latency_stats_now_us(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+void latency_stats_init(latency_stats_t *stats, float alpha)
+{
+    memset(stats, 0, sizeof(*stats));
+    stats->alpha = alpha;
+}
+
+/*
+ * 把序号为 seq 的新样本加入单调队列：先移出已经滑出窗口的队首，
+ * 再从队尾移出不可能再成为最值的样本。sign 为 1 时维护最小值，-1 时维护最大值
+ */
+static void latency_queue_push(latency_stats_queue_t *queue, const int32_t *samples,
+    int64_t seq, int32_t value, int32_t sign)
+{
+    while (queue->count > 0 && queue->seq[queue->head] <= seq - LATENCY_STATS_WINDOW) {
+        queue->head = (queue->head + 1) % LATENCY_STATS_WINDOW;
+        queue->count--;
+    }
+    while (queue->count > 0) {
+        int32_t tail = (queue->head + queue->count - 1) % LATENCY_STATS_WINDOW;
+        if (sign * samples[queue->seq[tail] % LATENCY_STATS_WINDOW] < sign * value) {
+            break;
+        }
+        queue->count--;
+    }
+    queue->seq[(queue->head + queue->count) % LATENCY_STATS_WINDOW] = seq;
+    queue->count++;
+}
+
+void latency_stats_add(latency_stats_t *stats, int32_t value_us)
+{
+    if (value_us < 0) {
+        value_us = 0;
+    }
+
+    // 入队时只读取还在窗口内的样本，先入队再覆盖最老的样本
+    latency_queue_push(&stats->min_queue, stats->samples, stats->total, value_us, 1);
+    latency_queue_push(&stats->max_queue, stats->samples, stats->total, value_us, -1);
+    stats->samples[stats->pos] = value_us;
+    stats->pos = (stats->pos + 1) % LATENCY_STATS_WINDOW;
+    if (stats->count < LATENCY_STATS_WINDOW) {
+        stats->count++;
+    }
+
+    // 第一个样本直接作为初值，避免从 0 开始爬升
+    if (stats->total == 0) {
+        stats->ewma = (float)value_us;
+    } else {
+        stats->ewma += stats->alpha * ((float)value_us - stats->ewma);
+    }
+    stats->total++;
+}
+
+static int compare_int32(const void *a, const void *b)
+{
+    int32_t x = *(const int32_t *)a;
+    int32_t y = *(const int32_t *)b;
+
+    return (x > y) - (x < y);
+}
+
+int32_t latency_stats_percentile(const latency_stats_t *stats, float percent)
+{
+    int32_t sorted[LATENCY_STATS_WINDOW];
+    int32_t index;
+
+    if (stats->count == 0) {
+        return 0;
+    }
+    if (percent <= 0.0f) {
+        return latency_stats_min(stats);
+    }
+    if (percent >= 100.0f) {
+        return latency_stats_max(stats);
+    }
+
+    memcpy(sorted, stats->samples, stats->count * sizeof(int32_t));
+    qsort(sorted, stats->count, sizeof(int32_t), compare_int32);
+
+    // nearest-rank
+    index = (int32_t)(percent * stats->count / 100.0f + 0.999f) - 1;
+    if (index < 0) {
+        index = 0;
+    }
+    return sorted[index];
+}
+
+int32_t latency_stats_min(const latency_stats_t *stats)
+{
+    if (stats->min_queue.count == 0) {
+        return 0;
+    }
+    return stats->samples[stats->min_queue.seq[stats->min_queue.head] % LATENCY_STATS_WINDOW];
+}
+
+int32_t latency_stats_max(const latency_stats_t *stats)
+{
+    if (stats->max_queue.count == 0) {
+        return 0;
+    }
+    return stats->samples[stats->max_queue.seq[stats->max_queue.head] % LATENCY_STATS_WINDOW];
+}
+
+void load_stats_init(load_stats_t *load, float alpha)
+{
+    memset(load, 0, sizeof(*load));
+    load->alpha = alpha;
+    load->period_start_us = latency_stats_now_us();
+}
+
+void load_stats_add(load_stats_t *load, int64_t start_us, int64_t end_us)
+{
+    int64_t elapsed;
+
+    // 和上一个任务重叠的部分已经统计过
+    if (start_us < load->busy_end_us) {
+        start_us = load->busy_end_us;
+    }
+    if (start_us < load->period_start_us) {
+        start_us = load->period_start_us;
+    }
+    if (end_us > start_us) {
+        load->period_busy_us += end_us - start_us;
+    }
+    if (end_us > load->busy_end_us) {
+        load->busy_end_us = end_us;
+    }
+    load->tasks++;
+
+    elapsed = end_us - load->period_start_us;
+    if (elapsed >= LOAD_STATS_PERIOD_US) {
+        float usage = (float)load->period_busy_us / (float)elapsed;
+        if (usage > 1.0f) {
+            usage = 1.0f;
+        }
+        load->utilization += load->alpha * (usage - load->utilization);
+        load->period_start_us = end_us;
+        load->period_busy_us = 0;
+    }
+}
+
+float load_stats_utilization(const load_stats_t *load, int64_t now_us)
+{
+    int64_t elapsed = now_us - load->period_start_us;
+    float usage;
+
+    if (elapsed < LOAD_STATS_PERIOD_US) {
+        return load->utilization;
+    }
+
+    usage = (float)load->period_busy_us / (float)elapsed;
+    if (usage > 1.0f) {
+        usage = 1.0f;
+    }
+    return load->utilization + load->alpha * (usage - load->utilization);
+}
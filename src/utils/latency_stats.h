@@ -0,0 +1,93 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#ifndef LATENCY_STATS_H_
+#define LATENCY_STATS_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 推理耗时统计
+ *
+ * latency_stats_t 保存最近 LATENCY_STATS_WINDOW 个样本（微秒）和一个 EWMA，
+ * 百分位数在查询时对窗口排序得到。窗口内的最小、最大值用单调队列维护，
+ * 添加样本和查询最小、最大值都是均摊 O(1)，可以在每次推理时使用。
+ * load_stats_t 按 LOAD_STATS_PERIOD_US 的周期统计一个 BPU 核的忙碌时间占比，
+ * 各个周期的结果再做 EWMA，重叠的任务区间只计算一次。
+ *
+ * 两者都不加锁，多线程使用时由调用者加锁。
+ */
+
+#define LATENCY_STATS_WINDOW 256
+#define LOAD_STATS_PERIOD_US 200000
+
+// 窗口内样本序号的单调队列，队首是窗口内的最小（或最大）值
+typedef struct {
+    int64_t seq[LATENCY_STATS_WINDOW];
+    int32_t head;
+    int32_t count;
+} latency_stats_queue_t;
+
+typedef struct {
+    int32_t samples[LATENCY_STATS_WINDOW];
+    int32_t pos;
+    int32_t count;                  // 窗口中的样本数
+    int64_t total;                  // 累计的样本数
+    float alpha;                    // EWMA 系数，越大越偏向最新的样本
+    float ewma;
+    latency_stats_queue_t min_queue;
+    latency_stats_queue_t max_queue;
+} latency_stats_t;
+
+typedef struct {
+    int64_t period_start_us;
+    int64_t period_busy_us;
+    int64_t busy_end_us;            // 已经统计过的忙碌区间的结束时间
+    int64_t tasks;
+    float alpha;
+    float utilization;              // 0 ~ 1
+} load_stats_t;
+
+int64_t latency_stats_now_us(void);
+
+void latency_stats_init(latency_stats_t *stats, float alpha);
+void latency_stats_add(latency_stats_t *stats, int32_t value_us);
+
+/**
+ * @brief 窗口内样本的百分位数，0 和 100 不排序，直接返回最小、最大值
+ * @param [in] percent   0 ~ 100，0 为最小值
+ *
+ * @return 没有样本时返回 0
+ */
+int32_t latency_stats_percentile(const latency_stats_t *stats, float percent);
+
+/**
+ * @brief 窗口内的最小、最大值，O(1)
+ *
+ * @return 没有样本时返回 0
+ */
+int32_t latency_stats_min(const latency_stats_t *stats);
+int32_t latency_stats_max(const latency_stats_t *stats);
+
+void load_stats_init(load_stats_t *load, float alpha);
+
+/**
+ * @brief 记录一个任务在 BPU 上执行的区间
+ */
+void load_stats_add(load_stats_t *load, int64_t start_us, int64_t end_us);
+
+/**
+ * @brief 当前的利用率估计，最近一个周期内没有任务完成时也会把空闲时间计算进去
+ */
+float load_stats_utilization(const load_stats_t *load, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_STATS_H_
@@ -9,6 +9,10 @@
 #include <stdint.h>
 #include <pthread.h>
 
+#ifdef __cplusplus
+extern "C" {
+#endif
+
 typedef enum {
     E_QUEUE_OK,
     E_QUEUE_ERROR_FAILED,
@@ -36,4 +40,8 @@ teQueueStatus mQueueDequeue(tsQueue *psQueue, void **ppvData);
 teQueueStatus mQueueDequeueTimed(tsQueue *psQueue, uint32_t u32WaitTimeMil, void **ppvData);
 int mQueueIsFull(tsQueue *psQueue);
 
+#ifdef __cplusplus
+}
+#endif
+
 #endif // MQUEUE_H_
\ No newline at end of file
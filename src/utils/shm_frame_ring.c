@@ -0,0 +1,371 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <time.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "utils_log.h"
+#include "shm_frame_ring.h"
+
+#define SHM_FRAME_RING_ALIGN 64
+#define SHM_FRAME_READ_POLL_US 1000
+#define SHM_FRAME_READ_RETRY 4
+#define SHM_FRAME_ALIVE_CHECK_NS (100 * 1000000LL)
+
+#define SHM_ALIGN_UP(x, a) (((x) + (a) - 1) & ~((uint64_t)(a) - 1))
+
+static int64_t shm_now_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void shm_make_name(char *dst, size_t size, const char *name)
+{
+    if (name == NULL || name[0] == '\0')
+        name = SHM_FRAME_DEFAULT_NAME;
+    snprintf(dst, size, "%s%s", (name[0] == '/') ? "" : "/", name);
+}
+
+static shm_frame_slot_t *shm_get_slot(shm_frame_ring_t *ring, uint64_t frame_seq)
+{
+    shm_frame_ring_header_t *header = ring->header;
+    uint64_t index = (frame_seq - 1) % header->slot_count;
+
+    return (shm_frame_slot_t *)((uint8_t *)header +
+        SHM_ALIGN_UP(sizeof(shm_frame_ring_header_t), SHM_FRAME_RING_ALIGN) +
+        index * header->slot_stride);
+}
+
+static uint8_t *shm_slot_data(shm_frame_slot_t *slot)
+{
+    return (uint8_t *)slot + SHM_ALIGN_UP(sizeof(shm_frame_slot_t), SHM_FRAME_RING_ALIGN);
+}
+
+shm_frame_ring_t *shm_frame_ring_create(const char *name, uint32_t slot_count, uint32_t slot_size)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_ring_header_t *header = NULL;
+    uint64_t slot_stride = 0;
+    size_t map_size = 0;
+
+    if (slot_count < 2 || slot_size == 0) {
+        LOGE_print("invalid shm ring slot_count:%u slot_size:%u\n", slot_count, slot_size);
+        return NULL;
+    }
+
+    ring = (shm_frame_ring_t *)calloc(1, sizeof(shm_frame_ring_t));
+    if (ring == NULL)
+        return NULL;
+
+    shm_make_name(ring->name, sizeof(ring->name), name);
+    slot_stride = SHM_ALIGN_UP(sizeof(shm_frame_slot_t), SHM_FRAME_RING_ALIGN) +
+        SHM_ALIGN_UP(slot_size, SHM_FRAME_RING_ALIGN);
+    map_size = SHM_ALIGN_UP(sizeof(shm_frame_ring_header_t), SHM_FRAME_RING_ALIGN) +
+        slot_stride * slot_count;
+
+    // 先删除旧对象，已经挂载的读者继续持有旧映射，会在旧对象上看到 closed 或者不再更新
+    (void)shm_unlink(ring->name);
+    ring->fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR, 0644);
+    if (ring->fd < 0) {
+        LOGE_print("shm_open %s failed: %s\n", ring->name, strerror(errno));
+        goto err;
+    }
+    if (ftruncate(ring->fd, (off_t)map_size) != 0) {
+        LOGE_print("ftruncate %s to %zu failed: %s\n", ring->name, map_size, strerror(errno));
+        goto err;
+    }
+
+    header = (shm_frame_ring_header_t *)mmap(NULL, map_size, PROT_READ | PROT_WRITE,
+        MAP_SHARED, ring->fd, 0);
+    if (header == MAP_FAILED) {
+        LOGE_print("mmap %s failed: %s\n", ring->name, strerror(errno));
+        goto err;
+    }
+
+    // ftruncate 得到的内存已经清零，所有槽位序号为 0（稳定且没有数据）
+    header->version = SHM_FRAME_RING_VERSION;
+    header->slot_count = slot_count;
+    header->slot_size = slot_size;
+    header->slot_stride = slot_stride;
+    header->session = (uint64_t)shm_now_ns();
+    header->producer_pid = getpid();
+    // magic 最后写入，读者看到 magic 时其余字段已经有效
+    __atomic_store_n(&header->magic, SHM_FRAME_RING_MAGIC, __ATOMIC_RELEASE);
+
+    ring->is_producer = 1;
+    ring->map_size = map_size;
+    ring->header = header;
+    ring->next_seq = 1;
+
+    return ring;
+
+err:
+    if (ring->fd >= 0) {
+        close(ring->fd);
+        (void)shm_unlink(ring->name);
+    }
+    free(ring);
+    return NULL;
+}
+
+shm_frame_ring_t *shm_frame_ring_open(const char *name)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_ring_header_t *header = NULL;
+    struct stat st;
+
+    ring = (shm_frame_ring_t *)calloc(1, sizeof(shm_frame_ring_t));
+    if (ring == NULL)
+        return NULL;
+
+    shm_make_name(ring->name, sizeof(ring->name), name);
+    ring->fd = shm_open(ring->name, O_RDONLY, 0);
+    if (ring->fd < 0) {
+        // 写者还没有启动是正常情况，由调用者决定是否重试
+        LOGD_print("shm_open %s failed: %s\n", ring->name, strerror(errno));
+        goto err;
+    }
+    if (fstat(ring->fd, &st) != 0 || (size_t)st.st_size < sizeof(shm_frame_ring_header_t))
+        goto err;
+
+    header = (shm_frame_ring_header_t *)mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, ring->fd, 0);
+    if (header == MAP_FAILED) {
+        LOGE_print("mmap %s failed: %s\n", ring->name, strerror(errno));
+        goto err;
+    }
+    ring->header = header;
+    ring->map_size = st.st_size;
+
+    if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) != SHM_FRAME_RING_MAGIC ||
+        header->version != SHM_FRAME_RING_VERSION ||
+        SHM_ALIGN_UP(sizeof(shm_frame_ring_header_t), SHM_FRAME_RING_ALIGN) +
+            header->slot_stride * header->slot_count > ring->map_size) {
+        LOGE_print("shm %s is not a frame ring or version mismatch\n", ring->name);
+        goto err;
+    }
+    ring->session = header->session;
+
+    return ring;
+
+err:
+    if (ring->header != NULL)
+        munmap(ring->header, ring->map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    free(ring);
+    return NULL;
+}
+
+void shm_frame_ring_close(shm_frame_ring_t *ring)
+{
+    if (ring == NULL)
+        return;
+
+    if (ring->is_producer && ring->header != NULL) {
+        __atomic_store_n(&ring->header->closed, 1, __ATOMIC_RELEASE);
+        (void)shm_unlink(ring->name);
+    }
+    if (ring->header != NULL)
+        munmap(ring->header, ring->map_size);
+    if (ring->fd >= 0)
+        close(ring->fd);
+    free(ring);
+}
+
+uint8_t *shm_frame_ring_begin(shm_frame_ring_t *ring, uint32_t *capacity)
+{
+    shm_frame_slot_t *slot = NULL;
+
+    if (ring == NULL || !ring->is_producer) {
+        LOGE_print("shm ring is not opened for writing\n");
+        return NULL;
+    }
+
+    // 序号置为奇数后才开始改写数据，读者看到奇数或者序号变化就会丢弃读到的内容
+    slot = shm_get_slot(ring, ring->next_seq);
+    __atomic_store_n(&slot->seq, ring->next_seq * 2 - 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if (capacity != NULL)
+        *capacity = ring->header->slot_size;
+
+    return shm_slot_data(slot);
+}
+
+int32_t shm_frame_ring_commit(shm_frame_ring_t *ring, const shm_frame_meta_t *meta)
+{
+    shm_frame_slot_t *slot = NULL;
+
+    if (ring == NULL || !ring->is_producer || meta == NULL)
+        return -1;
+
+    slot = shm_get_slot(ring, ring->next_seq);
+    if (meta->data_size > ring->header->slot_size) {
+        LOGE_print("frame size %u exceeds shm slot size %u\n",
+            meta->data_size, ring->header->slot_size);
+        // 槽位中原来的帧可能已经被部分覆盖，标记为无效
+        __atomic_store_n(&slot->seq, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+
+    slot->meta = *meta;
+    slot->meta.frame_seq = ring->next_seq;
+    slot->meta.publish_ns = shm_now_ns();
+
+    __atomic_store_n(&slot->seq, ring->next_seq * 2, __ATOMIC_RELEASE);
+    __atomic_store_n(&ring->header->write_seq, ring->next_seq, __ATOMIC_RELEASE);
+    ring->next_seq++;
+
+    return 0;
+}
+
+int32_t shm_frame_ring_publish(shm_frame_ring_t *ring, const shm_frame_meta_t *meta,
+    const uint8_t *const planes[SHM_FRAME_MAX_PLANES])
+{
+    shm_frame_meta_t tmp;
+    uint8_t *data = NULL;
+    uint32_t capacity = 0, offset = 0, i = 0;
+
+    if (meta == NULL || planes == NULL || meta->plane_count > SHM_FRAME_MAX_PLANES)
+        return -1;
+
+    tmp = *meta;
+    tmp.data_size = 0;
+    for (i = 0; i < tmp.plane_count; i++)
+        tmp.data_size += tmp.plane_size[i];
+    if (tmp.data_size > ring->header->slot_size) {
+        LOGE_print("frame size %u exceeds shm slot size %u\n",
+            tmp.data_size, ring->header->slot_size);
+        return -1;
+    }
+
+    data = shm_frame_ring_begin(ring, &capacity);
+    if (data == NULL)
+        return -1;
+
+    for (i = 0; i < tmp.plane_count; i++) {
+        if (planes[i] != NULL && tmp.plane_size[i] > 0)
+            memcpy(data + offset, planes[i], tmp.plane_size[i]);
+        offset += tmp.plane_size[i];
+    }
+
+    return shm_frame_ring_commit(ring, &tmp);
+}
+
+// 按 seqlock 协议拷贝 frame_seq 对应的槽位，数据在拷贝过程中被覆盖时返回 -1
+static int32_t shm_copy_slot(shm_frame_ring_t *ring, uint64_t frame_seq,
+    shm_frame_meta_t *meta, uint8_t *buf, uint32_t buf_size)
+{
+    shm_frame_slot_t *slot = shm_get_slot(ring, frame_seq);
+    uint64_t seq_begin = 0, seq_end = 0;
+
+    seq_begin = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+    if (seq_begin != frame_seq * 2)
+        return -1;
+
+    *meta = slot->meta;
+    if (meta->data_size > buf_size || meta->data_size > ring->header->slot_size)
+        return -2;
+    memcpy(buf, shm_slot_data(slot), meta->data_size);
+
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    seq_end = __atomic_load_n(&slot->seq, __ATOMIC_RELAXED);
+
+    return (seq_begin == seq_end) ? 0 : -1;
+}
+
+// 写者崩溃或者被 SIGKILL 时不会设置 closed，读超时后检查写者进程是否还在、
+// 同名对象是否已经被重启后的写者换成新的会话，两者任一成立都返回 1
+static int32_t shm_producer_gone(shm_frame_ring_t *ring)
+{
+    shm_frame_ring_header_t *header = NULL;
+    int32_t fd = -1, gone = 0;
+    struct stat st;
+    int64_t now = shm_now_ns();
+
+    // timeout 为 0 的轮询读不能每次都做系统调用
+    if (now - ring->alive_check_ns < SHM_FRAME_ALIVE_CHECK_NS)
+        return 0;
+    ring->alive_check_ns = now;
+
+    // 读者和写者不在同一个 pid 命名空间时 kill 返回 EPERM，只有 ESRCH 才说明进程已经退出
+    if (ring->header->producer_pid > 0 &&
+        kill(ring->header->producer_pid, 0) != 0 && errno == ESRCH)
+        return 1;
+
+    fd = shm_open(ring->name, O_RDONLY, 0);
+    if (fd < 0)
+        return 0;   // 新的写者正在创建，下一次超时再检查
+    if (fstat(fd, &st) == 0 && (size_t)st.st_size >= sizeof(shm_frame_ring_header_t)) {
+        header = (shm_frame_ring_header_t *)mmap(NULL, sizeof(shm_frame_ring_header_t),
+            PROT_READ, MAP_SHARED, fd, 0);
+        if (header != MAP_FAILED) {
+            // magic 还没写入说明新写者还在初始化，session 尚未生效
+            if (__atomic_load_n(&header->magic, __ATOMIC_ACQUIRE) == SHM_FRAME_RING_MAGIC &&
+                header->session != ring->session)
+                gone = 1;
+            munmap(header, sizeof(shm_frame_ring_header_t));
+        }
+    }
+    close(fd);
+
+    return gone;
+}
+
+int32_t shm_frame_ring_read(shm_frame_ring_t *ring, uint64_t *last_seq,
+    shm_frame_meta_t *meta, uint8_t *buf, uint32_t buf_size, int32_t timeout_ms)
+{
+    shm_frame_ring_header_t *header = NULL;
+    int64_t deadline = 0;
+    uint64_t write_seq = 0;
+    int32_t ret = 0, retry = 0;
+
+    if (ring == NULL || ring->is_producer || last_seq == NULL || meta == NULL || buf == NULL)
+        return SHM_FRAME_RING_ERROR;
+
+    header = ring->header;
+    deadline = shm_now_ns() + (int64_t)timeout_ms * 1000000LL;
+
+    while (1) {
+        write_seq = __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE);
+        if (write_seq > *last_seq) {
+            // 总是读最新的一帧；拷贝期间被写者追上时重新取最新帧
+            ret = shm_copy_slot(ring, write_seq, meta, buf, buf_size);
+            if (ret == 0) {
+                *last_seq = write_seq;
+                return SHM_FRAME_RING_NEW_FRAME;
+            }
+            if (ret == -2) {
+                LOGE_print("read buffer size %u too small for frame size %u\n",
+                    buf_size, meta->data_size);
+                return SHM_FRAME_RING_ERROR;
+            }
+            if (++retry < SHM_FRAME_READ_RETRY)
+                continue;
+            retry = 0;
+        }
+
+        // 写者关闭前发布的最后一帧也会被读到
+        if (__atomic_load_n(&header->closed, __ATOMIC_ACQUIRE) &&
+            __atomic_load_n(&header->write_seq, __ATOMIC_ACQUIRE) == *last_seq)
+            return SHM_FRAME_RING_CLOSED;
+
+        // 读者轮询等待，写者发布时不做任何系统调用
+        if (shm_now_ns() >= deadline)
+            return shm_producer_gone(ring) ? SHM_FRAME_RING_CLOSED : SHM_FRAME_RING_NO_FRAME;
+        usleep(SHM_FRAME_READ_POLL_US);
+    }
+}
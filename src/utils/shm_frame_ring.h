@@ -0,0 +1,152 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#ifndef SHM_FRAME_RING_H_
+#define SHM_FRAME_RING_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 共享内存图像环形缓冲区
+ *
+ * 一个写者（producer）把图像依次写入 N 个槽位，读者只读映射，随时可以挂载和退出，
+ * 写者不感知读者，也不会因为读者慢而阻塞。每个槽位带一个 seqlock 序号：
+ * 奇数表示正在写，偶数表示数据稳定，读者拷贝前后各读一次序号来判断数据是否被覆盖。
+ *
+ * 内存布局：shm_frame_ring_header_t | slot 0 | slot 1 | ... ，
+ * 每个 slot 为 shm_frame_slot_t 加上 slot_size 字节的数据区，均按 64 字节对齐。
+ */
+
+#define SHM_FRAME_RING_MAGIC 0x464d4853 /* "SHMF" */
+#define SHM_FRAME_RING_VERSION 1
+#define SHM_FRAME_MAX_PLANES 3
+#define SHM_FRAME_DEFAULT_NAME "/hobot_display"
+
+/* shm_frame_ring_read 的返回值 */
+#define SHM_FRAME_RING_NEW_FRAME 1
+#define SHM_FRAME_RING_NO_FRAME 0
+#define SHM_FRAME_RING_ERROR (-1)
+#define SHM_FRAME_RING_CLOSED (-2)  // 写者已经关闭或者不在了，读者需要重新 open
+
+typedef enum {
+    SHM_FRAME_FMT_RAW = 0,          // 不透明的字节流，例如编码后的码流
+    SHM_FRAME_FMT_NV12 = 1,
+    SHM_FRAME_FMT_RGBA = 2,
+} shm_frame_fmt_e;
+
+typedef struct {
+    uint64_t frame_seq;             // 发布序号，从 1 开始连续递增，读者据此计算丢帧
+    int64_t frame_id;               // 源帧的 frame_id
+    int64_t timestamp;              // 源帧的时间戳
+    int64_t publish_ns;             // 发布时刻，CLOCK_MONOTONIC 纳秒
+    uint32_t format;                // shm_frame_fmt_e
+    int32_t width;
+    int32_t height;
+    int32_t stride;                 // 每行字节数
+    uint32_t plane_count;
+    uint32_t plane_size[SHM_FRAME_MAX_PLANES];  // 各平面在数据区中依次紧密排列
+    uint32_t data_size;             // 所有平面大小之和
+    uint32_t reserved;
+} shm_frame_meta_t;
+
+typedef struct {
+    uint64_t seq;                   // seqlock 序号，只能用原子操作访问
+    uint64_t reserved[7];
+    shm_frame_meta_t meta;
+} __attribute__((aligned(64))) shm_frame_slot_t;
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t slot_count;
+    uint32_t slot_size;             // 每个槽位的数据区大小
+    uint64_t slot_stride;           // 相邻槽位间隔，包括 shm_frame_slot_t
+    uint64_t session;               // 写者创建时刻，用于区分写者重启
+    int32_t producer_pid;
+    uint32_t closed;                // 写者关闭时置 1
+    uint64_t reserved[4];
+    uint64_t write_seq;             // 最近一次发布完成的 frame_seq，只能用原子操作访问
+} __attribute__((aligned(64))) shm_frame_ring_header_t;
+
+typedef struct {
+    int32_t fd;
+    int32_t is_producer;
+    char name[64];
+    size_t map_size;
+    shm_frame_ring_header_t *header;
+    uint64_t next_seq;              // 写者：下一帧的 frame_seq
+    uint64_t session;               // 读者：open 时的 session
+    int64_t alive_check_ns;         // 读者：上一次检查写者是否还在的时刻
+} shm_frame_ring_t;
+
+/**
+ * @brief 写者创建共享内存环，同名的旧对象会被替换
+ * @param [in] name        共享内存名，不以 '/' 开头时自动补上
+ * @param [in] slot_count  槽位数，至少 2
+ * @param [in] slot_size   每个槽位能存放的最大图像字节数
+ *
+ * @return 成功返回句柄，失败返回 NULL
+ */
+shm_frame_ring_t *shm_frame_ring_create(const char *name, uint32_t slot_count, uint32_t slot_size);
+
+/**
+ * @brief 读者以只读方式挂载共享内存环
+ *
+ * @return 成功返回句柄，写者不存在或者版本不匹配时返回 NULL
+ */
+shm_frame_ring_t *shm_frame_ring_open(const char *name);
+
+/**
+ * @brief 关闭句柄。写者关闭时会通知读者并删除共享内存名
+ */
+void shm_frame_ring_close(shm_frame_ring_t *ring);
+
+/**
+ * @brief 写者开始写下一帧，返回槽位数据区地址，调用者直接写入后调用 shm_frame_ring_commit
+ * @param [out] capacity   数据区大小
+ */
+uint8_t *shm_frame_ring_begin(shm_frame_ring_t *ring, uint32_t *capacity);
+
+/**
+ * @brief 写者提交 shm_frame_ring_begin 写入的数据，meta 中的 frame_seq、publish_ns 由内部填写
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t shm_frame_ring_commit(shm_frame_ring_t *ring, const shm_frame_meta_t *meta);
+
+/**
+ * @brief 写者发布一帧：按 meta->plane_size 依次拷贝 planes 并提交
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t shm_frame_ring_publish(shm_frame_ring_t *ring, const shm_frame_meta_t *meta,
+    const uint8_t *const planes[SHM_FRAME_MAX_PLANES]);
+
+/**
+ * @brief 读者读取最新的一帧
+ * @param [in,out] last_seq   上一次读到的 frame_seq，读到新帧后更新
+ * @param [out] meta          帧信息
+ * @param [out] buf           数据拷贝到这里
+ * @param [in] buf_size       buf 大小，小于帧大小时返回错误
+ * @param [in] timeout_ms     没有新帧时等待的时间，0 表示不等待
+ *
+ * @retval SHM_FRAME_RING_NEW_FRAME   读到新帧
+ * @retval SHM_FRAME_RING_NO_FRAME    超时
+ * @retval SHM_FRAME_RING_CLOSED      写者已经关闭、进程已经退出或者已经被重启的写者替换
+ * @retval SHM_FRAME_RING_ERROR       失败
+ */
+int32_t shm_frame_ring_read(shm_frame_ring_t *ring, uint64_t *last_seq,
+    shm_frame_meta_t *meta, uint8_t *buf, uint32_t buf_size, int32_t timeout_ms);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_FRAME_RING_H_
@@ -0,0 +1,237 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "utils_log.h"
+#include "tensor_pool.h"
+
+#define TENSOR_POOL_CACHE_LINE 64
+#define TENSOR_POOL_NAME_LEN 128
+
+typedef struct {
+    char model[TENSOR_POOL_NAME_LEN];
+    tensor_pool_dir_e dir;
+    int32_t index;
+    hbSysMem mem;
+    int32_t in_use;
+    int64_t free_seq;               // 还给池的先后顺序，trim 时先释放最早还回来的
+} tensor_pool_entry_t;
+
+static pthread_mutex_t s_pool_mutex = PTHREAD_MUTEX_INITIALIZER;
+static tensor_pool_entry_t *s_entries = NULL;
+static int32_t s_entry_count = 0;
+static int32_t s_entry_capacity = 0;
+static int64_t s_ion_allocs = 0;
+static int64_t s_reuses = 0;
+static int64_t s_free_seq = 0;
+
+static int32_t same_tensor(const tensor_pool_entry_t *entry, const char *model,
+    tensor_pool_dir_e dir, int32_t index)
+{
+    return entry->dir == dir && entry->index == index
+        && strncmp(entry->model, model, TENSOR_POOL_NAME_LEN - 1) == 0;
+}
+
+int32_t tensor_pool_alloc(const char *model, tensor_pool_dir_e dir, int32_t index,
+    uint32_t size, hbSysMem *mem)
+{
+    tensor_pool_entry_t *best = NULL;
+    int32_t ret = 0;
+    int32_t i;
+
+    if (model == NULL || mem == NULL || size == 0) {
+        return -1;
+    }
+
+    pthread_mutex_lock(&s_pool_mutex);
+
+    // 同一个张量留下的空闲内存中选最小的一块
+    for (i = 0; i < s_entry_count; i++) {
+        tensor_pool_entry_t *entry = &s_entries[i];
+        if (!entry->in_use && entry->mem.memSize >= size && same_tensor(entry, model, dir, index)
+                && (best == NULL || entry->mem.memSize < best->mem.memSize)) {
+            best = entry;
+        }
+    }
+    if (best != NULL) {
+        best->in_use = 1;
+        *mem = best->mem;
+        s_reuses++;
+        pthread_mutex_unlock(&s_pool_mutex);
+        return 0;
+    }
+
+    pthread_mutex_unlock(&s_pool_mutex);
+
+    // ION 申请和映射比较慢，不持有锁，其他线程加载模型时可以并行申请
+    memset(mem, 0, sizeof(*mem));
+    ret = hbSysAllocCachedMem(mem, size);
+    if (ret != 0) {
+        LOGE_print("hbSysAllocCachedMem %u bytes for %s failed, ret = %d\n", size, model, ret);
+        return -1;
+    }
+
+    pthread_mutex_lock(&s_pool_mutex);
+    if (s_entry_count == s_entry_capacity) {
+        int32_t capacity = s_entry_capacity == 0 ? 16 : s_entry_capacity * 2;
+        tensor_pool_entry_t *entries = (tensor_pool_entry_t *)realloc(s_entries,
+            capacity * sizeof(tensor_pool_entry_t));
+        if (entries == NULL) {
+            pthread_mutex_unlock(&s_pool_mutex);
+            hbSysFreeMem(mem);
+            memset(mem, 0, sizeof(*mem));
+            return -1;
+        }
+        s_entries = entries;
+        s_entry_capacity = capacity;
+    }
+
+    best = &s_entries[s_entry_count];
+    memset(best, 0, sizeof(*best));
+    snprintf(best->model, sizeof(best->model), "%s", model);
+    best->dir = dir;
+    best->index = index;
+    best->mem = *mem;
+    best->in_use = 1;
+    s_entry_count++;
+    s_ion_allocs++;
+
+    pthread_mutex_unlock(&s_pool_mutex);
+    return 0;
+}
+
+void tensor_pool_free(hbSysMem *mem)
+{
+    int32_t pooled = 0;
+    int32_t i;
+
+    if (mem == NULL || mem->virAddr == NULL) {
+        return;
+    }
+
+    pthread_mutex_lock(&s_pool_mutex);
+    for (i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].mem.virAddr == mem->virAddr) {
+            s_entries[i].in_use = 0;
+            s_entries[i].free_seq = s_free_seq++;
+            pooled = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&s_pool_mutex);
+
+    if (!pooled) {
+        hbSysFreeMem(mem);
+    }
+    memset(mem, 0, sizeof(*mem));
+}
+
+int32_t tensor_pool_flush(hbSysMem *mem, uint32_t offset, uint32_t size, int32_t flag)
+{
+    hbSysMem range;
+    uint32_t start, end;
+
+    if (mem == NULL || mem->virAddr == NULL || offset >= mem->memSize) {
+        return -1;
+    }
+
+    start = offset & ~(uint32_t)(TENSOR_POOL_CACHE_LINE - 1);
+    end = offset + size;
+    if (end > mem->memSize || end < offset) {
+        end = mem->memSize;
+    }
+    end = (end + TENSOR_POOL_CACHE_LINE - 1) & ~(uint32_t)(TENSOR_POOL_CACHE_LINE - 1);
+    if (end > mem->memSize) {
+        end = mem->memSize;
+    }
+
+    range.phyAddr = mem->phyAddr + start;
+    range.virAddr = (uint8_t *)mem->virAddr + start;
+    range.memSize = end - start;
+    return hbSysFlushMem(&range, flag);
+}
+
+void tensor_pool_trim(int64_t keep_bytes)
+{
+    hbSysMem *victims = NULL;
+    int64_t free_bytes = 0;
+    int32_t victim_count = 0;
+    int32_t i, count;
+
+    pthread_mutex_lock(&s_pool_mutex);
+    for (i = 0; i < s_entry_count; i++) {
+        if (!s_entries[i].in_use) {
+            free_bytes += s_entries[i].mem.memSize;
+        }
+    }
+    if (free_bytes > keep_bytes) {
+        victims = (hbSysMem *)malloc(s_entry_count * sizeof(hbSysMem));
+    }
+    while (victims != NULL && free_bytes > keep_bytes) {
+        int32_t oldest = -1;
+        for (i = 0; i < s_entry_count; i++) {
+            if (!s_entries[i].in_use
+                    && (oldest < 0 || s_entries[i].free_seq < s_entries[oldest].free_seq)) {
+                oldest = i;
+            }
+        }
+        if (oldest < 0) {
+            break;
+        }
+        free_bytes -= s_entries[oldest].mem.memSize;
+        victims[victim_count++] = s_entries[oldest].mem;
+        s_entries[oldest] = s_entries[--s_entry_count];
+    }
+    pthread_mutex_unlock(&s_pool_mutex);
+
+    // 和申请一样，ION 释放不持有锁
+    for (count = 0; count < victim_count; count++) {
+        hbSysFreeMem(&victims[count]);
+    }
+    free(victims);
+}
+
+void tensor_pool_get_stats(tensor_pool_stats_t *stats)
+{
+    int32_t i;
+
+    memset(stats, 0, sizeof(*stats));
+
+    pthread_mutex_lock(&s_pool_mutex);
+    for (i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].in_use) {
+            stats->in_use_count++;
+            stats->in_use_bytes += s_entries[i].mem.memSize;
+        } else {
+            stats->free_count++;
+            stats->free_bytes += s_entries[i].mem.memSize;
+        }
+    }
+    stats->ion_allocs = s_ion_allocs;
+    stats->reuses = s_reuses;
+    pthread_mutex_unlock(&s_pool_mutex);
+}
+
+int32_t tensor_pool_dump(void)
+{
+    int32_t i, count = 0;
+
+    pthread_mutex_lock(&s_pool_mutex);
+    for (i = 0; i < s_entry_count; i++) {
+        if (s_entries[i].in_use) {
+            LOGW_print("tensor memory not released: %s %s[%d] %u bytes\n",
+                s_entries[i].model, s_entries[i].dir == TENSOR_POOL_INPUT ? "input" : "output",
+                s_entries[i].index, s_entries[i].mem.memSize);
+            count++;
+        }
+    }
+    pthread_mutex_unlock(&s_pool_mutex);
+
+    return count;
+}
@@ -0,0 +1,88 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+#ifndef TENSOR_POOL_H_
+#define TENSOR_POOL_H_
+
+#include <stdint.h>
+
+#include "dnn/hb_sys.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 模型输入输出张量的 cached 内存池
+ *
+ * 按（模型名，输入/输出，张量序号）索引。释放的内存不还给 ION，而是留在池中，
+ * 同一个模型再次加载或者重新申请输出张量时直接复用，避免重复的 ION 申请、映射和缺页。
+ * 池中记录每块内存的归属，tensor_pool_dump 可以列出没有释放的内存。
+ *
+ * 所有接口都是线程安全的。
+ */
+
+typedef enum {
+    TENSOR_POOL_INPUT = 0,
+    TENSOR_POOL_OUTPUT = 1,
+} tensor_pool_dir_e;
+
+// 一个张量有多块内存时（NV12_SEPARATE 的 Y 和 UV）用 plane 区分
+#define TENSOR_POOL_INDEX(tensor, plane) ((tensor) * 4 + (plane))
+
+typedef struct {
+    int32_t in_use_count;           // 已经分配出去、还没有释放的内存块
+    int64_t in_use_bytes;
+    int32_t free_count;             // 留在池中等待复用的内存块
+    int64_t free_bytes;
+    int64_t ion_allocs;             // 调用 hbSysAllocCachedMem 的次数
+    int64_t reuses;                 // 从池中复用的次数
+} tensor_pool_stats_t;
+
+/**
+ * @brief 申请张量内存，池中有同一个张量留下的、足够大的内存时直接复用
+ * @param [in] model   模型名
+ * @param [in] index   TENSOR_POOL_INDEX(张量序号, 内存块序号)
+ * @param [out] mem    内存信息，memSize 为实际大小，可能大于 size
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t tensor_pool_alloc(const char *model, tensor_pool_dir_e dir, int32_t index,
+    uint32_t size, hbSysMem *mem);
+
+/**
+ * @brief 把内存还给池，mem 被清零。不是池中分配的内存直接调用 hbSysFreeMem 释放
+ */
+void tensor_pool_free(hbSysMem *mem);
+
+/**
+ * @brief 只刷新 [offset, offset + size) 范围的 cache，按 cache line 对齐
+ * @param [in] flag   HB_SYS_MEM_CACHE_CLEAN 或者 HB_SYS_MEM_CACHE_INVALIDATE
+ */
+int32_t tensor_pool_flush(hbSysMem *mem, uint32_t offset, uint32_t size, int32_t flag);
+
+// 释放模型时池中最多保留的空闲内存，同一个模型马上重新加载时仍然可以复用
+#define TENSOR_POOL_KEEP_BYTES (64 * 1024 * 1024)
+
+/**
+ * @brief 把池中空闲的内存还给 ION，从最早还回池中的开始释放，直到空闲内存不超过 keep_bytes
+ * @param [in] keep_bytes   0 表示全部释放
+ */
+void tensor_pool_trim(int64_t keep_bytes);
+
+void tensor_pool_get_stats(tensor_pool_stats_t *stats);
+
+/**
+ * @brief 打印所有还没有释放的内存，用于检查泄漏
+ *
+ * @return 没有释放的内存块数
+ */
+int32_t tensor_pool_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TENSOR_POOL_H_
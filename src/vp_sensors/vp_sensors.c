@@ -869,3 +869,41 @@ vp_sensor_config_t *vp_get_sensor_config_by_mipi_host(int32_t mipi_host_index,
 	//to do 
 	return vp_sensor_config_list[0];
 }
+
+int32_t vp_sensor_config_clone(const vp_sensor_config_t *src,
+	vp_sensor_config_t *dst, vp_sensor_config_storage_t *storage)
+{
+	if ((src == NULL) || (dst == NULL) || (storage == NULL))
+		return -1;
+
+	memcpy(dst, src, sizeof(vp_sensor_config_t));
+	memset(storage, 0, sizeof(vp_sensor_config_storage_t));
+
+	// 只复制会被 pipeline 修改的配置，其余字段仍然共享只读的静态配置
+	if (src->camera_config != NULL) {
+		storage->camera_config = *src->camera_config;
+		dst->camera_config = &storage->camera_config;
+	}
+	if (src->deserial_config != NULL) {
+		storage->deserial_config = *src->deserial_config;
+		dst->deserial_config = &storage->deserial_config;
+	}
+	if (src->vin_attr != NULL) {
+		storage->vin_attr = *src->vin_attr;
+		dst->vin_attr = &storage->vin_attr;
+	}
+	if (src->isp_attr != NULL) {
+		storage->isp_attr = *src->isp_attr;
+		dst->isp_attr = &storage->isp_attr;
+	}
+	if (src->isp_ichn_attr != NULL) {
+		storage->isp_ichn_attr = *src->isp_ichn_attr;
+		dst->isp_ichn_attr = &storage->isp_ichn_attr;
+	}
+	if (src->isp_ochn_attr != NULL) {
+		storage->isp_ochn_attr = *src->isp_ochn_attr;
+		dst->isp_ochn_attr = &storage->isp_ochn_attr;
+	}
+
+	return 0;
+}
@@ -78,6 +78,17 @@ typedef struct vp_sensor_config_s {
 	isp_ochn_attr_t *isp_ochn_attr;
 } vp_sensor_config_t;
 
+// vp_sensor_config_t 中指针指向的各项配置的私有副本，
+// 多路相机同时使用同一种 sensor 时，各自修改分辨率、mipi_rx 等参数互不影响
+typedef struct vp_sensor_config_storage_s {
+	camera_config_t camera_config;
+	deserial_config_t deserial_config;
+	vin_attr_t vin_attr;
+	isp_attr_t isp_attr;
+	isp_ichn_attr_t isp_ichn_attr;
+	isp_ochn_attr_t isp_ochn_attr;
+} vp_sensor_config_storage_t;
+
 extern vp_sensor_config_t *vp_sensor_config_list[];
 
 uint32_t vp_get_sensors_list_number();
@@ -89,6 +100,8 @@ int32_t vp_sensor_fixed_mipi_host(vp_sensor_config_t *sensor_config, vp_csi_conf
 int32_t vp_sensor_multi_fixed_mipi_host(vp_sensor_config_t *sensor_config, int used_mipi_host, vp_csi_config_t* csi_config);
 vp_sensor_config_t *vp_get_sensor_config_by_mipi_host(int32_t mipi_host_index,
 	vp_csi_config_t* csi_config,int sensor_height,int sensor_width,int sensor_fps);
+int32_t vp_sensor_config_clone(const vp_sensor_config_t *src,
+	vp_sensor_config_t *dst, vp_sensor_config_storage_t *storage);
 
 #ifdef __cplusplus
 }
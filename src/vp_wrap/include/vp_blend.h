@@ -0,0 +1,92 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-08 14:05:37
+ * @LastEditTime: 2024-11-08 14:05:37
+ ***************************************************************************/
+#ifndef VP_BLEND_H_
+#define VP_BLEND_H_
+
+#include <stdint.h>
+
+#include "vp_overlay.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* 软件 alpha 合成，用于没有 nano2D (GC820) 时把 ARGB8888 图层烧录到 NV12 / RGBA 图像上
+ *
+ * 图层按 VP_BLEND_TILE_SIZE 划分 tile，只在图层内容变化时扫描一次 alpha，
+ * 记录哪些 tile 有不透明像素；每帧合成只处理这些 tile，
+ * 时间戳、检测框这类稀疏的 OSD 不需要遍历整帧。
+ */
+
+#define VP_BLEND_TILE_SIZE 32
+
+typedef struct {
+	const uint8_t *addr;      // ARGB8888，内存中按 B G R A 排列
+	int32_t width;
+	int32_t height;
+	int32_t stride;           // 每行字节数
+	int32_t premultiplied;    // 1: 颜色已经预乘 alpha；0: 直通 alpha（vp_overlay 绘制的内容）
+	uint8_t *tile_mask;       // 每个 tile 一个字节，非 0 表示有不透明像素
+	int32_t tiles_x;
+	int32_t tiles_y;
+	int32_t active_tiles;     // 有内容的 tile 数
+	uint64_t content_hash;    // vp_blend_layer_sync 同步到的 surface 内容
+	int32_t synced;
+} vp_blend_layer_t;
+
+int32_t vp_blend_layer_init(vp_blend_layer_t *layer, const uint8_t *addr,
+	int32_t width, int32_t height, int32_t stride, int32_t premultiplied);
+void vp_blend_layer_deinit(vp_blend_layer_t *layer);
+
+/**
+ * @brief 重新扫描 rects 覆盖到的 tile，其他 tile 的状态保持不变
+ * @param [in] rects   图层上内容有变化的区域，为 NULL 时扫描整个图层
+ *
+ * @return 有内容的 tile 数，失败返回 -1
+ */
+int32_t vp_blend_layer_update(vp_blend_layer_t *layer, const vp_overlay_rect_t *rects,
+	int32_t count);
+
+/**
+ * @brief 按 vp_overlay_surface 的脏区域更新 tile 状态，surface 内容没有变化时直接返回。
+ *        surface 上脏区域以外的像素都是透明的，所以只需要扫描脏区域
+ *
+ * @return 有内容的 tile 数，失败返回 -1
+ */
+int32_t vp_blend_layer_sync(vp_blend_layer_t *layer, const vp_overlay_surface_t *surface);
+
+/**
+ * @brief 把图层 region 区域合成到 NV12 图像上，图层左上角对齐目标图像的 (dst_x, dst_y)
+ *        UV 按 2x2 像素的平均颜色和平均 alpha 合成，所以 dst_x、dst_y 必须是偶数，
+ *        region 会向外扩展到 2 像素对齐。超出图层或者目标图像的部分被裁剪
+ * @param [in] region   图层上参与合成的区域，为 NULL 时合成整个图层
+ * @param [in] stride   Y、UV 平面每行字节数
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t vp_blend_nv12(const vp_blend_layer_t *layer, const vp_overlay_rect_t *region,
+	uint8_t *y, uint8_t *uv, int32_t stride, int32_t width, int32_t height,
+	int32_t dst_x, int32_t dst_y);
+
+/**
+ * @brief 把图层 region 区域合成到 RGBA8888 图像上（内存中按 R G B A 排列），
+ *        目标的 alpha 按 src-over 规则合成
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t vp_blend_rgba(const vp_blend_layer_t *layer, const vp_overlay_rect_t *region,
+	uint8_t *dst, int32_t stride, int32_t width, int32_t height,
+	int32_t dst_x, int32_t dst_y);
+
+#ifdef __cplusplus
+}
+#endif /* extern "C" */
+
+#endif // VP_BLEND_H_
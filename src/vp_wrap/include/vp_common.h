@@ -130,8 +130,11 @@ typedef struct vp_vflow_contex_s {
 	deserial_handle_t  des_fd;
 	int32_t mipi_csi_rx_index;
 	int32_t mclk_is_not_configed;
-	vp_sensor_config_t *sensor_config;
-	pym_cfg_t *pym_config;
+	vp_sensor_config_t *sensor_config; // 指向 sensor_cfg，本 pipeline 私有的 sensor 配置
+	vp_sensor_config_t sensor_cfg;
+	vp_sensor_config_storage_t sensor_storage;
+	pym_cfg_t *pym_config; // 指向本 pipeline 私有的 pym_cfg，由 vp_vse_init_config 设置
+	pym_cfg_t pym_cfg;
 	hbn_vnode_handle_t vin_node_handle;
 	hbn_vnode_handle_t isp_node_handle;
 	int32_t vse_chn_num;
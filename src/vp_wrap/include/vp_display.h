@@ -13,6 +13,7 @@
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
+#include <pthread.h>
 #include <drm/drm.h>
 #include <drm/drm_mode.h>
 #include <xf86drm.h>
@@ -60,6 +61,14 @@ extern "C" {
 
 #define DRM_MAX_PLANES 3
 #define DRM_ION_MAX_BUFFERS 3
+#define DRM_FB_CACHE_SIZE 32
+
+// 视频图层和 OSD 图层在 planes[] 中的序号
+#define VP_DISPLAY_PLANE_VIDEO 0
+#define VP_DISPLAY_PLANE_OSD 1
+
+// 可以通过环境变量指定 DRM 设备节点，例如在 PC 上用 vkms 调试时设为 /dev/dri/card1
+#define VP_DISPLAY_DEVICE_ENV "VP_DRM_DEVICE"
 
 typedef struct
 {
@@ -79,6 +88,54 @@ typedef struct
 	uint32_t pixel_blend_mode; // alpha模式
 } drm_plane_config_t;
 
+// 图层属性 id，初始化时查询一次，提交时直接使用
+typedef struct
+{
+	uint32_t fb_id;
+	uint32_t crtc_id;
+	uint32_t src_x;
+	uint32_t src_y;
+	uint32_t src_w;
+	uint32_t src_h;
+	uint32_t crtc_x;
+	uint32_t crtc_y;
+	uint32_t crtc_w;
+	uint32_t crtc_h;
+	uint32_t zpos;
+} drm_plane_props_t;
+
+// 每个图层的帧状态，保存的是 dma_buf fd，-1 表示空
+typedef struct
+{
+	int32_t pending_fd;      // 等待下一次提交的帧，新帧到来时直接替换（最新帧优先）
+	uint32_t pending_fb;
+	uint32_t pending_w;
+	uint32_t pending_h;
+	int32_t queued_fd;       // 已经提交、等待 page flip 完成的帧
+	int32_t shown_fd;        // 正在扫描输出的帧
+	int32_t enabled;         // 图层是否已经挂到 crtc 上
+} drm_plane_state_t;
+
+// 通过 PRIME 导入的 dma_buf 与 framebuffer 的对应关系
+typedef struct
+{
+	int32_t dma_buf_fd;
+	uint32_t width;
+	uint32_t height;
+	uint32_t format;
+	uint32_t gem_handle[2];  // Y/UV 不在同一个 dma_buf 时分别导入
+	uint32_t fb_id;
+} drm_fb_cache_t;
+
+typedef struct
+{
+	uint64_t frames_queued;  // 调用 vp_display_set_frame 的次数
+	uint64_t frames_dropped; // 还没提交就被更新的帧替换掉的次数
+	uint64_t commits;        // atomic 提交次数
+	uint64_t flips;          // page flip 完成次数
+	uint64_t commit_errors;  // 提交失败次数
+} vp_display_stats_t;
+
 typedef struct
 {
 	int drm_fd;
@@ -88,13 +145,65 @@ typedef struct
 	uint32_t width;
 	uint32_t height;
 	int plane_count;
+
+	drmModeModeInfo mode;
+	uint32_t mode_blob_id;
+	uint32_t crtc_active_prop;
+	uint32_t crtc_mode_prop;
+	uint32_t conn_crtc_prop;
+	drm_plane_props_t plane_props[DRM_MAX_PLANES];
+	drm_plane_state_t plane_state[DRM_MAX_PLANES];
+	drm_fb_cache_t fb_cache[DRM_FB_CACHE_SIZE];
+	int32_t fb_cache_count;
+
+	int32_t modeset_done;
+	int32_t flip_pending;
+	int32_t running;
+	pthread_t flip_thread;
+	pthread_mutex_t lock;
+	pthread_cond_t flip_cond;
+	vp_display_stats_t stats;
 } vp_drm_context_t;
 
+/**
+ * @brief 检查是否有可以独占使用的 DRM 设备
+ *
+ * @retval 1      可用
+ * @retval 0      不可用
+ */
+int32_t vp_display_is_available(void);
+
+/**
+ * @brief 打开 DRM 设备，选择 connector、crtc、显示模式以及视频/OSD 图层，并启动 page flip 事件线程。
+ *        真正的 modeset 在第一次提交帧时和图层配置一起原子完成
+ */
 int32_t vp_display_init(vp_drm_context_t *drm_ctx, int32_t width, int32_t height);
 int32_t vp_display_deinit(vp_drm_context_t *drm_ctx);
+
+/**
+ * @brief 把一个 dma_buf（hb_mem NV12/ARGB buffer）直接送到指定图层扫描输出，不做拷贝。
+ *        非阻塞：上一次提交的 page flip 还没完成时只记录为待提交帧，flip 完成后与其他图层
+ *        的待提交帧一起原子提交；期间再次调用会替换掉待提交帧（最新帧优先）。
+ *        调用者在 vp_display_buffer_busy 返回 0 之前不能改写或者释放该 buffer
+ */
 int32_t vp_display_set_frame(vp_drm_context_t *drm_ctx, int32_t plane_idx,
 	hbn_vnode_image_t *image_frame);
 
+/**
+ * @brief 查询 dma_buf 是否还被显示模块占用（待提交、等待 flip 或者正在扫描输出）
+ *
+ * @retval 1      占用
+ * @retval 0      空闲
+ */
+int32_t vp_display_buffer_busy(vp_drm_context_t *drm_ctx, int32_t plane_idx, int32_t dma_buf_fd);
+
+/**
+ * @brief 释放 dma_buf 对应的 framebuffer 缓存，调用者释放 buffer 之前调用
+ */
+int32_t vp_display_forget_buffer(vp_drm_context_t *drm_ctx, int32_t dma_buf_fd);
+
+void vp_display_get_stats(vp_drm_context_t *drm_ctx, vp_display_stats_t *stats);
+
 void vp_display_draw_rect(uint8_t *frame, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
 	int32_t color, int32_t fill, int32_t screen_width, int32_t screen_height,
 	int32_t line_width);
@@ -0,0 +1,145 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-06 10:21:53
+ * @LastEditTime: 2024-11-06 10:21:53
+ ***************************************************************************/
+#ifndef VP_OVERLAY_H_
+#define VP_OVERLAY_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define VP_OVERLAY_TEXT_MAX 128
+
+typedef enum {
+	VP_OVERLAY_CMD_BOX = 0,   // 空心框，线宽向框内延伸
+	VP_OVERLAY_CMD_FILL = 1,  // 实心矩形
+	VP_OVERLAY_CMD_TEXT = 2,  // 文字，支持 ASCII 和 GB2312 汉字
+} vp_overlay_cmd_type_e;
+
+typedef struct {
+	int32_t x;
+	int32_t y;
+	int32_t w;
+	int32_t h;
+} vp_overlay_rect_t;
+
+typedef struct {
+	int32_t type;
+	int32_t x0;
+	int32_t y0;
+	int32_t x1;
+	int32_t y1;
+	uint32_t color;           // ARGB8888
+	int32_t line_width;       // 框的线宽，或者文字的放大倍数
+	char text[VP_OVERLAY_TEXT_MAX];
+} vp_overlay_cmd_t;
+
+// 一帧 OSD 的绘制命令列表，逐条添加后一次性渲染
+typedef struct {
+	vp_overlay_cmd_t *cmds;
+	int32_t cmd_count;
+	int32_t cmd_capacity;
+} vp_overlay_list_t;
+
+// 一块 ARGB8888 OSD buffer，记录上一次绘制过的区域，下一次只清除这些区域
+typedef struct {
+	uint8_t *addr;
+	int32_t width;
+	int32_t height;
+	int32_t stride;           // 每行字节数
+	vp_overlay_rect_t *dirty;
+	int32_t dirty_count;
+	int32_t dirty_capacity;
+	uint64_t content_hash;    // 当前内容对应的命令列表 hash
+	int32_t has_content;
+} vp_overlay_surface_t;
+
+/**
+ * @brief 加载 ASC16/HZK16 字库并展开成按行的像素段，进程内只加载一次
+ *
+ * @retval 0      成功
+ * @retval -1     失败
+ */
+int32_t vp_overlay_load_fonts(void);
+
+void vp_overlay_list_init(vp_overlay_list_t *list);
+void vp_overlay_list_reset(vp_overlay_list_t *list);
+void vp_overlay_list_deinit(vp_overlay_list_t *list);
+int32_t vp_overlay_list_copy(vp_overlay_list_t *dst, const vp_overlay_list_t *src);
+int32_t vp_overlay_add_box(vp_overlay_list_t *list, int32_t x0, int32_t y0,
+	int32_t x1, int32_t y1, uint32_t color, int32_t line_width);
+int32_t vp_overlay_add_fill(vp_overlay_list_t *list, int32_t x0, int32_t y0,
+	int32_t x1, int32_t y1, uint32_t color);
+int32_t vp_overlay_add_text(vp_overlay_list_t *list, int32_t x, int32_t y,
+	const char *str, uint32_t color, int32_t scale);
+
+int32_t vp_overlay_surface_init(vp_overlay_surface_t *surface, uint8_t *addr,
+	int32_t width, int32_t height, int32_t stride);
+void vp_overlay_surface_deinit(vp_overlay_surface_t *surface);
+
+/**
+ * @brief 清空整个 surface，并丢弃脏区域记录
+ */
+void vp_overlay_surface_clear(vp_overlay_surface_t *surface);
+
+/**
+ * @brief 把 src 的内容（脏区域、内容 hash）拷贝到同样大小的 dst，
+ *        只清除 dst 上画过的区域、只拷贝 src 上画过的区域
+ */
+int32_t vp_overlay_surface_copy(vp_overlay_surface_t *dst, const vp_overlay_surface_t *src);
+
+/**
+ * @brief 把命令列表渲染到 surface：内容与上一次相同时直接返回，
+ *        否则只清除上一次绘制过的区域，再绘制新的命令
+ *
+ * @retval 1      surface 内容有变化，需要重新送显
+ * @retval 0      内容没有变化
+ * @retval -1     失败
+ */
+int32_t vp_overlay_render(vp_overlay_surface_t *surface, const vp_overlay_list_t *list);
+
+/**
+ * @brief 在 surface 现有内容上追加绘制 list 中从 first 开始的命令，不清除已有内容
+ */
+int32_t vp_overlay_render_append(vp_overlay_surface_t *surface,
+	const vp_overlay_list_t *list, int32_t first);
+
+/**
+ * @brief 判断命令列表是否与 surface 当前内容相同
+ */
+int32_t vp_overlay_same_content(const vp_overlay_surface_t *surface,
+	const vp_overlay_list_t *list);
+
+/**
+ * @brief 用 color 填充矩形，超出 buffer 的部分被裁剪
+ */
+void vp_overlay_fill_rect(uint8_t *addr, int32_t stride, int32_t width, int32_t height,
+	int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color);
+
+/**
+ * @brief 把线宽为 line_width 的空心框拆成上下左右四条边，框太小时返回一整个实心矩形
+ *
+ * @return 矩形个数
+ */
+int32_t vp_overlay_box_edges(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+	int32_t line_width, vp_overlay_rect_t edges[4]);
+
+/**
+ * @brief 绘制一行文字，scale 为放大倍数
+ * @param [out] bbox   文字实际覆盖的区域，可以为 NULL
+ */
+int32_t vp_overlay_draw_text(uint8_t *addr, int32_t stride, int32_t width, int32_t height,
+	int32_t x, int32_t y, const char *str, uint32_t color, int32_t scale,
+	vp_overlay_rect_t *bbox);
+
+#ifdef __cplusplus
+}
+#endif /* extern "C" */
+
+#endif // VP_OVERLAY_H_
@@ -66,7 +66,17 @@ int32_t vp_vse_init(vp_vflow_contex_t *vp_vflow_contex);
 int32_t vp_vse_start(vp_vflow_contex_t *vp_vflow_contex);
 int32_t vp_vse_stop(vp_vflow_contex_t *vp_vflow_contex);
 int32_t vp_vse_deinit(vp_vflow_contex_t *vp_vflow_contex);
-pym_cfg_t *get_vp_pym_common_config (void);
+/**
+ * 用默认配置初始化 vp_vflow_contex 私有的 pym 配置，
+ * 每个 pipeline 各自持有一份，互不影响
+ */
+int32_t vp_vse_init_config(vp_vflow_contex_t *vp_vflow_contex);
+/**
+ * 设置 pym 输出 buffer 数量和 feedback buffer 数量，
+ * 需要在 vp_vse_init_config 之后、vp_vse_init 之前调用
+ */
+int32_t vp_vse_set_buf_num(vp_vflow_contex_t *vp_vflow_contex,
+	uint32_t output_buf_num, uint32_t fb_buf_num);
 int32_t vp_vse_send_frame(vp_vflow_contex_t *vp_vflow_contex,
 	hbn_vnode_image_t *image_frame);
 int32_t vp_vse_get_frame(vp_vflow_contex_t *vp_vflow_contex,
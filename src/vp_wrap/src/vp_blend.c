@@ -0,0 +1,538 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-08 14:05:37
+ * @LastEditTime: 2024-11-08 14:05:37
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils/utils_log.h"
+
+#include "vp_display.h"
+#include "vp_blend.h"
+
+/* 合成公式（out、dst 为目标像素，c 为预乘后的图层颜色，a 为图层 alpha）：
+ *   RGBA: out = c + dst * (255 - a) / 255
+ *   Y:    out = Y(c) + (dst * (255 - a) + 16 * a) / 255
+ *   UV:   out = U(c) + (dst * (255 - a) + 128 * a) / 255，c、a 取 2x2 像素的平均值
+ * Y(c)、U(c) 为 BT.601 limited range 去掉偏移量的部分，对预乘颜色来说正好是 a 倍的颜色分量。
+ * 除以 255 统一用 (x + 128 + ((x + 128) >> 8)) >> 8，NEON 和 C 的结果逐位一致。
+ */
+
+typedef void (*blend_span_fn)(const vp_blend_layer_t *layer, int32_t x0, int32_t x1,
+	int32_t y0, int32_t y1, void *ctx);
+
+typedef struct {
+	uint8_t *y;
+	uint8_t *uv;
+	uint8_t *addr;
+	int32_t stride;
+	int32_t dst_x;
+	int32_t dst_y;
+} blend_target_t;
+
+static inline uint32_t blend_div255(uint32_t x)
+{
+	return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+static inline uint8_t blend_clamp(int32_t x)
+{
+	return (uint8_t)((x < 0) ? 0 : ((x > 255) ? 255 : x));
+}
+
+static inline void blend_load_pixel(const uint8_t *p, int32_t premultiplied,
+	int32_t *r, int32_t *g, int32_t *b, int32_t *a)
+{
+	*a = p[3];
+	if (premultiplied) {
+		*b = p[0];
+		*g = p[1];
+		*r = p[2];
+	} else {
+		*b = blend_div255(p[0] * *a);
+		*g = blend_div255(p[1] * *a);
+		*r = blend_div255(p[2] * *a);
+	}
+}
+
+static inline uint8_t blend_luma(uint8_t dst, int32_t r, int32_t g, int32_t b, int32_t a)
+{
+	int32_t lin = (66 * r + 129 * g + 25 * b + 128) >> 8;
+
+	return blend_clamp(blend_div255(dst * (255 - a) + 16 * a) + lin);
+}
+
+static inline uint8_t blend_chroma(uint8_t dst, int32_t lin, int32_t a)
+{
+	return blend_clamp((int32_t)blend_div255(dst * (255 - a) + 128 * a) + ((lin + 128) >> 8));
+}
+
+static void blend_nv12_span_c(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+	uint8_t *uv, int32_t count, int32_t premultiplied)
+{
+	int32_t i = 0, k = 0, r = 0, g = 0, b = 0, a = 0;
+	int32_t sum_r = 0, sum_g = 0, sum_b = 0, sum_a = 0;
+	const uint8_t *p = NULL;
+	uint8_t *py = NULL;
+
+	for (i = 0; i < count; i += 2) {
+		sum_r = sum_g = sum_b = sum_a = 0;
+		for (k = 0; k < 4; k++) {
+			p = ((k < 2) ? s0 : s1) + (i + (k & 1)) * 4;
+			py = ((k < 2) ? y0 : y1) + i + (k & 1);
+			blend_load_pixel(p, premultiplied, &r, &g, &b, &a);
+			*py = blend_luma(*py, r, g, b, a);
+			sum_r += r;
+			sum_g += g;
+			sum_b += b;
+			sum_a += a;
+		}
+		r = (sum_r + 2) >> 2;
+		g = (sum_g + 2) >> 2;
+		b = (sum_b + 2) >> 2;
+		a = (sum_a + 2) >> 2;
+		uv[i] = blend_chroma(uv[i], -38 * r - 74 * g + 112 * b, a);
+		uv[i + 1] = blend_chroma(uv[i + 1], 112 * r - 94 * g - 18 * b, a);
+	}
+}
+
+static void blend_rgba_span_c(const uint8_t *src, uint8_t *dst, int32_t count,
+	int32_t premultiplied)
+{
+	int32_t i = 0, r = 0, g = 0, b = 0, a = 0;
+
+	for (i = 0; i < count; i++, src += 4, dst += 4) {
+		blend_load_pixel(src, premultiplied, &r, &g, &b, &a);
+		dst[0] = blend_clamp(r + blend_div255(dst[0] * (255 - a)));
+		dst[1] = blend_clamp(g + blend_div255(dst[1] * (255 - a)));
+		dst[2] = blend_clamp(b + blend_div255(dst[2] * (255 - a)));
+		dst[3] = blend_clamp(a + blend_div255(dst[3] * (255 - a)));
+	}
+}
+
+#if defined(__ARM_NEON)
+static inline uint8x8_t blend_div255_n(uint16x8_t x)
+{
+	return vrshrn_n_u16(vrsraq_n_u16(x, x, 8), 8);
+}
+
+static inline uint8x16_t blend_mul_q(uint8x16_t c, uint8x16_t a)
+{
+	return vcombine_u8(blend_div255_n(vmull_u8(vget_low_u8(c), vget_low_u8(a))),
+		blend_div255_n(vmull_u8(vget_high_u8(c), vget_high_u8(a))));
+}
+
+static inline uint8x8_t blend_luma_n(uint8x8_t dst, uint8x8_t r, uint8x8_t g, uint8x8_t b,
+	uint8x8_t a)
+{
+	uint16x8_t lin = vmull_u8(r, vdup_n_u8(66));
+	uint16x8_t mix = vmull_u8(dst, vmvn_u8(a));
+
+	lin = vmlal_u8(lin, g, vdup_n_u8(129));
+	lin = vmlal_u8(lin, b, vdup_n_u8(25));
+	mix = vmlal_u8(mix, a, vdup_n_u8(16));
+
+	return vqadd_u8(blend_div255_n(mix), vrshrn_n_u16(lin, 8));
+}
+
+static inline uint8x16_t blend_luma_q(uint8x16_t dst, uint8x16x4_t px)
+{
+	return vcombine_u8(
+		blend_luma_n(vget_low_u8(dst), vget_low_u8(px.val[2]), vget_low_u8(px.val[1]),
+			vget_low_u8(px.val[0]), vget_low_u8(px.val[3])),
+		blend_luma_n(vget_high_u8(dst), vget_high_u8(px.val[2]), vget_high_u8(px.val[1]),
+			vget_high_u8(px.val[0]), vget_high_u8(px.val[3])));
+}
+
+static inline uint8x8_t blend_chroma_n(uint8x8_t dst, int16x8_t lin, uint8x8_t a)
+{
+	uint16x8_t mix = vmull_u8(dst, vmvn_u8(a));
+
+	mix = vmlal_u8(mix, a, vdup_n_u8(128));
+	mix = vrshrq_n_u16(vrsraq_n_u16(mix, mix, 8), 8);
+
+	return vqmovun_s16(vaddq_s16(vreinterpretq_s16_u16(mix), vrshrq_n_s16(lin, 8)));
+}
+
+static inline uint8x16x4_t blend_load_q(const uint8_t *src, int32_t premultiplied)
+{
+	uint8x16x4_t px = vld4q_u8(src);
+
+	if (!premultiplied) {
+		px.val[0] = blend_mul_q(px.val[0], px.val[3]);
+		px.val[1] = blend_mul_q(px.val[1], px.val[3]);
+		px.val[2] = blend_mul_q(px.val[2], px.val[3]);
+	}
+
+	return px;
+}
+
+// 一次处理两行各 16 个像素，对应 8 组 UV
+static void blend_nv12_span_neon(const uint8_t *s0, const uint8_t *s1, uint8_t *y0, uint8_t *y1,
+	uint8_t *uv, int32_t count, int32_t premultiplied)
+{
+	int32_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t p0 = blend_load_q(s0 + i * 4, premultiplied);
+		uint8x16x4_t p1 = blend_load_q(s1 + i * 4, premultiplied);
+		uint16x8_t sum_b = vpadalq_u8(vpaddlq_u8(p0.val[0]), p1.val[0]);
+		uint16x8_t sum_g = vpadalq_u8(vpaddlq_u8(p0.val[1]), p1.val[1]);
+		uint16x8_t sum_r = vpadalq_u8(vpaddlq_u8(p0.val[2]), p1.val[2]);
+		uint16x8_t sum_a = vpadalq_u8(vpaddlq_u8(p0.val[3]), p1.val[3]);
+		int16x8_t b = vreinterpretq_s16_u16(vrshrq_n_u16(sum_b, 2));
+		int16x8_t g = vreinterpretq_s16_u16(vrshrq_n_u16(sum_g, 2));
+		int16x8_t r = vreinterpretq_s16_u16(vrshrq_n_u16(sum_r, 2));
+		uint8x8_t a = vmovn_u16(vrshrq_n_u16(sum_a, 2));
+		int16x8_t u = vmulq_n_s16(b, 112);
+		int16x8_t v = vmulq_n_s16(r, 112);
+		uint8x8x2_t dst_uv = vld2_u8(uv + i);
+
+		vst1q_u8(y0 + i, blend_luma_q(vld1q_u8(y0 + i), p0));
+		vst1q_u8(y1 + i, blend_luma_q(vld1q_u8(y1 + i), p1));
+
+		u = vmlsq_n_s16(u, r, 38);
+		u = vmlsq_n_s16(u, g, 74);
+		v = vmlsq_n_s16(v, g, 94);
+		v = vmlsq_n_s16(v, b, 18);
+		dst_uv.val[0] = blend_chroma_n(dst_uv.val[0], u, a);
+		dst_uv.val[1] = blend_chroma_n(dst_uv.val[1], v, a);
+		vst2_u8(uv + i, dst_uv);
+	}
+
+	if (i < count)
+		blend_nv12_span_c(s0 + i * 4, s1 + i * 4, y0 + i, y1 + i, uv + i, count - i,
+			premultiplied);
+}
+
+static inline uint8x16_t blend_over_q(uint8x16_t c, uint8x16_t dst, uint8x16_t inv_a)
+{
+	uint8x8_t lo = blend_div255_n(vmull_u8(vget_low_u8(dst), vget_low_u8(inv_a)));
+	uint8x8_t hi = blend_div255_n(vmull_u8(vget_high_u8(dst), vget_high_u8(inv_a)));
+
+	return vqaddq_u8(c, vcombine_u8(lo, hi));
+}
+
+static void blend_rgba_span_neon(const uint8_t *src, uint8_t *dst, int32_t count,
+	int32_t premultiplied)
+{
+	int32_t i = 0;
+
+	for (; i + 16 <= count; i += 16) {
+		uint8x16x4_t px = blend_load_q(src + i * 4, premultiplied);
+		uint8x16x4_t out = vld4q_u8(dst + i * 4);
+		uint8x16_t inv_a = vmvnq_u8(px.val[3]);
+
+		out.val[0] = blend_over_q(px.val[2], out.val[0], inv_a);
+		out.val[1] = blend_over_q(px.val[1], out.val[1], inv_a);
+		out.val[2] = blend_over_q(px.val[0], out.val[2], inv_a);
+		out.val[3] = blend_over_q(px.val[3], out.val[3], inv_a);
+		vst4q_u8(dst + i * 4, out);
+	}
+
+	if (i < count)
+		blend_rgba_span_c(src + i * 4, dst + i * 4, count - i, premultiplied);
+}
+#endif
+
+static int32_t blend_scan_tile(const vp_blend_layer_t *layer, int32_t tx, int32_t ty)
+{
+	int32_t x0 = tx * VP_BLEND_TILE_SIZE, y0 = ty * VP_BLEND_TILE_SIZE;
+	int32_t x1 = x0 + VP_BLEND_TILE_SIZE, y1 = y0 + VP_BLEND_TILE_SIZE;
+	int32_t row = 0, i = 0;
+	const uint32_t *p = NULL;
+
+	x1 = (x1 > layer->width) ? layer->width : x1;
+	y1 = (y1 > layer->height) ? layer->height : y1;
+
+	for (row = y0; row < y1; row++) {
+		p = (const uint32_t *)(layer->addr + row * layer->stride) + x0;
+		i = 0;
+#if defined(__ARM_NEON)
+		{
+			uint32x4_t acc = vdupq_n_u32(0);
+			uint64x2_t any;
+
+			for (; i + 4 <= x1 - x0; i += 4)
+				acc = vorrq_u32(acc, vld1q_u32(p + i));
+			any = vreinterpretq_u64_u32(vandq_u32(acc, vdupq_n_u32(0xff000000)));
+			if (vgetq_lane_u64(any, 0) | vgetq_lane_u64(any, 1))
+				return 1;
+		}
+#endif
+		for (; i < x1 - x0; i++) {
+			if (p[i] & 0xff000000)
+				return 1;
+		}
+	}
+
+	return 0;
+}
+
+int32_t vp_blend_layer_init(vp_blend_layer_t *layer, const uint8_t *addr,
+	int32_t width, int32_t height, int32_t stride, int32_t premultiplied)
+{
+	if ((layer == NULL) || (addr == NULL) || (width <= 0) || (height <= 0)) {
+		SC_LOGE("invalid blend layer\n");
+		return -1;
+	}
+
+	memset(layer, 0, sizeof(vp_blend_layer_t));
+	layer->tiles_x = (width + VP_BLEND_TILE_SIZE - 1) / VP_BLEND_TILE_SIZE;
+	layer->tiles_y = (height + VP_BLEND_TILE_SIZE - 1) / VP_BLEND_TILE_SIZE;
+	layer->tile_mask = (uint8_t *)calloc(layer->tiles_x * layer->tiles_y, 1);
+	if (layer->tile_mask == NULL) {
+		SC_LOGE("alloc tile mask %dx%d failed\n", layer->tiles_x, layer->tiles_y);
+		return -1;
+	}
+	layer->addr = addr;
+	layer->width = width;
+	layer->height = height;
+	layer->stride = (stride > 0) ? stride : width * DISPLAY_ARGB_BYTES;
+	layer->premultiplied = premultiplied;
+
+	return 0;
+}
+
+void vp_blend_layer_deinit(vp_blend_layer_t *layer)
+{
+	free(layer->tile_mask);
+	memset(layer, 0, sizeof(vp_blend_layer_t));
+}
+
+static void blend_layer_update_rect(vp_blend_layer_t *layer, const vp_overlay_rect_t *rect)
+{
+	int32_t x0 = (rect->x > 0) ? rect->x : 0;
+	int32_t y0 = (rect->y > 0) ? rect->y : 0;
+	int32_t x1 = rect->x + rect->w, y1 = rect->y + rect->h;
+	int32_t tx = 0, ty = 0;
+	uint8_t *mask = NULL;
+
+	x1 = (x1 > layer->width) ? layer->width : x1;
+	y1 = (y1 > layer->height) ? layer->height : y1;
+	if ((x1 <= x0) || (y1 <= y0))
+		return;
+
+	for (ty = y0 / VP_BLEND_TILE_SIZE; ty <= (y1 - 1) / VP_BLEND_TILE_SIZE; ty++) {
+		for (tx = x0 / VP_BLEND_TILE_SIZE; tx <= (x1 - 1) / VP_BLEND_TILE_SIZE; tx++) {
+			mask = &layer->tile_mask[ty * layer->tiles_x + tx];
+			layer->active_tiles -= *mask;
+			*mask = (uint8_t)blend_scan_tile(layer, tx, ty);
+			layer->active_tiles += *mask;
+		}
+	}
+}
+
+int32_t vp_blend_layer_update(vp_blend_layer_t *layer, const vp_overlay_rect_t *rects,
+	int32_t count)
+{
+	vp_overlay_rect_t all;
+	int32_t i = 0;
+
+	if ((layer == NULL) || (layer->tile_mask == NULL)) {
+		SC_LOGE("blend layer not inited\n");
+		return -1;
+	}
+
+	if (rects == NULL) {
+		all = (vp_overlay_rect_t){0, 0, layer->width, layer->height};
+		blend_layer_update_rect(layer, &all);
+	} else {
+		for (i = 0; i < count; i++)
+			blend_layer_update_rect(layer, &rects[i]);
+	}
+
+	return layer->active_tiles;
+}
+
+int32_t vp_blend_layer_sync(vp_blend_layer_t *layer, const vp_overlay_surface_t *surface)
+{
+	if ((layer == NULL) || (layer->tile_mask == NULL) || (surface == NULL) ||
+		(layer->addr != surface->addr)) {
+		SC_LOGE("blend layer does not match overlay surface\n");
+		return -1;
+	}
+
+	if (!surface->has_content) {
+		if (layer->active_tiles > 0)
+			memset(layer->tile_mask, 0, layer->tiles_x * layer->tiles_y);
+		layer->active_tiles = 0;
+		layer->synced = 0;
+		return 0;
+	}
+	if (layer->synced && (layer->content_hash == surface->content_hash))
+		return layer->active_tiles;
+
+	memset(layer->tile_mask, 0, layer->tiles_x * layer->tiles_y);
+	layer->active_tiles = 0;
+	vp_blend_layer_update(layer, surface->dirty, surface->dirty_count);
+	layer->content_hash = surface->content_hash;
+	layer->synced = 1;
+
+	return layer->active_tiles;
+}
+
+/* 求 region、图层、目标图像三者的交集（图层坐标），align 为 2 时向外扩展到偶数边界，
+ * 然后按 tile 行遍历，把每一段连续的有内容 tile 交给 fn 处理
+ */
+static int32_t blend_for_each_span(const vp_blend_layer_t *layer, const vp_overlay_rect_t *region,
+	int32_t width, int32_t height, int32_t dst_x, int32_t dst_y, int32_t align,
+	blend_span_fn fn, void *ctx)
+{
+	int32_t x0 = 0, y0 = 0, x1 = 0, y1 = 0;
+	int32_t max_x = 0, max_y = 0, tx = 0, ty = 0, run = 0;
+	int32_t row0 = 0, row1 = 0;
+	const uint8_t *mask = NULL;
+
+	if ((layer == NULL) || (layer->tile_mask == NULL)) {
+		SC_LOGE("blend layer not inited\n");
+		return -1;
+	}
+	if (layer->active_tiles <= 0)
+		return 0;
+
+	if (region != NULL) {
+		x0 = region->x;
+		y0 = region->y;
+		x1 = region->x + region->w;
+		y1 = region->y + region->h;
+	} else {
+		x1 = layer->width;
+		y1 = layer->height;
+	}
+	x0 -= x0 & (align - 1);
+	y0 -= y0 & (align - 1);
+	x1 += x1 & (align - 1);
+	y1 += y1 & (align - 1);
+
+	max_x = (layer->width < width - dst_x) ? layer->width : width - dst_x;
+	max_y = (layer->height < height - dst_y) ? layer->height : height - dst_y;
+	max_x -= max_x & (align - 1);
+	max_y -= max_y & (align - 1);
+	x0 = (x0 > -dst_x) ? x0 : -dst_x;
+	y0 = (y0 > -dst_y) ? y0 : -dst_y;
+	x0 = (x0 > 0) ? x0 : 0;
+	y0 = (y0 > 0) ? y0 : 0;
+	x1 = (x1 < max_x) ? x1 : max_x;
+	y1 = (y1 < max_y) ? y1 : max_y;
+	if ((x1 <= x0) || (y1 <= y0))
+		return 0;
+
+	for (ty = y0 / VP_BLEND_TILE_SIZE; ty <= (y1 - 1) / VP_BLEND_TILE_SIZE; ty++) {
+		mask = &layer->tile_mask[ty * layer->tiles_x];
+		row0 = ty * VP_BLEND_TILE_SIZE;
+		row1 = row0 + VP_BLEND_TILE_SIZE;
+		row0 = (row0 > y0) ? row0 : y0;
+		row1 = (row1 < y1) ? row1 : y1;
+		for (tx = x0 / VP_BLEND_TILE_SIZE; tx <= (x1 - 1) / VP_BLEND_TILE_SIZE; tx++) {
+			if (!mask[tx])
+				continue;
+			// 相邻的有内容 tile 合并成一段，减少逐段调用的开销
+			for (run = tx; (run + 1 <= (x1 - 1) / VP_BLEND_TILE_SIZE) && mask[run + 1]; run++)
+				;
+			fn(layer,
+				(tx * VP_BLEND_TILE_SIZE > x0) ? tx * VP_BLEND_TILE_SIZE : x0,
+				((run + 1) * VP_BLEND_TILE_SIZE < x1) ? (run + 1) * VP_BLEND_TILE_SIZE : x1,
+				row0, row1, ctx);
+			tx = run;
+		}
+	}
+
+	return 0;
+}
+
+static void blend_nv12_span(const vp_blend_layer_t *layer, int32_t x0, int32_t x1,
+	int32_t y0, int32_t y1, void *ctx)
+{
+	blend_target_t *target = (blend_target_t *)ctx;
+	const uint8_t *src = NULL;
+	uint8_t *dst_y = NULL, *dst_uv = NULL;
+	int32_t row = 0;
+
+	for (row = y0; row < y1; row += 2) {
+		src = layer->addr + row * layer->stride + x0 * 4;
+		dst_y = target->y + (row + target->dst_y) * target->stride + x0 + target->dst_x;
+		dst_uv = target->uv + ((row + target->dst_y) / 2) * target->stride + x0 + target->dst_x;
+#if defined(__ARM_NEON)
+		blend_nv12_span_neon(src, src + layer->stride, dst_y, dst_y + target->stride,
+			dst_uv, x1 - x0, layer->premultiplied);
+#else
+		blend_nv12_span_c(src, src + layer->stride, dst_y, dst_y + target->stride,
+			dst_uv, x1 - x0, layer->premultiplied);
+#endif
+	}
+}
+
+static void blend_rgba_span(const vp_blend_layer_t *layer, int32_t x0, int32_t x1,
+	int32_t y0, int32_t y1, void *ctx)
+{
+	blend_target_t *target = (blend_target_t *)ctx;
+	const uint8_t *src = NULL;
+	uint8_t *dst = NULL;
+	int32_t row = 0;
+
+	for (row = y0; row < y1; row++) {
+		src = layer->addr + row * layer->stride + x0 * 4;
+		dst = target->addr + (row + target->dst_y) * target->stride + (x0 + target->dst_x) * 4;
+#if defined(__ARM_NEON)
+		blend_rgba_span_neon(src, dst, x1 - x0, layer->premultiplied);
+#else
+		blend_rgba_span_c(src, dst, x1 - x0, layer->premultiplied);
+#endif
+	}
+}
+
+int32_t vp_blend_nv12(const vp_blend_layer_t *layer, const vp_overlay_rect_t *region,
+	uint8_t *y, uint8_t *uv, int32_t stride, int32_t width, int32_t height,
+	int32_t dst_x, int32_t dst_y)
+{
+	blend_target_t target;
+
+	if ((y == NULL) || (uv == NULL) || (width <= 0) || (height <= 0)) {
+		SC_LOGE("invalid nv12 blend target\n");
+		return -1;
+	}
+	if ((dst_x & 1) || (dst_y & 1)) {
+		SC_LOGE("nv12 blend position (%d, %d) must be even\n", dst_x, dst_y);
+		return -1;
+	}
+
+	memset(&target, 0, sizeof(target));
+	target.y = y;
+	target.uv = uv;
+	target.stride = (stride > 0) ? stride : width;
+	target.dst_x = dst_x;
+	target.dst_y = dst_y;
+
+	return blend_for_each_span(layer, region, width, height, dst_x, dst_y, 2,
+		blend_nv12_span, &target);
+}
+
+int32_t vp_blend_rgba(const vp_blend_layer_t *layer, const vp_overlay_rect_t *region,
+	uint8_t *dst, int32_t stride, int32_t width, int32_t height,
+	int32_t dst_x, int32_t dst_y)
+{
+	blend_target_t target;
+
+	if ((dst == NULL) || (width <= 0) || (height <= 0)) {
+		SC_LOGE("invalid rgba blend target\n");
+		return -1;
+	}
+
+	memset(&target, 0, sizeof(target));
+	target.addr = dst;
+	target.stride = (stride > 0) ? stride : width * 4;
+	target.dst_x = dst_x;
+	target.dst_y = dst_y;
+
+	return blend_for_each_span(layer, region, width, height, dst_x, dst_y, 1,
+		blend_rgba_span, &target);
+}
@@ -0,0 +1,1020 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-05 15:02:47
+ * @LastEditTime: 2024-11-05 15:02:47
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <poll.h>
+
+#include "utils/utils_log.h"
+
+#include "vp_display.h"
+#include "vp_overlay.h"
+#include "vp_wrap.h"
+
+#define DRM_DEVICE_PROBE_MAX 8
+#define DRM_FLIP_POLL_TIMEOUT_MS 100
+#define DRM_FLIP_WAIT_TIMEOUT_MS 100
+
+void vp_display_draw_rect(uint8_t *frame, int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+	int32_t color, int32_t fill, int32_t screen_width, int32_t screen_height,
+	int32_t line_width)
+{
+	vp_overlay_rect_t edges[4];
+	int32_t stride = screen_width * DISPLAY_ARGB_BYTES;
+	int32_t count = 0, i = 0;
+
+	if (fill) {
+		edges[0].x = (x0 < x1) ? x0 : x1;
+		edges[0].y = (y0 < y1) ? y0 : y1;
+		edges[0].w = ((x0 > x1) ? x0 : x1) - edges[0].x + 1;
+		edges[0].h = ((y0 > y1) ? y0 : y1) - edges[0].y + 1;
+		count = 1;
+	} else {
+		count = vp_overlay_box_edges(x0, y0, x1, y1, line_width, edges);
+	}
+
+	for (i = 0; i < count; i++) {
+		vp_overlay_fill_rect(frame, stride, screen_width, screen_height,
+			edges[i].x, edges[i].y, edges[i].w, edges[i].h, (uint32_t)color);
+	}
+}
+
+int32_t vp_display_draw_word(uint8_t *addr, int32_t x, int32_t y, char *str, int32_t width, int32_t color, int32_t line_width)
+{
+	// 调用者没有给出 buffer 高度，这里只按宽度裁剪
+	return vp_overlay_draw_text(addr, width * DISPLAY_ARGB_BYTES, width, INT32_MAX / 2,
+		x, y, str, (uint32_t)color, line_width, NULL);
+}
+
+static uint32_t get_format_from_string(const char *format_str)
+{
+	if (strcmp(format_str, "AR12") == 0)
+	{
+		return DRM_FORMAT_ARGB4444;
+	}
+	else if (strcmp(format_str, "AR15") == 0)
+	{
+		return DRM_FORMAT_ARGB1555;
+	}
+	else if (strcmp(format_str, "RG16") == 0)
+	{
+		return DRM_FORMAT_RGB565;
+	}
+	else if (strcmp(format_str, "AR24") == 0)
+	{
+		return DRM_FORMAT_ARGB8888;
+	}
+	else if (strcmp(format_str, "RA12") == 0)
+	{
+		return DRM_FORMAT_RGBA4444;
+	}
+	else if (strcmp(format_str, "RA15") == 0)
+	{
+		return DRM_FORMAT_RGBA5551;
+	}
+	else if (strcmp(format_str, "RA24") == 0)
+	{
+		return DRM_FORMAT_RGBA8888;
+	}
+	else if (strcmp(format_str, "AB12") == 0)
+	{
+		return DRM_FORMAT_ABGR4444;
+	}
+	else if (strcmp(format_str, "AB15") == 0)
+	{
+		return DRM_FORMAT_ABGR1555;
+	}
+	else if (strcmp(format_str, "BG16") == 0)
+	{
+		return DRM_FORMAT_BGR565;
+	}
+	else if (strcmp(format_str, "BG24") == 0)
+	{
+		return DRM_FORMAT_BGR888;
+	}
+	else if (strcmp(format_str, "AB24") == 0)
+	{
+		return DRM_FORMAT_ABGR8888;
+	}
+	else if (strcmp(format_str, "BA12") == 0)
+	{
+		return DRM_FORMAT_BGRA4444;
+	}
+	else if (strcmp(format_str, "BA15") == 0)
+	{
+		return DRM_FORMAT_BGRA5551;
+	}
+	else if (strcmp(format_str, "BA24") == 0)
+	{
+		return DRM_FORMAT_BGRA8888;
+	}
+	else if (strcmp(format_str, "YUYV") == 0)
+	{
+		return DRM_FORMAT_YUYV;
+	}
+	else if (strcmp(format_str, "YVYU") == 0)
+	{
+		return DRM_FORMAT_YVYU;
+	}
+	else if (strcmp(format_str, "NV12") == 0)
+	{
+		return DRM_FORMAT_NV12;
+	}
+	else if (strcmp(format_str, "NV21") == 0)
+	{
+		return DRM_FORMAT_NV21;
+	}
+	else
+	{
+		return 0; // Unsupported format
+	}
+}
+
+
+static uint32_t drm_get_prop_id(int drm_fd, uint32_t obj_id, uint32_t obj_type,
+	const char *name)
+{
+	drmModeObjectProperties *props = NULL;
+	drmModePropertyRes *prop = NULL;
+	uint32_t prop_id = 0;
+	uint32_t i = 0;
+
+	props = drmModeObjectGetProperties(drm_fd, obj_id, obj_type);
+	if (props == NULL)
+		return 0;
+
+	for (i = 0; (i < props->count_props) && (prop_id == 0); i++) {
+		prop = drmModeGetProperty(drm_fd, props->props[i]);
+		if (prop == NULL)
+			continue;
+		if (strcmp(prop->name, name) == 0)
+			prop_id = prop->prop_id;
+		drmModeFreeProperty(prop);
+	}
+
+	drmModeFreeObjectProperties(props);
+
+	return prop_id;
+}
+
+static uint64_t drm_get_prop_value(int drm_fd, uint32_t obj_id, uint32_t obj_type,
+	const char *name, uint64_t def_value)
+{
+	drmModeObjectProperties *props = NULL;
+	drmModePropertyRes *prop = NULL;
+	uint64_t value = def_value;
+	uint32_t i = 0;
+
+	props = drmModeObjectGetProperties(drm_fd, obj_id, obj_type);
+	if (props == NULL)
+		return def_value;
+
+	for (i = 0; i < props->count_props; i++) {
+		prop = drmModeGetProperty(drm_fd, props->props[i]);
+		if (prop == NULL)
+			continue;
+		if (strcmp(prop->name, name) == 0) {
+			value = props->prop_values[i];
+			drmModeFreeProperty(prop);
+			break;
+		}
+		drmModeFreeProperty(prop);
+	}
+
+	drmModeFreeObjectProperties(props);
+
+	return value;
+}
+
+static void drm_add_prop(drmModeAtomicReq *req, uint32_t obj_id,
+	uint32_t prop_id, uint64_t value)
+{
+	// 驱动不支持的可选属性（例如 zpos）查询结果为 0，直接跳过
+	if (prop_id != 0)
+		drmModeAtomicAddProperty(req, obj_id, prop_id, value);
+}
+
+static int32_t drm_has_connected_output(int drm_fd)
+{
+	drmModeRes *resources = NULL;
+	drmModeConnector *conn = NULL;
+	int32_t found = 0;
+	int i = 0;
+
+	resources = drmModeGetResources(drm_fd);
+	if (resources == NULL)
+		return 0;
+
+	for (i = 0; (i < resources->count_connectors) && !found; i++) {
+		conn = drmModeGetConnector(drm_fd, resources->connectors[i]);
+		if (conn == NULL)
+			continue;
+		found = (conn->connection == DRM_MODE_CONNECTED) && (conn->count_modes > 0);
+		drmModeFreeConnector(conn);
+	}
+
+	drmModeFreeResources(resources);
+
+	return found;
+}
+
+/* 设备选择顺序：环境变量指定的节点 -> 板端的 vs-drm 驱动 -> 第一个有已连接输出的 cardN
+ * (例如 PC 上加载的 vkms)
+ */
+static int drm_open_device(void)
+{
+	const char *dev = getenv(VP_DISPLAY_DEVICE_ENV);
+	char path[32];
+	int fd = -1;
+	int i = 0;
+
+	if ((dev != NULL) && (dev[0] != '\0')) {
+		fd = open(dev, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			SC_LOGE("open %s failed: %s\n", dev, strerror(errno));
+		return fd;
+	}
+
+	fd = drmOpen("vs-drm", NULL);
+	if (fd >= 0)
+		return fd;
+
+	for (i = 0; i < DRM_DEVICE_PROBE_MAX; i++) {
+		snprintf(path, sizeof(path), "/dev/dri/card%d", i);
+		fd = open(path, O_RDWR | O_CLOEXEC);
+		if (fd < 0)
+			continue;
+		if (drm_has_connected_output(fd))
+			return fd;
+		close(fd);
+	}
+
+	return -1;
+}
+
+int32_t vp_display_is_available(void)
+{
+	int32_t available = 1;
+	int fd = -1;
+
+	fd = drm_open_device();
+	if (fd < 0)
+		return 0;
+
+	// 尝试获取 DRM master 权限, 如果失败则表示设备被占用
+	if (drmSetMaster(fd) != 0) {
+		if (errno == EBUSY)
+			available = 0;
+	} else {
+		drmDropMaster(fd);
+	}
+
+	close(fd);
+
+	return available;
+}
+
+/* 选择输出：优先已连接的 HDMI，其次任意已连接的 connector（vkms 为 Virtual 类型）。
+ * 显示模式优先与请求分辨率一致，其次为 preferred 模式
+ * 返回 crtc 在资源列表中的序号，用于判断图层能否挂到该 crtc 上
+ */
+static int32_t drm_select_output(vp_drm_context_t *ctx, int32_t width, int32_t height)
+{
+	drmModeRes *resources = NULL;
+	drmModeConnector *conn = NULL;
+	drmModeEncoder *encoder = NULL;
+	drmModeModeInfo *mode = NULL;
+	int32_t crtc_index = -1;
+	int pass = 0, i = 0, j = 0;
+
+	resources = drmModeGetResources(ctx->drm_fd);
+	if (resources == NULL) {
+		SC_LOGE("drmModeGetResources failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (pass = 0; (pass < 2) && (conn == NULL); pass++) {
+		for (i = 0; i < resources->count_connectors; i++) {
+			conn = drmModeGetConnector(ctx->drm_fd, resources->connectors[i]);
+			if ((conn != NULL) && (conn->connection == DRM_MODE_CONNECTED) &&
+				(conn->count_modes > 0) &&
+				((pass == 1) || (conn->connector_type == DRM_MODE_CONNECTOR_HDMIA)))
+				break;
+			if (conn != NULL)
+				drmModeFreeConnector(conn);
+			conn = NULL;
+		}
+	}
+
+	if (conn == NULL) {
+		SC_LOGE("no connected connector found\n");
+		drmModeFreeResources(resources);
+		return -1;
+	}
+
+	for (i = 0; (i < conn->count_modes) && (mode == NULL); i++) {
+		if ((conn->modes[i].hdisplay == width) && (conn->modes[i].vdisplay == height))
+			mode = &conn->modes[i];
+	}
+	for (i = 0; (i < conn->count_modes) && (mode == NULL); i++) {
+		if (conn->modes[i].type & DRM_MODE_TYPE_PREFERRED)
+			mode = &conn->modes[i];
+	}
+	if (mode == NULL)
+		mode = &conn->modes[0];
+	memcpy(&ctx->mode, mode, sizeof(drmModeModeInfo));
+
+	for (i = 0; (i < conn->count_encoders) && (crtc_index < 0); i++) {
+		encoder = drmModeGetEncoder(ctx->drm_fd, conn->encoders[i]);
+		if (encoder == NULL)
+			continue;
+		for (j = 0; j < resources->count_crtcs; j++) {
+			if (encoder->possible_crtcs & (1u << j)) {
+				crtc_index = j;
+				break;
+			}
+		}
+		drmModeFreeEncoder(encoder);
+	}
+
+	if (crtc_index < 0) {
+		SC_LOGE("no crtc for connector %u\n", conn->connector_id);
+	} else {
+		ctx->connector_id = conn->connector_id;
+		ctx->crtc_id = resources->crtcs[crtc_index];
+	}
+
+	drmModeFreeConnector(conn);
+	drmModeFreeResources(resources);
+
+	return crtc_index;
+}
+
+static int32_t drm_plane_support_format(drmModePlane *plane, uint32_t format)
+{
+	uint32_t i = 0;
+
+	for (i = 0; i < plane->count_formats; i++) {
+		if (plane->formats[i] == format)
+			return 1;
+	}
+
+	return 0;
+}
+
+static void drm_init_plane_config(vp_drm_context_t *ctx, int32_t idx,
+	uint32_t plane_id, const char *format, int32_t width, int32_t height)
+{
+	drm_plane_config_t *cfg = &ctx->planes[idx];
+
+	memset(cfg, 0, sizeof(drm_plane_config_t));
+	cfg->plane_id = plane_id;
+	cfg->src_w = width;
+	cfg->src_h = height;
+	// 视频和 OSD 都铺满整个屏幕，分辨率与显示模式不同时由显示控制器缩放
+	cfg->crtc_x = 0;
+	cfg->crtc_y = 0;
+	cfg->crtc_w = ctx->mode.hdisplay;
+	cfg->crtc_h = ctx->mode.vdisplay;
+	snprintf(cfg->format, sizeof(cfg->format), "%s", format);
+	cfg->z_pos = idx;
+	cfg->alpha = -1;
+	cfg->pixel_blend_mode = -1;
+	cfg->rotation = -1;
+	cfg->color_encoding = -1;
+	cfg->color_range = -1;
+}
+
+/* 视频图层选能显示 NV12 的图层，优先 primary（位于最底层）；
+ * OSD 图层选剩下的能显示 ARGB8888 的图层，优先 overlay。没有可用的 OSD 图层时只显示视频
+ */
+static int32_t drm_select_planes(vp_drm_context_t *ctx, int32_t crtc_index,
+	int32_t width, int32_t height)
+{
+	drmModePlaneRes *plane_res = NULL;
+	drmModePlane *plane = NULL;
+	uint32_t video_plane = 0, osd_plane = 0;
+	uint64_t video_type = 0, osd_type = 0, type = 0;
+	uint32_t i = 0;
+
+	plane_res = drmModeGetPlaneResources(ctx->drm_fd);
+	if (plane_res == NULL) {
+		SC_LOGE("drmModeGetPlaneResources failed: %s\n", strerror(errno));
+		return -1;
+	}
+
+	for (i = 0; i < plane_res->count_planes; i++) {
+		plane = drmModeGetPlane(ctx->drm_fd, plane_res->planes[i]);
+		if (plane == NULL)
+			continue;
+		type = drm_get_prop_value(ctx->drm_fd, plane->plane_id,
+			DRM_MODE_OBJECT_PLANE, "type", DRM_PLANE_TYPE_OVERLAY);
+		if ((plane->possible_crtcs & (1u << crtc_index)) &&
+			(type != DRM_PLANE_TYPE_CURSOR) &&
+			drm_plane_support_format(plane, DRM_FORMAT_NV12) &&
+			((video_plane == 0) ||
+			((type == DRM_PLANE_TYPE_PRIMARY) && (video_type != DRM_PLANE_TYPE_PRIMARY)))) {
+			video_plane = plane->plane_id;
+			video_type = type;
+		}
+		drmModeFreePlane(plane);
+	}
+
+	for (i = 0; i < plane_res->count_planes; i++) {
+		plane = drmModeGetPlane(ctx->drm_fd, plane_res->planes[i]);
+		if (plane == NULL)
+			continue;
+		type = drm_get_prop_value(ctx->drm_fd, plane->plane_id,
+			DRM_MODE_OBJECT_PLANE, "type", DRM_PLANE_TYPE_OVERLAY);
+		if ((plane->plane_id != video_plane) &&
+			(plane->possible_crtcs & (1u << crtc_index)) &&
+			(type != DRM_PLANE_TYPE_CURSOR) &&
+			drm_plane_support_format(plane, DRM_FORMAT_ARGB8888) &&
+			((osd_plane == 0) ||
+			((type == DRM_PLANE_TYPE_OVERLAY) && (osd_type != DRM_PLANE_TYPE_OVERLAY)))) {
+			osd_plane = plane->plane_id;
+			osd_type = type;
+		}
+		drmModeFreePlane(plane);
+	}
+
+	drmModeFreePlaneResources(plane_res);
+
+	if (video_plane == 0) {
+		SC_LOGE("no plane supports NV12 on crtc %u\n", ctx->crtc_id);
+		return -1;
+	}
+
+	drm_init_plane_config(ctx, VP_DISPLAY_PLANE_VIDEO, video_plane, "NV12", width, height);
+	ctx->plane_count = 1;
+	if (osd_plane != 0) {
+		drm_init_plane_config(ctx, VP_DISPLAY_PLANE_OSD, osd_plane, "AR24", width, height);
+		ctx->plane_count = 2;
+	} else {
+		SC_LOGW("no overlay plane supports ARGB8888, osd disabled\n");
+	}
+
+	return 0;
+}
+
+static int32_t drm_init_props(vp_drm_context_t *ctx)
+{
+	drm_plane_props_t *props = NULL;
+	uint32_t plane_id = 0;
+	int32_t i = 0;
+
+	ctx->crtc_active_prop = drm_get_prop_id(ctx->drm_fd, ctx->crtc_id,
+		DRM_MODE_OBJECT_CRTC, "ACTIVE");
+	ctx->crtc_mode_prop = drm_get_prop_id(ctx->drm_fd, ctx->crtc_id,
+		DRM_MODE_OBJECT_CRTC, "MODE_ID");
+	ctx->conn_crtc_prop = drm_get_prop_id(ctx->drm_fd, ctx->connector_id,
+		DRM_MODE_OBJECT_CONNECTOR, "CRTC_ID");
+	if ((ctx->crtc_active_prop == 0) || (ctx->crtc_mode_prop == 0) ||
+		(ctx->conn_crtc_prop == 0)) {
+		SC_LOGE("crtc/connector atomic properties not found\n");
+		return -1;
+	}
+
+	for (i = 0; i < ctx->plane_count; i++) {
+		props = &ctx->plane_props[i];
+		plane_id = ctx->planes[i].plane_id;
+		props->fb_id = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "FB_ID");
+		props->crtc_id = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_ID");
+		props->src_x = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_X");
+		props->src_y = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_Y");
+		props->src_w = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_W");
+		props->src_h = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "SRC_H");
+		props->crtc_x = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_X");
+		props->crtc_y = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_Y");
+		props->crtc_w = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_W");
+		props->crtc_h = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "CRTC_H");
+		props->zpos = drm_get_prop_id(ctx->drm_fd, plane_id, DRM_MODE_OBJECT_PLANE, "zpos");
+		if ((props->fb_id == 0) || (props->crtc_id == 0)) {
+			SC_LOGE("plane %u atomic properties not found\n", plane_id);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+static int32_t drm_buffer_busy_locked(vp_drm_context_t *ctx, int32_t plane_idx,
+	int32_t dma_buf_fd)
+{
+	drm_plane_state_t *state = NULL;
+	int32_t i = 0;
+
+	for (i = 0; i < ctx->plane_count; i++) {
+		if ((plane_idx >= 0) && (plane_idx != i))
+			continue;
+		state = &ctx->plane_state[i];
+		if ((state->pending_fd == dma_buf_fd) || (state->queued_fd == dma_buf_fd) ||
+			(state->shown_fd == dma_buf_fd))
+			return 1;
+	}
+
+	return 0;
+}
+
+static void drm_close_gem_handle(vp_drm_context_t *ctx, uint32_t handle)
+{
+	struct drm_gem_close gem_close;
+	int32_t i = 0;
+
+	if (handle == 0)
+		return;
+
+	// 同一个 dma_buf 多次导入得到的是同一个 handle，还有其他缓存项在用时不能关闭
+	for (i = 0; i < ctx->fb_cache_count; i++) {
+		if ((ctx->fb_cache[i].gem_handle[0] == handle) ||
+			(ctx->fb_cache[i].gem_handle[1] == handle))
+			return;
+	}
+
+	memset(&gem_close, 0, sizeof(gem_close));
+	gem_close.handle = handle;
+	drmIoctl(ctx->drm_fd, DRM_IOCTL_GEM_CLOSE, &gem_close);
+}
+
+static void drm_fb_cache_remove(vp_drm_context_t *ctx, int32_t index)
+{
+	drm_fb_cache_t entry = ctx->fb_cache[index];
+
+	ctx->fb_cache[index] = ctx->fb_cache[ctx->fb_cache_count - 1];
+	ctx->fb_cache_count--;
+
+	drmModeRmFB(ctx->drm_fd, entry.fb_id);
+	drm_close_gem_handle(ctx, entry.gem_handle[0]);
+	if (entry.gem_handle[1] != entry.gem_handle[0])
+		drm_close_gem_handle(ctx, entry.gem_handle[1]);
+}
+
+/* dma_buf 第一次送显时通过 PRIME 导入并创建 framebuffer，之后直接复用，
+ * 视频 buffer 由硬件直接扫描输出，不经过任何拷贝或者 GPU 合成
+ */
+static uint32_t drm_get_framebuffer(vp_drm_context_t *ctx, hbn_vnode_image_t *image,
+	uint32_t format)
+{
+	hb_mem_graphic_buf_t *buf = &image->buffer;
+	drm_fb_cache_t *entry = NULL;
+	uint32_t handles[4] = {0};
+	uint32_t pitches[4] = {0};
+	uint32_t offsets[4] = {0};
+	uint32_t stride = 0, vstride = 0, fb_id = 0;
+	int32_t i = 0;
+
+	for (i = 0; i < ctx->fb_cache_count; i++) {
+		entry = &ctx->fb_cache[i];
+		if ((entry->dma_buf_fd == buf->fd[0]) && (entry->format == format) &&
+			(entry->width == (uint32_t)buf->width) && (entry->height == (uint32_t)buf->height))
+			return entry->fb_id;
+	}
+
+	if (ctx->fb_cache_count >= DRM_FB_CACHE_SIZE) {
+		for (i = 0; i < ctx->fb_cache_count; i++) {
+			if (!drm_buffer_busy_locked(ctx, -1, ctx->fb_cache[i].dma_buf_fd)) {
+				drm_fb_cache_remove(ctx, i);
+				break;
+			}
+		}
+		if (ctx->fb_cache_count >= DRM_FB_CACHE_SIZE) {
+			SC_LOGE("framebuffer cache full\n");
+			return 0;
+		}
+	}
+
+	entry = &ctx->fb_cache[ctx->fb_cache_count];
+	memset(entry, 0, sizeof(drm_fb_cache_t));
+	if (drmPrimeFDToHandle(ctx->drm_fd, buf->fd[0], &entry->gem_handle[0]) != 0) {
+		SC_LOGE("import dma_buf fd %d failed: %s\n", buf->fd[0], strerror(errno));
+		return 0;
+	}
+	entry->gem_handle[1] = entry->gem_handle[0];
+
+	if (format == DRM_FORMAT_NV12) {
+		stride = (buf->stride > 0) ? buf->stride : buf->width;
+		vstride = (buf->vstride > 0) ? buf->vstride : buf->height;
+		handles[0] = entry->gem_handle[0];
+		pitches[0] = stride;
+		pitches[1] = stride;
+		if ((buf->fd[1] > 0) && (buf->fd[1] != buf->fd[0])) {
+			if (drmPrimeFDToHandle(ctx->drm_fd, buf->fd[1], &entry->gem_handle[1]) != 0) {
+				SC_LOGE("import dma_buf fd %d failed: %s\n", buf->fd[1], strerror(errno));
+				drm_close_gem_handle(ctx, entry->gem_handle[0]);
+				return 0;
+			}
+			offsets[1] = 0;
+		} else if (buf->phys_addr[1] > buf->phys_addr[0]) {
+			offsets[1] = (uint32_t)(buf->phys_addr[1] - buf->phys_addr[0]);
+		} else {
+			offsets[1] = stride * vstride;
+		}
+		handles[1] = entry->gem_handle[1];
+	} else {
+		stride = buf->width * DISPLAY_ARGB_BYTES;
+		handles[0] = entry->gem_handle[0];
+		pitches[0] = ((uint32_t)buf->stride > stride) ? (uint32_t)buf->stride : stride;
+	}
+
+	if (drmModeAddFB2(ctx->drm_fd, buf->width, buf->height, format,
+		handles, pitches, offsets, &fb_id, 0) != 0) {
+		SC_LOGE("drmModeAddFB2 %ux%u failed: %s\n", buf->width, buf->height, strerror(errno));
+		drm_close_gem_handle(ctx, entry->gem_handle[0]);
+		if (entry->gem_handle[1] != entry->gem_handle[0])
+			drm_close_gem_handle(ctx, entry->gem_handle[1]);
+		return 0;
+	}
+
+	entry->dma_buf_fd = buf->fd[0];
+	entry->width = buf->width;
+	entry->height = buf->height;
+	entry->format = format;
+	entry->fb_id = fb_id;
+	ctx->fb_cache_count++;
+	SC_LOGD("created framebuffer %u for dma_buf fd %d\n", fb_id, buf->fd[0]);
+
+	return fb_id;
+}
+
+/* 把所有图层的待提交帧放到一次 atomic 提交里，第一次提交同时完成 modeset。
+ * 提交使用 NONBLOCK + PAGE_FLIP_EVENT，同一时间只有一次提交在等待 flip
+ */
+static int32_t drm_commit_locked(vp_drm_context_t *ctx)
+{
+	drmModeAtomicReq *req = NULL;
+	drm_plane_config_t *cfg = NULL;
+	drm_plane_props_t *props = NULL;
+	drm_plane_state_t *state = NULL;
+	uint32_t flags = DRM_MODE_PAGE_FLIP_EVENT | DRM_MODE_ATOMIC_NONBLOCK;
+	int32_t i = 0, count = 0, ret = 0;
+
+	for (i = 0; i < ctx->plane_count; i++) {
+		if (ctx->plane_state[i].pending_fd >= 0)
+			count++;
+	}
+	if (count == 0)
+		return 0;
+
+	req = drmModeAtomicAlloc();
+	if (req == NULL) {
+		SC_LOGE("drmModeAtomicAlloc failed\n");
+		return -1;
+	}
+
+	if (!ctx->modeset_done) {
+		drm_add_prop(req, ctx->crtc_id, ctx->crtc_active_prop, 1);
+		drm_add_prop(req, ctx->crtc_id, ctx->crtc_mode_prop, ctx->mode_blob_id);
+		drm_add_prop(req, ctx->connector_id, ctx->conn_crtc_prop, ctx->crtc_id);
+		flags |= DRM_MODE_ATOMIC_ALLOW_MODESET;
+	}
+
+	for (i = 0; i < ctx->plane_count; i++) {
+		state = &ctx->plane_state[i];
+		if (state->pending_fd < 0)
+			continue;
+		cfg = &ctx->planes[i];
+		props = &ctx->plane_props[i];
+
+		drm_add_prop(req, cfg->plane_id, props->fb_id, state->pending_fb);
+		// 图层第一次使能或者输入分辨率变化时才需要重新设置几何参数
+		if (!state->enabled || (state->pending_w != cfg->src_w) ||
+			(state->pending_h != cfg->src_h)) {
+			cfg->src_w = state->pending_w;
+			cfg->src_h = state->pending_h;
+			drm_add_prop(req, cfg->plane_id, props->crtc_id, ctx->crtc_id);
+			drm_add_prop(req, cfg->plane_id, props->src_x, 0);
+			drm_add_prop(req, cfg->plane_id, props->src_y, 0);
+			drm_add_prop(req, cfg->plane_id, props->src_w, (uint64_t)cfg->src_w << 16);
+			drm_add_prop(req, cfg->plane_id, props->src_h, (uint64_t)cfg->src_h << 16);
+			drm_add_prop(req, cfg->plane_id, props->crtc_x, cfg->crtc_x);
+			drm_add_prop(req, cfg->plane_id, props->crtc_y, cfg->crtc_y);
+			drm_add_prop(req, cfg->plane_id, props->crtc_w, cfg->crtc_w);
+			drm_add_prop(req, cfg->plane_id, props->crtc_h, cfg->crtc_h);
+			drm_add_prop(req, cfg->plane_id, props->zpos, cfg->z_pos);
+		}
+	}
+
+	ret = drmModeAtomicCommit(ctx->drm_fd, req, flags, ctx);
+	drmModeAtomicFree(req);
+	if (ret != 0) {
+		SC_LOGE("drmModeAtomicCommit failed: %s\n", strerror(errno));
+		ctx->stats.commit_errors++;
+		// 提交失败的帧直接丢弃，buffer 归还给调用者
+		for (i = 0; i < ctx->plane_count; i++) {
+			ctx->plane_state[i].pending_fd = -1;
+			ctx->plane_state[i].pending_fb = 0;
+		}
+		return -1;
+	}
+
+	for (i = 0; i < ctx->plane_count; i++) {
+		state = &ctx->plane_state[i];
+		if (state->pending_fd < 0)
+			continue;
+		state->queued_fd = state->pending_fd;
+		state->pending_fd = -1;
+		state->pending_fb = 0;
+		state->enabled = 1;
+	}
+	ctx->modeset_done = 1;
+	ctx->flip_pending = 1;
+	ctx->stats.commits++;
+
+	return 0;
+}
+
+static void drm_page_flip_handler(int fd, unsigned int sequence,
+	unsigned int tv_sec, unsigned int tv_usec, void *user_data)
+{
+	vp_drm_context_t *ctx = (vp_drm_context_t *)user_data;
+	drm_plane_state_t *state = NULL;
+	int32_t i = 0;
+
+	(void)fd;
+	(void)sequence;
+	(void)tv_sec;
+	(void)tv_usec;
+
+	pthread_mutex_lock(&ctx->lock);
+	for (i = 0; i < ctx->plane_count; i++) {
+		state = &ctx->plane_state[i];
+		if (state->queued_fd >= 0) {
+			state->shown_fd = state->queued_fd;
+			state->queued_fd = -1;
+		}
+	}
+	ctx->flip_pending = 0;
+	ctx->stats.flips++;
+
+	// flip 完成后马上提交等待期间到达的最新帧，送显节奏由 vblank 决定
+	drm_commit_locked(ctx);
+
+	pthread_cond_broadcast(&ctx->flip_cond);
+	pthread_mutex_unlock(&ctx->lock);
+}
+
+static void *drm_flip_thread(void *arg)
+{
+	vp_drm_context_t *ctx = (vp_drm_context_t *)arg;
+	drmEventContext evctx;
+	struct pollfd pfd;
+	int ret = 0;
+
+	memset(&evctx, 0, sizeof(evctx));
+	evctx.version = 2;
+	evctx.page_flip_handler = drm_page_flip_handler;
+
+	pfd.fd = ctx->drm_fd;
+	pfd.events = POLLIN;
+
+	while (__atomic_load_n(&ctx->running, __ATOMIC_ACQUIRE)) {
+		pfd.revents = 0;
+		ret = poll(&pfd, 1, DRM_FLIP_POLL_TIMEOUT_MS);
+		if ((ret > 0) && (pfd.revents & POLLIN))
+			drmHandleEvent(ctx->drm_fd, &evctx);
+	}
+
+	return NULL;
+}
+
+int32_t vp_display_init(vp_drm_context_t *drm_ctx, int32_t width, int32_t height)
+{
+	int32_t crtc_index = 0;
+	int32_t i = 0;
+
+	memset(drm_ctx, 0, sizeof(vp_drm_context_t));
+	for (i = 0; i < DRM_MAX_PLANES; i++) {
+		drm_ctx->plane_state[i].pending_fd = -1;
+		drm_ctx->plane_state[i].queued_fd = -1;
+		drm_ctx->plane_state[i].shown_fd = -1;
+	}
+
+	drm_ctx->drm_fd = drm_open_device();
+	if (drm_ctx->drm_fd < 0) {
+		SC_LOGE("no usable drm device\n");
+		return -1;
+	}
+
+	if ((drmSetClientCap(drm_ctx->drm_fd, DRM_CLIENT_CAP_UNIVERSAL_PLANES, 1) != 0) ||
+		(drmSetClientCap(drm_ctx->drm_fd, DRM_CLIENT_CAP_ATOMIC, 1) != 0)) {
+		SC_LOGE("drm device does not support atomic modesetting\n");
+		goto err;
+	}
+
+	drm_ctx->width = width;
+	drm_ctx->height = height;
+
+	crtc_index = drm_select_output(drm_ctx, width, height);
+	if (crtc_index < 0)
+		goto err;
+	if (drm_select_planes(drm_ctx, crtc_index, width, height) != 0)
+		goto err;
+	if (drm_init_props(drm_ctx) != 0)
+		goto err;
+
+	if (drmModeCreatePropertyBlob(drm_ctx->drm_fd, &drm_ctx->mode,
+		sizeof(drm_ctx->mode), &drm_ctx->mode_blob_id) != 0) {
+		SC_LOGE("drmModeCreatePropertyBlob failed: %s\n", strerror(errno));
+		goto err;
+	}
+
+	pthread_mutex_init(&drm_ctx->lock, NULL);
+	pthread_cond_init(&drm_ctx->flip_cond, NULL);
+	drm_ctx->running = 1;
+	if (pthread_create(&drm_ctx->flip_thread, NULL, drm_flip_thread, drm_ctx) != 0) {
+		SC_LOGE("create flip thread failed\n");
+		drm_ctx->running = 0;
+		pthread_cond_destroy(&drm_ctx->flip_cond);
+		pthread_mutex_destroy(&drm_ctx->lock);
+		goto err;
+	}
+
+	SC_LOGI("display connector %u crtc %u mode %s, video plane %u, osd plane %u\n",
+		drm_ctx->connector_id, drm_ctx->crtc_id, drm_ctx->mode.name,
+		drm_ctx->planes[VP_DISPLAY_PLANE_VIDEO].plane_id,
+		(drm_ctx->plane_count > 1) ? drm_ctx->planes[VP_DISPLAY_PLANE_OSD].plane_id : 0);
+
+	return 0;
+
+err:
+	if (drm_ctx->mode_blob_id != 0)
+		drmModeDestroyPropertyBlob(drm_ctx->drm_fd, drm_ctx->mode_blob_id);
+	close(drm_ctx->drm_fd);
+	drm_ctx->drm_fd = -1;
+	return -1;
+}
+
+int32_t vp_display_deinit(vp_drm_context_t *drm_ctx)
+{
+	drmModeAtomicReq *req = NULL;
+	struct timespec deadline;
+	int32_t i = 0;
+
+	if ((drm_ctx == NULL) || (drm_ctx->drm_fd < 0))
+		return 0;
+
+	// 等最后一次提交 flip 完成再关闭，避免拆除正在扫描输出的 framebuffer
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	deadline.tv_nsec += DRM_FLIP_WAIT_TIMEOUT_MS * 1000000L;
+	if (deadline.tv_nsec >= 1000000000L) {
+		deadline.tv_sec++;
+		deadline.tv_nsec -= 1000000000L;
+	}
+	pthread_mutex_lock(&drm_ctx->lock);
+	for (i = 0; i < drm_ctx->plane_count; i++) {
+		drm_ctx->plane_state[i].pending_fd = -1;
+		drm_ctx->plane_state[i].pending_fb = 0;
+	}
+	while (drm_ctx->flip_pending) {
+		if (pthread_cond_timedwait(&drm_ctx->flip_cond, &drm_ctx->lock, &deadline) != 0)
+			break;
+	}
+	pthread_mutex_unlock(&drm_ctx->lock);
+
+	__atomic_store_n(&drm_ctx->running, 0, __ATOMIC_RELEASE);
+	pthread_join(drm_ctx->flip_thread, NULL);
+
+	if (drm_ctx->modeset_done) {
+		req = drmModeAtomicAlloc();
+		if (req != NULL) {
+			for (i = 0; i < drm_ctx->plane_count; i++) {
+				drm_add_prop(req, drm_ctx->planes[i].plane_id, drm_ctx->plane_props[i].fb_id, 0);
+				drm_add_prop(req, drm_ctx->planes[i].plane_id, drm_ctx->plane_props[i].crtc_id, 0);
+			}
+			drm_add_prop(req, drm_ctx->connector_id, drm_ctx->conn_crtc_prop, 0);
+			drm_add_prop(req, drm_ctx->crtc_id, drm_ctx->crtc_mode_prop, 0);
+			drm_add_prop(req, drm_ctx->crtc_id, drm_ctx->crtc_active_prop, 0);
+			if (drmModeAtomicCommit(drm_ctx->drm_fd, req,
+				DRM_MODE_ATOMIC_ALLOW_MODESET, NULL) != 0)
+				SC_LOGW("disable crtc failed: %s\n", strerror(errno));
+			drmModeAtomicFree(req);
+		}
+	}
+
+	for (i = 0; i < drm_ctx->plane_count; i++) {
+		drm_ctx->plane_state[i].queued_fd = -1;
+		drm_ctx->plane_state[i].shown_fd = -1;
+	}
+	while (drm_ctx->fb_cache_count > 0)
+		drm_fb_cache_remove(drm_ctx, drm_ctx->fb_cache_count - 1);
+
+	drmModeDestroyPropertyBlob(drm_ctx->drm_fd, drm_ctx->mode_blob_id);
+	pthread_cond_destroy(&drm_ctx->flip_cond);
+	pthread_mutex_destroy(&drm_ctx->lock);
+	close(drm_ctx->drm_fd);
+	drm_ctx->drm_fd = -1;
+
+	SC_LOGI("display closed, commits %llu flips %llu dropped %llu\n",
+		(unsigned long long)drm_ctx->stats.commits,
+		(unsigned long long)drm_ctx->stats.flips,
+		(unsigned long long)drm_ctx->stats.frames_dropped);
+
+	return 0;
+}
+
+int32_t vp_display_set_frame(vp_drm_context_t *drm_ctx, int32_t plane_idx,
+	hbn_vnode_image_t *image_frame)
+{
+	drm_plane_state_t *state = NULL;
+	uint32_t format = 0, fb_id = 0;
+	int32_t ret = 0;
+
+	if ((drm_ctx == NULL) || (drm_ctx->drm_fd < 0) || (image_frame == NULL)) {
+		SC_LOGE("display not inited\n");
+		return -1;
+	}
+	if ((plane_idx < 0) || (plane_idx >= drm_ctx->plane_count)) {
+		SC_LOGE("invalid plane index %d, plane count %d\n", plane_idx, drm_ctx->plane_count);
+		return -1;
+	}
+	if (image_frame->buffer.fd[0] <= 0) {
+		SC_LOGE("image buffer has no dma_buf fd\n");
+		return -1;
+	}
+
+	format = get_format_from_string(drm_ctx->planes[plane_idx].format);
+
+	pthread_mutex_lock(&drm_ctx->lock);
+	fb_id = drm_get_framebuffer(drm_ctx, image_frame, format);
+	if (fb_id == 0) {
+		pthread_mutex_unlock(&drm_ctx->lock);
+		return -1;
+	}
+
+	state = &drm_ctx->plane_state[plane_idx];
+	// 最新帧优先：还没来得及提交的旧帧直接被替换掉
+	if (state->pending_fd >= 0)
+		drm_ctx->stats.frames_dropped++;
+	state->pending_fd = image_frame->buffer.fd[0];
+	state->pending_fb = fb_id;
+	state->pending_w = image_frame->buffer.width;
+	state->pending_h = image_frame->buffer.height;
+	drm_ctx->stats.frames_queued++;
+
+	if (!drm_ctx->flip_pending)
+		ret = drm_commit_locked(drm_ctx);
+	pthread_mutex_unlock(&drm_ctx->lock);
+
+	return ret;
+}
+
+int32_t vp_display_buffer_busy(vp_drm_context_t *drm_ctx, int32_t plane_idx, int32_t dma_buf_fd)
+{
+	int32_t busy = 0;
+
+	if ((drm_ctx == NULL) || (drm_ctx->drm_fd < 0))
+		return 0;
+
+	pthread_mutex_lock(&drm_ctx->lock);
+	busy = drm_buffer_busy_locked(drm_ctx, plane_idx, dma_buf_fd);
+	pthread_mutex_unlock(&drm_ctx->lock);
+
+	return busy;
+}
+
+int32_t vp_display_forget_buffer(vp_drm_context_t *drm_ctx, int32_t dma_buf_fd)
+{
+	int32_t i = 0;
+
+	if ((drm_ctx == NULL) || (drm_ctx->drm_fd < 0))
+		return 0;
+
+	pthread_mutex_lock(&drm_ctx->lock);
+	if (drm_buffer_busy_locked(drm_ctx, -1, dma_buf_fd)) {
+		pthread_mutex_unlock(&drm_ctx->lock);
+		SC_LOGE("dma_buf fd %d is still on screen\n", dma_buf_fd);
+		return -1;
+	}
+	for (i = drm_ctx->fb_cache_count - 1; i >= 0; i--) {
+		if (drm_ctx->fb_cache[i].dma_buf_fd == dma_buf_fd)
+			drm_fb_cache_remove(drm_ctx, i);
+	}
+	pthread_mutex_unlock(&drm_ctx->lock);
+
+	return 0;
+}
+
+void vp_display_get_stats(vp_drm_context_t *drm_ctx, vp_display_stats_t *stats)
+{
+	if ((drm_ctx == NULL) || (stats == NULL))
+		return;
+
+	if (drm_ctx->drm_fd < 0) {
+		memcpy(stats, &drm_ctx->stats, sizeof(vp_display_stats_t));
+		return;
+	}
+
+	pthread_mutex_lock(&drm_ctx->lock);
+	memcpy(stats, &drm_ctx->stats, sizeof(vp_display_stats_t));
+	pthread_mutex_unlock(&drm_ctx->lock);
+}
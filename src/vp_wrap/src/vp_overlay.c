@@ -0,0 +1,657 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-06 10:21:53
+ * @LastEditTime: 2024-11-06 10:21:53
+ ***************************************************************************/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+#if defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+#include "utils/utils_log.h"
+
+#include "vp_display.h"
+#include "vp_overlay.h"
+
+#define OVERLAY_GLYPH_MAX_RUNS 8
+#define OVERLAY_HZK_GLYPH_NUM (94 * 94)
+#define OVERLAY_LIST_INIT_CAPACITY 64
+#define OVERLAY_DIRTY_INIT_CAPACITY 256
+
+/* 字形按行展开成连续像素段 (起点, 长度)，绘制时每一段就是一次 span 填充，
+ * 不再逐 bit 判断
+ */
+typedef struct {
+	uint8_t width;
+	uint8_t run_count[FONT_WORD_HEIGHT];
+	uint8_t runs[FONT_WORD_HEIGHT][OVERLAY_GLYPH_MAX_RUNS][2];
+} overlay_glyph_t;
+
+typedef struct {
+	int32_t ret;
+	overlay_glyph_t ascii[256];
+	overlay_glyph_t *hzk;
+	uint8_t *hzk_valid;
+} overlay_atlas_t;
+
+static overlay_atlas_t s_atlas;
+static pthread_once_t s_atlas_once = PTHREAD_ONCE_INIT;
+
+static void overlay_expand_glyph(overlay_glyph_t *glyph, const uint8_t *bitmap,
+	int32_t row_bytes)
+{
+	uint32_t bits = 0;
+	int32_t width = row_bytes * ONE_BYTE_BIT_CNT;
+	int32_t row = 0, x = 0, start = 0, count = 0;
+
+	memset(glyph, 0, sizeof(overlay_glyph_t));
+	glyph->width = (uint8_t)width;
+
+	for (row = 0; row < FONT_WORD_HEIGHT; row++) {
+		bits = bitmap[row * row_bytes];
+		if (row_bytes == 2)
+			bits = (bits << 8) | bitmap[row * row_bytes + 1];
+
+		count = 0;
+		x = 0;
+		while ((x < width) && (count < OVERLAY_GLYPH_MAX_RUNS)) {
+			if (!(bits & (1u << (width - 1 - x)))) {
+				x++;
+				continue;
+			}
+			start = x;
+			while ((x < width) && (bits & (1u << (width - 1 - x))))
+				x++;
+			glyph->runs[row][count][0] = (uint8_t)start;
+			glyph->runs[row][count][1] = (uint8_t)(x - start);
+			count++;
+		}
+		glyph->run_count[row] = (uint8_t)count;
+	}
+}
+
+static uint8_t *overlay_read_file(const char *path, size_t *size)
+{
+	FILE *file = NULL;
+	uint8_t *data = NULL;
+	long length = 0;
+
+	file = fopen(path, "rb");
+	if (file == NULL) {
+		SC_LOGE("open font file %s failed: %s\n", path, strerror(errno));
+		return NULL;
+	}
+
+	if ((fseek(file, 0, SEEK_END) == 0) && ((length = ftell(file)) > 0)) {
+		data = (uint8_t *)malloc(length);
+		if (data != NULL) {
+			rewind(file);
+			if (fread(data, 1, length, file) != (size_t)length) {
+				SC_LOGE("read font file %s failed\n", path);
+				free(data);
+				data = NULL;
+			}
+		}
+	}
+	(void)fclose(file);
+
+	*size = (data != NULL) ? (size_t)length : 0;
+	return data;
+}
+
+static void overlay_load_atlas(void)
+{
+	uint8_t *asc = NULL, *hzk = NULL;
+	size_t asc_size = 0, hzk_size = 0;
+	int32_t i = 0;
+
+	s_atlas.ret = -1;
+
+	asc = overlay_read_file(SDK_FONT_ASC16_FILE, &asc_size);
+	if (asc == NULL)
+		return;
+	for (i = 0; i < 256; i++) {
+		if ((size_t)(i + 1) * FONT_EN_WORD_BYTES <= asc_size)
+			overlay_expand_glyph(&s_atlas.ascii[i], asc + i * FONT_EN_WORD_BYTES, 1);
+		else
+			s_atlas.ascii[i].width = FONT_EN_WORD_WIDTH;
+	}
+	free(asc);
+
+	// 缺少汉字字库时只影响汉字显示
+	hzk = overlay_read_file(SDK_FONT_HZK16_FILE, &hzk_size);
+	if (hzk != NULL) {
+		s_atlas.hzk = (overlay_glyph_t *)calloc(OVERLAY_HZK_GLYPH_NUM, sizeof(overlay_glyph_t));
+		s_atlas.hzk_valid = (uint8_t *)calloc(OVERLAY_HZK_GLYPH_NUM, 1);
+		if ((s_atlas.hzk != NULL) && (s_atlas.hzk_valid != NULL)) {
+			for (i = 0; i < OVERLAY_HZK_GLYPH_NUM; i++) {
+				if ((size_t)(i + 1) * FONT_CN_WORD_BYTES > hzk_size)
+					break;
+				overlay_expand_glyph(&s_atlas.hzk[i], hzk + i * FONT_CN_WORD_BYTES, 2);
+				s_atlas.hzk_valid[i] = 1;
+			}
+		} else {
+			SC_LOGE("alloc hzk glyph atlas failed\n");
+			free(s_atlas.hzk);
+			free(s_atlas.hzk_valid);
+			s_atlas.hzk = NULL;
+			s_atlas.hzk_valid = NULL;
+		}
+		free(hzk);
+	}
+
+	s_atlas.ret = 0;
+}
+
+int32_t vp_overlay_load_fonts(void)
+{
+	pthread_once(&s_atlas_once, overlay_load_atlas);
+	return s_atlas.ret;
+}
+
+static const overlay_glyph_t *overlay_find_glyph(const uint8_t *str, int32_t *consumed)
+{
+	int32_t index = 0;
+
+	if (str[0] < FONT_CN_WORD_START_ENCODE) {
+		*consumed = FONT_EN_ENCODE_NUM;
+		return &s_atlas.ascii[str[0]];
+	}
+
+	*consumed = FONT_CN_ENCODE_NUM;
+	if (str[1] == '\0') {
+		// 不完整的汉字编码，跳过
+		*consumed = FONT_EN_ENCODE_NUM;
+		return NULL;
+	}
+
+	index = FONT_INTERVAL_CN_WORD_CNT * (str[0] - FONT_CN_WORD_START_ENCODE - 1) +
+		(str[1] - FONT_CN_WORD_START_ENCODE - 1);
+	if ((s_atlas.hzk == NULL) || (index < 0) || (index >= OVERLAY_HZK_GLYPH_NUM) ||
+		!s_atlas.hzk_valid[index])
+		return NULL;
+
+	return &s_atlas.hzk[index];
+}
+
+static inline void overlay_fill_span(uint32_t *dst, int32_t count, uint32_t color)
+{
+	int32_t i = 0;
+
+#if defined(__ARM_NEON)
+	uint32x4_t value = vdupq_n_u32(color);
+
+	for (; i + 16 <= count; i += 16) {
+		vst1q_u32(dst + i, value);
+		vst1q_u32(dst + i + 4, value);
+		vst1q_u32(dst + i + 8, value);
+		vst1q_u32(dst + i + 12, value);
+	}
+	for (; i + 4 <= count; i += 4)
+		vst1q_u32(dst + i, value);
+#endif
+	for (; i < count; i++)
+		dst[i] = color;
+}
+
+static int32_t overlay_clip_rect(int32_t width, int32_t height, vp_overlay_rect_t *rect)
+{
+	int32_t x1 = rect->x + rect->w;
+	int32_t y1 = rect->y + rect->h;
+
+	rect->x = (rect->x < 0) ? 0 : rect->x;
+	rect->y = (rect->y < 0) ? 0 : rect->y;
+	x1 = (x1 > width) ? width : x1;
+	y1 = (y1 > height) ? height : y1;
+	rect->w = x1 - rect->x;
+	rect->h = y1 - rect->y;
+
+	return (rect->w > 0) && (rect->h > 0);
+}
+
+void vp_overlay_fill_rect(uint8_t *addr, int32_t stride, int32_t width, int32_t height,
+	int32_t x, int32_t y, int32_t w, int32_t h, uint32_t color)
+{
+	vp_overlay_rect_t rect = {x, y, w, h};
+	int32_t row = 0;
+
+	if ((addr == NULL) || !overlay_clip_rect(width, height, &rect))
+		return;
+
+	for (row = rect.y; row < rect.y + rect.h; row++) {
+		overlay_fill_span((uint32_t *)(addr + row * stride) + rect.x, rect.w, color);
+	}
+}
+
+int32_t vp_overlay_draw_text(uint8_t *addr, int32_t stride, int32_t width, int32_t height,
+	int32_t x, int32_t y, const char *str, uint32_t color, int32_t scale,
+	vp_overlay_rect_t *bbox)
+{
+	const uint8_t *p = (const uint8_t *)str;
+	const overlay_glyph_t *glyph = NULL;
+	int32_t pen_x = x, row = 0, run = 0, consumed = 0;
+
+	if ((addr == NULL) || (str == NULL)) {
+		SC_LOGE("draw text addr or string was NULL\n");
+		return -1;
+	}
+	if (vp_overlay_load_fonts() != 0)
+		return -1;
+
+	scale = (scale > 0) ? scale : 1;
+	while ((*p != '\0') && (pen_x < width)) {
+		glyph = overlay_find_glyph(p, &consumed);
+		p += consumed;
+		if (glyph == NULL)
+			continue;
+
+		for (row = 0; row < FONT_WORD_HEIGHT; row++) {
+			for (run = 0; run < glyph->run_count[row]; run++) {
+				vp_overlay_fill_rect(addr, stride, width, height,
+					pen_x + glyph->runs[row][run][0] * scale, y + row * scale,
+					glyph->runs[row][run][1] * scale, scale, color);
+			}
+		}
+		pen_x += glyph->width * scale;
+	}
+
+	if (bbox != NULL) {
+		bbox->x = x;
+		bbox->y = y;
+		bbox->w = pen_x - x;
+		bbox->h = FONT_WORD_HEIGHT * scale;
+		if (!overlay_clip_rect(width, height, bbox))
+			bbox->w = bbox->h = 0;
+	}
+
+	return 0;
+}
+
+void vp_overlay_list_init(vp_overlay_list_t *list)
+{
+	memset(list, 0, sizeof(vp_overlay_list_t));
+}
+
+void vp_overlay_list_reset(vp_overlay_list_t *list)
+{
+	list->cmd_count = 0;
+}
+
+void vp_overlay_list_deinit(vp_overlay_list_t *list)
+{
+	free(list->cmds);
+	memset(list, 0, sizeof(vp_overlay_list_t));
+}
+
+int32_t vp_overlay_list_copy(vp_overlay_list_t *dst, const vp_overlay_list_t *src)
+{
+	vp_overlay_cmd_t *cmds = NULL;
+
+	if (src->cmd_count > dst->cmd_capacity) {
+		cmds = (vp_overlay_cmd_t *)realloc(dst->cmds, src->cmd_count * sizeof(vp_overlay_cmd_t));
+		if (cmds == NULL) {
+			SC_LOGE("grow overlay list to %d failed\n", src->cmd_count);
+			return -1;
+		}
+		dst->cmds = cmds;
+		dst->cmd_capacity = src->cmd_count;
+	}
+
+	if (src->cmd_count > 0)
+		memcpy(dst->cmds, src->cmds, src->cmd_count * sizeof(vp_overlay_cmd_t));
+	dst->cmd_count = src->cmd_count;
+
+	return 0;
+}
+
+static vp_overlay_cmd_t *overlay_list_append(vp_overlay_list_t *list)
+{
+	vp_overlay_cmd_t *cmds = NULL;
+	int32_t capacity = 0;
+
+	if (list->cmd_count >= list->cmd_capacity) {
+		capacity = (list->cmd_capacity > 0) ?
+			list->cmd_capacity * 2 : OVERLAY_LIST_INIT_CAPACITY;
+		cmds = (vp_overlay_cmd_t *)realloc(list->cmds, capacity * sizeof(vp_overlay_cmd_t));
+		if (cmds == NULL) {
+			SC_LOGE("grow overlay list to %d failed\n", capacity);
+			return NULL;
+		}
+		list->cmds = cmds;
+		list->cmd_capacity = capacity;
+	}
+
+	// 清零整个命令（包括文字缓冲区的尾部），内容相同的列表 hash 才会相同
+	memset(&list->cmds[list->cmd_count], 0, sizeof(vp_overlay_cmd_t));
+	return &list->cmds[list->cmd_count++];
+}
+
+int32_t vp_overlay_add_box(vp_overlay_list_t *list, int32_t x0, int32_t y0,
+	int32_t x1, int32_t y1, uint32_t color, int32_t line_width)
+{
+	vp_overlay_cmd_t *cmd = overlay_list_append(list);
+
+	if (cmd == NULL)
+		return -1;
+
+	cmd->type = VP_OVERLAY_CMD_BOX;
+	cmd->x0 = (x0 < x1) ? x0 : x1;
+	cmd->y0 = (y0 < y1) ? y0 : y1;
+	cmd->x1 = (x0 > x1) ? x0 : x1;
+	cmd->y1 = (y0 > y1) ? y0 : y1;
+	cmd->color = color;
+	cmd->line_width = (line_width > 0) ? line_width : 1;
+
+	return 0;
+}
+
+int32_t vp_overlay_add_fill(vp_overlay_list_t *list, int32_t x0, int32_t y0,
+	int32_t x1, int32_t y1, uint32_t color)
+{
+	vp_overlay_cmd_t *cmd = overlay_list_append(list);
+
+	if (cmd == NULL)
+		return -1;
+
+	cmd->type = VP_OVERLAY_CMD_FILL;
+	cmd->x0 = (x0 < x1) ? x0 : x1;
+	cmd->y0 = (y0 < y1) ? y0 : y1;
+	cmd->x1 = (x0 > x1) ? x0 : x1;
+	cmd->y1 = (y0 > y1) ? y0 : y1;
+	cmd->color = color;
+
+	return 0;
+}
+
+int32_t vp_overlay_add_text(vp_overlay_list_t *list, int32_t x, int32_t y,
+	const char *str, uint32_t color, int32_t scale)
+{
+	vp_overlay_cmd_t *cmd = NULL;
+
+	if (str == NULL) {
+		SC_LOGE("overlay text was NULL\n");
+		return -1;
+	}
+
+	cmd = overlay_list_append(list);
+	if (cmd == NULL)
+		return -1;
+
+	cmd->type = VP_OVERLAY_CMD_TEXT;
+	cmd->x0 = x;
+	cmd->y0 = y;
+	cmd->color = color;
+	cmd->line_width = (scale > 0) ? scale : 1;
+	snprintf(cmd->text, sizeof(cmd->text), "%s", str);
+
+	return 0;
+}
+
+int32_t vp_overlay_surface_init(vp_overlay_surface_t *surface, uint8_t *addr,
+	int32_t width, int32_t height, int32_t stride)
+{
+	if ((surface == NULL) || (addr == NULL) || (width <= 0) || (height <= 0)) {
+		SC_LOGE("invalid overlay surface\n");
+		return -1;
+	}
+
+	memset(surface, 0, sizeof(vp_overlay_surface_t));
+	surface->addr = addr;
+	surface->width = width;
+	surface->height = height;
+	surface->stride = (stride > 0) ? stride : width * DISPLAY_ARGB_BYTES;
+
+	return 0;
+}
+
+void vp_overlay_surface_deinit(vp_overlay_surface_t *surface)
+{
+	free(surface->dirty);
+	memset(surface, 0, sizeof(vp_overlay_surface_t));
+}
+
+void vp_overlay_surface_clear(vp_overlay_surface_t *surface)
+{
+	vp_overlay_fill_rect(surface->addr, surface->stride, surface->width, surface->height,
+		0, 0, surface->width, surface->height, 0);
+	surface->dirty_count = 0;
+	surface->has_content = 0;
+}
+
+static int32_t overlay_add_dirty(vp_overlay_surface_t *surface, int32_t x, int32_t y,
+	int32_t w, int32_t h)
+{
+	vp_overlay_rect_t rect = {x, y, w, h};
+	vp_overlay_rect_t *dirty = NULL;
+	int32_t capacity = 0;
+
+	if (!overlay_clip_rect(surface->width, surface->height, &rect))
+		return 0;
+
+	if (surface->dirty_count >= surface->dirty_capacity) {
+		capacity = (surface->dirty_capacity > 0) ?
+			surface->dirty_capacity * 2 : OVERLAY_DIRTY_INIT_CAPACITY;
+		dirty = (vp_overlay_rect_t *)realloc(surface->dirty, capacity * sizeof(vp_overlay_rect_t));
+		if (dirty == NULL) {
+			SC_LOGE("grow dirty list to %d failed\n", capacity);
+			return -1;
+		}
+		surface->dirty = dirty;
+		surface->dirty_capacity = capacity;
+	}
+
+	surface->dirty[surface->dirty_count++] = rect;
+	return 0;
+}
+
+int32_t vp_overlay_box_edges(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
+	int32_t line_width, vp_overlay_rect_t edges[4])
+{
+	int32_t xi = (x0 < x1) ? x0 : x1;
+	int32_t xa = (x0 > x1) ? x0 : x1;
+	int32_t yi = (y0 < y1) ? y0 : y1;
+	int32_t ya = (y0 > y1) ? y0 : y1;
+	int32_t w = xa - xi + 1;
+	int32_t h = ya - yi + 1;
+	int32_t lw = (line_width > 0) ? line_width : 1;
+
+	if ((lw * 2 >= w) || (lw * 2 >= h)) {
+		edges[0] = (vp_overlay_rect_t){xi, yi, w, h};
+		return 1;
+	}
+
+	edges[0] = (vp_overlay_rect_t){xi, yi, w, lw};
+	edges[1] = (vp_overlay_rect_t){xi, ya - lw + 1, w, lw};
+	edges[2] = (vp_overlay_rect_t){xi, yi + lw, lw, h - 2 * lw};
+	edges[3] = (vp_overlay_rect_t){xa - lw + 1, yi + lw, lw, h - 2 * lw};
+	return 4;
+}
+
+// 空心框只有线条所在的区域会被记为脏区域
+static int32_t overlay_draw_box(vp_overlay_surface_t *surface, const vp_overlay_cmd_t *cmd)
+{
+	vp_overlay_rect_t edges[4];
+	int32_t count = 0, i = 0, ret = 0;
+
+	count = vp_overlay_box_edges(cmd->x0, cmd->y0, cmd->x1, cmd->y1, cmd->line_width, edges);
+	for (i = 0; i < count; i++) {
+		vp_overlay_fill_rect(surface->addr, surface->stride, surface->width, surface->height,
+			edges[i].x, edges[i].y, edges[i].w, edges[i].h, cmd->color);
+		ret |= overlay_add_dirty(surface, edges[i].x, edges[i].y, edges[i].w, edges[i].h);
+	}
+
+	return ret;
+}
+
+static int32_t overlay_draw_cmd(vp_overlay_surface_t *surface, const vp_overlay_cmd_t *cmd)
+{
+	vp_overlay_rect_t bbox;
+
+	switch (cmd->type) {
+	case VP_OVERLAY_CMD_BOX:
+		return overlay_draw_box(surface, cmd);
+	case VP_OVERLAY_CMD_FILL:
+		vp_overlay_fill_rect(surface->addr, surface->stride, surface->width, surface->height,
+			cmd->x0, cmd->y0, cmd->x1 - cmd->x0 + 1, cmd->y1 - cmd->y0 + 1, cmd->color);
+		return overlay_add_dirty(surface, cmd->x0, cmd->y0,
+			cmd->x1 - cmd->x0 + 1, cmd->y1 - cmd->y0 + 1);
+	case VP_OVERLAY_CMD_TEXT:
+		if (vp_overlay_draw_text(surface->addr, surface->stride, surface->width, surface->height,
+				cmd->x0, cmd->y0, cmd->text, cmd->color, cmd->line_width, &bbox) != 0)
+			return -1;
+		return overlay_add_dirty(surface, bbox.x, bbox.y, bbox.w, bbox.h);
+	default:
+		SC_LOGE("unknown overlay command %d\n", cmd->type);
+		return -1;
+	}
+}
+
+static uint64_t overlay_list_hash(const vp_overlay_list_t *list, int32_t count)
+{
+	const uint8_t *p = (const uint8_t *)list->cmds;
+	size_t size = (size_t)count * sizeof(vp_overlay_cmd_t);
+	uint64_t hash = 1469598103934665603ULL;
+	size_t i = 0;
+
+	for (i = 0; i < size; i++) {
+		hash ^= p[i];
+		hash *= 1099511628211ULL;
+	}
+	hash ^= (uint64_t)count;
+
+	return hash;
+}
+
+static int64_t overlay_dirty_area(const vp_overlay_surface_t *surface)
+{
+	int64_t dirty_area = 0;
+	int32_t i = 0;
+
+	for (i = 0; i < surface->dirty_count; i++)
+		dirty_area += (int64_t)surface->dirty[i].w * surface->dirty[i].h;
+
+	return dirty_area;
+}
+
+// 只清除上一次绘制过的区域，脏区域超过半屏时整屏清除更快
+static void overlay_clear_dirty(vp_overlay_surface_t *surface)
+{
+	int32_t i = 0;
+
+	if (overlay_dirty_area(surface) * 2 > (int64_t)surface->width * surface->height) {
+		vp_overlay_surface_clear(surface);
+		return;
+	}
+
+	for (i = 0; i < surface->dirty_count; i++) {
+		vp_overlay_fill_rect(surface->addr, surface->stride, surface->width, surface->height,
+			surface->dirty[i].x, surface->dirty[i].y,
+			surface->dirty[i].w, surface->dirty[i].h, 0);
+	}
+	surface->dirty_count = 0;
+}
+
+int32_t vp_overlay_same_content(const vp_overlay_surface_t *surface,
+	const vp_overlay_list_t *list)
+{
+	return surface->has_content &&
+		(surface->content_hash == overlay_list_hash(list, list->cmd_count));
+}
+
+int32_t vp_overlay_render(vp_overlay_surface_t *surface, const vp_overlay_list_t *list)
+{
+	int32_t i = 0, ret = 0;
+
+	if ((surface == NULL) || (surface->addr == NULL) || (list == NULL)) {
+		SC_LOGE("overlay surface not inited\n");
+		return -1;
+	}
+
+	if (vp_overlay_same_content(surface, list))
+		return 0;
+
+	overlay_clear_dirty(surface);
+
+	for (i = 0; i < list->cmd_count; i++)
+		ret |= overlay_draw_cmd(surface, &list->cmds[i]);
+
+	surface->content_hash = overlay_list_hash(list, list->cmd_count);
+	surface->has_content = 1;
+
+	return (ret == 0) ? 1 : -1;
+}
+
+int32_t vp_overlay_render_append(vp_overlay_surface_t *surface,
+	const vp_overlay_list_t *list, int32_t first)
+{
+	int32_t i = 0, ret = 0;
+
+	if ((surface == NULL) || (surface->addr == NULL) || (list == NULL)) {
+		SC_LOGE("overlay surface not inited\n");
+		return -1;
+	}
+
+	for (i = (first > 0) ? first : 0; i < list->cmd_count; i++)
+		ret |= overlay_draw_cmd(surface, &list->cmds[i]);
+
+	surface->content_hash = overlay_list_hash(list, list->cmd_count);
+	surface->has_content = 1;
+
+	return (ret == 0) ? 1 : -1;
+}
+
+int32_t vp_overlay_surface_copy(vp_overlay_surface_t *dst, const vp_overlay_surface_t *src)
+{
+	vp_overlay_rect_t *dirty = NULL;
+	const vp_overlay_rect_t *rect = NULL;
+	int32_t i = 0, row = 0;
+
+	if ((dst == NULL) || (src == NULL) || (dst->addr == NULL) || (src->addr == NULL) ||
+		(dst->width != src->width) || (dst->height != src->height)) {
+		SC_LOGE("overlay surface size mismatch\n");
+		return -1;
+	}
+
+	if (dst->dirty_capacity < src->dirty_count) {
+		dirty = (vp_overlay_rect_t *)realloc(dst->dirty,
+			src->dirty_count * sizeof(vp_overlay_rect_t));
+		if (dirty == NULL) {
+			SC_LOGE("grow dirty list to %d failed\n", src->dirty_count);
+			return -1;
+		}
+		dst->dirty = dirty;
+		dst->dirty_capacity = src->dirty_count;
+	}
+
+	overlay_clear_dirty(dst);
+
+	// src 上只有脏区域有内容，脏区域超过半屏时整屏拷贝
+	if (overlay_dirty_area(src) * 2 > (int64_t)src->width * src->height) {
+		for (row = 0; row < src->height; row++)
+			memcpy(dst->addr + (size_t)row * dst->stride,
+				src->addr + (size_t)row * src->stride, (size_t)src->width * DISPLAY_ARGB_BYTES);
+	} else {
+		for (i = 0; i < src->dirty_count; i++) {
+			rect = &src->dirty[i];
+			for (row = rect->y; row < rect->y + rect->h; row++)
+				memcpy(dst->addr + (size_t)row * dst->stride + (size_t)rect->x * DISPLAY_ARGB_BYTES,
+					src->addr + (size_t)row * src->stride + (size_t)rect->x * DISPLAY_ARGB_BYTES,
+					(size_t)rect->w * DISPLAY_ARGB_BYTES);
+		}
+	}
+
+	if (src->dirty_count > 0)
+		memcpy(dst->dirty, src->dirty, src->dirty_count * sizeof(vp_overlay_rect_t));
+	dst->dirty_count = src->dirty_count;
+	dst->content_hash = src->content_hash;
+	dst->has_content = src->has_content;
+
+	return 0;
+}
@@ -16,7 +16,8 @@
 #include "vp_wrap.h"
 #include "vp_vse.h"
 
-static pym_cfg_t pym_common_config = {
+// 默认配置模板，每个 pipeline 拷贝一份后再按需修改，不能直接写
+static const pym_cfg_t pym_default_config = {
 		.hw_id = 1,
 		.pym_mode = 3,
 		.slot_id = 0,
@@ -87,10 +88,34 @@ static pym_cfg_t pym_common_config = {
 		},
 	.magicNumber = MAGIC_NUMBER,
 };
-pym_cfg_t *get_vp_pym_common_config (void)
+int32_t vp_vse_init_config(vp_vflow_contex_t *vp_vflow_contex)
 {
-	return &pym_common_config;
+	memcpy(&vp_vflow_contex->pym_cfg, &pym_default_config, sizeof(pym_cfg_t));
+	vp_vflow_contex->pym_config = &vp_vflow_contex->pym_cfg;
+	return 0;
 }
+
+int32_t vp_vse_set_buf_num(vp_vflow_contex_t *vp_vflow_contex,
+	uint32_t output_buf_num, uint32_t fb_buf_num)
+{
+	pym_cfg_t *pym_cfg = vp_vflow_contex->pym_config;
+
+	if (pym_cfg == NULL) {
+		SC_LOGE("pym config not initialized, call vp_vse_init_config first");
+		return -1;
+	}
+	if ((output_buf_num == 0u) || (output_buf_num > PYM_MAX_BUF_NUM)
+		|| (fb_buf_num > PYM_MAX_BUF_NUM)) {
+		SC_LOGE("invalid buffer num output:%u fb:%u, range [1, %u]",
+			output_buf_num, fb_buf_num, PYM_MAX_BUF_NUM);
+		return -1;
+	}
+	pym_cfg->output_buf_num = output_buf_num;
+	pym_cfg->fb_buf_num = fb_buf_num;
+	SC_LOGD("pym output_buf_num:%u fb_buf_num:%u", output_buf_num, fb_buf_num);
+	return 0;
+}
+
 int32_t vp_vse_init(vp_vflow_contex_t *vp_vflow_contex)
 {
 	int32_t ret = 0;
@@ -99,6 +124,10 @@ int32_t vp_vse_init(vp_vflow_contex_t *vp_vflow_contex)
 	hbn_buf_alloc_attr_t alloc_attr;
 	//coverity[misra_c_2012_rule_11_5_violation:SUPPRESS], ## violation reason SYSSW_V_11.5.04
 	pym_cfg = (pym_cfg_t *)vp_vflow_contex->pym_config;
+	if (pym_cfg == NULL) {
+		SC_LOGE("pym config not initialized");
+		return -1;
+	}
 	ret = hbn_vnode_open(HB_PYM, pym_cfg->hw_id, AUTO_ALLOC_ID, &vnode_magic_id);
 	if (ret < 0) {
 		//coverity[misra_c_2012_rule_15_1_violation:SUPPRESS], ## violation reason SYSSW_V_15.1.01
@@ -14,8 +14,11 @@
 #include <linux/fb.h>
 #include <stdlib.h>
 #include <stdbool.h>
+#include <string.h>
+#include <string>
 
 #include <egl_preview.h>
+#include <GLES2/gl2ext.h>
 
 using namespace std;
 
@@ -27,7 +30,9 @@ bool EGLPreviewWindow::isInitialized = false;
 EGLPreviewWindow::EGLPreviewWindow(int width, int height)
 	: width(width), height(height), x_display(nullptr), x_window(0),
 	  egl_display(EGL_NO_DISPLAY), egl_context(EGL_NO_CONTEXT), egl_surface(EGL_NO_SURFACE),
-	  program(0), rgba_tex(0) {}
+	  program(0), rgba_tex(0), yuv_program(0), y_tex{}, uv_tex{},
+	  yuv_tex_width(0), yuv_tex_height(0), yuv_index(0),
+	  y_format(GL_LUMINANCE), uv_format(GL_LUMINANCE_ALPHA), current_program(0) {}
 
 EGLPreviewWindow::~EGLPreviewWindow() {
 	close();
@@ -100,47 +105,81 @@ bool EGLPreviewWindow::initialize() {
 	return true;
 }
 
-bool EGLPreviewWindow::initialize_shaders() {
-	const char* vertex_shader_src = R"(
-		attribute vec4 position;
-		attribute vec2 texcoord;
-		varying vec2 v_texcoord;
+static const char* vertex_shader_src = R"(
+	attribute vec4 position;
+	attribute vec2 texcoord;
+	varying vec2 v_texcoord;
 
-		void main() {
-			gl_Position = position;
-			v_texcoord = vec2(texcoord.x, 1.0 - texcoord.y);  // Flip Y coordinate
-		}
-	)";
-
-	const char* fragment_shader_src = R"(
-		precision mediump float;
-		varying vec2 v_texcoord;
-		uniform sampler2D rgba_texture;
+	void main() {
+		gl_Position = position;
+		v_texcoord = vec2(texcoord.x, 1.0 - texcoord.y);  // Flip Y coordinate
+	}
+)";
 
-		void main() {
-			// Sample the RGBA texture
-			vec4 rgba = texture2D(rgba_texture, v_texcoord);
-			gl_FragColor = rgba;
-		}
-	)";
+GLuint EGLPreviewWindow::create_program(const char* vertex_shader_src, const char* fragment_shader_src) {
+	GLint status = GL_FALSE;
+	char log[512];
 
 	GLuint vertex_shader = glCreateShader(GL_VERTEX_SHADER);
 	glShaderSource(vertex_shader, 1, &vertex_shader_src, nullptr);
 	glCompileShader(vertex_shader);
+	glGetShaderiv(vertex_shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		glGetShaderInfoLog(vertex_shader, sizeof(log), nullptr, log);
+		std::cerr << "Failed to compile vertex shader: " << log << std::endl;
+	}
 
 	GLuint fragment_shader = glCreateShader(GL_FRAGMENT_SHADER);
 	glShaderSource(fragment_shader, 1, &fragment_shader_src, nullptr);
 	glCompileShader(fragment_shader);
+	glGetShaderiv(fragment_shader, GL_COMPILE_STATUS, &status);
+	if (status != GL_TRUE) {
+		glGetShaderInfoLog(fragment_shader, sizeof(log), nullptr, log);
+		std::cerr << "Failed to compile fragment shader: " << log << std::endl;
+	}
 
-	program = glCreateProgram();
-	glAttachShader(program, vertex_shader);
-	glAttachShader(program, fragment_shader);
-	glLinkProgram(program);
+	GLuint prog = glCreateProgram();
+	glAttachShader(prog, vertex_shader);
+	glAttachShader(prog, fragment_shader);
+	// 所有 program 的顶点属性位置一致，共用同一份顶点数据设置
+	glBindAttribLocation(prog, 0, "position");
+	glBindAttribLocation(prog, 1, "texcoord");
+	glLinkProgram(prog);
 
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 
+	glGetProgramiv(prog, GL_LINK_STATUS, &status);
+	if (status != GL_TRUE) {
+		glGetProgramInfoLog(prog, sizeof(log), nullptr, log);
+		std::cerr << "Failed to link program: " << log << std::endl;
+		glDeleteProgram(prog);
+		return 0;
+	}
+
+	return prog;
+}
+
+bool EGLPreviewWindow::initialize_shaders() {
+	const char* fragment_shader_src = R"(
+		precision mediump float;
+		varying vec2 v_texcoord;
+		uniform sampler2D rgba_texture;
+
+		void main() {
+			// Sample the RGBA texture
+			vec4 rgba = texture2D(rgba_texture, v_texcoord);
+			gl_FragColor = rgba;
+		}
+	)";
+
+	program = create_program(vertex_shader_src, fragment_shader_src);
+	if (program == 0) {
+		return false;
+	}
+
 	glUseProgram(program);
+	current_program = program;
 
 	const float vertices[] = {
 		-1.0f, -1.0f, 0.0f, 0.0f,
@@ -149,8 +188,6 @@ bool EGLPreviewWindow::initialize_shaders() {
 		 1.0f,  1.0f, 1.0f, 1.0f,
 	};
 
-	const GLushort indices[] = { 0, 1, 2, 2, 3, 0 };
-
 	GLuint vbo;
 	glGenBuffers(1, &vbo);
 	glBindBuffer(GL_ARRAY_BUFFER, vbo);
@@ -172,6 +209,80 @@ bool EGLPreviewWindow::initialize_shaders() {
 	return true;
 }
 
+bool EGLPreviewWindow::initialize_yuv_shader() {
+	// BT.601 limited range，与 CPU 路径 color_nv12_to_rgb 的默认参数一致
+	const char* fragment_shader_head = R"(
+		precision mediump float;
+		varying vec2 v_texcoord;
+		uniform sampler2D y_texture;
+		uniform sampler2D uv_texture;
+
+		void main() {
+			float y = 1.164383 * (texture2D(y_texture, v_texcoord).r - 0.062745);
+			vec2 uv = texture2D(uv_texture, v_texcoord).)";
+	const char* fragment_shader_tail = R"( - 0.501961;
+			gl_FragColor = vec4(y + 1.596027 * uv.y,
+								y - 0.391762 * uv.x - 0.812968 * uv.y,
+								y + 2.017232 * uv.x,
+								1.0);
+		}
+	)";
+	const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+	bool use_rg = (extensions != nullptr) && (strstr(extensions, "GL_EXT_texture_rg") != nullptr);
+
+	// 有 GL_EXT_texture_rg 时用单/双通道纹理（R8/RG8），否则退回 LUMINANCE/LUMINANCE_ALPHA，
+	// 两种格式 U 分别在 r 通道，V 分别在 g/a 通道
+#if defined(GL_RED_EXT) && defined(GL_RG_EXT)
+	y_format = use_rg ? GL_RED_EXT : GL_LUMINANCE;
+	uv_format = use_rg ? GL_RG_EXT : GL_LUMINANCE_ALPHA;
+#else
+	use_rg = false;
+	y_format = GL_LUMINANCE;
+	uv_format = GL_LUMINANCE_ALPHA;
+#endif
+
+	std::string fragment_shader_src = std::string(fragment_shader_head) +
+		(use_rg ? "rg" : "ra") + fragment_shader_tail;
+	yuv_program = create_program(vertex_shader_src, fragment_shader_src.c_str());
+	if (yuv_program == 0) {
+		return false;
+	}
+
+	glUseProgram(yuv_program);
+	glUniform1i(glGetUniformLocation(yuv_program, "y_texture"), 0);
+	glUniform1i(glGetUniformLocation(yuv_program, "uv_texture"), 1);
+
+	return true;
+}
+
+void EGLPreviewWindow::allocate_yuv_textures(int width, int height) {
+	if (y_tex[0] == 0) {
+		glGenTextures(YUV_TEX_RING, y_tex);
+		glGenTextures(YUV_TEX_RING, uv_tex);
+	}
+
+	for (int i = 0; i < YUV_TEX_RING; i++) {
+		GLuint textures[2] = {y_tex[i], uv_tex[i]};
+		for (int j = 0; j < 2; j++) {
+			glBindTexture(GL_TEXTURE_2D, textures[j]);
+			// 非 2 的幂尺寸的纹理在 GLES2 上只能用 CLAMP_TO_EDGE 且不能有 mipmap
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		}
+		glBindTexture(GL_TEXTURE_2D, y_tex[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, y_format, width, height, 0,
+			y_format, GL_UNSIGNED_BYTE, nullptr);
+		glBindTexture(GL_TEXTURE_2D, uv_tex[i]);
+		glTexImage2D(GL_TEXTURE_2D, 0, uv_format, width / 2, height / 2, 0,
+			uv_format, GL_UNSIGNED_BYTE, nullptr);
+	}
+
+	yuv_tex_width = width;
+	yuv_tex_height = height;
+}
+
 void EGLPreviewWindow::updateTextureSize() {
 	glBindTexture(GL_TEXTURE_2D, rgba_tex);
 
@@ -194,6 +305,7 @@ void EGLPreviewWindow::resize(int new_width, int new_height) {
 }
 
 void EGLPreviewWindow::upload_texture(const std::vector<uint8_t>& rgba_data) {
+	glActiveTexture(GL_TEXTURE0);
 	glBindTexture(GL_TEXTURE_2D, rgba_tex);
 	glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, image_width, image_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, rgba_data.data());
 }
@@ -223,9 +335,44 @@ void EGLPreviewWindow::show(const std::vector<uint8_t>& rgba_data) {
 
 void EGLPreviewWindow::update(const std::vector<uint8_t>& rgba_data) {
 	upload_texture(rgba_data);
+	current_program = program;
 	draw();  // Draw the current texture
 }
 
+void EGLPreviewWindow::updateNV12(const std::vector<uint8_t>& nv12_data) {
+	size_t y_size = (size_t)image_width * image_height;
+
+	if ((image_width <= 0) || (image_height <= 0) || (nv12_data.size() < y_size * 3 / 2)) {
+		std::cerr << "Invalid NV12 frame, size " << nv12_data.size() << " for "
+			<< image_width << "x" << image_height << std::endl;
+		return;
+	}
+
+	if ((yuv_program == 0) && !initialize_yuv_shader()) {
+		return;
+	}
+
+	if ((yuv_tex_width != image_width) || (yuv_tex_height != image_height)) {
+		allocate_yuv_textures(image_width, image_height);
+	}
+
+	// 写入环中的下一组纹理，上一帧的绘制还在读的纹理不会被改写，驱动不需要等待或拷贝
+	yuv_index = (yuv_index + 1) % YUV_TEX_RING;
+
+	glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_2D, y_tex[yuv_index]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image_width, image_height,
+		y_format, GL_UNSIGNED_BYTE, nv12_data.data());
+	glActiveTexture(GL_TEXTURE1);
+	glBindTexture(GL_TEXTURE_2D, uv_tex[yuv_index]);
+	glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, image_width / 2, image_height / 2,
+		uv_format, GL_UNSIGNED_BYTE, nv12_data.data() + y_size);
+
+	current_program = yuv_program;
+	draw();
+}
+
 void EGLPreviewWindow::processEvents() {
 	XEvent xev;
 	while (XPending(x_display) > 0) {
@@ -241,6 +388,17 @@ void EGLPreviewWindow::processEvents() {
 }
 
 void EGLPreviewWindow::draw() {
+	glUseProgram(current_program);
+	if ((current_program != 0) && (current_program == yuv_program)) {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, y_tex[yuv_index]);
+		glActiveTexture(GL_TEXTURE1);
+		glBindTexture(GL_TEXTURE_2D, uv_tex[yuv_index]);
+	} else {
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, rgba_tex);
+	}
+
 	glClear(GL_COLOR_BUFFER_BIT);
 
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
@@ -45,6 +45,11 @@ namespace spdev
         void setImageDimensions(int width, int height);
         void resize(int new_width, int new_height);
         void update(const std::vector<uint8_t>& rgba_data);
+        /**
+         * @brief 直接上传 NV12 的 Y、UV 平面，由片元着色器转成 RGB，CPU 不做颜色转换
+         * @param [in] nv12_data   紧密排列的 NV12 数据，宽高为 setImageDimensions 设置的值
+         */
+        void updateNV12(const std::vector<uint8_t>& nv12_data);
         void processEvents();
 
     private:
@@ -66,7 +71,20 @@ namespace spdev
         GLuint rgba_tex;
         int tex_width, tex_height;
 
+        // NV12 纹理环：上传写下一组纹理，GPU 还在读的上一组不受影响
+        static const int YUV_TEX_RING = 2;
+        GLuint yuv_program;
+        GLuint y_tex[YUV_TEX_RING];
+        GLuint uv_tex[YUV_TEX_RING];
+        int yuv_tex_width, yuv_tex_height;
+        int yuv_index;
+        GLenum y_format, uv_format;  // GL_RED_EXT/GL_RG_EXT 或 GL_LUMINANCE/GL_LUMINANCE_ALPHA
+        GLuint current_program;
+
         bool initialize_shaders();
+        bool initialize_yuv_shader();
+        GLuint create_program(const char* vertex_shader_src, const char* fragment_shader_src);
+        void allocate_yuv_textures(int width, int height);
         void draw();
         void upload_texture(const std::vector<uint8_t>& rgba_data);
     };
@@ -12,6 +12,8 @@
 #include <fcntl.h>
 #include <sys/ioctl.h>
 #include <string.h>
+#include <mutex>
+#include <thread>
 #include <cJSON.h>
 
 #include "utils_log.h"
@@ -70,6 +72,11 @@ namespace spdev
 		},
 	};
 
+	// 同一进程内多路相机共享的资源（mipi rx 接口、VSE 上下文）由该锁保护
+	static std::mutex s_camera_res_mutex;
+	static uint32_t s_mipi_rx_used_mask = 0;
+	static int32_t s_vse_open_num = 0;
+
 	static cJSON *open_json_file(const char *path)
 	{
 		FILE *fp = fopen(path, "r");
@@ -222,6 +229,35 @@ namespace spdev
 		return -1;
 	}
 
+	int32_t VPPCamera::SetBufferNum(int32_t output_buf_num, int32_t fb_buf_num)
+	{
+		if ((output_buf_num <= 0) || (output_buf_num > (int32_t)PYM_MAX_BUF_NUM)
+			|| (fb_buf_num < 0) || (fb_buf_num > (int32_t)PYM_MAX_BUF_NUM)) {
+			SC_LOGE("invalid buffer num output:%d fb:%d", output_buf_num, fb_buf_num);
+			return -1;
+		}
+		m_output_buf_num = output_buf_num;
+		m_fb_buf_num = fb_buf_num;
+		return 0;
+	}
+
+	int32_t VPPCamera::CamInitPymConfig(vp_vflow_contex_t *vp_vflow_contex)
+	{
+		int32_t ret = 0;
+
+		// 每个 VPPCamera 使用自己 context 内的 pym 配置，多路相机互不覆盖
+		ret = vp_vse_init_config(vp_vflow_contex);
+		if (ret != 0) {
+			SC_LOGE("vp_vse_init_config failed error(%d)", ret);
+			return ret;
+		}
+		if (m_output_buf_num > 0) {
+			ret = vp_vse_set_buf_num(vp_vflow_contex,
+				m_output_buf_num, m_fb_buf_num);
+		}
+		return ret;
+	}
+
 	int32_t VPPCamera::CamInitParam(vp_vflow_contex_t *vp_vflow_contex,
 					const int pipe_id, const int video_index,
 					int chn_num, int *width, int *height,
@@ -236,8 +272,10 @@ namespace spdev
 		vin_attr_t *vin_attr = NULL;
 		vin_ochn_attr_t *vin_ochn_attr = NULL;
 		pym_cfg_t *pym_config = NULL; // vse_config_t *vse_config = NULL;
+		vp_sensor_config_t *sensor_config = NULL;
 		vp_csi_config_t csi_config = {0};
 		int32_t input_width = 0, input_height = 0;
+		int32_t mipi_rx = -1;
 		//board_camera_info_t camera_info[MAX_CAMERAS];
 
 		if(parameters != NULL)
@@ -247,8 +285,10 @@ namespace spdev
 			sensor_height = parameters->raw_height;
 		}
 		memset(vp_vflow_contex, 0, sizeof(vp_vflow_contex_t));
-		vp_vflow_contex->pym_config = get_vp_pym_common_config();
-		pym_config = get_vp_pym_common_config();
+		ret = CamInitPymConfig(vp_vflow_contex);
+		if (ret != 0)
+			return -1;
+		pym_config = vp_vflow_contex->pym_config;
 		printf("set camera fps: %d,width: %d,height: %d\n",sensor_fps,sensor_width,sensor_height);
 		//memset(camera_info, 0, sizeof(camera_info));
 		/* to do 这里不需要解析json，需要删掉
@@ -290,9 +330,52 @@ namespace spdev
 		//	return -1;
 		//}
 
-		//to do 后面修改为通过配置获取sensor 配置
-		vp_vflow_contex->mipi_csi_rx_index = camera_info[0].mipi_host;
-		vp_vflow_contex->sensor_config = vp_get_sensor_config_by_mipi_host(camera_info[0].mipi_host, &csi_config,sensor_height,sensor_width,sensor_fps);
+		if (video_index >= MAX_CAMERAS || video_index < -1) {
+			SC_LOGE("The parameter video_idx=%d is not supported. Please set it to one of [-1, 0 ~ %d].",
+				video_index, MAX_CAMERAS - 1);
+			return -1;
+		}
+
+		// 先申请 mipi rx 接口，再在申请到的接口上探测 sensor，保证 sensor 配置和实际使用的接口一致。
+		// 指定了相机序号时只使用该相机的接口，否则按顺序选择第一个空闲并且探测到 sensor 的接口
+		if (video_index >= 0) {
+			mipi_rx = camera_info[video_index].mipi_host;
+			if (ClaimMipiRx(mipi_rx) != 0) {
+				SC_LOGE("mipi rx %d of video_index %d is in use", mipi_rx, video_index);
+				return -1;
+			}
+			sensor_config = vp_get_sensor_config_by_mipi_host(mipi_rx,
+				&csi_config, sensor_height, sensor_width, sensor_fps);
+			if (sensor_config == NULL)
+				ReleaseMipiRx(mipi_rx);
+		} else {
+			for (i = 0; i < MAX_CAMERAS; i++) {
+				if (!camera_info[i].enable)
+					continue;
+				mipi_rx = camera_info[i].mipi_host;
+				if (ClaimMipiRx(mipi_rx) != 0)
+					continue;
+				sensor_config = vp_get_sensor_config_by_mipi_host(mipi_rx,
+					&csi_config, sensor_height, sensor_width, sensor_fps);
+				if (sensor_config != NULL)
+					break;
+				ReleaseMipiRx(mipi_rx);
+			}
+		}
+		if (sensor_config == NULL) {
+			SC_LOGE("No sensor found on a free mipi rx for video_index %d", video_index);
+			return -1;
+		}
+		// 拷贝一份私有的 sensor 配置，多路相机使用同一种 sensor 时互不覆盖
+		vp_sensor_config_clone(sensor_config, &vp_vflow_contex->sensor_cfg,
+			&vp_vflow_contex->sensor_storage);
+		vp_vflow_contex->sensor_config = &vp_vflow_contex->sensor_cfg;
+
+		m_mipi_rx = mipi_rx;
+		vp_vflow_contex->cam_index = GetCameraIndexByMipiHost(mipi_rx);
+		vp_vflow_contex->mipi_csi_rx_index = mipi_rx;
+		vp_vflow_contex->sensor_config->vin_attr->vin_node_attr.cim_attr.mipi_rx = mipi_rx;
+		SC_LOGI("camera video_index:%d use mipi rx %d", video_index, mipi_rx);
 
 		vin_attr = vp_vflow_contex->sensor_config->vin_attr;
 		pym_config = vp_vflow_contex->pym_config;
@@ -497,8 +580,10 @@ namespace spdev
 		pym_cfg_t *pym_config = NULL; // vse_config_t *vse_config = NULL;
 
 		memset(vp_vflow_contex, 0, sizeof(vp_vflow_contex_t));
-		vp_vflow_contex->pym_config = get_vp_pym_common_config();
-		pym_config = get_vp_pym_common_config(); // vse_config = &vp_vflow_contex->vse_config;
+		ret = CamInitPymConfig(vp_vflow_contex);
+		if (ret != 0)
+			return -1;
+		pym_config = vp_vflow_contex->pym_config;
 
 		pym_config->chn_ctrl.src_in_width = src_width;
 	    pym_config->chn_ctrl.src_in_height = src_height;
@@ -605,6 +690,87 @@ namespace spdev
 		return ret;
 	}
 
+	enum {
+		CAM_INIT_NONE = 0,
+		CAM_INIT_VIN,
+		CAM_INIT_ISP,
+		CAM_INIT_VSE,
+		CAM_INIT_VFLOW,
+	};
+
+	int32_t VPPCamera::ClaimMipiRx(int32_t mipi_rx)
+	{
+		std::lock_guard<std::mutex> lock(s_camera_res_mutex);
+
+		if ((mipi_rx < 0) || (mipi_rx >= 32))
+			return -1;
+		if (s_mipi_rx_used_mask & (1u << mipi_rx))
+			return -1;
+		s_mipi_rx_used_mask |= (1u << mipi_rx);
+		return 0;
+	}
+
+	void VPPCamera::ReleaseMipiRx(int32_t mipi_rx)
+	{
+		std::lock_guard<std::mutex> lock(s_camera_res_mutex);
+
+		if ((mipi_rx < 0) || (mipi_rx >= 32))
+			return;
+		s_mipi_rx_used_mask &= ~(1u << mipi_rx);
+	}
+
+	int32_t VPPCamera::InitVse(void)
+	{
+		std::lock_guard<std::mutex> lock(s_camera_res_mutex);
+		vp_vflow_contex_t *vp_vflow_contex = &m_vp_vflow_context;
+		int32_t ret = 0;
+
+		// pym 上下文由驱动分配（AUTO_ALLOC_ID），输出 buffer 也在这里从 hb_mem 申请，
+		// 多路并行打开时串行执行；上下文或者内存不足时直接返回错误，由调用者回滚本路已初始化的模块
+		ret = vp_vse_init(vp_vflow_contex);
+		if (ret != 0) {
+			SC_LOGE("VSE busy: no free context or buffer on pym hw%u, %d pipelines opened, error(%d)",
+				vp_vflow_contex->pym_config->hw_id, s_vse_open_num, ret);
+			return -1;
+		}
+		s_vse_open_num++;
+		return 0;
+	}
+
+	int32_t VPPCamera::DeinitVse(void)
+	{
+		std::lock_guard<std::mutex> lock(s_camera_res_mutex);
+
+		s_vse_open_num--;
+		return vp_vse_deinit(&m_vp_vflow_context);
+	}
+
+	int32_t VPPCamera::GetCameraIndexByMipiHost(int32_t mipi_host)
+	{
+		for (int32_t i = 0; i < MAX_CAMERAS; i++) {
+			if (camera_info[i].enable && (camera_info[i].mipi_host == mipi_host))
+				return i;
+		}
+		return -1;
+	}
+
+	void VPPCamera::RollbackOpen(int32_t init_step)
+	{
+		vp_vflow_contex_t *vp_vflow_contex = &m_vp_vflow_context;
+
+		if (init_step >= CAM_INIT_VFLOW)
+			vp_vflow_deinit(vp_vflow_contex);
+		if (init_step >= CAM_INIT_VSE)
+			DeinitVse();
+		if (init_step >= CAM_INIT_ISP)
+			vp_isp_deinit(vp_vflow_contex);
+		if (init_step >= CAM_INIT_VIN)
+			vp_vin_deinit(vp_vflow_contex);
+
+		ReleaseMipiRx(m_mipi_rx);
+		m_mipi_rx = -1;
+	}
+
 	int32_t VPPCamera::OpenCamera(const int pipe_id,
 								  const int32_t video_index,
 								  int32_t chn_num, //to do： pym 只有一个通道 chn_num后续不需要传值
@@ -612,60 +778,118 @@ namespace spdev
 								  vp_sensors_parameters *parameters)
 	{
 		int32_t ret = 0;
+		int32_t init_step = CAM_INIT_NONE;
 		vp_vflow_contex_t *vp_vflow_contex = &m_vp_vflow_context;
+
+		if (m_is_open) {
+			SC_LOGE("camera already opened");
+			return -1;
+		}
+
 		// TODO: 根据 video_index 和 chn_num 完成sensor的探测、初始化、开流
 		ret = CamInitParam(vp_vflow_contex, pipe_id, video_index, chn_num,
 			width, height, parameters);
 		if (ret != 0){
 			SC_LOGE("CamInitParam failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 
 		ret = vp_vin_init(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_vin_init failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
+		init_step = CAM_INIT_VIN;
 		ret = vp_isp_init(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_isp_init failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
-		ret = vp_vse_init(vp_vflow_contex);
+		init_step = CAM_INIT_ISP;
+		ret = InitVse();
 		if (ret != 0){
-			SC_LOGE("vp_vse_init failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
+		init_step = CAM_INIT_VSE;
 		ret = vp_vflow_init(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_vflow_init failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
+		init_step = CAM_INIT_VFLOW;
 
 		ret = vp_vin_start(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_vin_start failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 		ret = vp_isp_start(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_isp_start failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 		ret = vp_vse_start(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_vse_start failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 		ret = vp_vflow_start(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("vp_vflow_start failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 
+		m_only_vse = false;
+		m_is_open = true;
 		vp_print_debug_infos();
 
 		return ret;
+
+	err:
+		// 只回滚本路相机，不影响同进程中的其他相机
+		RollbackOpen(init_step);
+		return -1;
+	}
+
+	int32_t VPPCamera::OpenCameras(std::vector<VPPCamera *> &cameras,
+			std::vector<camera_open_param_t> &params,
+			std::vector<int32_t> &results)
+	{
+		int32_t success_num = 0;
+		std::vector<std::thread> workers;
+
+		if (cameras.size() != params.size()) {
+			LOGE_print("cameras size %zu mismatch params size %zu\n",
+				cameras.size(), params.size());
+			return 0;
+		}
+
+		results.assign(cameras.size(), -1);
+		// 各路相机的 sensor/vin/isp/vse 初始化相互独立，并行执行以缩短启动时间
+		for (size_t i = 0; i < cameras.size(); i++) {
+			if (cameras[i] == NULL)
+				continue;
+			workers.emplace_back([&cameras, &params, &results, i]() {
+				camera_open_param_t &param = params[i];
+				results[i] = cameras[i]->OpenCamera(param.pipe_id, param.video_index,
+					param.chn_num, param.width, param.height,
+					param.has_parameters ? &param.parameters : NULL);
+			});
+		}
+		for (auto &worker : workers) {
+			worker.join();
+		}
+
+		for (size_t i = 0; i < results.size(); i++) {
+			if (results[i] == 0) {
+				success_num++;
+			} else {
+				LOGE_print("camera %zu (video_index %d) open failed\n",
+					i, params[i].video_index);
+			}
+		}
+
+		return success_num;
 	}
 
 	int32_t VPPCamera::OpenVSE(const int32_t pipe_id, int32_t chn_num, int32_t proc_mode,
@@ -690,10 +914,14 @@ namespace spdev
 		m_width = src_width;
 		m_height = src_height;
 
-		ret = vp_vse_init(vp_vflow_contex);
-		ret |= vp_vflow_init(vp_vflow_contex);
+		ret = InitVse();
+		if (ret != 0){
+			return -1;
+		}
+		ret = vp_vflow_init(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("pipeline init failed error(%d)", ret);
+			DeinitVse();
 			return -1;
 		}
 
@@ -701,7 +929,7 @@ namespace spdev
 		ret |= vp_vflow_start(vp_vflow_contex);
 		if (ret != 0){
 			SC_LOGE("pipeline start failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 
 		memset(&m_vse_input_image, 0, sizeof(hbn_vnode_image_t));
@@ -718,11 +946,19 @@ namespace spdev
 									&m_vse_input_image.buffer);
 		if (ret != 0){
 			SC_LOGE("hb_mem_alloc_graph_buf failed error(%d)", ret);
-			return -1;
+			goto err;
 		}
 
+		m_is_open = true;
 		vp_print_debug_infos();
 		return ret;
+
+	err:
+		vp_vflow_stop(vp_vflow_contex);
+		vp_vse_stop(vp_vflow_contex);
+		vp_vflow_deinit(vp_vflow_contex);
+		DeinitVse();
+		return -1;
 	}
 
 	int32_t VPPCamera::OpenVPS(const int32_t pipe_id, int32_t chn_num, int32_t proc_mode,
@@ -738,6 +974,8 @@ namespace spdev
 	{
 		int32_t ret = 0;
 		vp_vflow_contex_t *vp_vflow_contex = &m_vp_vflow_context;
+		if (!m_is_open)
+			return 0;
 		ret = vp_vflow_stop(vp_vflow_contex);
 		if (m_only_vse == false) {
 			ret |= vp_vin_stop(vp_vflow_contex);
@@ -749,11 +987,17 @@ namespace spdev
 			return -1;
 		}
 		ret = vp_vflow_deinit(vp_vflow_contex);
-		ret |= vp_vse_deinit(vp_vflow_contex);
+		ret |= DeinitVse();
 		if (m_only_vse == false) {
 			ret |= vp_isp_deinit(vp_vflow_contex);
 			ret |= vp_vin_deinit(vp_vflow_contex);
+		} else if (m_vse_input_image.buffer.fd[0] > 0) {
+			hb_mem_free_buf(m_vse_input_image.buffer.fd[0]);
+			memset(&m_vse_input_image, 0, sizeof(hbn_vnode_image_t));
 		}
+		m_is_open = false;
+		ReleaseMipiRx(m_mipi_rx);
+		m_mipi_rx = -1;
 		if (ret != 0){
 			SC_LOGE("pipeline deinit failed error(%d)", ret);
 			return -1;
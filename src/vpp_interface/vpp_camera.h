@@ -10,6 +10,7 @@
 
 #include <sstream>
 #include <string>
+#include <vector>
 
 #include "vp_wrap.h"
 #include "vp_sensors.h"
@@ -38,6 +39,17 @@ typedef struct {
     int mipi_host;
 } board_camera_info_t;
 
+// 多路相机并行打开时每一路的参数
+typedef struct {
+	int pipe_id;
+	int video_index;        // 相机序号，-1 表示自动选择空闲的接口
+	int chn_num;
+	int width[VSE_MAX_CHN_NUM];
+	int height[VSE_MAX_CHN_NUM];
+	int has_parameters;
+	vp_sensors_parameters parameters;
+} camera_open_param_t;
+
 class VPPCamera :public VPPModule
 {
   public:
@@ -47,11 +59,34 @@ class VPPCamera :public VPPModule
 	};
 	virtual ~VPPCamera() = default;
 
+	/**
+	 * @brief 多路相机并行初始化，每一路在独立线程中执行 OpenCamera，
+	 *        某一路失败只会回滚该路，不影响其他路
+	 * @param [in] cameras   相机对象数组
+	 * @param [in] params    每一路相机的打开参数，与 cameras 一一对应
+	 * @param [out] results  每一路的返回值，0 成功，-1 失败
+	 *
+	 * @retval 成功打开的相机数量
+	 */
+	static int32_t OpenCameras(std::vector<VPPCamera *> &cameras,
+			std::vector<camera_open_param_t> &params,
+			std::vector<int32_t> &results);
+
+	/**
+	 * @brief 根据 mipi host 查找相机序号，可作为 OpenCamera 的 video_index
+	 * @param [in] mipi_host   mipi host 编号
+	 *
+	 * @retval 非-1      相机序号
+	 * @retval -1        没有对应的相机
+	 */
+	static int32_t GetCameraIndexByMipiHost(int32_t mipi_host);
+
 	/**
 	 * @brief 指定原始分辨率并打开摄像头，适用于有多种分辨率的摄像头
 	 *
 	 * @param pipe_id           视频pipeline id
-	 * @param video_index       相机节点
+	 * @param video_index       相机序号(0 ~ MAX_CAMERAS - 1)，-1 表示使用 sensor 默认接口，
+	 *                          默认接口已被占用时自动选择其他空闲接口
 	 * @param chn_num           VPS通道数量
 	 * @param parameters        raw图相关参数 参见 x3_sensors_parameters 声明部分
 	 * @param width             VPS宽数组
@@ -208,6 +243,24 @@ class VPPCamera :public VPPModule
 	int32_t SelectVseChn(int *chn_en, int src_width, int src_height,
 		int dst_width, int dst_height);
 
+	/**
+	 * @brief 设置本路 VSE(pym) 的 buffer 数量，需要在 OpenCamera/OpenVSE 之前调用
+	 * @param [in] output_buf_num  输出 buffer 数量，低延时预览可设为 2，默认 6
+	 * @param [in] fb_buf_num      feedback buffer 数量，默认 2
+	 *
+	 * @retval 0      成功
+	 * @retval -1     失败
+	 */
+	int32_t SetBufferNum(int32_t output_buf_num, int32_t fb_buf_num);
+
+	/**
+	 * @brief 用默认值初始化本路私有的 pym 配置，并应用 SetBufferNum 设置的 buffer 数量
+	 *
+	 * @retval 0      成功
+	 * @retval -1     失败
+	 */
+	int32_t CamInitPymConfig(vp_vflow_contex_t *vp_vflow_contex);
+
 	/**
 	 * @brief 初始化 Camera Sensor 和 VSE 各通道的参数
 	 *
@@ -231,10 +284,32 @@ class VPPCamera :public VPPModule
 		int *crop_x, int *crop_y, int *crop_width, int *crop_height, int *rotate);
 
 	private:
+		/**
+		 * @brief 申请/释放 mipi rx 接口，同一进程内多路相机不能重复使用同一个接口
+		 */
+		static int32_t ClaimMipiRx(int32_t mipi_rx);
+		static void ReleaseMipiRx(int32_t mipi_rx);
+
+		/**
+		 * @brief 初始化/释放本路的 VSE（pym），与同一进程中其他相机的 VSE 初始化串行执行，
+		 *        没有空闲的 pym 上下文或者 hb_mem 不足时返回 -1
+		 */
+		int32_t InitVse(void);
+		int32_t DeinitVse(void);
+
+		/**
+		 * @brief 按照初始化的逆序释放已经初始化的模块
+		 */
+		void RollbackOpen(int32_t init_step);
+
 		int32_t m_last_frame_id = 0;
+		int32_t m_mipi_rx = -1;
+		int32_t m_is_open = false;
 		vp_vflow_contex_t m_vp_vflow_context;
 		int32_t m_only_vse = false;
 		hbn_vnode_image_t m_vse_input_image;
+		int32_t m_output_buf_num = 0; // 0 表示使用默认值
+		int32_t m_fb_buf_num = 0;
 };
 
 } // namespace spdev
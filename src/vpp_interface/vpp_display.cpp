@@ -33,8 +33,8 @@ namespace spdev
 	struct timeval tv_timestamp;
 	bool isGPUInit = false;
 	int32_t currentRenderBufferIndex = 0;
-	// Queue to hold RGBA buffers
-	std::queue<std::vector<uint8_t>> rgbaQueue;
+	// Queue to hold NV12 frames for the EGL preview window
+	std::queue<std::vector<uint8_t>> previewQueue;
 	std::mutex queueMutex;
 	std::condition_variable queueCV;
 	std::atomic<bool> stopProcessing{false}; // To control when to stop the processing thread
@@ -53,199 +53,189 @@ bool is_x11_or_wayland_available() {
 }
 
 bool is_drm_available() {
-	int fd = open("/dev/dri/card0", O_RDWR | O_CLOEXEC);
-	if (fd < 0) {
-		return false;
-	}
-
-	// 尝试获取 DRM master 权限, 如果失败则表示设备被占用
-	if (ioctl(fd, DRM_IOCTL_SET_MASTER, 0) != 0) {
-		if (errno == EBUSY) {
-			close(fd);
-			return false;  // 设备被占用
-		}
-	}
-
-	// 设备没有被占用
-	ioctl(fd, DRM_IOCTL_DROP_MASTER, 0);
-	close(fd);
-	return true;
+	// 设备选择规则与 vp_display_init 一致，可以用 VP_DRM_DEVICE 指定 vkms 等设备
+	return vp_display_is_available() != 0;
 }
 
 /// Class VPPDisplay related
 
 int32_t VPPDisplay::OpenDisplay(int32_t width, int32_t height)
 {
-//	int32_t ret = 0;
-//	int64_t allocFlags = 0;
-//
-//	m_width = width;
-//	m_height = height;
-//
-//	if (is_x11_or_wayland_available()) {
-//		printf("X11 is available, using EGL for rendering.\n");
-//		// 使用 EGL 进行显示
-//		m_display_mode = 1;
-//	} else if (is_drm_available()) {
-//		printf("DRM is available, using libdrm for rendering.\n");
-//		// 使用 libdrm 进行显示
-//		m_display_mode = 0;
-//	} else {
-//		printf("No suitable display method found.\n");
-//		printf("Running without preview window\n");
-//		m_display_mode = 2;
-//		return 0;
-//	}
-//
-//	if (2 == m_display_mode) {
-//		return 0;
-//	} else if (0 == m_display_mode) {
-//		hb_mem_module_open();
-//
-//		vp_display_init(&m_drm_ctx, width, height);
-//
-//		allocFlags = HB_MEM_USAGE_MAP_INITIALIZED |
-//						HB_MEM_USAGE_PRIV_HEAP_2_RESERVERD |
-//						HB_MEM_USAGE_CPU_READ_OFTEN |
-//						HB_MEM_USAGE_CPU_WRITE_OFTEN |
-//						HB_MEM_USAGE_CACHED |
-//						HB_MEM_USAGE_GRAPHIC_CONTIGUOUS_BUF;
-//
-//		for (int i = 0; i < NUM_BUFFERS; ++i) {
-//			memset(&m_vo_buffers[i], 0, sizeof(hbn_vnode_image_t));
-//			ret = hb_mem_alloc_graph_buf(width, height,
-//					MEM_PIX_FMT_NV12,
-//					allocFlags,
-//					width, height,
-//					&m_vo_buffers[i].buffer);
-//			if (ret != 0) {
-//				SC_LOGE("hb_mem_alloc_graph_buf for buffer[%d] failed error(%d)", i, ret);
-//				for (int j = 0; j < i; ++j) {
-//					hb_mem_free_buf(m_vo_buffers[j].buffer.fd[0]);
-//				}
-//				return -1;
-//			}
-//		}
-//	} else if (1 == m_display_mode) {
-//		allocFlags = HB_MEM_USAGE_MAP_INITIALIZED |
-//						HB_MEM_USAGE_PRIV_HEAP_2_RESERVERD |
-//						HB_MEM_USAGE_CPU_READ_OFTEN |
-//						HB_MEM_USAGE_CPU_WRITE_OFTEN |
-//						HB_MEM_USAGE_CACHED |
-//						HB_MEM_USAGE_GRAPHIC_CONTIGUOUS_BUF;
-//
-//		for (int i = 0; i < NUM_BUFFERS; ++i) {
-//			memset(&m_vo_buffers[i], 0, sizeof(hbn_vnode_image_t));
-//			ret = hb_mem_alloc_graph_buf(width, height,
-//					MEM_PIX_FMT_NV12,
-//					allocFlags,
-//					width, height,
-//					&m_vo_buffers[i].buffer);
-//			if (ret != 0) {
-//				SC_LOGE("hb_mem_alloc_graph_buf for buffer[%d] failed error(%d)", i, ret);
-//				for (int j = 0; j < i; ++j) {
-//					hb_mem_free_buf(m_vo_buffers[j].buffer.fd[0]);
-//				}
-//				return -1;
-//			}
-//		}
-//
-//		startProcessingThread();
-//	}
-//
-//	memset(&m_draw_buffers, 0, sizeof(hbn_vnode_image_t));
-//	ret = hb_mem_alloc_graph_buf(width, height,
-//			MEM_PIX_FMT_ARGB,
-//			allocFlags,
-//			width, height,
-//			&m_draw_buffers.buffer);
-//
-//// final buffer for overlay process
-//	memset(&m_final_buffers[0], 0, sizeof(hbn_vnode_image_t));
-//	ret = hb_mem_alloc_graph_buf(width, height,
-//			MEM_PIX_FMT_NV12,
-//			allocFlags,
-//			width, height,
-//			&m_final_buffers[0].buffer);
-//	memset(&m_final_buffers[1], 0, sizeof(hbn_vnode_image_t));
-//	ret = hb_mem_alloc_graph_buf(width, height,
-//			MEM_PIX_FMT_NV12,
-//			allocFlags,
-//			width, height,
-//			&m_final_buffers[1].buffer);
-//
-//	if (ret != 0) {
-//		SC_LOGE("hb_mem_alloc_graph_buf for m_draw_buffers failed error(%d)", ret);
-//		for (int j = 0; j < NUM_BUFFERS; ++j) {
-//			hb_mem_free_buf(m_vo_buffers[j].buffer.fd[0]);
-//		}
-//		return -1;
-//	}
-//
-//	return ret;
+	m_width = width;
+	m_height = height;
+
+	if (is_x11_or_wayland_available()) {
+		printf("X11 is available, using EGL for rendering.\n");
+		// 使用 EGL 进行显示
+		m_display_mode = 1;
+		startProcessingThread();
+		return OpenSoftOsd(width, height);
+	} else if (is_drm_available()) {
+		printf("DRM is available, using libdrm for rendering.\n");
+		// 使用 libdrm 进行显示
+		m_display_mode = 0;
+		return OpenDrmDisplay(width, height);
+	}
 
-// to do display准备好后再开启
-	return 0;
+	printf("No suitable display method found.\n");
+	printf("Running without preview window\n");
+	m_display_mode = 2;
+	return OpenSoftOsd(width, height);
 }
 
-int32_t VPPDisplay::Close()
+int32_t VPPDisplay::OpenDrmDisplay(int32_t width, int32_t height)
 {
-//	int32_t ret = 0;
-//	if (0 == m_display_mode) {
-//		hb_mem_free_buf(m_draw_buffers.buffer.fd[0]);
-//		for (int i = 0; i < NUM_BUFFERS; ++i) {
-//			hb_mem_free_buf(m_vo_buffers[i].buffer.fd[0]);
-//		}
-//		vp_display_deinit(&m_drm_ctx);
-//		hb_mem_module_close();
-//	} else if (1 == m_display_mode) {
-//		hb_mem_free_buf(m_draw_buffers.buffer.fd[0]);
-//		EGLPreviewWindow& window = EGLPreviewWindow::getInstance();
-//		window.close();
-//	}
-//
-//	return ret;
+	int32_t ret = 0;
+	int64_t allocFlags = 0;
+	int32_t i = 0;
+
+	ret = vp_display_init(&m_drm_ctx, width, height);
+	if (ret != 0) {
+		LOGE_print("vp_display_init failed\n");
+		return -1;
+	}
+
+	hb_mem_module_open();
+	m_hb_mem_opened = 1;
+
+	// 送显 buffer 由显示控制器直接扫描输出，不使用 CACHED，CPU 写完不需要刷 cache
+	allocFlags = HB_MEM_USAGE_MAP_INITIALIZED |
+					HB_MEM_USAGE_PRIV_HEAP_2_RESERVERD |
+					HB_MEM_USAGE_CPU_WRITE_OFTEN |
+					HB_MEM_USAGE_GRAPHIC_CONTIGUOUS_BUF;
+
+	for (i = 0; i < NUM_BUFFERS; ++i) {
+		memset(&m_vo_buffers[i], 0, sizeof(hbn_vnode_image_t));
+		ret = hb_mem_alloc_graph_buf(width, height,
+				MEM_PIX_FMT_NV12,
+				allocFlags,
+				width, height,
+				&m_vo_buffers[i].buffer);
+		if (ret != 0) {
+			LOGE_print("hb_mem_alloc_graph_buf for buffer[%d] failed error(%d)\n", i, ret);
+			goto err;
+		}
+	}
+
+	if (m_drm_ctx.plane_count > VP_DISPLAY_PLANE_OSD) {
+		for (i = 0; i < NUM_OSD_BUFFERS; ++i) {
+			memset(&m_osd_buffers[i], 0, sizeof(hbn_vnode_image_t));
+			ret = hb_mem_alloc_graph_buf(width, height,
+					MEM_PIX_FMT_ARGB,
+					allocFlags,
+					width, height,
+					&m_osd_buffers[i].buffer);
+			if (ret != 0) {
+				LOGE_print("hb_mem_alloc_graph_buf for osd buffer[%d] failed error(%d)\n", i, ret);
+				goto err;
+			}
+			if (InitOsdSurface(i, m_osd_buffers[i].buffer.virt_addr[0], width, height) != 0)
+				goto err;
+		}
+		// 字库在这里加载一次，之后绘制文字不再访问文件
+		(void)vp_overlay_load_fonts();
+		vp_overlay_list_reset(&m_osd_list);
+	} else if (OpenSoftOsd(width, height) != 0) {
+		goto err;
+	}
+
+	currentBufferIndex = 0;
+	m_osd_index = 0;
 
-// to do display准备好后再开启
 	return 0;
-}
 
-inline int clamp(int value, int minVal, int maxVal) {
-	return std::max(minVal, std::min(value, maxVal));
+err:
+	CloseDrmDisplay();
+	return -1;
 }
 
-// NV12 转 RGBA 函数
-void NV12ToRGBA(const uint8_t* nv12, uint8_t* rgba, int width, int height) {
-	int frameSize = width * height;
-	int chromaSize = frameSize / 4;
+void VPPDisplay::CloseDrmDisplay()
+{
+	// 先停止送显并删除 framebuffer，再释放 buffer
+	vp_display_deinit(&m_drm_ctx);
 
-	const uint8_t* yPlane = nv12;
-	const uint8_t* uvPlane = nv12 + frameSize;
+	for (int i = 0; i < NUM_BUFFERS; ++i) {
+		if (m_vo_buffers[i].buffer.fd[0] > 0)
+			hb_mem_free_buf(m_vo_buffers[i].buffer.fd[0]);
+		memset(&m_vo_buffers[i], 0, sizeof(hbn_vnode_image_t));
+	}
+	CloseOsd();
 
-	for (int j = 0; j < height; ++j) {
-		for (int i = 0; i < width; ++i) {
-			int yIndex = j * width + i;
-			int uvIndex = (j / 2) * (width / 2) + (i / 2);
+	if (m_hb_mem_opened) {
+		hb_mem_module_close();
+		m_hb_mem_opened = 0;
+	}
+}
 
-			int y = yPlane[yIndex];
-			int u = uvPlane[2 * uvIndex];
-			int v = uvPlane[2 * uvIndex + 1];
+// OSD buffer 已经分配好，清空后初始化对应的 surface 和合成图层
+int32_t VPPDisplay::InitOsdSurface(int32_t index, uint8_t *addr, int32_t width, int32_t height)
+{
+	memset(addr, 0, width * height * DISPLAY_ARGB_BYTES);
+	vp_overlay_surface_init(&m_osd_surfaces[index], addr, width, height,
+		width * DISPLAY_ARGB_BYTES);
+	return vp_blend_layer_init(&m_osd_layers[index], addr, width, height,
+		width * DISPLAY_ARGB_BYTES, 0);
+}
 
-			// 将 YUV 转换为 RGBA
-			int c = y - 16;
-			int d = u - 128;
-			int e = v - 128;
+// 没有 DRM OSD 图层时，OSD 画在普通内存中，SetGraph* 照常可用，结果只通过 BlendOsd 烧录到图像
+int32_t VPPDisplay::OpenSoftOsd(int32_t width, int32_t height)
+{
+	for (int32_t i = 0; i < NUM_OSD_BUFFERS; ++i) {
+		m_osd_soft_buffers[i] = (uint8_t *)malloc(width * height * DISPLAY_ARGB_BYTES);
+		if ((m_osd_soft_buffers[i] == NULL) ||
+			(InitOsdSurface(i, m_osd_soft_buffers[i], width, height) != 0)) {
+			LOGE_print("init software osd buffer[%d] %dx%d failed\n", i, width, height);
+			CloseOsd();
+			return -1;
+		}
+	}
+	(void)vp_overlay_load_fonts();
+	vp_overlay_list_reset(&m_osd_list);
+	m_osd_index = 0;
+	m_osd_soft = 1;
 
-			int r = clamp((298 * c + 409 * e + 128) >> 8, 0, 255);
-			int g = clamp((298 * c - 100 * d - 208 * e + 128) >> 8, 0, 255);
-			int b = clamp((298 * c + 516 * d + 128) >> 8, 0, 255);
+	return 0;
+}
 
-			rgba[4 * yIndex + 0] = r;
-			rgba[4 * yIndex + 1] = g;
-			rgba[4 * yIndex + 2] = b;
-			rgba[4 * yIndex + 3] = 255; // Alpha 通道设为 255
-		}
+void VPPDisplay::CloseOsd()
+{
+	std::lock_guard<std::mutex> draw_lock(m_osd_draw_mutex);
+	std::lock_guard<std::mutex> blend_lock(m_osd_blend_mutex);
+	std::lock_guard<std::mutex> lock(m_osd_mutex);
+
+	for (int32_t i = 0; i < NUM_OSD_BUFFERS; ++i) {
+		if (m_osd_buffers[i].buffer.fd[0] > 0)
+			hb_mem_free_buf(m_osd_buffers[i].buffer.fd[0]);
+		memset(&m_osd_buffers[i], 0, sizeof(hbn_vnode_image_t));
+		free(m_osd_soft_buffers[i]);
+		m_osd_soft_buffers[i] = NULL;
+		vp_overlay_surface_deinit(&m_osd_surfaces[i]);
+		vp_blend_layer_deinit(&m_osd_layers[i]);
 	}
+	m_osd_soft = 0;
+	m_osd_pending = false;
+}
+
+int32_t VPPDisplay::Close()
+{
+	if (0 == m_display_mode) {
+		CloseDrmDisplay();
+	} else {
+		if (1 == m_display_mode)
+			stopProcessingThread();
+		CloseOsd();
+	}
+
+	return 0;
+}
+
+void VPPDisplay::GetDisplayStats(vp_display_stats_t *stats)
+{
+	vp_display_get_stats(&m_drm_ctx, stats);
+}
+
+inline int clamp(int value, int minVal, int maxVal) {
+	return std::max(minVal, std::min(value, maxVal));
 }
 
 class FrameRateCounter {
@@ -357,27 +347,18 @@ n2d_error_t create_n2d_buffer_from_phyaddr_continuous_memory(n2d_buffer_t *n2d_b
 	return N2D_SUCCESS;
 }
 
-n2d_error_t VPPDisplay::do_overlay(n2d_buffer_t *src0_nv12,n2d_buffer_t *scr1_ar24,n2d_buffer_t *dst0_nv12){
-//	n2d_error_t error	       = N2D_SUCCESS;
-//	n2d_rectangle_t rect;
-//	rect.x = 0; //top left
-//	rect.y = 0;
-//	rect.width = scr1_ar24->width;
-//	rect.height = scr1_ar24->height;
-//
-//	N2D_ON_ERROR(n2d_blit(&rgba_buffer, N2D_NULL, src0_nv12, N2D_NULL, N2D_BLEND_NONE));
-//	N2D_ON_ERROR(n2d_blit(&rgba_buffer, &rect , scr1_ar24, N2D_NULL, N2D_BLEND_SRC_OVER));
-//	N2D_ON_ERROR(n2d_blit(dst0_nv12, &rect , &rgba_buffer, N2D_NULL, N2D_BLEND_NONE));
-//	N2D_ON_ERROR(n2d_commit());
-//	return error;
-//on_error:
-//	n2d_free(src0_nv12);
-//	n2d_free(scr1_ar24);
-//	n2d_free(dst0_nv12);
-//	return error;
+// 没有 nano2D 时用软件合成代替 GC820 的 SRC_OVER blit：把当前 OSD 图层烧录到 NV12 图像上，
+// 只处理 OSD 上有内容的 tile，OSD 内容没变化时不重新扫描
+int32_t VPPDisplay::do_overlay(int32_t index, uint8_t *dst_y, uint8_t *dst_uv, int32_t stride,
+	int32_t width, int32_t height)
+{
+	vp_blend_layer_t *layer = &m_osd_layers[index];
+	int32_t active = vp_blend_layer_sync(layer, &m_osd_surfaces[index]);
 
-// to do display准备好后再开启
-	return N2D_SUCCESS;
+	if (active <= 0)
+		return active;
+
+	return vp_blend_nv12(layer, NULL, dst_y, dst_uv, stride, width, height, 0, 0);
 }
 
 
@@ -390,117 +371,119 @@ int32_t VPPDisplay::convertN2DBuffer(n2d_buffer_t *n2d_buffer, hb_mem_graphic_bu
 	return error;
 }
 
-size_t get_nv12_size(int width, int height) {
-    return width * height * 1.5; // Y plane + UV plane
-}
-
-size_t get_argb8888_size(int width, int height) {
-    return width * height * 4; // 每个像素4字节
-}
+// 把 frame 中的 NV12 数据按 dst_stride 拷贝到 dst_y/dst_uv
+static int32_t copy_frame_nv12(ImageFrame *frame, int32_t width, int32_t height,
+	uint8_t *dst_y, uint8_t *dst_uv, int32_t dst_stride)
+{
+	int32_t src_stride = 0;
+	uint8_t *src_y = NULL, *src_uv = NULL;
 
-void save_image_to_file(const char* file_name, void* buffer, size_t size) {
+	if ((frame == NULL) || (frame->data[0] == NULL)) {
+		LOGE_print("frame data is null\n");
+		return -1;
+	}
+	if (((frame->width != 0) && (frame->width != width)) ||
+		((frame->height != 0) && (frame->height != height))) {
+		LOGE_print("frame size %dx%d mismatch display size %dx%d\n",
+			frame->width, frame->height, width, height);
+		return -1;
+	}
 
-    FILE* file = fopen(file_name, "wb");
-    if (!file) {
-        printf("Failed to open file %s for writing\n", file_name);
-        return;
-    }
+	src_y = frame->data[0];
+	if ((frame->plane_count > 1) && (frame->data[1] != NULL)) {
+		src_stride = (frame->stride > 0) ? frame->stride : width;
+		src_uv = frame->data[1];
+	} else {
+		// 单平面数据（例如 python 传入的 bytes）按紧密排列的 NV12 处理
+		if (frame->data_size[0] < (uint32_t)(width * height * 3 / 2)) {
+			LOGE_print("frame data size %u too small for %dx%d nv12\n",
+				frame->data_size[0], width, height);
+			return -1;
+		}
+		src_stride = width;
+		src_uv = src_y + width * height;
+	}
 
+	if ((src_stride == width) && (dst_stride == width)) {
+		memcpy(dst_y, src_y, width * height);
+		memcpy(dst_uv, src_uv, width * height / 2);
+	} else {
+		for (int32_t row = 0; row < height; row++)
+			memcpy(dst_y + row * dst_stride, src_y + row * src_stride, width);
+		for (int32_t row = 0; row < height / 2; row++)
+			memcpy(dst_uv + row * dst_stride, src_uv + row * src_stride, width);
+	}
 
-    size_t written = fwrite(buffer, 1, size, file);
-    if (written != size) {
-        printf("Failed to write all data to file. Written: %zu, Expected: %zu\n", written, size);
-    }
+	return 0;
+}
 
+int32_t VPPDisplay::CopyFrameToBuffer(ImageFrame *frame, hb_mem_graphic_buf_t *buffer)
+{
+	int32_t dst_stride = (buffer->stride > 0) ? buffer->stride : buffer->width;
+	int32_t dst_vstride = (buffer->vstride > 0) ? buffer->vstride : buffer->height;
+	uint8_t *dst_y = buffer->virt_addr[0];
+	uint8_t *dst_uv = (buffer->virt_addr[1] != NULL) ?
+		buffer->virt_addr[1] : dst_y + dst_stride * dst_vstride;
 
-    fclose(file);
-    printf("Image data successfully saved to %s\n", file_name);
+	return copy_frame_nv12(frame, buffer->width, buffer->height, dst_y, dst_uv, dst_stride);
 }
 
 int32_t VPPDisplay::SetImageFrame(ImageFrame *frame) {
-//	int32_t ret = 0;
-//
-//	if (2 == m_display_mode) {
-//		fpsCounter.update();
-//		return 0;
-//	}
-//
-//	//Must ensure that the n2d_open and the final compositing operations are executed on the same thread.
-//	if(isGPUInit == false){
-//		ret = n2d_open();
-//		if(ret)
-//		{
-//			LOGE_print("n2d_open fail,ret:%d\n",ret);
-//		}
-//
-//		for (size_t i = 0; i < 3; i++)
-//		{
-//			ret = convertN2DBuffer(&primary_mapped_gpu_buffer[i],&m_vo_buffers[i].buffer, N2D_NV12);
-//			if(ret){
-//				LOGE_print("convertN2DBuffer(NV12) fail,ret:%d\n",ret);
-//			}
-//		}
-//
-//		ret = convertN2DBuffer(&overlay_mapped_gpu_buffer[0],&m_draw_buffers.buffer, N2D_RGBA8888);
-//		if(ret){
-//			LOGE_print("convertN2DBuffer(AR24) fail,ret:%d\n",ret);
-//		}
-//
-//		ret = convertN2DBuffer(&final_mapped_gpu_buffer[0],&m_final_buffers[0].buffer, N2D_NV12);
-//		if(ret){
-//			LOGE_print("convertN2DBuffer(NV12 final) fail,ret:%d\n",ret);
-//		}
-//		ret = convertN2DBuffer(&final_mapped_gpu_buffer[1],&m_final_buffers[1].buffer, N2D_NV12);
-//		if(ret){
-//			LOGE_print("convertN2DBuffer(NV12 final) fail,ret:%d\n",ret);
-//		}
-//		memset(&rgba_buffer,0,sizeof(n2d_buffer_t));
-//		n2d_util_allocate_buffer(
-//        m_vo_buffers[0].buffer.width,
-//        m_vo_buffers[0].buffer.height,
-//        N2D_RGBA8888,
-//        N2D_0,
-//        N2D_LINEAR,
-//        N2D_TSC_DISABLE,
-//        &rgba_buffer);
-//
-//		LOGI_print("N2D init done!\n");
-//		isGPUInit = true;
-//	}
-//
-//	hbn_vnode_image_t& currentBuffer = m_vo_buffers[currentBufferIndex];
-//	currentBufferIndex = (currentBufferIndex + 1) % NUM_BUFFERS;
-//
-//	for (int i = 0; i < frame->plane_count; ++i) {
-//		memcpy(currentBuffer.buffer.virt_addr[i], frame->data[i], frame->data_size[i]);
-//	}
-//
-//	if (0 == m_display_mode) {
-//		// let's do overlay
-//		do_overlay(&primary_mapped_gpu_buffer[currentBufferIndex], &overlay_mapped_gpu_buffer[0], &final_mapped_gpu_buffer[currentRenderBufferIndex]);
-//		ret = vp_display_set_frame(&m_drm_ctx, 0, &m_final_buffers[currentRenderBufferIndex]);
-//		currentRenderBufferIndex = (currentRenderBufferIndex + 1) % 2;
-//
-//	} else if (1 == m_display_mode) {
-//		std::vector<uint8_t> rgbaData(frame->width * frame->height * 4);
-//
-//		// Convert NV12 to RGBA in the main thread (producer)
-//		NV12ToRGBA(currentBuffer.buffer.virt_addr[0], rgbaData.data(), frame->width, frame->height);
-//
-//		// Lock and push the converted RGBA data into the queue
-//		{
-//			std::lock_guard<std::mutex> lock(queueMutex);
-//			if (rgbaQueue.size() < MAX_QUEUE_SIZE) {
-//				rgbaQueue.push(std::move(rgbaData));
-//			}
-//		}
-//		queueCV.notify_one();  // Notify the consumer thread to process the RGBA data
-//	}
-//err:
-//	return ret;
+	hbn_vnode_image_t *vo_buffer = NULL;
+	int32_t idx = 0;
+
+	if (2 == m_display_mode) {
+		fpsCounter.update();
+		return 0;
+	} else if (1 == m_display_mode) {
+		// 预览窗口直接上传 NV12，由 GPU 着色器做颜色转换
+		std::vector<uint8_t> nv12Data(m_width * m_height * 3 / 2);
+		if (copy_frame_nv12(frame, m_width, m_height, nv12Data.data(),
+				nv12Data.data() + m_width * m_height, m_width) != 0)
+			return -1;
+
+		{
+			std::lock_guard<std::mutex> lock(queueMutex);
+			// 预览跟不上时丢掉最旧的帧，保证显示的是最新画面
+			if (previewQueue.size() >= MAX_QUEUE_SIZE)
+				previewQueue.pop();
+			previewQueue.push(std::move(nv12Data));
+		}
+		queueCV.notify_one();
+		return 0;
+	}
 
-// to do display准备好后再开启
-	return 0;
+	if (m_drm_ctx.drm_fd < 0) {
+		LOGE_print("display not opened\n");
+		return -1;
+	}
+
+	// 送显模块最多同时占用 3 块 buffer（待提交、等待 flip、正在显示），这里总能找到空闲的
+	for (int32_t i = 0; i < NUM_BUFFERS; ++i) {
+		idx = (currentBufferIndex + i) % NUM_BUFFERS;
+		if (!vp_display_buffer_busy(&m_drm_ctx, VP_DISPLAY_PLANE_VIDEO,
+				m_vo_buffers[idx].buffer.fd[0])) {
+			vo_buffer = &m_vo_buffers[idx];
+			currentBufferIndex = (idx + 1) % NUM_BUFFERS;
+			break;
+		}
+	}
+	if (vo_buffer == NULL) {
+		LOGE_print("no free display buffer\n");
+		return -1;
+	}
+
+	if (CopyFrameToBuffer(frame, &vo_buffer->buffer) != 0)
+		return -1;
+
+	// 被合并的 OSD 更新在送显时补上，正在绘制时由绘制线程处理
+	if (m_osd_pending && m_osd_draw_mutex.try_lock()) {
+		if (m_osd_pending)
+			(void)CommitOsd(0);
+		m_osd_draw_mutex.unlock();
+	}
+
+	return vp_display_set_frame(&m_drm_ctx, VP_DISPLAY_PLANE_VIDEO, vo_buffer);
 }
 
 int32_t VPPDisplay::GetImageFrame(ImageFrame *frame, int32_t chn, const int32_t timeout)
@@ -514,68 +497,212 @@ void VPPDisplay::ReturnImageFrame(ImageFrame *frame, int32_t chn)
 	// not support
 }
 
+// 找一块可以重绘的 OSD buffer：不是当前内容 exclude、BlendOsd 没有在读，
+// 也没有被显示模块占用（待提交、等待 flip 或者正在扫描输出）；都不满足时返回 -1，不等待
+int32_t VPPDisplay::AcquireOsdBuffer(int32_t exclude)
+{
+	int32_t idx = 0;
+
+	for (int32_t i = 1; i < NUM_OSD_BUFFERS; ++i) {
+		idx = (exclude + i) % NUM_OSD_BUFFERS;
+		if (idx == m_osd_blend_index)
+			continue;
+		// 内存中的 OSD 不送显
+		if (!m_osd_soft && vp_display_buffer_busy(&m_drm_ctx, VP_DISPLAY_PLANE_OSD,
+				m_osd_buffers[idx].buffer.fd[0]))
+			continue;
+		return idx;
+	}
+
+	return -1;
+}
+
+int32_t VPPDisplay::CommitOsd(int32_t first)
+{
+	int32_t ret = 0;
+	int32_t front = 0, idx = 0;
+
+	// 只有持有 m_osd_draw_mutex 的线程会切换 m_osd_index，这里读到的 front 在绘制期间不变
+	{
+		std::lock_guard<std::mutex> lock(m_osd_mutex);
+		front = m_osd_index;
+	}
+
+	// 之前有更新被合并时，front 上缺少那些命令，只能整帧重绘
+	if (m_osd_pending)
+		first = 0;
+
+	// 整帧重绘：内容与正在显示的相同时什么都不做
+	if ((first == 0) && vp_overlay_same_content(&m_osd_surfaces[front], &m_osd_list)) {
+		m_osd_pending = false;
+		return 0;
+	}
+
+	{
+		std::lock_guard<std::mutex> lock(m_osd_mutex);
+		idx = AcquireOsdBuffer(front);
+	}
+	if (idx < 0) {
+		// buffer 都被占用时不等待 page flip，命令已经在 m_osd_list 中，下一次提交时一起画
+		m_osd_pending = true;
+		return 0;
+	}
+
+	// 在一块空闲的 buffer 上绘制，不会擦掉正在显示、等待显示或者正在合成的内容
+	if (first == 0) {
+		ret = vp_overlay_render(&m_osd_surfaces[idx], &m_osd_list);
+	} else {
+		// 叠加绘制：先把当前内容拷贝过来，再只画新增的命令
+		if (vp_overlay_surface_copy(&m_osd_surfaces[idx], &m_osd_surfaces[front]) != 0)
+			return -1;
+		ret = vp_overlay_render_append(&m_osd_surfaces[idx], &m_osd_list, first);
+	}
+	if (ret < 0)
+		return -1;
+
+	// 绘制完成后才切换到新的 buffer，BlendOsd 不会读到画了一半的内容
+	{
+		std::lock_guard<std::mutex> lock(m_osd_mutex);
+		m_osd_index = idx;
+	}
+	m_osd_pending = false;
+	if (m_osd_soft)
+		return 0;
+	return vp_display_set_frame(&m_drm_ctx, VP_DISPLAY_PLANE_OSD, &m_osd_buffers[idx]);
+}
+
 int32_t VPPDisplay::SetGraphRect(int32_t x0, int32_t y0, int32_t x1, int32_t y1,
 	int32_t flush, uint32_t color, int32_t line_width)
 {
-//	int32_t ret = 0;
-//
-//	if (0 == m_display_mode) {
-//		x0 = (x0 < (m_width - line_width)) ? ((x0 >= 0) ? x0 : 0) : (m_width - line_width);
-//		y0 = (y0 < (m_height - line_width)) ? ((y0 >= 0) ? y0 : 0) : (m_height - line_width);
-//		x1 = (x1 < (m_width - line_width)) ? ((x1 >= 0) ? x1 : 0) : (m_width - line_width);
-//		y1 = (y1 < (m_height - line_width)) ? ((y1 >= 0) ? y1 : 0) : (m_height - line_width);
-//
-//		if (flush) {
-//			//ret = vp_display_set_frame(&m_drm_ctx, 1, &m_draw_buffers);
-//			memset(m_draw_buffers.buffer.virt_addr[0], 0, m_width * m_height * DISPLAY_ARGB_BYTES);
-//		}
-//
-//		vp_display_draw_rect(m_draw_buffers.buffer.virt_addr[0],
-//			x0, y0, x1, y1, color, 0, m_width, m_height, line_width);
-//	} else if (1 == m_display_mode) {
-//		return 0;
-//	}
-//
-//	return ret;
+	int32_t first = 0;
 
-// to do display准备好后再开启
-	return 0;
+	if (m_osd_surfaces[0].addr == NULL) {
+		LOGE_print("osd not available, open display first\n");
+		return -1;
+	}
+
+	x0 = (x0 < (m_width - line_width)) ? ((x0 >= 0) ? x0 : 0) : (m_width - line_width);
+	y0 = (y0 < (m_height - line_width)) ? ((y0 >= 0) ? y0 : 0) : (m_height - line_width);
+	x1 = (x1 < (m_width - line_width)) ? ((x1 >= 0) ? x1 : 0) : (m_width - line_width);
+	y1 = (y1 < (m_height - line_width)) ? ((y1 >= 0) ? y1 : 0) : (m_height - line_width);
+
+	std::lock_guard<std::mutex> lock(m_osd_draw_mutex);
+	if (flush)
+		vp_overlay_list_reset(&m_osd_list);
+	first = m_osd_list.cmd_count;
+
+	if (vp_overlay_add_box(&m_osd_list, x0, y0, x1, y1, color, line_width) != 0)
+		return -1;
+
+	return CommitOsd(first);
 }
 
 int32_t VPPDisplay::SetGraphWord(int32_t x, int32_t y, char *str,
 	int32_t flush, uint32_t color, int32_t line_width)
 {
-//	int32_t ret = 0;
-//	int32_t len;
-//	if (str == NULL) {
-//		LOGE_print("string was NULL\n");
-//		return -1;
-//	}
-//
-//	if (0 == m_display_mode) {
-//		if ((x < 0) || (x > m_width) || (y < 0) || (y > m_height) ||
-//			((line_width * FONT_ONE_ENCODE_WIDTH + y) > m_height)) {
-//			LOGE_print("parameter error, coordinate (%d, %d) string:%s line_width:%d\n",
-//				x, y, str, line_width);
-//			return -1;
-//		}
-//		if (((int)strlen(str) * line_width * FONT_ONE_ENCODE_WIDTH + x) > m_width) {
-//			len = (m_width - x) / (line_width * FONT_ONE_ENCODE_WIDTH);
-//			str[len] = '\0';
-//		}
-//		ret = vp_display_draw_word(m_draw_buffers.buffer.virt_addr[0], x, y, str, m_width, color, line_width);
-//	} else if (1 == m_display_mode) {
-//
-//		return 0;
-//	}
+	int32_t first = 0;
+	int32_t len;
 
-	return 0;
+	if (str == NULL) {
+		LOGE_print("string was NULL\n");
+		return -1;
+	}
+
+	if (m_osd_surfaces[0].addr == NULL) {
+		LOGE_print("osd not available, open display first\n");
+		return -1;
+	}
+
+	if ((x < 0) || (x > m_width) || (y < 0) || (y > m_height) ||
+		((line_width * FONT_WORD_HEIGHT + y) > m_height)) {
+		LOGE_print("parameter error, coordinate (%d, %d) string:%s line_width:%d\n",
+			x, y, str, line_width);
+		return -1;
+	}
+	if (((int)strlen(str) * line_width * FONT_ONE_ENCODE_WIDTH + x) > m_width) {
+		len = (m_width - x) / (line_width * FONT_ONE_ENCODE_WIDTH);
+		str[len] = '\0';
+	}
+
+	std::lock_guard<std::mutex> lock(m_osd_draw_mutex);
+	if (flush)
+		vp_overlay_list_reset(&m_osd_list);
+	first = m_osd_list.cmd_count;
+
+	if (vp_overlay_add_text(&m_osd_list, x, y, str, color, line_width) != 0)
+		return -1;
+
+	return CommitOsd(first);
+}
+
+int32_t VPPDisplay::SetGraphBatch(const vp_overlay_list_t *list)
+{
+	if (list == NULL) {
+		LOGE_print("osd list was NULL\n");
+		return -1;
+	}
+
+	if (m_osd_surfaces[0].addr == NULL) {
+		LOGE_print("osd not available, open display first\n");
+		return -1;
+	}
+
+	std::lock_guard<std::mutex> lock(m_osd_draw_mutex);
+	if (vp_overlay_list_copy(&m_osd_list, list) != 0)
+		return -1;
+
+	return CommitOsd(0);
+}
+
+int32_t VPPDisplay::BlendOsd(ImageFrame *frame)
+{
+	int32_t width = 0, height = 0, stride = 0;
+	int32_t idx = 0, ret = 0;
+	uint8_t *dst_uv = NULL;
+
+	if ((frame == NULL) || (frame->data[0] == NULL)) {
+		LOGE_print("frame was NULL\n");
+		return -1;
+	}
+
+	width = (frame->width > 0) ? frame->width : m_width;
+	height = (frame->height > 0) ? frame->height : m_height;
+	if ((frame->plane_count > 1) && (frame->data[1] != NULL)) {
+		stride = (frame->stride > 0) ? frame->stride : width;
+		dst_uv = frame->data[1];
+	} else {
+		if (frame->data_size[0] < (uint32_t)(width * height * 3 / 2)) {
+			LOGE_print("frame data size %u too small for %dx%d nv12\n",
+				frame->data_size[0], width, height);
+			return -1;
+		}
+		stride = width;
+		dst_uv = frame->data[0] + width * height;
+	}
+
+	// 只在取当前 buffer 时持有 m_osd_mutex，合成期间绘制线程跳过这块 buffer
+	std::lock_guard<std::mutex> blend_lock(m_osd_blend_mutex);
+	{
+		std::lock_guard<std::mutex> lock(m_osd_mutex);
+		if (m_osd_surfaces[m_osd_index].addr == NULL)
+			return 0;
+		idx = m_osd_index;
+		m_osd_blend_index = idx;
+	}
+
+	ret = do_overlay(idx, frame->data[0], dst_uv, stride, width, height);
+
+	{
+		std::lock_guard<std::mutex> lock(m_osd_mutex);
+		m_osd_blend_index = -1;
+	}
+	return ret;
 }
 
 void VPPDisplay::startProcessingThread() {
 	stopProcessing = false;
-	// Start the consumer thread to process RGBA queue
-	std::thread(&VPPDisplay::processRGBAQueue, this).detach();
+	// Start the consumer thread to process the preview queue
+	std::thread(&VPPDisplay::processPreviewQueue, this).detach();
 }
 
 void VPPDisplay::stopProcessingThread() {
@@ -583,35 +710,38 @@ void VPPDisplay::stopProcessingThread() {
 	queueCV.notify_all();  // Ensure the thread can exit
 }
 
-// Consumer thread function: Processes the RGBA queue and updates the window
-void VPPDisplay::processRGBAQueue() {
+// Consumer thread function: uploads queued NV12 frames to the preview window
+void VPPDisplay::processPreviewQueue() {
+	int imageWidth = 0, imageHeight = 0;
+
 	while (!stopProcessing) {
 		std::unique_lock<std::mutex> lock(queueMutex);
 		// Wait until there's data in the queue or stop is requested
-		queueCV.wait(lock, [] { return !rgbaQueue.empty() || stopProcessing; });
+		queueCV.wait(lock, [] { return !previewQueue.empty() || stopProcessing; });
 
-		if (stopProcessing && rgbaQueue.empty()) {
+		if (stopProcessing) {
 			break;
 		}
 
-		// Get the RGBA buffer from the queue
-		auto rgbaData = std::move(rgbaQueue.front());
-		rgbaQueue.pop();
+		// Get the NV12 frame from the queue
+		auto nv12Data = std::move(previewQueue.front());
+		previewQueue.pop();
 		lock.unlock();
 
+		// EGL 上下文属于这个线程，窗口的创建和绘制都在这里完成
 		EGLPreviewWindow& window = EGLPreviewWindow::getInstance(clamp(m_width / 2, 0, 720), clamp(m_height / 2, 0, 405));
 		if (!window.initialize()) {
 			printf("Failed to initialize display window\n");
 			return;
 		}
 
-		// Update the window with the RGBA data
-		if (!window.initialize()) {
-			return;
+		// 只在尺寸变化时重新分配纹理
+		if ((imageWidth != m_width) || (imageHeight != m_height)) {
+			window.setImageDimensions(m_width, m_height);
+			imageWidth = m_width;
+			imageHeight = m_height;
 		}
-
-		window.setImageDimensions(m_width, m_height);
-		window.update(rgbaData);
+		window.updateNV12(nv12Data);
 		window.processEvents();  // Process X11 events
 	}
 }
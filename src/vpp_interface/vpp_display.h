@@ -42,6 +42,8 @@
 #include "vp_wrap.h"
 #include "vpp_module.h"
 #include "vp_display.h"
+#include "vp_overlay.h"
+#include "vp_blend.h"
 
 using namespace std;
 
@@ -54,9 +56,20 @@ namespace spdev
 		{
 			SetModuleType(VPP_DISPLAY);
 			SetModuleTypeString((char *)"Display");
+			memset(&m_drm_ctx, 0, sizeof(m_drm_ctx));
+			m_drm_ctx.drm_fd = -1;
+			memset(m_vo_buffers, 0, sizeof(m_vo_buffers));
+			memset(m_osd_buffers, 0, sizeof(m_osd_buffers));
+			memset(m_osd_soft_buffers, 0, sizeof(m_osd_soft_buffers));
+			memset(m_osd_surfaces, 0, sizeof(m_osd_surfaces));
+			memset(m_osd_layers, 0, sizeof(m_osd_layers));
+			vp_overlay_list_init(&m_osd_list);
 		}
 
-		virtual ~VPPDisplay() = default;
+		virtual ~VPPDisplay()
+		{
+			vp_overlay_list_deinit(&m_osd_list);
+		}
 
 	public:
 		int32_t OpenDisplay(int32_t width = 1920, int32_t height = 1080);
@@ -83,27 +96,95 @@ namespace spdev
 		int32_t SetGraphWord(int32_t x, int32_t y, char *str,
 							 int32_t flush = 0, uint32_t color = 0xffff0000, int32_t line_width = 1);
 
+		/**
+		 * @brief 一次提交一整帧 OSD（框、实心矩形、文字），替换图层上原有的内容
+		 *        内容与正在显示的相同时不重绘也不送显，
+		 *        否则只清除上一次画过的区域再绘制
+		 * @param [in] list   绘制命令列表
+		 *
+		 * @retval 0      成功
+		 * @retval -1      失败
+		 */
+		int32_t SetGraphBatch(const vp_overlay_list_t *list);
+
+		/**
+		 * @brief 把当前 OSD 图层内容烧录到 NV12 图像中（原地修改），例如送编码器之前，
+		 *        只处理 OSD 上有内容的 tile，图像尺寸与显示尺寸不同时从左上角对齐并裁剪
+		 *        没有 DRM OSD 图层（EGL 预览、无显示）时 OSD 画在内存中，同样可以烧录
+		 * @param [in] frame   NV12 图像，单平面时按紧密排列处理
+		 *
+		 * @retval 0      成功
+		 * @retval -1      失败
+		 */
+		int32_t BlendOsd(ImageFrame *frame);
+
 		void startProcessingThread();
 		void stopProcessingThread();
 
+		/**
+		 * @brief 获取 DRM 送显统计：提交次数、flip 次数、被新帧替换掉的帧数等
+		 */
+		void GetDisplayStats(vp_display_stats_t *stats);
+
 	private:
+		int32_t OpenDrmDisplay(int32_t width, int32_t height);
+		void CloseDrmDisplay();
+		int32_t InitOsdSurface(int32_t index, uint8_t *addr, int32_t width, int32_t height);
+		int32_t OpenSoftOsd(int32_t width, int32_t height);
+		void CloseOsd();
+		int32_t CopyFrameToBuffer(ImageFrame *frame, hb_mem_graphic_buf_t *buffer);
+		// 调用时需要持有 m_osd_draw_mutex
+		int32_t CommitOsd(int32_t first);
+		// 调用时需要持有 m_osd_mutex
+		int32_t AcquireOsdBuffer(int32_t exclude);
+
 		vp_drm_context_t m_drm_ctx;
-		static const int NUM_BUFFERS = 3;
+		// 一块正在扫描输出，一块等待 page flip，一块待提交，一块给 CPU 写下一帧
+		static const int NUM_BUFFERS = 4;
 		hbn_vnode_image_t m_vo_buffers[NUM_BUFFERS];
 		int32_t currentBufferIndex = 0;
+		// OSD 图层三缓冲，flush 时切换到一块没有被显示模块占用的 buffer 重新绘制：
+		// 一块正在扫描输出，一块等待 page flip，一块给 CPU 绘制
+		static const int NUM_OSD_BUFFERS = 3;
+		hbn_vnode_image_t m_osd_buffers[NUM_OSD_BUFFERS];
+		// 没有 DRM OSD 图层时 OSD 画在普通内存中，只给 BlendOsd 使用，不送显
+		uint8_t *m_osd_soft_buffers[NUM_OSD_BUFFERS];
+		int32_t m_osd_soft = 0;
+		int32_t m_osd_index = 0;
+		// 每块 OSD buffer 记录自己画过的区域，重绘时只清除这些区域
+		vp_overlay_surface_t m_osd_surfaces[NUM_OSD_BUFFERS];
+		// 当前 OSD 图层内容对应的绘制命令，flush 时清空
+		vp_overlay_list_t m_osd_list;
+		// 每块 OSD buffer 有内容的 tile，软件合成时只处理这些 tile
+		vp_blend_layer_t m_osd_layers[NUM_OSD_BUFFERS];
+		// 绘制（SetGraph*）和软件合成（BlendOsd）可能在不同线程：
+		// m_osd_draw_mutex 串行化绘制，保护 m_osd_list 和 surface，绘制期间一直持有；
+		// m_osd_blend_mutex 串行化 BlendOsd，保护合成图层；
+		// m_osd_mutex 只保护 m_osd_index 和 m_osd_blend_index，只在切换 buffer 时短暂持有，
+		// 绘制和合成本身都不持有。加锁顺序 draw/blend -> m_osd_mutex
+		std::mutex m_osd_draw_mutex;
+		std::mutex m_osd_blend_mutex;
+		std::mutex m_osd_mutex;
+		// BlendOsd 正在读取的 buffer，绘制时跳过，-1 表示没有
+		int32_t m_osd_blend_index = -1;
+		// 没有空闲 buffer 时不等待，更新合并到下一次提交（或者下一次送显）时整帧重绘
+		std::atomic<bool> m_osd_pending{false};
+		int32_t m_hb_mem_opened = 0;
 		hbn_vnode_image_t m_draw_buffers;
 		hbn_vnode_image_t m_final_buffers[2];
 		int32_t currentDrawBufferIndex = 0;
 
-		int32_t m_display_mode = 0; /* 0: libdrm; 1: egl x11 */
+		int32_t m_display_mode = 0; /* 0: libdrm; 1: egl x11; 2: none */
 
 		n2d_buffer_t primary_mapped_gpu_buffer[3];
 		n2d_buffer_t overlay_mapped_gpu_buffer[1];
 		n2d_buffer_t final_mapped_gpu_buffer[2];
 		n2d_buffer_t rgba_buffer;
-		void processRGBAQueue();
+		void processPreviewQueue();
 		int32_t convertN2DBuffer(n2d_buffer_t *n2d_buffer, hb_mem_graphic_buf_t *hbm_buffer, n2d_buffer_format_t format);
-		n2d_error_t do_overlay(n2d_buffer_t *src0_nv12,n2d_buffer_t *scr1_ar24,n2d_buffer_t *dst0_nv12);
+		// 调用时需要持有 m_osd_blend_mutex，index 已经记录在 m_osd_blend_index
+		int32_t do_overlay(int32_t index, uint8_t *dst_y, uint8_t *dst_uv, int32_t stride,
+			int32_t width, int32_t height);
 	};
 
 }; // namespace spdev
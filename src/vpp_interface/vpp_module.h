@@ -24,7 +24,8 @@ namespace spdev
 		VPP_CAMERA,
 		VPP_ENCODE,
 		VPP_DECODE,
-		VPP_DISPLAY
+		VPP_DISPLAY,
+		VPP_SHM_SINK
 	} VPP_Object_e;
 
 	class VPPModule
@@ -0,0 +1,155 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-07 09:41:18
+ * @LastEditTime: 2024-11-07 09:41:18
+ ***************************************************************************/
+#include <string.h>
+
+#include "utils_log.h"
+
+#include "vpp_shm_sink.h"
+
+namespace spdev
+{
+	VPPShmSink::~VPPShmSink()
+	{
+		Close();
+	}
+
+	int32_t VPPShmSink::Open(const char *name, int32_t width, int32_t height, int32_t slot_count)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if ((width <= 0) || (height <= 0) || (width % 2) || (height % 2)) {
+			LOGE_print("invalid shm sink size %dx%d\n", width, height);
+			return -1;
+		}
+		if (m_ring != nullptr) {
+			LOGE_print("shm sink already opened\n");
+			return -1;
+		}
+
+		m_ring = shm_frame_ring_create(name, slot_count, width * height * 3 / 2);
+		if (m_ring == nullptr)
+			return -1;
+
+		m_width = width;
+		m_height = height;
+		m_published = 0;
+		m_dropped = 0;
+		m_bytes = 0;
+
+		LOGI_print("shm sink %s opened, %dx%d, %d slots\n", m_ring->name, width, height, slot_count);
+		return 0;
+	}
+
+	int32_t VPPShmSink::Close()
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+
+		if (m_ring != nullptr) {
+			shm_frame_ring_close(m_ring);
+			m_ring = nullptr;
+		}
+
+		return 0;
+	}
+
+	int32_t VPPShmSink::SetImageFrame(ImageFrame *frame)
+	{
+		std::lock_guard<std::mutex> lock(m_lock);
+		shm_frame_meta_t meta;
+		uint8_t *dst = nullptr, *src_y = nullptr, *src_uv = nullptr;
+		uint32_t capacity = 0;
+		int32_t src_stride = 0;
+		int32_t y_size = m_width * m_height;
+
+		if (m_ring == nullptr) {
+			LOGE_print("shm sink not opened\n");
+			return -1;
+		}
+		if ((frame == nullptr) || (frame->data[0] == nullptr) ||
+			((frame->width != 0) && (frame->width != m_width)) ||
+			((frame->height != 0) && (frame->height != m_height))) {
+			m_dropped++;
+			LOGE_print("shm sink frame mismatch, expect %dx%d nv12\n", m_width, m_height);
+			return -1;
+		}
+
+		src_y = frame->data[0];
+		if ((frame->plane_count > 1) && (frame->data[1] != nullptr)) {
+			src_stride = (frame->stride > 0) ? frame->stride : m_width;
+			src_uv = frame->data[1];
+		} else {
+			// 单平面数据按紧密排列的 NV12 处理
+			if (frame->data_size[0] < (uint32_t)(y_size * 3 / 2)) {
+				m_dropped++;
+				LOGE_print("frame data size %u too small for %dx%d nv12\n",
+					frame->data_size[0], m_width, m_height);
+				return -1;
+			}
+			src_stride = m_width;
+			src_uv = src_y + y_size;
+		}
+
+		// 直接写入槽位，只有这一次拷贝
+		dst = shm_frame_ring_begin(m_ring, &capacity);
+		if (dst == nullptr) {
+			m_dropped++;
+			return -1;
+		}
+		if (src_stride == m_width) {
+			memcpy(dst, src_y, y_size);
+			memcpy(dst + y_size, src_uv, y_size / 2);
+		} else {
+			for (int32_t row = 0; row < m_height; row++)
+				memcpy(dst + row * m_width, src_y + row * src_stride, m_width);
+			for (int32_t row = 0; row < m_height / 2; row++)
+				memcpy(dst + y_size + row * m_width, src_uv + row * src_stride, m_width);
+		}
+
+		memset(&meta, 0, sizeof(meta));
+		meta.frame_id = frame->frame_id;
+		meta.timestamp = frame->image_timestamp;
+		meta.format = SHM_FRAME_FMT_NV12;
+		meta.width = m_width;
+		meta.height = m_height;
+		meta.stride = m_width;
+		meta.plane_count = 2;
+		meta.plane_size[0] = y_size;
+		meta.plane_size[1] = y_size / 2;
+		meta.data_size = y_size * 3 / 2;
+		if (shm_frame_ring_commit(m_ring, &meta) != 0) {
+			m_dropped++;
+			return -1;
+		}
+
+		m_published++;
+		m_bytes += meta.data_size;
+		return 0;
+	}
+
+	int32_t VPPShmSink::GetImageFrame(ImageFrame *frame, int32_t chn, const int32_t timeout)
+	{
+		// not support
+		return -1;
+	}
+
+	void VPPShmSink::ReturnImageFrame(ImageFrame *frame, int32_t chn)
+	{
+		// not support
+	}
+
+	void VPPShmSink::GetStats(vpp_shm_sink_stats_t *stats)
+	{
+		if (stats == nullptr)
+			return;
+
+		stats->published = m_published;
+		stats->dropped = m_dropped;
+		stats->bytes = m_bytes;
+	}
+
+} // namespace spdev
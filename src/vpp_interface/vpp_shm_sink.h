@@ -0,0 +1,82 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-07 09:41:18
+ * @LastEditTime: 2024-11-07 09:41:18
+ ***************************************************************************/
+#ifndef _VPP_SHM_SINK_H__
+#define _VPP_SHM_SINK_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <mutex>
+
+#include "vp_wrap.h"
+#include "vpp_module.h"
+#include "shm_frame_ring.h"
+
+namespace spdev
+{
+	typedef struct {
+		int64_t published; // 写入共享内存的帧数
+		int64_t dropped;   // 因为尺寸不符等原因没有写入的帧数
+		int64_t bytes;     // 写入的字节数
+	} vpp_shm_sink_stats_t;
+
+	/**
+	 * 共享内存送显模块：把收到的 NV12 图像写入 POSIX 共享内存环，
+	 * 不依赖 DRM/X11，读者进程（例如 shm_frame_reader）随时挂载、退出，不影响写入端。
+	 * 可以像 VPPDisplay 一样通过 BindTo 接在相机、解码器之后。
+	 */
+	class VPPShmSink : public VPPModule
+	{
+	public:
+		VPPShmSink()
+		{
+			SetModuleType(VPP_SHM_SINK);
+			SetModuleTypeString((char *)"ShmSink");
+		}
+
+		virtual ~VPPShmSink();
+
+		/**
+		 * @brief 创建共享内存环
+		 * @param [in] name        共享内存名，为 NULL 时使用 SHM_FRAME_DEFAULT_NAME
+		 * @param [in] width       图像宽度
+		 * @param [in] height      图像高度
+		 * @param [in] slot_count  环中的槽位数，至少 2
+		 *
+		 * @retval 0      成功
+		 * @retval -1      失败
+		 */
+		int32_t Open(const char *name, int32_t width, int32_t height, int32_t slot_count = 3);
+
+		int32_t Close();
+
+		/**
+		 * @brief 把一帧 NV12 写入共享内存，带 stride 的图像会按宽度紧密排列后写入
+		 *
+		 * @retval 0      成功
+		 * @retval -1      失败
+		 */
+		int32_t SetImageFrame(ImageFrame *frame);
+
+		int32_t GetImageFrame(ImageFrame *frame, int32_t chn = 0, const int32_t timeout = 0);
+
+		void ReturnImageFrame(ImageFrame *frame, int32_t chn = 0);
+
+		void GetStats(vpp_shm_sink_stats_t *stats);
+
+	private:
+		std::mutex m_lock;
+		shm_frame_ring_t *m_ring = nullptr;
+		std::atomic<int64_t> m_published{0};
+		std::atomic<int64_t> m_dropped{0};
+		std::atomic<int64_t> m_bytes{0};
+	};
+
+} // namespace spdev
+
+#endif // _VPP_SHM_SINK_H__
@@ -0,0 +1,231 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-04 10:12:36
+ * @LastEditTime: 2024-11-04 10:12:36
+ ***************************************************************************/
+#include <string.h>
+#include <unistd.h>
+
+#include <chrono>
+
+#include "utils_log.h"
+
+#include "vpp_sync_group.h"
+
+namespace spdev
+{
+	VPPSyncGroup::~VPPSyncGroup()
+	{
+		Stop();
+	}
+
+	int32_t VPPSyncGroup::AddSource(VPPModule *module, int32_t chn)
+	{
+		sync_source_t source;
+
+		if (module == NULL) {
+			LOGE_print("sync source module is null\n");
+			return -1;
+		}
+		if (m_run) {
+			LOGE_print("sync group already started, stop it before add source\n");
+			return -1;
+		}
+
+		source.module = module;
+		source.chn = chn;
+		memset(&source.stats, 0, sizeof(source.stats));
+		source.worker = nullptr;
+		m_sources.push_back(source);
+
+		return (int32_t)m_sources.size() - 1;
+	}
+
+	void VPPSyncGroup::SetTolerance(int64_t tolerance)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_tolerance = (tolerance < 0) ? 0 : tolerance;
+	}
+
+	void VPPSyncGroup::SetDropPolicy(VPP_SYNC_DROP_POLICY_E policy)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_policy = policy;
+	}
+
+	int32_t VPPSyncGroup::SetQueueDepth(int32_t depth)
+	{
+		if (depth <= 0) {
+			LOGE_print("invalid queue depth %d\n", depth);
+			return -1;
+		}
+		std::lock_guard<std::mutex> lock(m_mutex);
+		m_queue_depth = depth;
+		return 0;
+	}
+
+	int32_t VPPSyncGroup::Start(void)
+	{
+		if (m_sources.size() < 2) {
+			LOGE_print("sync group need at least 2 sources, now %zu\n",
+				m_sources.size());
+			return -1;
+		}
+		if (m_run.exchange(1)) {
+			return 0;
+		}
+
+		m_frame_sets = 0;
+		for (size_t i = 0; i < m_sources.size(); i++) {
+			memset(&m_sources[i].stats, 0, sizeof(m_sources[i].stats));
+			m_sources[i].worker = new std::thread(&VPPSyncGroup::GrabFunc,
+				this, (int32_t)i);
+		}
+
+		return 0;
+	}
+
+	int32_t VPPSyncGroup::Stop(void)
+	{
+		if (!m_run.exchange(0)) {
+			return 0;
+		}
+
+		m_cond.notify_all();
+		for (auto &source : m_sources) {
+			if (source.worker != nullptr) {
+				if (source.worker->joinable())
+					source.worker->join();
+				delete source.worker;
+				source.worker = nullptr;
+			}
+		}
+
+		// 取帧线程已经退出，归还所有还没有交付的帧
+		std::lock_guard<std::mutex> lock(m_mutex);
+		for (auto &source : m_sources) {
+			while (!source.queue.empty()) {
+				source.module->ReturnImageFrame(&source.queue.front(), source.chn);
+				source.queue.pop_front();
+			}
+		}
+
+		return 0;
+	}
+
+	void VPPSyncGroup::GrabFunc(int32_t index)
+	{
+		sync_source_t &source = m_sources[index];
+		ImageFrame frame;
+		int32_t ret = 0;
+
+		while (m_run) {
+			memset(&frame, 0, sizeof(frame));
+			ret = source.module->GetImageFrame(&frame, source.chn);
+			if (ret != 0) {
+				usleep(30);
+				continue;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			if (!m_run) {
+				source.module->ReturnImageFrame(&frame, source.chn);
+				break;
+			}
+			source.stats.received++;
+			// 用户取帧太慢时丢掉本路最旧的帧，避免占满图像源的 buffer
+			while ((int32_t)source.queue.size() >= m_queue_depth) {
+				DropFrontLocked(index);
+				source.stats.drop_overflow++;
+			}
+			source.queue.push_back(frame);
+			m_cond.notify_all();
+		}
+	}
+
+	void VPPSyncGroup::DropFrontLocked(int32_t index)
+	{
+		sync_source_t &source = m_sources[index];
+
+		source.module->ReturnImageFrame(&source.queue.front(), source.chn);
+		source.queue.pop_front();
+	}
+
+	int32_t VPPSyncGroup::TryMatchLocked(std::vector<ImageFrame> &frames)
+	{
+		size_t i = 0;
+		int64_t ts = 0, min_ts = 0, max_ts = 0;
+
+		while (1) {
+			for (i = 0; i < m_sources.size(); i++) {
+				if (m_sources[i].queue.empty())
+					return -1;
+			}
+
+			min_ts = max_ts = m_sources[0].queue.front().image_timestamp;
+			for (i = 1; i < m_sources.size(); i++) {
+				ts = m_sources[i].queue.front().image_timestamp;
+				min_ts = (ts < min_ts) ? ts : min_ts;
+				max_ts = (ts > max_ts) ? ts : max_ts;
+			}
+
+			if ((max_ts - min_ts) <= m_tolerance) {
+				frames.resize(m_sources.size());
+				for (i = 0; i < m_sources.size(); i++) {
+					frames[i] = m_sources[i].queue.front();
+					m_sources[i].queue.pop_front();
+					m_sources[i].stats.matched++;
+				}
+				m_frame_sets++;
+				return 0;
+			}
+
+			for (i = 0; i < m_sources.size(); i++) {
+				ts = m_sources[i].queue.front().image_timestamp;
+				// 各路时间戳单调递增，早于 max_ts - tolerance 的帧以后也不可能再匹配上
+				if ((m_policy == VPP_SYNC_DROP_ALL) || (ts < max_ts - m_tolerance)) {
+					DropFrontLocked((int32_t)i);
+					m_sources[i].stats.drop_stale++;
+				}
+			}
+		}
+	}
+
+	int32_t VPPSyncGroup::GetFrameSet(std::vector<ImageFrame> &frames, int32_t timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() +
+			std::chrono::milliseconds(timeout);
+		std::unique_lock<std::mutex> lock(m_mutex);
+
+		while (m_run) {
+			if (TryMatchLocked(frames) == 0)
+				return 0;
+			if (m_cond.wait_until(lock, deadline) == std::cv_status::timeout)
+				return TryMatchLocked(frames);
+		}
+
+		return -1;
+	}
+
+	void VPPSyncGroup::ReturnFrameSet(std::vector<ImageFrame> &frames)
+	{
+		for (size_t i = 0; (i < frames.size()) && (i < m_sources.size()); i++) {
+			m_sources[i].module->ReturnImageFrame(&frames[i], m_sources[i].chn);
+		}
+		frames.clear();
+	}
+
+	void VPPSyncGroup::GetStats(vpp_sync_stats_t *stats)
+	{
+		std::lock_guard<std::mutex> lock(m_mutex);
+
+		stats->frame_sets = m_frame_sets;
+		stats->sources.clear();
+		for (auto &source : m_sources) {
+			stats->sources.push_back(source.stats);
+		}
+	}
+
+} // namespace spdev
@@ -0,0 +1,141 @@
+/***************************************************************************
+ * @COPYRIGHT NOTICE
+ * @Copyright 2024 D-Robotics, Inc.
+ * @All rights reserved.
+ * @Date: 2024-11-04 10:12:36
+ * @LastEditTime: 2024-11-04 10:12:36
+ ***************************************************************************/
+#ifndef __VPP_SYNC_GROUP_H__
+#define __VPP_SYNC_GROUP_H__
+
+#include <stdint.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "vp_wrap.h"
+#include "vpp_module.h"
+
+namespace spdev
+{
+
+typedef enum {
+	// 丢弃已经不可能与其他路匹配上的旧帧（时间戳早于最新帧 - 容差），其余帧继续等待
+	VPP_SYNC_DROP_STALE = 0,
+	// 只要各路队首帧无法匹配，就把所有路的队首帧全部丢弃，适合卡顿后快速重新同步
+	VPP_SYNC_DROP_ALL = 1,
+} VPP_SYNC_DROP_POLICY_E;
+
+typedef struct {
+	int64_t received;   // 收到的帧数
+	int64_t matched;    // 成功组成帧组的帧数
+	int64_t drop_stale; // 因为时间戳无法匹配而丢弃的帧数
+	int64_t drop_overflow; // 因为用户取帧太慢、队列满而丢弃的帧数
+} vpp_sync_source_stats_t;
+
+typedef struct {
+	int64_t frame_sets; // 已经交付的帧组数量
+	std::vector<vpp_sync_source_stats_t> sources;
+} vpp_sync_stats_t;
+
+/**
+ * 多路相机帧同步组：每一路由独立线程取帧，按照硬件时间戳在容差范围内匹配，
+ * 匹配成功的一组帧一次性交付给用户，未匹配的帧按照丢帧策略释放并计数。
+ */
+class VPPSyncGroup
+{
+  public:
+	VPPSyncGroup() = default;
+	~VPPSyncGroup();
+
+	/**
+	 * @brief 添加一路图像源，需要在 Start 之前调用
+	 * @param [in] module   图像源模块，一般为已经打开的 VPPCamera
+	 * @param [in] chn      从该模块取图的通道
+	 *
+	 * @retval 非-1     该路在帧组中的序号
+	 * @retval -1       失败
+	 */
+	int32_t AddSource(VPPModule *module, int32_t chn = 0);
+
+	/**
+	 * @brief 设置时间戳匹配容差，单位与 ImageFrame::image_timestamp 相同
+	 */
+	void SetTolerance(int64_t tolerance);
+
+	/**
+	 * @brief 设置未匹配帧的丢弃策略
+	 */
+	void SetDropPolicy(VPP_SYNC_DROP_POLICY_E policy);
+
+	/**
+	 * @brief 设置每一路最多缓存的帧数，需要小于图像源的输出 buffer 数量
+	 */
+	int32_t SetQueueDepth(int32_t depth);
+
+	/**
+	 * @brief 启动各路取帧线程
+	 *
+	 * @retval 0      成功
+	 * @retval -1     失败
+	 */
+	int32_t Start(void);
+
+	/**
+	 * @brief 停止取帧线程，并归还所有缓存的帧
+	 */
+	int32_t Stop(void);
+
+	/**
+	 * @brief 获取一组时间戳同步的帧，frames[i] 对应第 i 路图像源
+	 * @param [out] frames    帧组，使用完毕后需要调用 ReturnFrameSet 归还
+	 * @param [in] timeout    超时时间，单位 ms
+	 *
+	 * @retval 0      成功
+	 * @retval -1     超时或者未启动
+	 */
+	int32_t GetFrameSet(std::vector<ImageFrame> &frames,
+		int32_t timeout = VP_GET_FRAME_TIMEOUT);
+
+	/**
+	 * @brief 归还 GetFrameSet 获取的帧组
+	 */
+	void ReturnFrameSet(std::vector<ImageFrame> &frames);
+
+	/**
+	 * @brief 获取各路的收帧、匹配和丢帧统计
+	 */
+	void GetStats(vpp_sync_stats_t *stats);
+
+	int32_t GetSourceNum(void) { return (int32_t)m_sources.size(); }
+
+  private:
+	typedef struct {
+		VPPModule *module;
+		int32_t chn;
+		std::deque<ImageFrame> queue;
+		vpp_sync_source_stats_t stats;
+		std::thread *worker;
+	} sync_source_t;
+
+	void GrabFunc(int32_t index);
+	int32_t TryMatchLocked(std::vector<ImageFrame> &frames);
+	void DropFrontLocked(int32_t index);
+
+	std::vector<sync_source_t> m_sources;
+	std::mutex m_mutex;
+	std::condition_variable m_cond;
+	std::atomic<int32_t> m_run{0};
+	int64_t m_tolerance = 5000;
+	int32_t m_queue_depth = 2;
+	int64_t m_frame_sets = 0;
+	VPP_SYNC_DROP_POLICY_E m_policy = VPP_SYNC_DROP_STALE;
+};
+
+} // namespace spdev
+
+#endif // __VPP_SYNC_GROUP_H__
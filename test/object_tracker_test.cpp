@@ -0,0 +1,335 @@
+// Copyright (c) 2020 D-Robotics.All Rights Reserved.
+//
+// The material in this file is confidential and contains trade secrets
+// of D-Robotics Inc. This is proprietary information owned by
+// D-Robotics Inc. No part of this work may be disclosed,
+// reproduced, copied, transmitted, or used in any way for any purpose,
+// without the express written permission of D-Robotics Inc.
+
+// object_tracker 的主机测试：卡尔曼预测、两轮关联、隔帧检测时 id 稳定、
+// 自适应检测间隔、解析检测后处理输出的 JSON
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+
+#include "object_tracker.h"
+
+#define CHECK(cond)                                                   \
+  do {                                                                \
+    if (!(cond)) {                                                    \
+      fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, \
+              #cond);                                                 \
+      exit(1);                                                        \
+    }                                                                 \
+  } while (0)
+
+static const int kMaxTracks = 16;
+
+static TrackerBox_t MakeBox(float cx, float cy, float w, float h, float score,
+                            int id) {
+  TrackerBox_t box;
+  box.xmin = cx - w / 2;
+  box.ymin = cy - h / 2;
+  box.xmax = cx + w / 2;
+  box.ymax = cy + h / 2;
+  box.score = score;
+  box.id = id;
+  return box;
+}
+
+static float CenterX(const TrackerTrack_t &track) {
+  return (track.xmin + track.xmax) / 2;
+}
+
+static float CenterY(const TrackerTrack_t &track) {
+  return (track.ymin + track.ymax) / 2;
+}
+
+static const TrackerTrack_t *FindTrack(const TrackerTrack_t *tracks, int num,
+                                       int track_id) {
+  for (int i = 0; i < num; i++) {
+    if (tracks[i].track_id == track_id) {
+      return &tracks[i];
+    }
+  }
+  return nullptr;
+}
+
+// 匀速运动的目标：更新几帧后卡尔曼滤波学到速度，只预测的帧沿速度外推
+static void TestKalman() {
+  ObjectTracker_t *tracker = ObjectTrackerCreate(nullptr);
+  TrackerTrack_t tracks[kMaxTracks];
+  const float speed = 4;
+  float cx = 100;
+
+  for (int frame = 0; frame < 20; frame++, cx += speed) {
+    TrackerBox_t box = MakeBox(cx, 200, 50, 100, 0.9f, 0);
+    CHECK(ObjectTrackerUpdate(tracker, &box, 1) == 0);
+  }
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  // 更新后的框贴近最后一次检测
+  CHECK(std::fabs(CenterX(tracks[0]) - (cx - speed)) < 1.f);
+  CHECK(std::fabs(CenterY(tracks[0]) - 200) < 1e-3f);
+  CHECK(std::fabs((tracks[0].ymax - tracks[0].ymin) - 100) < 1e-2f);
+  CHECK(std::fabs((tracks[0].xmax - tracks[0].xmin) - 50) < 0.1f);
+  CHECK(tracks[0].predicted == 0);
+  CHECK(tracks[0].hits == 20);
+
+  for (int frame = 0; frame < 5; frame++, cx += speed) {
+    CHECK(ObjectTrackerPredict(tracker) == 0);
+  }
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].predicted == 1);
+  CHECK(tracks[0].hits == 20);
+  CHECK(std::fabs(CenterX(tracks[0]) - (cx - speed)) < 2.f);
+  CHECK(std::fabs(CenterY(tracks[0]) - 200) < 1e-3f);
+
+  // 再次检测到后回到观测值附近
+  TrackerBox_t box = MakeBox(cx, 200, 50, 100, 0.9f, 0);
+  CHECK(ObjectTrackerUpdate(tracker, &box, 1) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].predicted == 0);
+  CHECK(std::fabs(CenterX(tracks[0]) - cx) < 1.f);
+
+  ObjectTrackerDestroy(tracker);
+  printf("kalman: ok\n");
+}
+
+// 已确认的轨迹：高分检测 IoU 0.2 即可匹配，低分检测需要 IoU 0.5；
+// 低分检测不新建轨迹，新轨迹需要连续匹配 min_hits 次才输出
+static void TestAssociation() {
+  ObjectTracker_t *tracker = ObjectTrackerCreate(nullptr);
+  TrackerTrack_t tracks[kMaxTracks];
+  TrackerBox_t boxes[4];
+
+  boxes[0] = MakeBox(100, 100, 100, 100, 0.9f, 0);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 1) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  int track_id = tracks[0].track_id;
+  CHECK(track_id == 1);
+
+  // 低分检测和轨迹重合：第二轮匹配，不产生新轨迹
+  boxes[0] = MakeBox(105, 100, 100, 100, 0.3f, 0);
+  // 低分且不重合：既不匹配也不新建
+  boxes[1] = MakeBox(400, 400, 100, 100, 0.3f, 0);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 2) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].track_id == track_id);
+  CHECK(tracks[0].predicted == 0);
+  CHECK(std::fabs(tracks[0].score - 0.3f) < 1e-6f);
+
+  // 低分检测只和轨迹有少量重叠（IoU 约 0.4）：不匹配，轨迹丢失不再输出
+  boxes[0] = MakeBox(150, 100, 100, 100, 0.3f, 0);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 1) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 0);
+
+  // 同样的重叠，高分检测在第一轮匹配，轨迹重新输出
+  boxes[0] = MakeBox(150, 100, 100, 100, 0.9f, 0);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 1) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].track_id == track_id);
+  CHECK(tracks[0].predicted == 0);
+
+  // 类别不同的检测不匹配，高分时新建轨迹，第一次匹配后还不输出
+  TrackerBox_t last = MakeBox(CenterX(tracks[0]), CenterY(tracks[0]), 100, 100,
+                              0.9f, 0);
+  boxes[0] = last;
+  boxes[1] = MakeBox(CenterX(tracks[0]), CenterY(tracks[0]), 100, 100, 0.9f, 1);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 2) == 0);
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].track_id == track_id);
+  // 新轨迹再匹配一次后确认
+  CHECK(ObjectTrackerUpdate(tracker, boxes, 2) == 0);
+  int num = ObjectTrackerGetTracks(tracker, tracks, kMaxTracks);
+  CHECK(num == 2);
+  const TrackerTrack_t *other = FindTrack(tracks, num, track_id + 1);
+  CHECK(other != nullptr);
+  CHECK(other->class_id == 1);
+
+  ObjectTrackerDestroy(tracker);
+  printf("association: ok\n");
+}
+
+// 两个相向运动的目标，每 3 帧检测一次，id 不变也不互换
+static void TestSkippedFrames() {
+  TrackerConfig_t config;
+  ObjectTrackerDefaultConfig(&config);
+  config.detect_interval = 3;
+  ObjectTracker_t *tracker = ObjectTrackerCreate(&config);
+  TrackerTrack_t tracks[kMaxTracks];
+  TrackerBox_t boxes[2];
+  int first_id = 0, second_id = 0;
+
+  for (int frame = 0; frame < 60; frame++) {
+    float left = 100 + frame * 3.f;
+    float right = 500 - frame * 3.f;
+    if (ObjectTrackerShouldDetect(tracker)) {
+      CHECK(frame % 3 == 0);
+      // 检测结果的顺序每次都变，关联不能依赖顺序
+      int a = (frame / 3) % 2;
+      boxes[a] = MakeBox(left, 100, 40, 80, 0.9f, 0);
+      boxes[1 - a] = MakeBox(right, 300, 40, 80, 0.9f, 0);
+      CHECK(ObjectTrackerUpdate(tracker, boxes, 2) == 0);
+    } else {
+      CHECK(frame % 3 != 0);
+      CHECK(ObjectTrackerPredict(tracker) == 0);
+    }
+
+    int num = ObjectTrackerGetTracks(tracker, tracks, kMaxTracks);
+    CHECK(num == 2);
+    if (frame == 0) {
+      first_id = (CenterY(tracks[0]) < 200) ? tracks[0].track_id
+                                            : tracks[1].track_id;
+      second_id = (first_id == tracks[0].track_id) ? tracks[1].track_id
+                                                   : tracks[0].track_id;
+      CHECK(first_id != second_id);
+    }
+    const TrackerTrack_t *first = FindTrack(tracks, num, first_id);
+    const TrackerTrack_t *second = FindTrack(tracks, num, second_id);
+    CHECK(first != nullptr && second != nullptr);
+    CHECK(CenterY(*first) < 200 && CenterY(*second) > 200);
+    CHECK(first->predicted == (frame % 3 != 0));
+    // 学到速度之后，预测帧的框也跟着目标走
+    if (frame >= 30) {
+      CHECK(std::fabs(CenterX(*first) - left) < 3.f);
+      CHECK(std::fabs(CenterX(*second) - right) < 3.f);
+    }
+  }
+
+  ObjectTrackerDestroy(tracker);
+  printf("skipped frames: ok\n");
+}
+
+static int DetectSequence(ObjectTracker_t *tracker, float speed, int frames,
+                          float *cx) {
+  int detects = 0;
+  for (int frame = 0; frame < frames; frame++, *cx += speed) {
+    if (ObjectTrackerShouldDetect(tracker)) {
+      TrackerBox_t box = MakeBox(*cx, 200, 50, 100, 0.9f, 0);
+      CHECK(ObjectTrackerUpdate(tracker, &box, 1) == 0);
+      detects++;
+    } else {
+      CHECK(ObjectTrackerPredict(tracker) == 0);
+    }
+  }
+  return detects;
+}
+
+// 自适应间隔：静止目标按 max_detect_interval 检测，快速目标每帧检测
+static void TestAdaptiveInterval() {
+  TrackerConfig_t config;
+  ObjectTrackerDefaultConfig(&config);
+  config.detect_interval = 0;
+  config.max_detect_interval = 3;
+  config.motion_threshold = 0.05f;
+  float cx = 100;
+
+  ObjectTracker_t *tracker = ObjectTrackerCreate(&config);
+  CHECK(ObjectTrackerShouldDetect(tracker) == 1);
+  // 没有轨迹时也按最大间隔
+  CHECK(ObjectTrackerUpdate(tracker, nullptr, 0) == 0);
+  CHECK(ObjectTrackerShouldDetect(tracker) == 0);
+  CHECK(ObjectTrackerPredict(tracker) == 0);
+  CHECK(ObjectTrackerShouldDetect(tracker) == 0);
+  CHECK(ObjectTrackerPredict(tracker) == 0);
+  CHECK(ObjectTrackerShouldDetect(tracker) == 1);
+  ObjectTrackerDestroy(tracker);
+
+  tracker = ObjectTrackerCreate(&config);
+  CHECK(DetectSequence(tracker, 0, 30, &cx) == 10);
+  ObjectTrackerDestroy(tracker);
+
+  // 每帧移动 0.1 个框高，超过 motion_threshold：学到速度后每帧都检测
+  tracker = ObjectTrackerCreate(&config);
+  cx = 100;
+  DetectSequence(tracker, 10, 30, &cx);
+  CHECK(DetectSequence(tracker, 10, 30, &cx) == 30);
+  ObjectTrackerDestroy(tracker);
+
+  // 每帧移动 0.02 个框高，间隔 min(3, 0.05 / 0.02) = 2
+  tracker = ObjectTrackerCreate(&config);
+  cx = 100;
+  DetectSequence(tracker, 2, 30, &cx);
+  CHECK(DetectSequence(tracker, 2, 30, &cx) == 15);
+  ObjectTrackerDestroy(tracker);
+
+  // 固定间隔时不看运动速度
+  config.detect_interval = 2;
+  tracker = ObjectTrackerCreate(&config);
+  cx = 100;
+  CHECK(DetectSequence(tracker, 10, 30, &cx) == 15);
+  ObjectTrackerDestroy(tracker);
+
+  printf("adaptive interval: ok\n");
+}
+
+// 字符串和 Yolov5Emit / Yolov8Emit 的输出格式一致，包括 "xxx_result": 前缀、
+// std::fixed 之后 6 位小数的得分，以及分割模型附带的 mask
+static void TestParseResult() {
+  TrackerBox_t boxes[4];
+  const char *yolov5 =
+      "\"yolov5_result\": ["
+      "{\"bbox\":[12.500000,20.000000,110.250000,220.000000],"
+      "\"score\":0.912345,\"id\":0,\"name\":\"person\"},"
+      "{\"bbox\":[300.000000,40.000000,420.000000,160.000000],"
+      "\"score\":0.305000,\"id\":2,\"name\":\"car\"},"
+      "{\"bbox\":[-3.000000,0.000000,30.000000,60.000000],"
+      "\"score\":0.150000,\"id\":16,\"name\":\"dog\"}]";
+  CHECK(ObjectTrackerParseResult(yolov5, boxes, 4) == 3);
+  CHECK(boxes[0].xmin == 12.5f && boxes[0].ymin == 20.f);
+  CHECK(boxes[0].xmax == 110.25f && boxes[0].ymax == 220.f);
+  CHECK(std::fabs(boxes[0].score - 0.912345f) < 1e-6f && boxes[0].id == 0);
+  CHECK(boxes[1].xmin == 300.f && boxes[1].ymax == 160.f);
+  CHECK(std::fabs(boxes[1].score - 0.305f) < 1e-6f && boxes[1].id == 2);
+  CHECK(boxes[2].xmin == -3.f && boxes[2].id == 16);
+
+  // 只写入 max_num 个，返回总数
+  CHECK(ObjectTrackerParseResult(yolov5, boxes, 1) == 3);
+  CHECK(ObjectTrackerParseResult(yolov5, nullptr, 0) == 3);
+
+  const char *yolov8_seg =
+      "\"yolov8_seg_result\": ["
+      "{\"bbox\":[10.000000,20.000000,50.000000,80.000000],"
+      "\"score\":0.800000,\"id\":3,\"name\":\"motorcycle\","
+      "\"mask\":{\"rect\":[10.000000,20.000000,50.000000,80.000000],"
+      "\"size\":[40,60],\"rle\":[5,10,2400]}},"
+      "{\"bbox\":[60.000000,20.000000,90.000000,80.000000],"
+      "\"score\":0.700000,\"id\":5,\"name\":\"bus\","
+      "\"mask\":{\"rect\":[60.000000,20.000000,90.000000,80.000000],"
+      "\"size\":[30,60],\"rle\":[1800]}}]";
+  CHECK(ObjectTrackerParseResult(yolov8_seg, boxes, 4) == 2);
+  CHECK(boxes[0].xmax == 50.f && boxes[0].id == 3);
+  CHECK(boxes[1].xmin == 60.f && boxes[1].id == 5);
+  CHECK(std::fabs(boxes[1].score - 0.7f) < 1e-6f);
+
+  CHECK(ObjectTrackerParseResult("\"yolov5_result\": []", boxes, 4) == 0);
+  CHECK(ObjectTrackerParseResult(nullptr, boxes, 4) == 0);
+  // 缺少 score 的目标
+  CHECK(ObjectTrackerParseResult(
+            "[{\"bbox\":[1,2,3,4],\"id\":0},{\"bbox\":[1,2,3,4],"
+            "\"score\":0.5,\"id\":0}]",
+            boxes, 4) == -1);
+
+  // 解析结果直接送给 tracker
+  ObjectTracker_t *tracker = ObjectTrackerCreate(nullptr);
+  TrackerTrack_t tracks[kMaxTracks];
+  int num = ObjectTrackerParseResult(yolov5, boxes, 4);
+  CHECK(ObjectTrackerUpdate(tracker, boxes, num) == 0);
+  // 低于 new_track_threshold 的检测不新建轨迹
+  CHECK(ObjectTrackerGetTracks(tracker, tracks, kMaxTracks) == 1);
+  CHECK(tracks[0].class_id == 0);
+  ObjectTrackerDestroy(tracker);
+
+  printf("parse result: ok\n");
+}
+
+int main() {
+  TestKalman();
+  TestAssociation();
+  TestSkippedFrames();
+  TestAdaptiveInterval();
+  TestParseResult();
+  printf("object_tracker_test passed\n");
+  return 0;
+}
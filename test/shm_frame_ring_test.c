@@ -0,0 +1,288 @@
+/***************************************************************************
+ * COPYRIGHT NOTICE
+ * Copyright 2024 D-Robotics, Inc.
+ * All rights reserved.
+ ***************************************************************************/
+/*
+ * shm_frame_ring 的主机测试，只依赖 POSIX：
+ * 1. 写者进程连续发布 200k 帧，读者校验每一帧的内容都属于同一个 frame_seq（seqlock），
+ *    frame_seq 单调递增，写者关闭前的最后一帧一定能读到
+ * 2. 写者被 SIGKILL 后读者返回 CLOSED；同名对象被重启的写者替换（旧写者还活着）时
+ *    读者也返回 CLOSED，重新 open 后读到新写者的帧
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+
+#include "shm_frame_ring.h"
+
+#define TEST_STRESS_FRAMES 200000
+#define TEST_STRESS_SLOTS 2
+#define TEST_STRESS_SLOT_SIZE (16 * 1024)
+#define TEST_RESTART_SLOT_SIZE 1024
+#define TEST_WAIT_MS 5000
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            exit(1); \
+        } \
+    } while (0)
+
+static char s_name[64];
+
+static int64_t now_ms(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (int64_t)ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+// 每个 32 位字都由 frame_seq 和下标决定，读到两帧混在一起时校验必然失败
+static uint32_t frame_word(uint64_t frame_seq, uint32_t index)
+{
+    return (uint32_t)(frame_seq * 2654435761u) ^ (index * 40503u);
+}
+
+static void fill_frame(uint8_t *data, uint32_t size, uint64_t frame_seq)
+{
+    uint32_t *words = (uint32_t *)data;
+    uint32_t i = 0;
+
+    for (i = 0; i < size / 4; i++)
+        words[i] = frame_word(frame_seq, i);
+}
+
+static int32_t check_frame(const uint8_t *data, uint32_t size, uint64_t frame_seq)
+{
+    const uint32_t *words = (const uint32_t *)data;
+    uint32_t i = 0;
+
+    for (i = 0; i < size / 4; i++) {
+        if (words[i] != frame_word(frame_seq, i))
+            return -1;
+    }
+    return 0;
+}
+
+static shm_frame_ring_t *open_ring(void)
+{
+    shm_frame_ring_t *ring = NULL;
+    int64_t deadline = now_ms() + TEST_WAIT_MS;
+
+    while ((ring = shm_frame_ring_open(s_name)) == NULL) {
+        CHECK(now_ms() < deadline);
+        usleep(1000);
+    }
+    return ring;
+}
+
+static void stress_producer(int32_t start_fd)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_meta_t meta;
+    uint8_t *data = NULL;
+    uint32_t capacity = 0;
+    uint64_t seq = 0;
+    char c = 0;
+
+    ring = shm_frame_ring_create(s_name, TEST_STRESS_SLOTS, TEST_STRESS_SLOT_SIZE);
+    if (ring == NULL)
+        _exit(1);
+    // 等读者挂载之后再开始发布，保证读写真正并发
+    if (read(start_fd, &c, 1) != 1)
+        _exit(1);
+
+    memset(&meta, 0, sizeof(meta));
+    meta.format = SHM_FRAME_FMT_RAW;
+    for (seq = 1; seq <= TEST_STRESS_FRAMES; seq++) {
+        data = shm_frame_ring_begin(ring, &capacity);
+        if (data == NULL || capacity < TEST_STRESS_SLOT_SIZE)
+            _exit(1);
+        fill_frame(data, TEST_STRESS_SLOT_SIZE, seq);
+        meta.frame_id = (int64_t)seq;
+        meta.data_size = TEST_STRESS_SLOT_SIZE;
+        if (shm_frame_ring_commit(ring, &meta) != 0)
+            _exit(1);
+    }
+    shm_frame_ring_close(ring);
+    _exit(0);
+}
+
+static void test_stress(void)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_meta_t meta;
+    uint8_t *buf = NULL;
+    uint64_t last_seq = 0, prev_seq = 0, frames = 0;
+    int32_t fds[2], ret = 0, status = 0;
+    pid_t pid = 0;
+
+    CHECK(pipe(fds) == 0);
+    pid = fork();
+    CHECK(pid >= 0);
+    if (pid == 0) {
+        close(fds[1]);
+        stress_producer(fds[0]);
+    }
+    close(fds[0]);
+
+    ring = open_ring();
+    buf = (uint8_t *)malloc(ring->header->slot_size);
+    CHECK(buf != NULL);
+    CHECK(write(fds[1], "s", 1) == 1);
+
+    // 不等待地轮询，读者和写者尽量同时访问同一个槽位
+    while (1) {
+        ret = shm_frame_ring_read(ring, &last_seq, &meta, buf, ring->header->slot_size, 0);
+        if (ret == SHM_FRAME_RING_CLOSED)
+            break;
+        if (ret == SHM_FRAME_RING_NO_FRAME)
+            continue;
+        CHECK(ret == SHM_FRAME_RING_NEW_FRAME);
+        CHECK(meta.frame_seq == last_seq);
+        CHECK(meta.frame_seq > prev_seq);
+        CHECK((uint64_t)meta.frame_id == meta.frame_seq);
+        CHECK(meta.data_size == TEST_STRESS_SLOT_SIZE);
+        CHECK(check_frame(buf, meta.data_size, meta.frame_seq) == 0);
+        prev_seq = meta.frame_seq;
+        frames++;
+    }
+    CHECK(last_seq == TEST_STRESS_FRAMES);
+
+    CHECK(waitpid(pid, &status, 0) == pid);
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+    printf("stress: read %llu of %d frames\n", (unsigned long long)frames, TEST_STRESS_FRAMES);
+
+    shm_frame_ring_close(ring);
+    free(buf);
+    close(fds[1]);
+}
+
+// 帧内容的第一个字节记录写者编号；frame_limit 为 0 时一直发布直到被杀死，否则发布完后挂起
+static pid_t spawn_producer(uint8_t tag, uint64_t frame_limit)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_meta_t meta;
+    const uint8_t *planes[SHM_FRAME_MAX_PLANES] = {&tag};
+    uint64_t seq = 0;
+    pid_t pid = fork();
+
+    CHECK(pid >= 0);
+    if (pid > 0)
+        return pid;
+
+    ring = shm_frame_ring_create(s_name, 4, TEST_RESTART_SLOT_SIZE);
+    if (ring == NULL)
+        _exit(1);
+    memset(&meta, 0, sizeof(meta));
+    meta.plane_count = 1;
+    meta.plane_size[0] = 1;
+    for (seq = 1; frame_limit == 0 || seq <= frame_limit; seq++) {
+        if (shm_frame_ring_publish(ring, &meta, planes) != 0)
+            _exit(1);
+        usleep(1000);
+    }
+    while (1)
+        pause();
+}
+
+// 读到 tag 写者发布的一帧，期间遇到旧写者留下的对象时重新 open
+static shm_frame_ring_t *attach_producer(uint8_t tag, uint8_t *buf, uint64_t *last_seq)
+{
+    shm_frame_ring_t *ring = NULL;
+    shm_frame_meta_t meta;
+    int64_t deadline = now_ms() + TEST_WAIT_MS;
+    int32_t ret = 0;
+
+    while (1) {
+        CHECK(now_ms() < deadline);
+        if (ring == NULL) {
+            ring = open_ring();
+            *last_seq = 0;
+        }
+        ret = shm_frame_ring_read(ring, last_seq, &meta, buf, TEST_RESTART_SLOT_SIZE, 100);
+        CHECK(ret != SHM_FRAME_RING_ERROR);
+        if (ret == SHM_FRAME_RING_NEW_FRAME && buf[0] == tag)
+            return ring;
+        if (ret == SHM_FRAME_RING_CLOSED) {
+            shm_frame_ring_close(ring);
+            ring = NULL;
+        }
+    }
+}
+
+// 读完剩下的帧，直到读者发现写者不在了
+static void wait_closed(shm_frame_ring_t *ring, uint8_t *buf, uint64_t *last_seq)
+{
+    shm_frame_meta_t meta;
+    int64_t deadline = now_ms() + TEST_WAIT_MS;
+    int32_t ret = 0;
+
+    while ((ret = shm_frame_ring_read(ring, last_seq, &meta, buf, TEST_RESTART_SLOT_SIZE,
+        100)) != SHM_FRAME_RING_CLOSED) {
+        CHECK(ret != SHM_FRAME_RING_ERROR);
+        CHECK(now_ms() < deadline);
+    }
+}
+
+static void test_restart(void)
+{
+    shm_frame_ring_t *ring = NULL;
+    uint8_t buf[TEST_RESTART_SLOT_SIZE];
+    uint64_t last_seq = 0, session = 0;
+    pid_t first = 0, second = 0, third = 0;
+
+    // 写者崩溃：不会设置 closed，也不会删除共享内存
+    first = spawn_producer(1, 0);
+    ring = attach_producer(1, buf, &last_seq);
+    CHECK(kill(first, SIGKILL) == 0);
+    CHECK(waitpid(first, NULL, 0) == first);
+    wait_closed(ring, buf, &last_seq);
+    CHECK(ring->header->closed == 0);
+    session = ring->session;
+    shm_frame_ring_close(ring);
+
+    // 重启的写者替换同名对象，读者重新挂载到新的会话
+    second = spawn_producer(2, 10);
+    ring = attach_producer(2, buf, &last_seq);
+    CHECK(ring->session != session);
+    printf("restart: reattached after producer crash\n");
+
+    // 旧写者还活着但对象已经被新写者替换
+    usleep(100 * 1000);
+    third = spawn_producer(3, 0);
+    wait_closed(ring, buf, &last_seq);
+    CHECK(kill(second, 0) == 0);
+    session = ring->session;
+    shm_frame_ring_close(ring);
+
+    ring = attach_producer(3, buf, &last_seq);
+    CHECK(ring->session != session);
+    printf("restart: reattached after producer replaced\n");
+    shm_frame_ring_close(ring);
+
+    kill(second, SIGKILL);
+    kill(third, SIGKILL);
+    waitpid(second, NULL, 0);
+    waitpid(third, NULL, 0);
+}
+
+int main(void)
+{
+    snprintf(s_name, sizeof(s_name), "/shm_frame_ring_test_%d", (int)getpid());
+
+    test_stress();
+    test_restart();
+    shm_unlink(s_name);
+
+    printf("shm_frame_ring_test passed\n");
+    return 0;
+}